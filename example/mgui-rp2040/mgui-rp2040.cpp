@@ -1,7 +1,14 @@
-#include "ssd1306.h"
+#include <stdio.h>
+#include "pico_display_bus.h"
 #include "../../mGUI/mgui.h"
+#include "../../mGUI/mgui_memory_report.h"
+#include "../../mGUI/mgui_pipeline.h"
+#include "../../mGUI/mgui_telemetry.h"
 #include "../../test/font_16x8.h"
 #include "pico/stdlib.h"
+#include "pico/binary_info.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
 #include "hardware/pio.h"
 #include "hardware/timer.h"
 
@@ -9,10 +16,34 @@
 
 #define BUTTON_GPIO 15
 
+// I2C0 on GPIO20 (SDA) and GPIO21 (SCL)
+#define I2C_PORT i2c0
+#define I2C_SDA 20
+#define I2C_SCL 21
+
+// 400 kHz is usual, but the SSD1306 often works at 1 MHz.
+#define DISPLAY_I2C_CLK 1000
+
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+
 // Base pin to connect the A phase of the encoder.
 // The B phase must be connected to the next pin
 #define ENCODER_FIRST_GPIO 18
 
+// The display is dimmed, then turned off, after a time without input.
+#define IDLE_DIM_MS 10000
+#define IDLE_OFF_MS 60000
+
+// Input poll period while nothing moves on the screen
+#define IDLE_POLL_MS 20
+
+// Time of update_lcd(); moving texts wait for a frame with time left
+#define FRAME_BUDGET_US 33000
+
+// 1: core 0 draws the frames and core 1 sends them (the display is not dimmed)
+#define DUAL_CORE 0
+
 const uint sm = 0;
 
 const unsigned char TEST_IMAGE[] = {
@@ -64,42 +95,62 @@ static void update_selection(mgui_ui_group* group, int delta) {
     group->set_on_select_next(delta > 0);
 }
 
-static void read_button(mgui_input_state* result) {
-    result->type = mgui_input_type::Single;
-    result->value_1 = !gpio_get(BUTTON_GPIO);
-}
+// layout of the input states passed to the handlers
+enum input_channel { INPUT_BUTTON, INPUT_ENCODER, INPUT_CHANNELS };
 
-static void read_encoder(mgui_input_state* result) {
-    result->type = mgui_input_type::Single;
+static const mgui_input_channel INPUT_TABLE[INPUT_CHANNELS] = {
+    { "button", mgui_input_type::Buttons },
+    { "encoder", mgui_input_type::Encoder },
+};
+
+static void read_inputs(mgui_input_state result[], int) {
+    // all the switches from one read of the GPIO register
+    const uint32_t pins = gpio_get_all();
+    result[INPUT_BUTTON].value_1 = (pins & (1u << BUTTON_GPIO)) == 0 ? 1 : 0;
 
     // set delta
-    result->value_1 = update_quadrature_encoder(pio0);
+    result[INPUT_ENCODER].value_1 = update_quadrature_encoder(pio0);
+}
+
+static mgui_pipeline<mgui_multi>* core1_pipeline = nullptr;
+
+static void core1_transmit() {
+    while (true) {
+        if (!core1_pipeline->transmit()) {
+            __wfe();
+        }
+    }
 }
 
-static void clear(SSD1306* disp) {
-    mgui gui(SSD1306_WIDTH, SSD1306_HEIGHT);
-    disp->render(gui.lcd());
+static void clear(mgui_display* disp, mgui_async_bus* bus) {
+    mgui gui(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    disp->transfer(gui.lcd());
+
+    // the buffer is sent by DMA
+    bus->wait();
 }
 
-static void splash(SSD1306* disp) {
-    mgui gui(SSD1306_WIDTH, SSD1306_HEIGHT);
+static void splash(mgui_display* disp, mgui_async_bus* bus) {
+    mgui gui(DISPLAY_WIDTH, DISPLAY_HEIGHT);
     font_16x8 font;
     mgui_text text(&font, "mGUI Test", 16, 24);
 
     // show splash
     gui.add((mgui_object*)&text);
     gui.update_lcd();
-    disp->render(gui.lcd());
+    disp->transfer(gui.lcd());
+    bus->wait();
     sleep_ms(5000);
 
     // clear display
     gui.clear();
     gui.update_lcd();
-    disp->render(gui.lcd());
+    disp->transfer(gui.lcd());
+    bus->wait();
 }
 
 mgui test_circle() {
-    mgui gui(SSD1306_WIDTH, SSD1306_HEIGHT);
+    mgui gui(DISPLAY_WIDTH, DISPLAY_HEIGHT);
     mgui_circle Circle;
     Circle.set_x(20);
     Circle.set_y(20);
@@ -114,29 +165,29 @@ static void menu_item_handler(const mgui_menu_item* sender, const mgui_input_sta
 }
 
 static void menu_handler(mgui_menu* sender, const mgui_input_state state[], mgui_string *current_group) {
-    sender->set_on_enter(state[0].value_1);
+    sender->set_on_enter(state[INPUT_BUTTON].value_1);
 
-    int delta = state[1].value_1;
+    int delta = state[INPUT_ENCODER].value_1;
     sender->set_on_select_prev(delta < 0);
     sender->set_on_select_next(delta > 0);
 }
 
 static void scroll_handler(mgui_vertical_scrollbar* sender, const mgui_input_state state[], mgui_string *current_group) {
-    int delta = state[1].value_1;
+    int delta = state[INPUT_ENCODER].value_1;
     sender->set_on_select_prev(delta < 0);
     sender->set_on_select_next(delta > 0);
 }
 
 static void menu_return_handler(const mgui_menu_item* sender, const mgui_input_state state[], mgui_string *current_group) {
-    static int button_state = state[0].value_1;
+    static int button_state = state[INPUT_BUTTON].value_1;
     
     // 0 -> 1 edge
-    if(button_state < state[0].value_1){
+    if(button_state < state[INPUT_BUTTON].value_1){
         // change gui group
         *current_group = "main";
     }
 
-    button_state = state[0].value_1;
+    button_state = state[INPUT_BUTTON].value_1;
 }
 
 static void test_menu(mgui_multi *gui) {
@@ -153,7 +204,7 @@ static void test_menu(mgui_multi *gui) {
     static mgui_text text3(&font, "Menu");
     static mgui_menu_item item3(&text3);
 
-    static mgui_menu item_menu3(SSD1306_WIDTH, SSD1306_HEIGHT);
+    static mgui_menu item_menu3(DISPLAY_WIDTH, DISPLAY_HEIGHT);
 
     static mgui_text text3_1(&font, "Back");
     static mgui_menu_item item3_1(&text3_1);
@@ -190,7 +241,7 @@ static void test_menu(mgui_multi *gui) {
     item8.set_text(&text8);
     item8.set_input_event_handler(&menu_return_handler);
 
-    static mgui_menu menu(SSD1306_WIDTH - 16, SSD1306_HEIGHT);
+    static mgui_menu menu(DISPLAY_WIDTH - 16, DISPLAY_HEIGHT);
     menu.set_input_event_handler(&menu_handler);
     menu.add(&item);
     menu.add(&item2);
@@ -203,7 +254,7 @@ static void test_menu(mgui_multi *gui) {
 
     gui->add("menu", (mgui_object*)&menu);
 
-    static mgui_vertical_scrollbar scroll(SSD1306_WIDTH - 16 + 1, 0, 14, SSD1306_HEIGHT, menu.menu_item_count());
+    static mgui_vertical_scrollbar scroll(DISPLAY_WIDTH - 16 + 1, 0, 14, DISPLAY_HEIGHT, menu.menu_item_count());
     scroll.set_input_event_handler(&scroll_handler);
     gui->add("menu", (mgui_object*)&scroll);
 }
@@ -216,7 +267,7 @@ static void test_text(mgui_multi *gui) {
     item8.set_text(&text8);
     item8.set_input_event_handler(&menu_return_handler);
 
-    static mgui_menu menu(SSD1306_WIDTH, SSD1306_HEIGHT);
+    static mgui_menu menu(DISPLAY_WIDTH, DISPLAY_HEIGHT);
     menu.set_input_event_handler(&menu_handler);
     menu.add(&item8);
 
@@ -226,7 +277,7 @@ static void test_text(mgui_multi *gui) {
     long_text.set_x(0);
     long_text.set_y(16);
     long_text.set_view_height(font.height());
-    long_text.set_view_width(SSD1306_WIDTH);
+    long_text.set_view_width(DISPLAY_WIDTH);
     long_text.set_move(true, 2);
     gui->add("text", (mgui_object*)&long_text);
 
@@ -234,53 +285,53 @@ static void test_text(mgui_multi *gui) {
     long_text2.set_x(32);
     long_text2.set_y(32);
     long_text2.set_view_height(font.height());
-    long_text2.set_view_width(SSD1306_WIDTH / 2);
+    long_text2.set_view_width(DISPLAY_WIDTH / 2);
     long_text2.set_move(true);
     gui->add("text", (mgui_object*)&long_text2);
 }
 
 static void button_group_handler(mgui_ui_group* sender, const mgui_input_state state[], mgui_string* current_group){
-    sender->set_on_press(state[0].value_1);
+    sender->set_on_press(state[INPUT_BUTTON].value_1);
 
-    int delta = state[1].value_1;
+    int delta = state[INPUT_ENCODER].value_1;
     sender->set_on_select_prev(delta < 0);
     sender->set_on_select_next(delta > 0);
 }
 
 static void move_to_test_menu(const mgui_button* sender, const mgui_input_state state[], mgui_string* current_group){
-    static int button_state = state[0].value_1;
+    static int button_state = state[INPUT_BUTTON].value_1;
     
     // 0 -> 1 edge
-    if(button_state < state[0].value_1){
+    if(button_state < state[INPUT_BUTTON].value_1){
         // change gui group
         *current_group = "menu";
     }
 
-    button_state = state[0].value_1;
+    button_state = state[INPUT_BUTTON].value_1;
 }
 
 static void move_to_test_text(const mgui_button* sender, const mgui_input_state state[], mgui_string* current_group){
-    static int button_state = state[0].value_1;
+    static int button_state = state[INPUT_BUTTON].value_1;
     
     // 0 -> 1 edge
-    if(button_state < state[0].value_1){
+    if(button_state < state[INPUT_BUTTON].value_1){
         // change gui group
         *current_group = "text";
     }
 
-    button_state = state[0].value_1;
+    button_state = state[INPUT_BUTTON].value_1;
 }
 
 static void move_to_test_image(const mgui_button* sender, const mgui_input_state state[], mgui_string* current_group) {
-    static int button_state = state[0].value_1;
+    static int button_state = state[INPUT_BUTTON].value_1;
 
     // 0 -> 1 edge
-    if (button_state < state[0].value_1) {
+    if (button_state < state[INPUT_BUTTON].value_1) {
         // change gui group
         *current_group = "image";
     }
 
-    button_state = state[0].value_1;
+    button_state = state[INPUT_BUTTON].value_1;
 }
 
 static void test_image(mgui_multi* gui) {
@@ -291,7 +342,7 @@ static void test_image(mgui_multi* gui) {
     item8.set_text(&text8);
     item8.set_input_event_handler(&menu_return_handler);
 
-    static mgui_menu menu(SSD1306_WIDTH, SSD1306_HEIGHT);
+    static mgui_menu menu(DISPLAY_WIDTH, DISPLAY_HEIGHT);
     menu.set_input_event_handler(&menu_handler);
     menu.add(&item8);
 
@@ -301,7 +352,7 @@ static void test_image(mgui_multi* gui) {
     long_text.set_x(0);
     long_text.set_y(16);
     long_text.set_view_height(font.height());
-    long_text.set_view_width(SSD1306_WIDTH);
+    long_text.set_view_width(DISPLAY_WIDTH);
     long_text.set_move(true, 2);
 
     static mgui_image_property image_prop(32,32, TEST_IMAGE);
@@ -351,19 +402,35 @@ int main()
 
     button_gpio_init();
 
-    SSD1306 disp(SSD1306_WIDTH, SSD1306_NUM_PAGES);
+    // useful information for picotool
+    bi_decl(bi_2pins_with_func(I2C_SDA, I2C_SCL, GPIO_FUNC_I2C));
+    bi_decl(bi_program_description("mGUI example for the Raspberry Pi Pico"));
+
+    // I2C is "open drain", pull ups to keep signal high when no data is being sent
+    i2c_init(I2C_PORT, DISPLAY_I2C_CLK * 1000);
+    gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
+    gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
+    gpio_pull_up(I2C_SDA);
+    gpio_pull_up(I2C_SCL);
+
+    // The frame is sent by DMA while the next one is drawn.
+    // Use pico_i2c_bus for blocking transfers, and mgui_sh1106 or
+    // mgui_st7565 (with pico_spi_dma_transport) for other controllers.
+    pico_i2c_dma_transport transport(I2C_PORT);
+    mgui_async_bus bus(&transport);
+    mgui_ssd1306 disp(DISPLAY_WIDTH, DISPLAY_HEIGHT, &bus);
+    disp.init();
 
     // clear screen
-    clear(&disp);
+    clear(&disp, &bus);
 
     // show splash
-    splash(&disp);
+    splash(&disp, &bus);
 
-    mgui_multi gui(SSD1306_WIDTH, SSD1306_HEIGHT);
+    mgui_multi gui(DISPLAY_WIDTH, DISPLAY_HEIGHT);
 
     // register input
-    gui.input()->add(&read_button); // 0
-    gui.input()->add(&read_encoder); // 1
+    gui.input()->set_reader(&read_inputs, INPUT_TABLE, INPUT_CHANNELS);
 
     // register gui views
     test_menu(&gui);
@@ -374,9 +441,72 @@ int main()
     // select registered gui
     gui.select("main");
 
+    // object sizes and heap usage of the screens
+    mgui_print_sizes(stdout);
+    mgui_print_memory(stdout);
+
+    // frame times and input latency, printed to stdio every 1024 frames
+    mgui_telemetry telemetry(&time_us_32);
+    gui.set_frame_listener(&telemetry);
+    char report[1024];
+    uint32_t frames = 0;
+
+    // frames are drawn only on input or animation, and sent only when they changed
+    gui.set_adaptive_refresh(true);
+    gui.set_frame_budget(FRAME_BUDGET_US, &time_us_32);
+
+#if DUAL_CORE
+    // Core 1 owns the bus and sends each frame with blocking transfers,
+    // so a frame takes the longer of drawing and sending instead of both.
+    bus.wait();
+    // the blocking bus must not race with the stop interrupt of the DMA transport
+    transport.stop();
+    pico_i2c_bus blocking_bus(I2C_PORT);
+    mgui_ssd1306 core1_disp(DISPLAY_WIDTH, DISPLAY_HEIGHT, &blocking_bus);
+    mgui_pipeline<mgui_multi> pipeline(&gui, &core1_disp, [] { __wfe(); }, [] { __sev(); });
+    core1_pipeline = &pipeline;
+    multicore_launch_core1(&core1_transmit);
+
+    while (true) {
+        if (!pipeline.render() && !gui.animating() && !gui.input_active()) {
+            sleep_ms(IDLE_POLL_MS);
+        }
+
+        if ((++frames & 1023) == 0 && telemetry.write(report, sizeof(report)) > 0) {
+            fputs(report, stdout);
+        }
+    }
+#endif
+
+    mgui_idle_power power(&disp, &time_us_32);
+    power.set_dim(IDLE_DIM_MS, 0x10);
+    power.set_off(IDLE_OFF_MS);
+    bool sending = false;
+
+    gui.set_double_buffer(true);
     while (true) {
-        disp.render(gui.lcd());
-        gui.update_lcd();
+        // draw frame N + 1 while frame N is on the wire
+        const bool changed = gui.update_lcd();
+        const bool woke = power.update(gui.input_active());
+        const bool send = (changed || woke) && power.on();
+        if (send || sending) {
+            bus.wait();
+            if (sending) {
+                telemetry.end_transfer();
+                sending = false;
+            }
+        }
+        if (send) {
+            telemetry.begin_transfer();
+            disp.transfer(gui.lcd());
+            sending = true;
+        } else if (!gui.animating() && !gui.input_active()) {
+            sleep_ms(IDLE_POLL_MS);
+        }
+
+        if ((++frames & 1023) == 0 && telemetry.write(report, sizeof(report)) > 0) {
+            fputs(report, stdout);
+        }
     }
 
     return 0;
@@ -0,0 +1,343 @@
+/**
+ * @file pico_display_bus.h
+ * @brief I2C and SPI connections of mgui_display for the Raspberry Pi Pico SDK
+ */
+#ifndef PICO_DISPLAY_BUS_H
+#define PICO_DISPLAY_BUS_H
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+#include "../../mGUI/mgui_display.h"
+
+/**
+ * @brief
+ * I2C connection (SSD1306, SH1106).
+ * Each transaction starts with the control byte, so the bytes are copied
+ * to a chunk buffer with the control byte in front.
+ */
+class pico_i2c_bus : public mgui_display_bus {
+public:
+    /**
+     * @param i2c I2C instance initialized by the caller (i2c_init and gpio_set_function)
+     * @param address 7-bit address of the controller
+     */
+    pico_i2c_bus(i2c_inst_t* i2c, uint8_t address = 0x3C) : i2c_(i2c), address_(address) {}
+
+    void command(const uint8_t* commands, int count) {
+        // Co = 0, D/C = 0: all following bytes are commands
+        write(0x00, commands, count);
+    }
+
+    void data(const uint8_t* data, int count) {
+        // Co = 0, D/C = 1: all following bytes are display data
+        write(0x40, data, count);
+    }
+
+private:
+    void write(uint8_t control, const uint8_t* bytes, int count) {
+        while (count > 0) {
+            const int length = (count < CHUNK) ? count : CHUNK;
+            chunk_[0] = control;
+            memcpy(chunk_ + 1, bytes, length);
+            i2c_write_blocking(i2c_, address_, chunk_, length + 1, false);
+            bytes += length;
+            count -= length;
+        }
+    }
+
+    static const int CHUNK = 256;
+
+    i2c_inst_t* i2c_;
+    uint8_t address_;
+    uint8_t chunk_[CHUNK + 1];
+};
+
+/**
+ * @brief
+ * 4-wire SPI connection (SSD1306, SH1106, ST7565) with the D/C and CS pins.
+ */
+class pico_spi_bus : public mgui_display_bus {
+public:
+    /**
+     * @param spi SPI instance initialized by the caller (spi_init and gpio_set_function)
+     * @param dc_pin D/C pin (low: command, high: data)
+     * @param cs_pin Chip select pin (active low)
+     */
+    pico_spi_bus(spi_inst_t* spi, uint dc_pin, uint cs_pin) : spi_(spi), dc_pin_(dc_pin), cs_pin_(cs_pin) {
+        gpio_init(dc_pin_);
+        gpio_set_dir(dc_pin_, GPIO_OUT);
+        gpio_init(cs_pin_);
+        gpio_set_dir(cs_pin_, GPIO_OUT);
+        gpio_put(cs_pin_, 1);
+    }
+
+    void command(const uint8_t* commands, int count) {
+        write(false, commands, count);
+    }
+
+    void data(const uint8_t* data, int count) {
+        write(true, data, count);
+    }
+
+private:
+    void write(bool data, const uint8_t* bytes, int count) {
+        gpio_put(dc_pin_, data);
+        gpio_put(cs_pin_, 0);
+        spi_write_blocking(spi_, bytes, count);
+        gpio_put(cs_pin_, 1);
+    }
+
+    spi_inst_t* spi_;
+    uint dc_pin_;
+    uint cs_pin_;
+};
+
+/**
+ * @brief
+ * SPI transfers by DMA. Use it with mgui_async_bus.
+ * The DMA interrupt (DMA_IRQ_0) finishes a transfer and starts the next one.
+ * Only one instance may exist at a time.
+ */
+class pico_spi_dma_transport : public mgui_transport {
+public:
+    /**
+     * @param spi SPI instance initialized by the caller (spi_init and gpio_set_function)
+     * @param dc_pin D/C pin (low: command, high: data)
+     * @param cs_pin Chip select pin (active low)
+     * @param capacity Maximum number of queued transfers
+     */
+    pico_spi_dma_transport(spi_inst_t* spi, uint dc_pin, uint cs_pin, int capacity = 16)
+     : mgui_transport(capacity), spi_(spi), dc_pin_(dc_pin), cs_pin_(cs_pin) {
+        gpio_init(dc_pin_);
+        gpio_set_dir(dc_pin_, GPIO_OUT);
+        gpio_init(cs_pin_);
+        gpio_set_dir(cs_pin_, GPIO_OUT);
+        gpio_put(cs_pin_, 1);
+
+        channel_ = dma_claim_unused_channel(true);
+        dma_channel_config config = dma_channel_get_default_config(channel_);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, spi_get_dreq(spi_, true));
+        dma_channel_configure(channel_, &config, &spi_get_hw(spi_)->dr, nullptr, 0, false);
+
+        instance() = this;
+        dma_channel_set_irq0_enabled(channel_, true);
+        irq_set_exclusive_handler(DMA_IRQ_0, &irq_handler);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+
+    ~pico_spi_dma_transport() { stop(); }
+
+    /**
+     * @brief
+     * Release the interrupt and the DMA channel, for example before the SPI is used
+     * by a blocking bus. Wait for the transfers first; the transport cannot be used after it.
+     */
+    void stop() {
+        if (channel_ < 0) {
+            return;
+        }
+        irq_set_enabled(DMA_IRQ_0, false);
+        dma_channel_set_irq0_enabled(channel_, false);
+        irq_remove_handler(DMA_IRQ_0, &irq_handler);
+        dma_channel_abort(channel_);
+        dma_channel_unclaim(channel_);
+        channel_ = -1;
+        instance() = nullptr;
+    }
+
+protected:
+    void start(const mgui_transfer* transfer) {
+        gpio_put(dc_pin_, transfer->data);
+        gpio_put(cs_pin_, 0);
+        dma_channel_transfer_from_buffer_now(channel_, transfer->buffer, transfer->length);
+    }
+
+    void lock() { interrupts_ = save_and_disable_interrupts(); }
+    void unlock() { restore_interrupts(interrupts_); }
+    void idle() { tight_loop_contents(); }
+
+private:
+    static pico_spi_dma_transport*& instance() {
+        static pico_spi_dma_transport* value = nullptr;
+        return value;
+    }
+
+    static void irq_handler() {
+        pico_spi_dma_transport* self = instance();
+        dma_channel_acknowledge_irq0(self->channel_);
+
+        // the DMA is done when the last byte enters the FIFO, so wait for the wire
+        // before the D/C pin is changed by the next transfer
+        while (spi_is_busy(self->spi_)) {
+            tight_loop_contents();
+        }
+        gpio_put(self->cs_pin_, 1);
+
+        // discard the received bytes and the overrun
+        while (spi_is_readable(self->spi_)) {
+            (void)spi_get_hw(self->spi_)->dr;
+        }
+        spi_get_hw(self->spi_)->icr = SPI_SSPICR_RORIC_BITS;
+
+        self->complete();
+    }
+
+    spi_inst_t* spi_;
+    uint dc_pin_;
+    uint cs_pin_;
+    int channel_;
+    uint32_t interrupts_;
+};
+
+/**
+ * @brief
+ * I2C transfers by DMA. Use it with mgui_async_bus.
+ *
+ * @remarks
+ * The I2C data register takes a command word per byte, so a transfer is expanded
+ * with the control byte and the stop bit into a word buffer a chunk at a time.
+ * The stop interrupt of the I2C sends the next chunk or finishes the transfer.
+ * When the controller does not acknowledge (for example a panel which is not
+ * connected), the abort interrupt drops the rest of the transfer and the stop finishes it.
+ * Only one instance may exist at a time.
+ */
+class pico_i2c_dma_transport : public mgui_transport {
+public:
+    /**
+     * @param i2c I2C instance initialized by the caller (i2c_init and gpio_set_function)
+     * @param address 7-bit address of the controller
+     * @param capacity Maximum number of queued transfers
+     */
+    pico_i2c_dma_transport(i2c_inst_t* i2c, uint8_t address = 0x3C, int capacity = 16)
+     : mgui_transport(capacity), i2c_(i2c) {
+        i2c_hw_t* hw = i2c_get_hw(i2c_);
+        hw->enable = 0;
+        hw->tar = address;
+        hw->enable = 1;
+
+        channel_ = dma_claim_unused_channel(true);
+        dma_channel_config config = dma_channel_get_default_config(channel_);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, i2c_get_dreq(i2c_, true));
+        dma_channel_configure(channel_, &config, &hw->data_cmd, nullptr, 0, false);
+
+        instance() = this;
+        current_ = nullptr;
+        aborts_ = 0;
+        hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+        irq_set_exclusive_handler(irq(), &irq_handler);
+        irq_set_enabled(irq(), true);
+    }
+
+    ~pico_i2c_dma_transport() { stop(); }
+
+    /**
+     * @brief
+     * Release the interrupt and the DMA channel, for example before the I2C is used
+     * by a blocking bus. Wait for the transfers first; the transport cannot be used after it.
+     */
+    void stop() {
+        if (channel_ < 0) {
+            return;
+        }
+        irq_set_enabled(irq(), false);
+        i2c_get_hw(i2c_)->intr_mask = 0;
+        irq_remove_handler(irq(), &irq_handler);
+        dma_channel_abort(channel_);
+        dma_channel_unclaim(channel_);
+        channel_ = -1;
+        instance() = nullptr;
+    }
+
+    /**
+     * @brief Number of transfers dropped because the controller did not acknowledge.
+     */
+    uint32_t aborts() const { return aborts_; }
+
+protected:
+    void start(const mgui_transfer* transfer) {
+        current_ = transfer;
+        offset_ = 0;
+        send_chunk();
+    }
+
+    void lock() { interrupts_ = save_and_disable_interrupts(); }
+    void unlock() { restore_interrupts(interrupts_); }
+    void idle() { tight_loop_contents(); }
+
+private:
+    void send_chunk() {
+        const int remain = current_->length - offset_;
+        const int length = (remain < CHUNK) ? remain : CHUNK;
+        const uint8_t* bytes = current_->buffer + offset_;
+
+        // control byte (Co = 0, D/C), the bytes, and the stop bit on the last one
+        words_[0] = current_->data ? 0x40 : 0x00;
+        for (int i = 0; i < length; i++) {
+            words_[i + 1] = bytes[i];
+        }
+        words_[length] |= I2C_IC_DATA_CMD_STOP_BITS;
+        offset_ += length;
+
+        dma_channel_transfer_from_buffer_now(channel_, words_, length + 1);
+    }
+
+    uint irq() const { return (i2c_hw_index(i2c_) == 0) ? I2C0_IRQ : I2C1_IRQ; }
+
+    static pico_i2c_dma_transport*& instance() {
+        static pico_i2c_dma_transport* value = nullptr;
+        return value;
+    }
+
+    static void irq_handler() {
+        pico_i2c_dma_transport* self = instance();
+        i2c_hw_t* hw = i2c_get_hw(self->i2c_);
+        const uint32_t status = hw->intr_stat;
+
+        if ((status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) != 0) {
+            // no acknowledge: the FIFO is flushed and a stop follows, so drop the rest of the transfer
+            dma_channel_abort(self->channel_);
+            (void)hw->clr_tx_abrt;
+            if (self->current_ != nullptr) {
+                self->offset_ = self->current_->length;
+            }
+            self->aborts_++;
+        }
+        if ((status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) == 0) {
+            return;
+        }
+        (void)hw->clr_stop_det;
+        if (self->current_ == nullptr) {
+            return;
+        }
+
+        if (self->offset_ < self->current_->length) {
+            self->send_chunk();
+            return;
+        }
+        self->current_ = nullptr;
+        self->complete();
+    }
+
+    static const int CHUNK = 256;
+
+    i2c_inst_t* i2c_;
+    int channel_;
+    uint32_t interrupts_;
+    const mgui_transfer* current_;
+    int offset_;
+    volatile uint32_t aborts_;
+    uint32_t words_[CHUNK + 1];
+};
+
+#endif // PICO_DISPLAY_BUS_H
@@ -1,164 +0,0 @@
-/**
- * Copyright (c) 2021 Raspberry Pi (Trading) Ltd.
- *
- * SPDX-License-Identifier: BSD-3-Clause
- */
-
-#include "ssd1306.h"
-
-SSD1306::SSD1306(uint8_t width, uint8_t number_of_page){
-    // useful information for picotool
-    bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
-    bi_decl(bi_program_description("SSD1306 OLED driver I2C example for the Raspberry Pi Pico"));
-
-    printf("Hello, SSD1306 OLED display! Look at my raspberries..\n");
-
-    // I2C is "open drain", pull ups to keep signal high when no data is being
-    // sent
-    i2c_init(I2C_PORT, SSD1306_I2C_CLK * 1000);
-    gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
-    gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(I2C_SDA);
-    gpio_pull_up(I2C_SCL);
-
-    // update rendering area
-    render_area_.start_page = 0;
-    render_area_.end_page = number_of_page - 1;
-    render_area_.start_col = 0;
-    render_area_.end_col = width - 1;
-    calc_render_area_buflen(&render_area_);
-
-    // run through the complete initialization process
-    init();
-
-}
-
-void SSD1306::init() {
-    // Some of these commands are not strictly necessary as the reset
-    // process defaults to some of these but they are shown here
-    // to demonstrate what the initialization sequence looks like
-    // Some configuration values are recommended by the board manufacturer
-
-    uint8_t cmds[] = {
-        SSD1306_SET_DISP,               // set display off
-        /* memory mapping */
-        SSD1306_SET_MEM_MODE,           // set memory address mode 0 = horizontal, 1 = vertical, 2 = page
-        0x00,                           // horizontal addressing mode
-        /* resolution and layout */
-        SSD1306_SET_DISP_START_LINE,    // set display start line to 0
-        SSD1306_SET_SEG_REMAP | 0x01,   // set segment re-map, column address 127 is mapped to SEG0
-        SSD1306_SET_MUX_RATIO,          // set multiplex ratio
-        SSD1306_HEIGHT - 1,             // Display height - 1
-        SSD1306_SET_COM_OUT_DIR | 0x08, // set COM (common) output scan direction. Scan from bottom up, COM[N-1] to COM0
-        SSD1306_SET_DISP_OFFSET,        // set display offset
-        0x00,                           // no offset
-        SSD1306_SET_COM_PIN_CFG,        // set COM (common) pins hardware configuration. Board specific magic number. 
-                                        // 0x02 Works for 128x32, 0x12 Possibly works for 128x64. Other options 0x22, 0x32
-#if ((SSD1306_WIDTH == 128) && (SSD1306_HEIGHT == 32))
-        0x02,                           
-#elif ((SSD1306_WIDTH == 128) && (SSD1306_HEIGHT == 64))
-        0x12,
-#else
-        0x02,
-#endif
-        /* timing and driving scheme */
-        SSD1306_SET_DISP_CLK_DIV,       // set display clock divide ratio
-        0x80,                           // div ratio of 1, standard freq
-        SSD1306_SET_PRECHARGE,          // set pre-charge period
-        0xF1,                           // Vcc internally generated on our board
-        SSD1306_SET_VCOM_DESEL,         // set VCOMH deselect level
-        0x30,                           // 0.83xVcc
-        /* display */
-        SSD1306_SET_CONTRAST,           // set contrast control
-        0xFF,
-        SSD1306_SET_ENTIRE_ON,          // set entire display on to follow RAM content
-        SSD1306_SET_NORM_DISP,           // set normal (not inverted) display
-        SSD1306_SET_CHARGE_PUMP,        // set charge pump
-        0x14,                           // Vcc internally generated on our board
-        SSD1306_SET_SCROLL | 0x00,      // deactivate horizontal scrolling if set. This is necessary as memory writes will corrupt if scrolling was enabled
-        SSD1306_SET_DISP | 0x01, // turn display on
-    };
-
-    SSD1306_send_cmd_list(cmds, count_of(cmds));
-}
-
-void SSD1306::scroll(bool on) {
-    // configure horizontal scrolling
-    uint8_t cmds[] = {
-        SSD1306_SET_HORIZ_SCROLL | 0x00,
-        0x00, // dummy byte
-        0x00, // start page 0
-        0x00, // time interval
-        0x03, // end page 3 SSD1306_NUM_PAGES ??
-        0x00, // dummy byte
-        0xFF, // dummy byte
-        SSD1306_SET_SCROLL | (on ? 0x01 : 0) // Start/stop scrolling
-    };
-
-    SSD1306_send_cmd_list(cmds, count_of(cmds));
-}
-
-void SSD1306::invert_display(bool on)
-{
-    send_cmd(on? SSD1306_SET_INV_DISP : SSD1306_SET_NORM_DISP);
-}
-
-void SSD1306::render(uint8_t *buf) {
-    // update a portion of the display with a render area
-    uint8_t cmds[] = {
-        SSD1306_SET_COL_ADDR,
-        render_area_.start_col,
-        render_area_.end_col,
-        SSD1306_SET_PAGE_ADDR,
-        render_area_.start_page,
-        render_area_.end_page
-    };
-    
-    SSD1306_send_cmd_list(cmds, count_of(cmds));
-    SSD1306_send_buf(buf, render_area_.buflen);
-}
-
-uint8_t SSD1306::reverse(uint8_t b) {
-    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
-    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
-    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
-    return b;
-}
-
-void SSD1306::send_cmd(uint8_t cmd) {
-    // I2C write process expects a control byte followed by data
-    // this "data" can be a command or data to follow up a command
-    // Co = 1, D/C = 0 => the driver expects a command
-    uint8_t buf[2] = {0x80, cmd};
-    i2c_write_blocking(I2C_PORT, (SSD1306_I2C_ADDR & SSD1306_WRITE_MODE), buf, 2, false);
-}
-
-void SSD1306::calc_render_area_buflen(struct render_area *area) {
-    // calculate how long the flattened buffer will be for a render area
-    area->buflen 
-        = (area->end_col - area->start_col + 1)
-            * (area->end_page - area->start_page + 1);
-}
-
-void SSD1306::SSD1306_send_cmd_list(uint8_t *buf, int num) {
-    for (int i=0;i<num;i++)
-        send_cmd(buf[i]);
-}
-
-void SSD1306::SSD1306_send_buf(uint8_t buf[], int buflen) {
-    // in horizontal addressing mode, the column address pointer auto-increments
-    // and then wraps around to the next page, so we can send the entire frame
-    // buffer in one gooooooo!
-
-    // copy our frame buffer into a new buffer because we need to add the control byte
-    // to the beginning
-
-    uint8_t *temp_buf = (uint8_t *) malloc(buflen + 1);
-
-    temp_buf[0] = 0x40;
-    memcpy(temp_buf+1, buf, buflen);
-
-    i2c_write_blocking(I2C_PORT, (SSD1306_I2C_ADDR & SSD1306_WRITE_MODE), temp_buf, buflen + 1, false);
-
-    free(temp_buf);
-}
@@ -11,10 +11,346 @@
 #ifndef MGUI_H
 #define MGUI_H
 
+// SIMD kernels for the host. Define MGUI_NO_SIMD to use only the SWAR kernels.
+#if defined(__SSE2__) && !defined(MGUI_NO_SIMD)
+#include <emmintrin.h>
+#define MGUI_USE_SSE2
+#endif
+#if defined(__AVX2__) && !defined(MGUI_NO_SIMD)
+#include <immintrin.h>
+#define MGUI_USE_AVX2
+#endif
+#if defined(__ARM_NEON) && !defined(MGUI_NO_SIMD)
+#include <arm_neon.h>
+#define MGUI_USE_NEON
+#endif
+
 // typedefs
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
 
+/**
+ * @brief 32-bit word used by the SWAR (SIMD within a register) kernels.
+ */
+typedef unsigned int mgui_word32;
+
+/**
+ * @brief 64-bit word used by the SWAR (SIMD within a register) kernels.
+ */
+typedef unsigned long long mgui_word64;
+
+/**
+ * @brief
+ * Register width used by the SWAR kernels.
+ * 64 on 64-bit hosts, 32 on microcontrollers such as the Cortex-M0+ of rp2040.
+ * It can be overridden by defining it before including this file.
+ */
+#ifndef MGUI_SWAR_BITS
+#if defined(__LP64__) || defined(_WIN64)
+#define MGUI_SWAR_BITS 64
+#else
+#define MGUI_SWAR_BITS 32
+#endif
+#endif
+
+/**
+ * @brief
+ * Trace points of update_lcd(), the objects, the input callbacks and the transfers.
+ * Define MGUI_TRACE to record them with mgui_trace.h on the host;
+ * otherwise they compile to nothing.
+ */
+#ifdef MGUI_TRACE
+#include "mgui_trace.h"
+#else
+#define MGUI_TRACE_SCOPE(category, name)
+#endif
+
+// Instances of mgui may be used on several threads (one thread per instance).
+// Define MGUI_THREADS to synchronize what they share: the memory statistics,
+// the layout serial and the glyph caches of anti-aliased fonts.
+#ifdef MGUI_THREADS
+#include <atomic>
+#include <mutex>
+#endif
+
+/**
+ * @brief Size type of the allocation functions (size_t without the standard headers)
+ */
+typedef decltype(sizeof(0)) mgui_size_t;
+
+/**
+ * @brief Subsystems of the allocations of mgui
+ */
+enum class mgui_memory_tag {
+    /**
+     * @brief Nodes of mgui_list, the lists of mgui_ui_group and their navigation tables
+     */
+    List,
+    /**
+     * @brief Characters of mgui_string
+     */
+    String,
+    /**
+     * @brief Nodes and values of mgui_string_map (the groups of mgui_multi)
+     */
+    StringMap,
+    /**
+     * @brief mgui_text_property and its text
+     */
+    TextProperty,
+    /**
+     * @brief mgui_stack and its nodes (the menu history)
+     */
+    Stack,
+    /**
+     * @brief Frame buffers, mgui_draw and draw lists
+     */
+    Screen,
+    /**
+     * @brief Glyph caches of anti-aliased fonts
+     */
+    Font,
+    /**
+     * @brief Input states and traces
+     */
+    Input,
+    /**
+     * @brief Transfer queues of the display drivers
+     */
+    Transfer
+};
+
+/**
+ * @brief
+ * Source of the memory of mgui. Set it with mgui_memory::set_allocator
+ * to use a pool or an arena instead of new/delete.
+ */
+class mgui_allocator {
+public:
+    virtual ~mgui_allocator() {}
+
+    /**
+     * @return nullptr if there is no memory
+     */
+    virtual void* allocate(long size, mgui_memory_tag tag) = 0;
+
+    /**
+     * @brief Release memory of allocate(). size and tag are those of the allocation.
+     */
+    virtual void deallocate(void* memory, long size, mgui_memory_tag tag) = 0;
+};
+
+/**
+ * @brief Allocation statistics of a subsystem (bytes and calls)
+ */
+struct mgui_memory_stats {
+    long current;
+    long peak;
+    long allocations;
+    long frees;
+};
+
+/**
+ * @brief
+ * Counts the allocations of mgui per subsystem and passes them to the allocator.
+ *
+ * @remarks
+ * The statistics are shared by all instances of mgui. They are synchronized only
+ * when MGUI_THREADS is defined; otherwise allocate from one thread (the GUI thread).
+ * With MGUI_THREADS the allocator is called by one thread at a time.
+ * The allocator must not be changed while memory of it is in use.
+ */
+class mgui_memory {
+public:
+    static const int TAGS = (int)mgui_memory_tag::Transfer + 1;
+
+    /**
+     * @brief Set the allocator (nullptr for new/delete).
+     */
+    static inline void set_allocator(mgui_allocator* allocator) {
+        lock_scope lock;
+        state().allocator = allocator;
+    }
+
+    static inline mgui_allocator* allocator() {
+        lock_scope lock;
+        return state().allocator;
+    }
+
+    static inline void* allocate(long size, mgui_memory_tag tag) {
+        lock_scope lock;
+        state_type& s = state();
+        void* memory = (s.allocator != nullptr) ? s.allocator->allocate(size, tag) : ::operator new(size);
+        if (memory == nullptr) {
+            return nullptr;
+        }
+
+        add(&s.tags[(int)tag], size);
+        add(&s.total, size);
+        return memory;
+    }
+
+    static inline void deallocate(void* memory, long size, mgui_memory_tag tag) {
+        if (memory == nullptr) {
+            return;
+        }
+
+        lock_scope lock;
+        state_type& s = state();
+        remove(&s.tags[(int)tag], size);
+        remove(&s.total, size);
+        if (s.allocator != nullptr) {
+            s.allocator->deallocate(memory, size, tag);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    static inline mgui_memory_stats stats(mgui_memory_tag tag) {
+        lock_scope lock;
+        return state().tags[(int)tag];
+    }
+
+    /**
+     * @brief Statistics of all subsystems (the peak is of the sum)
+     */
+    static inline mgui_memory_stats total() {
+        lock_scope lock;
+        return state().total;
+    }
+
+    /**
+     * @brief Start measuring the peaks from the current usage.
+     */
+    static inline void reset_peak() {
+        lock_scope lock;
+        state_type& s = state();
+        for (int i = 0; i < TAGS; i++) {
+            s.tags[i].peak = s.tags[i].current;
+        }
+        s.total.peak = s.total.current;
+    }
+
+    static inline const char* tag_name(mgui_memory_tag tag) {
+        switch (tag) {
+        case mgui_memory_tag::List: return "List";
+        case mgui_memory_tag::String: return "String";
+        case mgui_memory_tag::StringMap: return "StringMap";
+        case mgui_memory_tag::TextProperty: return "TextProperty";
+        case mgui_memory_tag::Stack: return "Stack";
+        case mgui_memory_tag::Screen: return "Screen";
+        case mgui_memory_tag::Font: return "Font";
+        case mgui_memory_tag::Input: return "Input";
+        case mgui_memory_tag::Transfer: return "Transfer";
+        }
+        return "Unknown";
+    }
+
+private:
+    struct state_type {
+        mgui_allocator* allocator;
+        mgui_memory_stats tags[TAGS];
+        mgui_memory_stats total;
+#ifdef MGUI_THREADS
+        std::mutex mutex;
+#endif
+    };
+
+    static inline state_type& state() {
+        static state_type s = {};
+        return s;
+    }
+
+    /**
+     * @brief Holds the lock of the statistics in its scope (nothing without MGUI_THREADS).
+     */
+    struct lock_scope {
+#ifdef MGUI_THREADS
+        lock_scope() { state().mutex.lock(); }
+        ~lock_scope() { state().mutex.unlock(); }
+#else
+        lock_scope() {}
+#endif
+    };
+
+    static inline void add(mgui_memory_stats* stats, long size) {
+        stats->current += size;
+        stats->allocations++;
+        if (stats->current > stats->peak) {
+            stats->peak = stats->current;
+        }
+    }
+
+    static inline void remove(mgui_memory_stats* stats, long size) {
+        stats->current -= size;
+        stats->frees++;
+    }
+};
+
+/**
+ * @brief Allocation of mgui_create (new (tag, sizeof(T)) T)
+ *
+ * @remarks
+ * It is noexcept, so the new-expression checks for nullptr (no memory in the allocator)
+ * and does not run the constructor.
+ */
+inline void* operator new(mgui_size_t size, mgui_memory_tag tag, mgui_size_t) noexcept {
+    return mgui_memory::allocate((long)size, tag);
+}
+
+/**
+ * @brief Release when the constructor of new (tag, sizeof(T)) T throws
+ *
+ * @remarks
+ * The placement form does not receive the size of the allocation, so mgui_create passes it
+ * as the last argument to release it with the size it was counted with.
+ */
+inline void operator delete(void* memory, mgui_memory_tag tag, mgui_size_t size) noexcept {
+    mgui_memory::deallocate(memory, (long)size, tag);
+}
+
+/**
+ * @brief Create an object in the memory of a subsystem.
+ *
+ * @return T* The object, or nullptr if the allocator has no memory
+ */
+template <typename T, typename... A>
+inline T* mgui_create(mgui_memory_tag tag, A&&... args) {
+    return new (tag, sizeof(T)) T(static_cast<A&&>(args)...);
+}
+
+/**
+ * @brief Destroy an object of mgui_create. T must be the type it was created with.
+ */
+template <typename T>
+inline void mgui_destroy(T* object, mgui_memory_tag tag) {
+    if (object == nullptr) {
+        return;
+    }
+    object->~T();
+    mgui_memory::deallocate(object, sizeof(T), tag);
+}
+
+/**
+ * @brief Allocate a zero-filled array of a trivial type in the memory of a subsystem.
+ */
+template <typename T>
+inline T* mgui_alloc(int count, mgui_memory_tag tag) {
+    T* array = static_cast<T*>(mgui_memory::allocate((long)sizeof(T) * count, tag));
+    if (array != nullptr) {
+        memset(array, 0, sizeof(T) * count);
+    }
+    return array;
+}
+
+/**
+ * @brief Release an array of mgui_alloc with the same count.
+ */
+template <typename T>
+inline void mgui_free(T* array, int count, mgui_memory_tag tag) {
+    mgui_memory::deallocate(array, (long)sizeof(T) * count, tag);
+}
+
 // prototype declare
 class mgui_menu_item;
 
@@ -45,6 +381,54 @@ enum mgui_draw_line_dir {
     Down
 };
 
+/**
+ * @brief
+ * Clockwise rotation applied to the drawn screen before it is output to the LCD.
+ */
+enum class mgui_rotation {
+    /**
+     * @brief No rotation
+     */
+    Rotate0,
+    /**
+     * @brief Rotate 90 degrees clockwise
+     */
+    Rotate90,
+    /**
+     * @brief Rotate 180 degrees
+     */
+    Rotate180,
+    /**
+     * @brief Rotate 270 degrees clockwise (90 degrees counterclockwise)
+     */
+    Rotate270
+};
+
+/**
+ * @brief
+ * Pixel format of the frame buffer.
+ */
+enum class mgui_pixel_format {
+    /**
+     * @brief
+     * 1 bit per pixel. Each byte is a column of 8 pixels (LSB is the top row)
+     * and the bytes are ordered page by page (SSD1306, SH1106, ST7565).
+     */
+    Mono1,
+    /**
+     * @brief
+     * 2 bits per pixel (4 levels). Pixels are packed row by row,
+     * the leftmost pixel is in the most significant bits.
+     */
+    Gray2,
+    /**
+     * @brief
+     * 4 bits per pixel (16 levels). Pixels are packed row by row,
+     * the leftmost pixel is in the high nibble (SSD1322, SSD1327).
+     */
+    Gray4
+};
+
 /**
  * @brief List of object types that use drawing functions
  *
@@ -98,9 +482,35 @@ enum mgui_object_type {
     /**
      * @brief UI group drawing function
      */
-    UiGroup
+    UiGroup,
+    /**
+     * @brief Touch controller (draws nothing)
+     */
+    TouchController
 };
 
+/**
+ * @brief Name of an object type (for traces and statistics)
+ */
+inline const char* mgui_object_type_name(const mgui_object_type type) {
+    switch (type) {
+    case Rectangle: return "Rectangle";
+    case Circle: return "Circle";
+    case Triangle: return "Triangle";
+    case Pixel: return "Pixel";
+    case Line: return "Line";
+    case Text: return "Text";
+    case Image: return "Image";
+    case Button: return "Button";
+    case VerticalScroll: return "VerticalScroll";
+    case MenuItem: return "MenuItem";
+    case Menu: return "Menu";
+    case UiGroup: return "UiGroup";
+    case TouchController: return "TouchController";
+    }
+    return "Unknown";
+}
+
 /**
  * @brief
  * Types of parameters entered using GPIO or other communication methods
@@ -112,6 +522,24 @@ enum mgui_input_type {
      * that can represent input states within a single int value.
      */
     Single,
+    /**
+     * @brief
+     * Touch panel: value_1 has x in bits 0-11, y in bits 12-23 and the pressure
+     * in bits 24-30, and it is 0 while the panel is not touched (see mgui_touch_sample).
+     */
+    Touch,
+    /**
+     * @brief Push switches: bit n of value_1 is set while switch n is pressed.
+     */
+    Buttons,
+    /**
+     * @brief Rotary encoder: value_1 is the number of steps since the last read (signed).
+     */
+    Encoder,
+    /**
+     * @brief Variable resistors and sensors: value_1 is the reading, for example of an ADC.
+     */
+    Analog,
 };
 
 /**
@@ -130,6 +558,28 @@ struct mgui_input_state {
      * @brief Current input value
      */
     int value_1;
+
+    /**
+     * @brief It returns true if switch n of a Buttons state is pressed.
+     */
+    inline bool button(int n) const { return ((unsigned int)value_1 >> n & 1u) != 0; }
+};
+
+/**
+ * @brief
+ * Declaration of an input channel read by the reader of mgui_input (see mgui_input::set_reader).
+ * A constant table of them gives the layout of the states passed to the handlers.
+ */
+struct mgui_input_channel {
+    /**
+     * @brief Name of the channel (see mgui_input::find)
+     */
+    const char* name;
+
+    /**
+     * @brief Type set to the state before each read
+     */
+    mgui_input_type type;
 };
 
 /**
@@ -155,7 +605,7 @@ struct mgui_list_node {
  * A simple list class that can be used for various object types.
  * It is created to avoid using standard functions.
  */
-template <typename T>
+template <typename T, mgui_memory_tag Tag = mgui_memory_tag::List>
 class mgui_list {
 public:
     /**
@@ -258,9 +708,13 @@ public:
      * @brief Appends a new item to the end of a linked list.
      *
      * @param item A new item to append. The objects being set must be comparable.
+     * @return false There is no memory for the node; the list is not changed
      */
-    void add(const T& item) {
-        mgui_list_node<T>* node = new mgui_list_node<T>();
+    bool add(const T& item) {
+        mgui_list_node<T>* node = mgui_create<mgui_list_node<T>>(Tag);
+        if (node == nullptr) {
+            return false;
+        }
         node->obj = item;
         node->next = nullptr;
 
@@ -272,6 +726,7 @@ public:
         }
         tail = node;
         counter++;
+        return true;
     }
 
     /**
@@ -343,7 +798,7 @@ public:
                 tail = prev_node;
             }
         }
-        delete current_node;
+        mgui_destroy(current_node, Tag);
         counter--;
     }
 
@@ -369,6 +824,7 @@ public:
      * @return mgui_list_node<T>* first list node
      */
     inline mgui_list_node<T>* first() { return head; }
+    inline const mgui_list_node<T>* first() const { return head; }
 
     /**
      * @brief It returns last node
@@ -399,6 +855,7 @@ public:
     mgui_stack() { 
         // Initialize the head of the stack to nullptr
         head_ = nullptr;
+        spare_ = nullptr;
     }
 
     /**
@@ -411,18 +868,37 @@ public:
         while (head_ != nullptr) {
             pop();
         }
+        while (spare_ != nullptr) {
+            mgui_list_node<T>* node = spare_;
+            spare_ = node->next;
+            mgui_destroy(node, mgui_memory_tag::Stack);
+        }
     }
 
     /**
      * @brief Add item to the end of stack.
      *
+     * @remarks
+     * The nodes of popped items are reused, so a stack that has been as deep
+     * before (or reserved) does not allocate.
+     *
      * @param item object
+     * @return false There is no memory for the node; the stack is not changed
      */
-    void push(const T& item) {
-        mgui_list_node<T>* node = new mgui_list_node<T>();
+    bool push(const T& item) {
+        mgui_list_node<T>* node = spare_;
+        if (node != nullptr) {
+            spare_ = node->next;
+        } else {
+            node = mgui_create<mgui_list_node<T>>(mgui_memory_tag::Stack);
+            if (node == nullptr) {
+                return false;
+            }
+        }
         node->obj = item;
         node->next = head_;
         head_ = node;
+        return true;
     }
 
     /**
@@ -434,7 +910,30 @@ public:
         mgui_list_node<T>* node = head_;
         head_ = node->next;
 
-        return static_cast<T&&>(node->obj);
+        T item = static_cast<T&&>(node->obj);
+        node->next = spare_;
+        spare_ = node;
+        return item;
+    }
+
+    /**
+     * @brief Allocate the nodes for count items in advance.
+     */
+    void reserve(int count) {
+        for (mgui_list_node<T>* node = head_; node != nullptr; node = node->next) {
+            count--;
+        }
+        for (mgui_list_node<T>* node = spare_; node != nullptr; node = node->next) {
+            count--;
+        }
+        for (; count > 0; count--) {
+            mgui_list_node<T>* node = mgui_create<mgui_list_node<T>>(mgui_memory_tag::Stack);
+            if (node == nullptr) {
+                return;
+            }
+            node->next = spare_;
+            spare_ = node;
+        }
     }
 
     /**
@@ -447,6 +946,7 @@ public:
 
 private:
     mgui_list_node<T>* head_;
+    mgui_list_node<T>* spare_;
 };
 
 /**
@@ -458,6 +958,7 @@ class mgui_string {
 public:
     mgui_string() {
         str_length_ = 0;
+        str_capacity_ = 0;
         str_ = nullptr;
     }
 
@@ -465,7 +966,7 @@ public:
      * @brief Constructs a `mgui_string` object from a C-style string.
      * @param str the C-style string to initialize the `mgui_string` object with
      */
-    mgui_string(const char* str) {
+    mgui_string(const char* str) : mgui_string() {
         build(str);
     }
 
@@ -473,7 +974,7 @@ public:
      * @brief Copy constructor
      * @param other The object to copy from
      */
-    mgui_string(const mgui_string& other) {
+    mgui_string(const mgui_string& other) : mgui_string() {
         build(other.c_str());
     }
 
@@ -507,13 +1008,13 @@ public:
      * Assignment operator.
      *
      * Copies a C-style string to the `mgui_string` object.
+     * The memory is reused when the string fits in it.
      *
      * @param str the C-style string to copy
      * @return a reference to the `mgui_string` object
      */
-    mgui_string operator=(const char* str) {
+    mgui_string& operator=(const char* str) {
         if (str != nullptr) {
-            clear();
             build(str);
         }
         return *this;
@@ -528,12 +1029,7 @@ public:
      * @param other the `mgui_string` object to copy from
      * @return a reference to this `mgui_string` object
      */
-    mgui_string operator=(const mgui_string& other) noexcept {
-        // If the current string is not empty, clear it
-        if (this->str_ != nullptr) {
-            clear();
-        }
-        
+    mgui_string& operator=(const mgui_string& other) noexcept {
         // If the current object is not the same as the other object, copy the content
         if (this != &other) {
             build(other.c_str());
@@ -598,14 +1094,26 @@ private:
 
     /**
      * @brief
-     * Get the number of characters received, allocate memory and copy them there.
+     * Get the number of characters received and copy them.
+     * Memory is allocated only when they do not fit in the current memory.
      *
-     * @param str char[]
+     * @param str char[] (nullptr is an empty string)
      */
     inline void build(const char* str) {
-        str_length_ = strlen(str);
-        str_ = new char[str_length_ + 1];
-        memcpy(str_, str, str_length_);
+        const int length = (str != nullptr) ? strlen(str) : 0;
+        if (length + 1 > str_capacity_) {
+            clear();
+            str_ = mgui_alloc<char>(length + 1, mgui_memory_tag::String);
+            if (str_ == nullptr) {
+                // no memory: the string stays empty
+                return;
+            }
+            str_capacity_ = length + 1;
+        }
+        if (str != str_ && length > 0) {
+            memcpy(str_, str, length);
+        }
+        str_length_ = length;
         str_[str_length_] = '\0';
     }
 
@@ -614,11 +1122,12 @@ private:
      * Initialize string settings and memory release.
      */
     inline void clear() {
-        str_length_ = 0;
         if (str_) {
-            delete[] str_;
+            mgui_free(str_, str_capacity_, mgui_memory_tag::String);
             str_ = nullptr;
         }
+        str_length_ = 0;
+        str_capacity_ = 0;
     }
 
     /**
@@ -639,6 +1148,7 @@ private:
 
     char* str_;
     int str_length_;
+    int str_capacity_;
 };
 
 template <typename K, typename V>
@@ -694,11 +1204,16 @@ public:
      *
      * @param key key string
      * @param value Object associated with key
+     * @return false There is no memory for the entry; the map is not changed
      */
-    void insert(const mgui_string key, V value) {
+    bool insert(const mgui_string& key, V value) {
         unsigned long index = djb2_hash(key.c_str());
 
-        mgui_pair<mgui_string, V*> pair = { key, new V(value) };
+        mgui_pair<mgui_string, V*> pair = { key, mgui_create<V>(mgui_memory_tag::StringMap, value) };
+        if (pair.value == nullptr || !(pair.key == key)) {
+            mgui_destroy(pair.value, mgui_memory_tag::StringMap);
+            return false;
+        }
 
         const int count = table[index].count();
         mgui_list_node<mgui_pair<mgui_string, V*>>* node = table[index].first();
@@ -709,15 +1224,20 @@ public:
 
             if (node->obj.key == key) {
                 // overwrite member
+                mgui_destroy(node->obj.value, mgui_memory_tag::StringMap);
                 node->obj.value = pair.value;
-                return;
+                return true;
             }
 
             node = node->next;
         }
 
-        table[index].add(pair);
+        if (!table[index].add(pair)) {
+            mgui_destroy(pair.value, mgui_memory_tag::StringMap);
+            return false;
+        }
         counter_++;
+        return true;
     }
 
     /**
@@ -726,8 +1246,18 @@ public:
      * @param key Key corresponding to the value to retrieve.
      * @return V* A pointer to the element corresponding to the assigned key. If it does not exist, return nullptr.
      */
-    V* get(const mgui_string key) {
-        unsigned long index = djb2_hash(key.c_str());
+    V* get(const mgui_string& key) {
+        return get(key.c_str());
+    }
+
+    /**
+     * @brief Get the element corresponding to the key without copying it to a mgui_string.
+     */
+    V* get(const char* key) {
+        if (key == nullptr) {
+            key = "";
+        }
+        unsigned long index = djb2_hash(key);
         const int count = table[index].count();
 
         mgui_list_node<mgui_pair<mgui_string, V*>>* node = table[index].first();
@@ -751,7 +1281,7 @@ public:
      *
      * @param key key string
      */
-    void remove(mgui_string key) {
+    void remove(const mgui_string& key) {
         unsigned long index = djb2_hash(key.c_str());
         const int count = table[index].count();
 
@@ -762,7 +1292,9 @@ public:
             }
 
             if (node->obj.key == key) {
+                V* value = node->obj.value;
                 table[index].remove(node->obj);
+                mgui_destroy(value, mgui_memory_tag::StringMap);
                 counter_--;
                 break;
             }
@@ -777,6 +1309,9 @@ public:
      */
     void clear() {
         for (int i = 0; i < HASH_TABLE_SIZE; i++) {
+            for (mgui_list_node<mgui_pair<mgui_string, V*>>* node = table[i].first(); node != nullptr; node = node->next) {
+                mgui_destroy(node->obj.value, mgui_memory_tag::StringMap);
+            }
             table[i].clear();
         }
         counter_ = 0;
@@ -801,13 +1336,17 @@ private:
         unsigned long hash = 5381;
         int c;
 
+        if (data == nullptr) {
+            return hash % HASH_TABLE_SIZE;
+        }
+
         while ((c = *data++)) {
             hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
         }
         return hash % HASH_TABLE_SIZE;
     }
 
-    mgui_list<mgui_pair<mgui_string, V*>> table[HASH_TABLE_SIZE];
+    mgui_list<mgui_pair<mgui_string, V*>, mgui_memory_tag::StringMap> table[HASH_TABLE_SIZE];
     int counter_;
 };
 
@@ -822,11 +1361,17 @@ public:
      * @param width The width of the image
      * @param height The height of the image
      * @param resource A pointer to the image data
+     * @param bits_per_pixel
+     * 1: Each byte is a column of 8 pixels (MSB is the top row).
+     * 2 or 4: Levels packed row by row, the leftmost pixel is in the most significant bits.
+     * Each row starts on a byte boundary. Level 0 is transparent.
      */
-    explicit mgui_image_property(const uint16_t width, const uint16_t height, const uint8_t* resource) {
+    explicit mgui_image_property(const uint16_t width, const uint16_t height, const uint8_t* resource,
+                                 const uint8_t bits_per_pixel = 1) {
         image_width_ = width;
         image_height_ = height;
         resource_ = resource;
+        bits_per_pixel_ = bits_per_pixel;
     }
 
     /**
@@ -855,10 +1400,21 @@ public:
      */
     inline const uint8_t* resource() const { return resource_; }
 
+    /**
+     * @brief Get the number of bits per pixel of the image data (1, 2 or 4)
+     */
+    inline uint8_t bits_per_pixel() const { return bits_per_pixel_; }
+
+    /**
+     * @brief Get the number of bytes in a row of a multi-bit image
+     */
+    inline int stride() const { return (image_width_ * bits_per_pixel_ + 7) >> 3; }
+
 private:
     uint16_t image_width_;
     uint16_t image_height_;
     const uint8_t* resource_;
+    uint8_t bits_per_pixel_;
 };
 
 /**
@@ -877,9 +1433,11 @@ public:
      * @param w Font width to be set for the resource
      * @param h Font height to be set for the resource
      * @param resource Array of font data with specified width and height
+     * @param bits_per_pixel Bits per pixel of the font data (see mgui_image_property)
      */
-    explicit mgui_font(const uint16_t w, const uint16_t h, const uint8_t* resource)
-     : mgui_image_property(w, h, resource) {};
+    explicit mgui_font(const uint16_t w, const uint16_t h, const uint8_t* resource,
+                       const uint8_t bits_per_pixel = 1)
+     : mgui_image_property(w, h, resource, bits_per_pixel) {};
     virtual ~mgui_font() {}
 
     /**
@@ -890,6 +1448,11 @@ public:
      * Position of the first array of font resources corresponding to the character to be searched for.
      */
     virtual int search(const char* c) = 0;
+
+    /**
+     * @brief If true, the font is an mgui_font_aa with coverage data.
+     */
+    virtual bool antialiased() const { return false; }
 };
 
 /**
@@ -908,9 +1471,11 @@ public:
      * @param w Font width to be set for the resource
      * @param h Font height to be set for the resource
      * @param resource Array of font data with specified width and height
+     * @param bits_per_pixel Bits per pixel of the font data (see mgui_image_property)
      */
-    explicit mgui_font_w(const uint16_t w, const uint16_t h, const uint8_t* resource)
-     : mgui_image_property(w, h, resource) {};
+    explicit mgui_font_w(const uint16_t w, const uint16_t h, const uint8_t* resource,
+                         const uint8_t bits_per_pixel = 1)
+     : mgui_image_property(w, h, resource, bits_per_pixel) {};
     virtual ~mgui_font_w() {}
 
     /**
@@ -924,790 +1489,4430 @@ public:
 };
 
 /**
- * @brief 
- * Set a pixel, line, or shape at an arbitrary position in the preallocated lcd buffer array
+ * @brief
+ * Anti-aliased font. Each pixel of a glyph is a coverage of 2 or 4 bits,
+ * packed row by row with the leftmost pixel in the most significant bits.
+ * Each row starts on a byte boundary.
+ *
+ * @remarks
+ * On grayscale screens the coverage is blended into the buffer with a lookup table,
+ * and glyphs are kept pre-shifted to the pixel position within a byte in a small cache.
+ * On monochrome screens pixels with more than half coverage are drawn.
+ * When using this class, define a class that inherits from this class
+ * and implement search().
+ * The caches are changed by glyph() and blend_table(), so a font shared by instances
+ * on several threads needs MGUI_THREADS; hold a lock_scope while their results are used.
+ * Without MGUI_THREADS use each font from one thread only.
  */
-class mgui_draw {
+class mgui_font_aa : public mgui_font {
 public:
 
     /**
-     * @brief Construct a new mgui draw object
-     * 
-     * @param width Target LCD width
-     * @param height Target LCD height
-     * @param buffer Buffer to reflect drawing results
-     */
-    explicit mgui_draw(const uint16_t width, const uint16_t height, uint8_t *buffer){
-        lcd_width_ = width;
-        lcd_height_ = height;
-        lcd_buffer_ = buffer;
-    }
-
-    /**
-     * @brief Destroy the mgui draw object
-     */
-    ~mgui_draw(){}
+     * @brief Construct a new anti-aliased font property object
+     *
+     * @param w Font width to be set for the resource
+     * @param h Font height to be set for the resource
+     * @param resource Array of coverage data with specified width and height
+     * @param coverage_bits Bits of coverage per pixel (2 or 4)
+     * @param cache_slots Number of pre-shifted glyphs kept in the cache (at least 1)
+     */
+    explicit mgui_font_aa(const uint16_t w, const uint16_t h, const uint8_t* resource,
+                          const uint8_t coverage_bits = 4, const int cache_slots = 32)
+     : mgui_font(w, h, resource, coverage_bits) {
+        cache_slots_ = (cache_slots < 1) ? 1 : cache_slots;
+        // Room for the widest (4 bits per pixel) glyph shifted by a pixel
+        cache_stride_ = (w * 4 + 4 + 7) >> 3;
+        cache_keys_ = mgui_alloc<int>(cache_slots_, mgui_memory_tag::Font);
+        cache_ = mgui_alloc<uint8_t>(cache_slots_ * cache_stride_ * h, mgui_memory_tag::Font);
+        for (int i = 0; i < cache_slots_; i++) {
+            cache_keys_[i] = -1;
+        }
+        blend_key_ = -1;
+    }
 
-    /**
-     * @brief Drawing circle
-     * 
-     * @param x0 center point of X
-     * @param y0 center point of Y
-     * @param r  radius
-     * @param fill If true, set fill circle
-     */
-    void draw_circle(int x0, int y0, int r, bool fill = false) {
+    virtual ~mgui_font_aa() {
+        mgui_free(cache_keys_, cache_slots_, mgui_memory_tag::Font);
+        mgui_free(cache_, cache_slots_ * cache_stride_ * height(), mgui_memory_tag::Font);
+    }
 
-        if(fill){
-            draw_circle_fill(x0, y0, r);
-            return;
-        }
+    // a copy would free the caches twice
+    mgui_font_aa(const mgui_font_aa&) = delete;
+    mgui_font_aa& operator=(const mgui_font_aa&) = delete;
 
-        int x = r;
-        int y = 0;
-        int f = -(r << 1) + 3;
+    bool antialiased() const { return true; }
 
-        while (x >= y)
-        {
-            // 1
-            draw_pixel(x0 + x, y0 + y, true);
-            draw_pixel(x0 + y, y0 - x, true);
+    /**
+     * @brief Holds the caches of the font in its scope (nothing without MGUI_THREADS).
+     */
+    class lock_scope {
+    public:
+#ifdef MGUI_THREADS
+        explicit lock_scope(const mgui_font_aa* font) : font_(font) { font_->mutex_.lock(); }
+        ~lock_scope() { font_->mutex_.unlock(); }
 
-            // 2
-            draw_pixel(x0 + x, y0 - y, true);
-            draw_pixel(x0 + y, y0 + x, true);
+    private:
+        const mgui_font_aa* font_;
+#else
+        explicit lock_scope(const mgui_font_aa*) {}
+#endif
+    };
 
-            // 3
-            draw_pixel(x0 - x, y0 + y, true);
-            draw_pixel(x0 - y, y0 + x, true);
-            
-            // 4
-            draw_pixel(x0 - x, y0 - y, true);
-            draw_pixel(x0 - y, y0 - x, true);
-            
-            if (f >= 0)
-            {
-                x--;
-                f -= (x << 2);
+    /**
+     * @brief
+     * It returns the coverage of a glyph rescaled to the screen format and
+     * shifted right by phase pixels, with glyph_stride(bits_per_pixel) bytes per row.
+     *
+     * @param index Returned value of search()
+     * @param phase Pixel position of the glyph within a byte of the screen
+     * @param bits_per_pixel Bits per pixel of the screen (2 or 4)
+     */
+    inline const uint8_t* glyph(int index, int phase, int bits_per_pixel) const {
+        const int key = (index << 3) | (phase << 1) | (bits_per_pixel == 4 ? 1 : 0);
+        const int slot = (unsigned int)(index / glyph_bytes() * 4 + phase) % cache_slots_;
+        uint8_t* data = cache_ + slot * cache_stride_ * height();
+        if (cache_keys_[slot] == key) {
+            return data;
+        }
+
+        const int src_bits = this->bits_per_pixel();
+        const int src_max = (1 << src_bits) - 1;
+        const int max = (1 << bits_per_pixel) - 1;
+        const int stride = glyph_stride(bits_per_pixel);
+        memset(data, 0, stride * height());
+
+        for (int y = 0; y < height(); y++) {
+            const uint8_t* row = resource() + index + y * this->stride();
+            for (int x = 0; x < width(); x++) {
+                const int bit = x * src_bits;
+                int level = (row[bit >> 3] >> (8 - src_bits - (bit & 7))) & src_max;
+                level = (src_bits >= bits_per_pixel) ? (level >> (src_bits - bits_per_pixel))
+                                                     : level * (max / src_max);
+                const int dst_bit = (x + phase) * bits_per_pixel;
+                data[y * stride + (dst_bit >> 3)]
+                    |= (uint8_t)(level << (8 - bits_per_pixel - (dst_bit & 7)));
             }
-            y++;
-            f += (y << 2) + 2;
         }
+
+        cache_keys_[slot] = key;
+        return data;
     }
 
     /**
-     * @brief Drawing rounded rectangle
-     * 
-     * @param x0 x position at upper left
-     * @param y0 y position at upper left
-     * @param x1 x position at bottom right
-     * @param y1 y position at bottom right
-     * @param r rounded corner radius
-     * @param fill If you want to fill the figure, set true
-     * @param on if true, set 1; if false, set 0
+     * @brief Number of bytes in a row of glyph()
      */
-    void draw_rectangle_rounded(int x0, int y0, int x1, int y1, int r, bool fill = false, bool on = true){
-        
-        if(fill){
-            draw_rectangle_rounded_fill(x0, y0, x1, y1, r, on);
-            return;
+    inline int glyph_stride(int bits_per_pixel) const {
+        return (width() * bits_per_pixel + 8 - bits_per_pixel + 7) >> 3;
+    }
+
+    /**
+     * @brief
+     * It returns the blend table for the ink level, indexed by
+     * (coverage << bits_per_pixel) | level of the buffer.
+     *
+     * @param ink Level of the text (Gray2: 0-3, Gray4: 0-15)
+     * @param bits_per_pixel Bits per pixel of the screen (2 or 4)
+     */
+    inline const uint8_t* blend_table(int ink, int bits_per_pixel) const {
+        const int key = (ink << 3) | bits_per_pixel;
+        if (blend_key_ == key) {
+            return blend_;
         }
 
-        int x = r;
-        int y = 0;
-        int f = -(r << 1) + 3;
+        const int max = (1 << bits_per_pixel) - 1;
+        for (int coverage = 0; coverage <= max; coverage++) {
+            for (int level = 0; level <= max; level++) {
+                // Rounded to the nearest level
+                const int delta = (ink - level) * coverage;
+                blend_[(coverage << bits_per_pixel) | level]
+                    = (uint8_t)(level + (delta + ((delta < 0) ? -max / 2 : max / 2)) / max);
+            }
+        }
 
-        int px0 = x0 + r;
-        int px1 = x1 - r;
-        int py0 = y0 + r;
-        int py1 = y1 - r;
+        blend_key_ = key;
+        return blend_;
+    }
 
-        while (x >= y)
-        {
-            // 1
-            draw_pixel(px1 + x, py0 - y, on);
-            draw_pixel(px1 + y, py0 - x, on);
-            
-            // 2
-            draw_pixel(px1 + x, py1 + y, on);
-            draw_pixel(px1 + y, py1 + x, on);
-            
-            // 3
-            draw_pixel(px0 - x, py1 + y, on);
-            draw_pixel(px0 - y, py1 + x, on);
+private:
+    inline int glyph_bytes() const { return this->stride() * height(); }
+
+    int cache_slots_;
+    int cache_stride_;
+    mutable int* cache_keys_;
+    mutable uint8_t* cache_;
+    mutable int blend_key_;
+    mutable uint8_t blend_[256];
+#ifdef MGUI_THREADS
+    mutable std::mutex mutex_;
+#endif
+};
 
-            // 4
-            draw_pixel(px0 - x, py0 - y, on);
-            draw_pixel(px0 - y, py0 - x, on);
-            if (f >= 0)
-            {
-                x--;
-                f -= (x << 2);
-            }
-            y++;
-            f += (y << 2) + 2;
-        }
+/**
+ * @brief 32-bit SWAR vector operations for mgui_buffer_kernel.
+ */
+struct mgui_simd_swar32 {
+    typedef mgui_word32 vector;
+    static constexpr int size = 4;
+
+    static inline vector load(const uint8_t* p) { vector v; memcpy(&v, p, size); return v; }
+    static inline void store(uint8_t* p, vector v) { memcpy(p, &v, size); }
+    static inline vector set1(uint8_t value) { return value * 0x01010101U; }
+    static inline vector bit_and(vector a, vector b) { return a & b; }
+    static inline vector bit_or(vector a, vector b) { return a | b; }
+    static inline vector bit_xor(vector a, vector b) { return a ^ b; }
+    static inline vector bit_andnot(vector a, vector b) { return ~a & b; }
+    static inline bool equal(vector a, vector b) { return a == b; }
+};
 
-        for (int x = px0; x <=px1 ; x++) {
-            draw_pixel(x, y0, on);
-            draw_pixel(x, y1, on);
-        }
+/**
+ * @brief 64-bit SWAR vector operations for mgui_buffer_kernel.
+ */
+struct mgui_simd_swar64 {
+    typedef mgui_word64 vector;
+    static constexpr int size = 8;
+
+    static inline vector load(const uint8_t* p) { vector v; memcpy(&v, p, size); return v; }
+    static inline void store(uint8_t* p, vector v) { memcpy(p, &v, size); }
+    static inline vector set1(uint8_t value) { return value * 0x0101010101010101ULL; }
+    static inline vector bit_and(vector a, vector b) { return a & b; }
+    static inline vector bit_or(vector a, vector b) { return a | b; }
+    static inline vector bit_xor(vector a, vector b) { return a ^ b; }
+    static inline vector bit_andnot(vector a, vector b) { return ~a & b; }
+    static inline bool equal(vector a, vector b) { return a == b; }
+};
 
-        for(int y = py0; y <= py1; y++) {
-            draw_pixel(x0, y, on);
-            draw_pixel(x1, y, on);
-        }
+#ifdef MGUI_USE_SSE2
+/**
+ * @brief SSE2 vector operations for mgui_buffer_kernel.
+ */
+struct mgui_simd_sse2 {
+    typedef __m128i vector;
+    static constexpr int size = 16;
+
+    static inline vector load(const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static inline void store(uint8_t* p, vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static inline vector set1(uint8_t value) { return _mm_set1_epi8((char)value); }
+    static inline vector bit_and(vector a, vector b) { return _mm_and_si128(a, b); }
+    static inline vector bit_or(vector a, vector b) { return _mm_or_si128(a, b); }
+    static inline vector bit_xor(vector a, vector b) { return _mm_xor_si128(a, b); }
+    static inline vector bit_andnot(vector a, vector b) { return _mm_andnot_si128(a, b); }
+    static inline bool equal(vector a, vector b) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF; }
+};
+#endif
+
+#ifdef MGUI_USE_AVX2
+/**
+ * @brief AVX2 vector operations for mgui_buffer_kernel.
+ */
+struct mgui_simd_avx2 {
+    typedef __m256i vector;
+    static constexpr int size = 32;
+
+    static inline vector load(const uint8_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static inline void store(uint8_t* p, vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static inline vector set1(uint8_t value) { return _mm256_set1_epi8((char)value); }
+    static inline vector bit_and(vector a, vector b) { return _mm256_and_si256(a, b); }
+    static inline vector bit_or(vector a, vector b) { return _mm256_or_si256(a, b); }
+    static inline vector bit_xor(vector a, vector b) { return _mm256_xor_si256(a, b); }
+    static inline vector bit_andnot(vector a, vector b) { return _mm256_andnot_si256(a, b); }
+    static inline bool equal(vector a, vector b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == -1; }
+};
+#endif
+
+#ifdef MGUI_USE_NEON
+/**
+ * @brief NEON vector operations for mgui_buffer_kernel.
+ */
+struct mgui_simd_neon {
+    typedef uint8x16_t vector;
+    static constexpr int size = 16;
+
+    static inline vector load(const uint8_t* p) { return vld1q_u8(p); }
+    static inline void store(uint8_t* p, vector v) { vst1q_u8(p, v); }
+    static inline vector set1(uint8_t value) { return vdupq_n_u8(value); }
+    static inline vector bit_and(vector a, vector b) { return vandq_u8(a, b); }
+    static inline vector bit_or(vector a, vector b) { return vorrq_u8(a, b); }
+    static inline vector bit_xor(vector a, vector b) { return veorq_u8(a, b); }
+    static inline vector bit_andnot(vector a, vector b) { return vbicq_u8(b, a); }
+    static inline bool equal(vector a, vector b) {
+        uint64x2_t c = vreinterpretq_u64_u8(vceqq_u8(a, b));
+        return (vgetq_lane_u64(c, 0) & vgetq_lane_u64(c, 1)) == ~0ULL;
     }
+};
+#endif
+
+/**
+ * @brief
+ * Whole-buffer and span operations processed one vector (word or SIMD register)
+ * at a time. The vector operations are given by the template parameter, and the
+ * remaining bytes that do not fill a vector are processed one byte at a time.
+ *
+ * @remarks
+ * Use mgui_kernel, which is the implementation selected at compile time.
+ *
+ * @tparam S mgui_simd_swar32, mgui_simd_swar64, mgui_simd_sse2, mgui_simd_avx2 or mgui_simd_neon
+ */
+template <typename S>
+class mgui_buffer_kernel {
+public:
+    typedef typename S::vector vector;
 
     /**
-     * @brief Drawing rectangle
-     * 
-     * @param x0 x position at upper left
-     * @param y0 y position at upper left
-     * @param x1 x position at bottom right
-     * @param y1 y position at bottom right
-     * @param fill If you want to fill the figure, set true
-     * @param on if true, set 1; if false, set 0
+     * @brief Set all bytes to the value.
      */
-    void draw_rectangle(int x0, int y0, int x1, int y1, bool fill = false, bool on = true){
-        if(fill){
-            draw_rectangle_fill(x0, y0, x1, y1, on);
-            return;
+    static inline void fill(uint8_t* dst, uint8_t value, int size) {
+        vector v = S::set1(value);
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, v);
         }
-
-        for (int x = x0; x <=x1 ; x++) {
-            draw_pixel(x, y0, on);
-            draw_pixel(x, y1, on);
+        for (; i < size; i++) {
+            dst[i] = value;
         }
+    }
 
-        for(int y = y0; y <= y1; y++) {
-            draw_pixel(x0, y, on);
-            draw_pixel(x1, y, on);
+    /**
+     * @brief Copy bytes from src to dst. The areas must not overlap.
+     */
+    static inline void copy(uint8_t* dst, const uint8_t* src, int size) {
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::load(src + i));
+        }
+        for (; i < size; i++) {
+            dst[i] = src[i];
         }
     }
 
     /**
-     * @brief Drawing triangle
-     * 
-     * @param x0 x position 0
-     * @param y0 y position 0
-     * @param x1 x position 1
-     * @param y1 y position 1
-     * @param x2 x position 2
-     * @param y2 y position 2
-     * @param invert if true, set 0; if false, set 1
+     * @brief Compare two buffers.
+     *
+     * @return true All bytes are equal
+     * @return false At least one byte differs
      */
-    void draw_triangle(int x0, int y0, int x1, int y1, int x2, int y2, bool invert = false) {
-        
-        draw_line(x0, y0, x1, y1, !invert);
-        draw_line(x0, y0, x2, y2, !invert);
-        draw_line(x1, y1, x2, y2, !invert);
+    static inline bool equal(const uint8_t* a, const uint8_t* b, int size) {
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            if (!S::equal(S::load(a + i), S::load(b + i))) {
+                return false;
+            }
+        }
+        for (; i < size; i++) {
+            if (a[i] != b[i]) {
+                return false;
+            }
+        }
+        return true;
     }
 
     /**
-     * @brief Drawing straight line
-     * 
-     * @param x0 x position at start
-     * @param y0 y position at start
-     * @param x1 x position at end
-     * @param y1 y position at end
-     * @param on if true, set 1; if false, set 0
-     */
-    void draw_line(int x0, int y0, int x1, int y1, bool on){
-        int sx = x0 < x1 ? 1 : -1;
-        int sy = y0 < y1 ? 1 : -1;
-        int dx = sx * (x1 - x0);
-        int dy = -sy * (y1 - y0);
-        int err = dx + dy;
-        int e2;
+     * @brief Find the range of bytes that differ between two buffers.
+     *
+     * @param first Receives the index of the first differing byte
+     * @param last Receives the index of the last differing byte
+     * @return true Differences were found
+     * @return false The buffers are equal (first and last are not changed)
+     */
+    static inline bool diff(const uint8_t* a, const uint8_t* b, int size, int* first, int* last) {
+        int head = 0;
+        while (head + S::size <= size && S::equal(S::load(a + head), S::load(b + head))) {
+            head += S::size;
+        }
+        while (head < size && a[head] == b[head]) {
+            head++;
+        }
+        if (head == size) {
+            return false;
+        }
 
-        while (x0 != x1 || y0 != y1)
-        {
-            draw_pixel(x0, y0, on);
+        int tail = size;
+        while (tail - S::size > head && S::equal(S::load(a + tail - S::size), S::load(b + tail - S::size))) {
+            tail -= S::size;
+        }
+        while (a[tail - 1] == b[tail - 1]) {
+            tail--;
+        }
 
-            e2 = 2 * err;
+        *first = head;
+        *last = tail - 1;
+        return true;
+    }
 
-            if (e2 >= dy)
-            {
-                err += dy;
-                x0 += sx;
-            } else {
-                err += dx;
-                y0 += sy;
-            }
+    /**
+     * @brief Invert all bits.
+     */
+    static inline void invert(uint8_t* dst, int size) {
+        vector ones = S::set1(0xFF);
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::bit_xor(S::load(dst + i), ones));
+        }
+        for (; i < size; i++) {
+            dst[i] = ~dst[i];
         }
     }
 
     /**
-     * @brief Drawing straight line other than diagonals
-     * 
-     * @param x0 x position at start
-     * @param y0 y position at start
-     * @param length straight line length
-     * @param on if true, set 1; if false, set 0
-     * @param direction Direction for drawing a straight line
+     * @brief Composite src over dst by OR (dst |= src).
      */
-    void draw_line_straight(int x0, int y0, int length, bool on, mgui_draw_line_dir direction) {
-
-        if (direction == mgui_draw_line_dir::Left) {
-            int xlast = x0 + length;
-            for (int x = x0; x < xlast; x++) {
-                draw_pixel(x, y0, on);
-            }
-            return;
+    static inline void or_into(uint8_t* dst, const uint8_t* src, int size) {
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::bit_or(S::load(dst + i), S::load(src + i)));
+        }
+        for (; i < size; i++) {
+            dst[i] |= src[i];
         }
+    }
 
-        int ylast = y0 + length;
-        for (int y = y0; y < ylast; y++) {
-            draw_pixel(x0, y, on);
+    /**
+     * @brief Erase the bits set in src from dst (dst &= ~src).
+     */
+    static inline void and_not_into(uint8_t* dst, const uint8_t* src, int size) {
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::bit_andnot(S::load(src + i), S::load(dst + i)));
+        }
+        for (; i < size; i++) {
+            dst[i] &= ~src[i];
         }
     }
 
     /**
-     * @brief Sets the color at the specified position
-     * The point outside the set height and width are ignored.
-     * 
-     * @param x x position
-     * @param y y position
-     * @param on 
-     * If true, the bit at the position corresponding to (x,y) is set to 1;
-     * if false, it is set to 0
+     * @brief Set the masked bits of every byte (dst |= mask).
+     * In a page-ordered buffer this draws a horizontal span of up to 8 rows.
      */
-    void draw_pixel(int x, int y, bool on){
-        if (x < lcd_width_ && y < lcd_height_) {
-            // Calculate the byte index.
-            int byte_idx = (y >> 3) * lcd_width_ + x;
-            uint8_t bit_idx = (1 << (y % 8));
+    static inline void or_mask(uint8_t* dst, uint8_t mask, int size) {
+        vector m = S::set1(mask);
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::bit_or(S::load(dst + i), m));
+        }
+        for (; i < size; i++) {
+            dst[i] |= mask;
+        }
+    }
 
-            // Set or clear the bit at the specified index.
-            lcd_buffer_[byte_idx]
-                = on ? (lcd_buffer_[byte_idx] | bit_idx)
-                        : (lcd_buffer_[byte_idx] & ~bit_idx);
+    /**
+     * @brief Keep only the masked bits of every byte (dst &= mask).
+     */
+    static inline void and_mask(uint8_t* dst, uint8_t mask, int size) {
+        vector m = S::set1(mask);
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            S::store(dst + i, S::bit_and(S::load(dst + i), m));
+        }
+        for (; i < size; i++) {
+            dst[i] &= mask;
         }
     }
 
     /**
-     * @brief 
-     * Draw an arbitrary character from mgui_font resource
+     * @brief
+     * Replace the masked bits of every byte with a repeating 8-byte pattern:
+     * dst[i] = (dst[i] & ~mask) | (pattern[(phase + i) % 8] & mask)
+     *
+     * @param pattern 8-byte pattern. In a page-ordered buffer it is an 8x8 tile.
+     * @param phase Pattern index of dst[0]
+     */
+    static inline void fill_pattern(uint8_t* dst, const uint8_t* pattern, int phase, uint8_t mask, int size) {
+        // Pattern repeated so that a vector can be loaded from any phase.
+        uint8_t tile[S::size + 8];
+        for (int k = 0; k < S::size + 8; k++) {
+            tile[k] = pattern[(phase + k) & 7];
+        }
+
+        vector m = S::set1(mask);
+        int i = 0;
+        for (; i + S::size <= size; i += S::size) {
+            vector p = S::bit_and(S::load(tile + (i & 7)), m);
+            S::store(dst + i, S::bit_or(S::bit_andnot(m, S::load(dst + i)), p));
+        }
+        for (; i < size; i++) {
+            dst[i] = (dst[i] & ~mask) | (tile[i & 7] & mask);
+        }
+    }
+};
+
+/**
+ * @brief Buffer kernel selected at compile time.
+ */
+#if defined(MGUI_USE_AVX2)
+typedef mgui_buffer_kernel<mgui_simd_avx2> mgui_kernel;
+#elif defined(MGUI_USE_SSE2)
+typedef mgui_buffer_kernel<mgui_simd_sse2> mgui_kernel;
+#elif defined(MGUI_USE_NEON)
+typedef mgui_buffer_kernel<mgui_simd_neon> mgui_kernel;
+#elif MGUI_SWAR_BITS == 64
+typedef mgui_buffer_kernel<mgui_simd_swar64> mgui_kernel;
+#else
+typedef mgui_buffer_kernel<mgui_simd_swar32> mgui_kernel;
+#endif
+
+/**
+ * @brief
+ * Bit-matrix operations on page-ordered LCD buffers.
+ * A page-ordered buffer stores 8 vertical pixels per byte (bit 0 is the top),
+ * and the bytes of each page of 8 rows are arranged from left to right.
+ * Eight consecutive bytes of a page therefore form an 8x8 bit matrix that
+ * can be transposed in a few register operations.
+ *
+ * @remarks
+ * The kernels load 8 bytes into one word and assume a little-endian CPU.
+ */
+class mgui_bit_matrix {
+public:
+    /**
+     * @brief Transpose an 8x8 bit matrix held in a 64-bit word.
+     *
+     * @param x Byte i holds row i, bit j of the byte holds column j.
+     * @return mgui_word64 Byte j holds column j, bit i of the byte holds row i.
+     */
+    static inline mgui_word64 transpose8x8_64(mgui_word64 x) {
+        mgui_word64 t;
+        t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+        x = x ^ t ^ (t << 7);
+        t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+        x = x ^ t ^ (t << 14);
+        t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+        x = x ^ t ^ (t << 28);
+        return x;
+    }
+
+    /**
+     * @brief Transpose an 8x8 bit matrix using only 32-bit operations.
+     *
+     * @param lo Rows 0 to 3 of the matrix. It receives columns 0 to 3.
+     * @param hi Rows 4 to 7 of the matrix. It receives columns 4 to 7.
+     */
+    static inline void transpose8x8_32(mgui_word32& lo, mgui_word32& hi) {
+        mgui_word32 t;
+        t = (lo ^ (lo >> 7)) & 0x00AA00AAU;
+        lo = lo ^ t ^ (t << 7);
+        t = (hi ^ (hi >> 7)) & 0x00AA00AAU;
+        hi = hi ^ t ^ (t << 7);
+        t = (lo ^ (lo >> 14)) & 0x0000CCCCU;
+        lo = lo ^ t ^ (t << 14);
+        t = (hi ^ (hi >> 14)) & 0x0000CCCCU;
+        hi = hi ^ t ^ (t << 14);
+        t = (lo ^ (hi << 4)) & 0xF0F0F0F0U;
+        lo = lo ^ t;
+        hi = hi ^ (t >> 4);
+    }
+
+    /**
+     * @brief Transpose an 8x8 bit matrix with the SWAR width set in MGUI_SWAR_BITS.
+     *
+     * @param x Byte i holds row i, bit j of the byte holds column j.
+     * @return mgui_word64 Byte j holds column j, bit i of the byte holds row i.
+     */
+    static inline mgui_word64 transpose8x8(mgui_word64 x) {
+#if MGUI_SWAR_BITS == 64
+        return transpose8x8_64(x);
+#else
+        mgui_word32 lo = (mgui_word32)x;
+        mgui_word32 hi = (mgui_word32)(x >> 32);
+        transpose8x8_32(lo, hi);
+        return ((mgui_word64)hi << 32) | lo;
+#endif
+    }
+
+#ifdef MGUI_USE_SSE2
+    /**
+     * @brief Transpose two horizontally adjacent 8x8 bit matrices with SSE2.
+     *
+     * @param src 16 bytes. Bytes 0-7 are the first matrix, bytes 8-15 the second.
+     * @param first Transposed first matrix
+     * @param second Transposed second matrix
+     */
+    static inline void transpose8x8x2_sse2(const uint8_t* src, mgui_word64& first, mgui_word64& second) {
+        // Same exchange network as transpose8x8_64, applied to both 64-bit lanes.
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i t;
+        t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 7)), _mm_set1_epi64x(0x00AA00AA00AA00AALL));
+        x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 7)));
+        t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 14)), _mm_set1_epi64x(0x0000CCCC0000CCCCLL));
+        x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 14)));
+        t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(x, 28)), _mm_set1_epi64x(0x00000000F0F0F0F0LL));
+        x = _mm_xor_si128(x, _mm_xor_si128(t, _mm_slli_epi64(t, 28)));
+
+        uint8_t out[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), x);
+        memcpy(&first, out, sizeof(first));
+        memcpy(&second, out + 8, sizeof(second));
+    }
+#endif
+
+    /**
+     * @brief Reverse the bit order of each byte in the word.
+     */
+    static inline mgui_word64 reverse_bits(mgui_word64 x) {
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        return x;
+    }
+
+    /**
+     * @brief Reverse the byte order of the word.
+     */
+    static inline mgui_word64 reverse_bytes(mgui_word64 x) {
+        x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+        x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+        return (x >> 32) | (x << 32);
+    }
+
+    /**
+     * @brief
+     * Copy a page-ordered buffer to another buffer while transposing and mirroring it.
+     * Rotations are combinations of these three operations.
+     *
+     * @param src Source buffer
+     * @param width Source width. It must be a multiple of 8.
+     * @param height Source height. It must be a multiple of 8.
+     * @param dst
+     * Destination buffer. If transpose is true, its width is the source height
+     * and its height is the source width.
+     * @param transpose If true, the pixel (x, y) is moved to (y, x)
+     * @param mirror_x If true, the destination is flipped left and right
+     * @param mirror_y If true, the destination is flipped up and down
+     */
+    static void transform(const uint8_t* src, int width, int height, uint8_t* dst,
+                          bool transpose, bool mirror_x, bool mirror_y) {
+        const int pages = height >> 3;
+        const int blocks = width >> 3;
+
+        if (!transpose) {
+            for (int page = 0; page < pages; page++) {
+                const uint8_t* s = src + page * width;
+                uint8_t* d = dst + (mirror_y ? pages - 1 - page : page) * width;
+                for (int block = 0; block < blocks; block++) {
+                    int column = mirror_x ? width - 8 - (block << 3) : (block << 3);
+                    store(d + column, load(s + (block << 3)), mirror_x, mirror_y);
+                }
+            }
+            return;
+        }
+
+        // The destination is "height" pixels wide and "width" pixels high.
+        for (int page = 0; page < pages; page++) {
+            const uint8_t* s = src + page * width;
+            int column = mirror_x ? height - 8 - (page << 3) : (page << 3);
+            int block = 0;
+#ifdef MGUI_USE_SSE2
+            for (; block + 1 < blocks; block += 2) {
+                mgui_word64 first, second;
+                transpose8x8x2_sse2(s + (block << 3), first, second);
+                store(dst + dst_page(block, blocks, mirror_y) * height + column, first, mirror_x, mirror_y);
+                store(dst + dst_page(block + 1, blocks, mirror_y) * height + column, second, mirror_x, mirror_y);
+            }
+#endif
+            for (; block < blocks; block++) {
+                mgui_word64 t = transpose8x8(load(s + (block << 3)));
+                store(dst + dst_page(block, blocks, mirror_y) * height + column, t, mirror_x, mirror_y);
+            }
+        }
+    }
+
+private:
+    static inline int dst_page(int block, int blocks, bool mirror_y) {
+        return mirror_y ? blocks - 1 - block : block;
+    }
+
+    static inline mgui_word64 load(const uint8_t* p) {
+        mgui_word64 x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
+
+    static inline void store(uint8_t* p, mgui_word64 x, bool mirror_x, bool mirror_y) {
+        if (mirror_y) x = reverse_bits(x);
+        if (mirror_x) x = reverse_bytes(x);
+        memcpy(p, &x, sizeof(x));
+    }
+};
+
+/**
+ * @brief
+ * Rotation and mirroring settings of the screen.
+ * The screen is drawn in the rotated coordinate system and converted to the
+ * coordinate system of the LCD by a post-pass on the whole buffer.
+ */
+class mgui_orientation {
+public:
+    mgui_orientation() {
+        rotation_ = mgui_rotation::Rotate0;
+        mirror_x_ = false;
+        mirror_y_ = false;
+    }
+
+    /**
+     * @brief Set the rotation and mirroring.
+     *
+     * @param rotation Clockwise rotation
+     * @param mirror_x If true, the rotated screen is flipped left and right
+     * @param mirror_y If true, the rotated screen is flipped up and down
+     */
+    inline void set(mgui_rotation rotation, bool mirror_x = false, bool mirror_y = false) {
+        rotation_ = rotation;
+        mirror_x_ = mirror_x;
+        mirror_y_ = mirror_y;
+    }
+
+    inline mgui_rotation rotation() const { return rotation_; }
+    inline bool mirror_x() const { return mirror_x_; }
+    inline bool mirror_y() const { return mirror_y_; }
+
+    /**
+     * @brief Check if the drawn width and height are swapped on the LCD.
+     */
+    inline bool transpose() const {
+        return rotation_ == mgui_rotation::Rotate90 || rotation_ == mgui_rotation::Rotate270;
+    }
+
+    /**
+     * @brief Check if the buffer can be output without conversion.
+     */
+    inline bool identity() const {
+        return !transpose() && !flip_x() && !flip_y();
+    }
+
+    /**
+     * @brief Check if apply() can convert a buffer of the size.
+     * Every conversion works on 8x8 blocks, so only the identity allows other sizes.
+     */
+    inline bool supports(int width, int height) const {
+        return identity() || ((width & 7) == 0 && (height & 7) == 0);
+    }
+
+    /**
+     * @brief Convert a drawn buffer to the LCD buffer.
+     *
+     * @param src Drawn buffer
+     * @param width Drawn width. It must be a multiple of 8.
+     * @param height Drawn height. It must be a multiple of 8.
+     * @param dst LCD buffer
+     */
+    inline void apply(const uint8_t* src, int width, int height, uint8_t* dst) const {
+        mgui_bit_matrix::transform(src, width, height, dst, transpose(), flip_x(), flip_y());
+    }
+
+private:
+    // 90 degrees is a transpose followed by a left-right flip,
+    // 270 degrees is a transpose followed by an up-down flip.
+    inline bool flip_x() const {
+        bool flip = rotation_ == mgui_rotation::Rotate90 || rotation_ == mgui_rotation::Rotate180;
+        return flip != mirror_x_;
+    }
+
+    inline bool flip_y() const {
+        bool flip = rotation_ == mgui_rotation::Rotate180 || rotation_ == mgui_rotation::Rotate270;
+        return flip != mirror_y_;
+    }
+
+    mgui_rotation rotation_;
+    bool mirror_x_;
+    bool mirror_y_;
+};
+
+/**
+ * @brief Drawing operations recorded in mgui_draw_list.
+ */
+enum class mgui_draw_op {
+    Pixel,
+    PixelLevel,
+    Line,
+    LineStraight,
+    Circle,
+    Rectangle,
+    RectangleRounded,
+    Char,
+    Image,
+    Pattern,
+    Invert,
+    Clear
+};
+
+/**
+ * @brief A drawing operation and its arguments.
+ */
+struct mgui_draw_command {
+    mgui_draw_op op;
+    uint8_t flags;
+    uint8_t intensity;
+    short v[6];
+    int index;
+    const void* resource;
+};
+
+/**
+ * @brief
+ * Fixed-capacity list of drawing operations.
+ * mgui_draw records into it instead of drawing (see mgui_draw::set_recorder),
+ * so that a frame can be drawn again in parts (bands) without updating the objects again.
+ */
+class mgui_draw_list {
+public:
+    /**
+     * @brief Construct a new draw list
+     *
+     * @param capacity Maximum number of operations in a frame
+     */
+    explicit mgui_draw_list(int capacity) {
+        capacity_ = capacity;
+        commands_ = mgui_alloc<mgui_draw_command>(capacity, mgui_memory_tag::Screen);
+        count_ = 0;
+        overflow_ = false;
+    }
+
+    ~mgui_draw_list() {
+        mgui_free(commands_, capacity_, mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief Remove all operations.
+     */
+    inline void clear() {
+        count_ = 0;
+        overflow_ = false;
+    }
+
+    /**
+     * @brief Append an operation.
+     *
+     * @return mgui_draw_command* The operation to be set, or nullptr if the list is full.
+     */
+    inline mgui_draw_command* add() {
+        if (count_ == capacity_) {
+            overflow_ = true;
+            return nullptr;
+        }
+        return &commands_[count_++];
+    }
+
+    inline const mgui_draw_command& get(int index) const { return commands_[index]; }
+    inline int count() const { return count_; }
+    inline int capacity() const { return capacity_; }
+
+    /**
+     * @brief If true, operations were dropped since the last clear().
+     */
+    inline bool overflow() const { return overflow_; }
+
+private:
+    mgui_draw_command* commands_;
+    int capacity_;
+    int count_;
+    bool overflow_;
+};
+
+#ifdef MGUI_OVERDRAW
+/**
+ * @brief
+ * Number of writes per pixel of a frame (debug mode, defined with MGUI_OVERDRAW).
+ * Set it with mgui_draw::set_overdraw; update_lcd() starts a new frame and
+ * attributes the writes to the type of the object being drawn.
+ *
+ * @remarks
+ * clear() is not counted. The positions are in drawing coordinates (before rotation)
+ * of the buffer. A count stops at 255.
+ */
+class mgui_overdraw {
+public:
+    /**
+     * @brief Object types and OTHER for drawing outside an object
+     */
+    static const int TYPES = TouchController + 2;
+    static const int OTHER = TouchController + 1;
+
+    mgui_overdraw(const int width, const int height) {
+        width_ = width;
+        height_ = height;
+        counts_ = new uint8_t[width * height];
+        types_ = new uint16_t[width * height];
+        type_ = OTHER;
+        frames_ = 0;
+        total_writes_ = 0;
+        total_unique_ = 0;
+        begin_frame();
+    }
+
+    ~mgui_overdraw() {
+        delete[] counts_;
+        delete[] types_;
+    }
+
+    /**
+     * @brief Clear the counts of the frame.
+     */
+    inline void begin_frame() {
+        memset(counts_, 0, width_ * height_);
+        memset(types_, 0, width_ * height_ * sizeof(uint16_t));
+        for (int i = 0; i < TYPES; i++) {
+            writes_[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Add the frame to the totals.
+     */
+    inline void end_frame() {
+        frames_++;
+        total_writes_ += writes();
+        total_unique_ += unique();
+    }
+
+    /**
+     * @brief Type the following writes are attributed to (mgui_object_type or OTHER).
+     */
+    inline void set_type(int type) { type_ = type; }
+    inline int type() const { return type_; }
+
+    inline void add(int x, int y) {
+        const int i = y * width_ + x;
+        if (counts_[i] != 0xFF) {
+            counts_[i]++;
+        }
+        types_[i] |= (uint16_t)(1 << type_);
+        writes_[type_]++;
+    }
+
+    inline void add_rect(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                add(x, y);
+            }
+        }
+    }
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline int count(int x, int y) const { return counts_[y * width_ + x]; }
+
+    /**
+     * @brief Pixel writes of the frame.
+     */
+    inline long writes() const {
+        long total = 0;
+        for (int i = 0; i < TYPES; i++) {
+            total += writes_[i];
+        }
+        return total;
+    }
+
+    /**
+     * @brief Pixels written at least once in the frame.
+     */
+    inline int unique() const {
+        int total = 0;
+        for (int i = 0; i < width_ * height_; i++) {
+            total += counts_[i] != 0;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Largest count of the frame.
+     */
+    inline int max() const {
+        int result = 0;
+        for (int i = 0; i < width_ * height_; i++) {
+            if (counts_[i] > result) {
+                result = counts_[i];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Pixel writes of a type in the frame.
+     */
+    inline long writes(int type) const { return writes_[type]; }
+
+    /**
+     * @brief Pixels written by a type in the frame.
+     */
+    inline int unique(int type) const {
+        int total = 0;
+        for (int i = 0; i < width_ * height_; i++) {
+            total += (types_[i] >> type) & 1;
+        }
+        return total;
+    }
+
+    inline long frames() const { return frames_; }
+    inline long long total_writes() const { return total_writes_; }
+    inline long long total_unique() const { return total_unique_; }
+
+private:
+    int width_;
+    int height_;
+    uint8_t* counts_;
+    uint16_t* types_;
+    int type_;
+    long writes_[TYPES];
+    long frames_;
+    long long total_writes_;
+    long long total_unique_;
+};
+
+/**
+ * @brief Attributes the writes of the scope to an object type.
+ */
+class mgui_overdraw_scope {
+public:
+    mgui_overdraw_scope(mgui_overdraw* overdraw, int type) {
+        overdraw_ = overdraw;
+        if (overdraw_ != nullptr) {
+            previous_ = overdraw_->type();
+            overdraw_->set_type(type);
+        }
+    }
+
+    ~mgui_overdraw_scope() {
+        if (overdraw_ != nullptr) {
+            overdraw_->set_type(previous_);
+        }
+    }
+
+private:
+    mgui_overdraw* overdraw_;
+    int previous_;
+};
+
+/**
+ * @brief Counts a frame of update_lcd().
+ */
+class mgui_overdraw_frame {
+public:
+    explicit mgui_overdraw_frame(mgui_overdraw* overdraw) {
+        overdraw_ = overdraw;
+        if (overdraw_ != nullptr) {
+            overdraw_->begin_frame();
+        }
+    }
+
+    ~mgui_overdraw_frame() {
+        if (overdraw_ != nullptr) {
+            overdraw_->end_frame();
+        }
+    }
+
+private:
+    mgui_overdraw* overdraw_;
+};
+
+#define MGUI_OVERDRAW_FRAME(draw) mgui_overdraw_frame mgui_overdraw_frame_((draw)->overdraw())
+#define MGUI_OVERDRAW_OBJECT(draw, type) mgui_overdraw_scope mgui_overdraw_scope_((draw)->overdraw(), type)
+#else
+#define MGUI_OVERDRAW_FRAME(draw)
+#define MGUI_OVERDRAW_OBJECT(draw, type)
+#endif
+
+/**
+ * @brief 
+ * Set a pixel, line, or shape at an arbitrary position in the preallocated lcd buffer array
+ */
+class mgui_draw {
+public:
+
+    /**
+     * @brief Construct a new mgui draw object
      * 
-     * @param font 
-     * @param x x position in the upper left corner of the text display
-     * @param y y position in the upper left corner of the text display
-     * @param index  Starting position of font resource loading (returned value of mgui_font::search)
-     * @param invert If true, invert buffer color of font resource
-     * @param font_start_x Starting pixel position x-coordinate of font resource setting to be displayed
-     * @param font_start_y Starting pixel position y-coordinate of font resource setting to be displayed
-     * @param font_end_x 
-     * End pixel position x-coordinate of the font resource setting to be displayed.
-     * (If 0, the size of the font resource setting is applied.)
-     * @param font_end_y
-     * End pixel position y-coordinate of the font resource setting to be displayed. 
-     * (If 0, the size of the font resource setting is applied.)
+     * @param width Target LCD width
+     * @param height Target LCD height
+     * @param buffer Buffer to reflect drawing results
+     * @param format Pixel format of the buffer
      */
-    inline void draw_char(const mgui_font *font,
-                          const int& x,
-                          const int& y,
+    explicit mgui_draw(const uint16_t width, const uint16_t height, uint8_t *buffer,
+                       const mgui_pixel_format format = mgui_pixel_format::Mono1){
+        lcd_width_ = width;
+        lcd_height_ = height;
+        lcd_buffer_ = buffer;
+        format_ = format;
+        bpp_ = bits_per_pixel(format);
+        stride_ = (width * bpp_) >> 3;
+        origin_x_ = 0;
+        origin_y_ = 0;
+        recorder_ = nullptr;
+        animating_ = false;
+        deferring_ = false;
+        deferred_ = 0;
+#ifdef MGUI_OVERDRAW
+        overdraw_ = nullptr;
+#endif
+        set_intensity(0xFF);
+    }
+
+    /**
+     * @brief Destroy the mgui draw object
+     */
+    ~mgui_draw(){}
+
+    /**
+     * @brief Drawing circle
+     * 
+     * @param x0 center point of X
+     * @param y0 center point of Y
+     * @param r  radius
+     * @param fill If true, set fill circle
+     */
+    void draw_circle(int x0, int y0, int r, bool fill = false) {
+        if (recorder_) {
+            record(mgui_draw_op::Circle, fill, x0, y0, r);
+            return;
+        }
+
+        if(fill){
+            draw_circle_fill(x0, y0, r);
+            return;
+        }
+
+        int x = r;
+        int y = 0;
+        int f = -(r << 1) + 3;
+
+        while (x >= y)
+        {
+            // 1
+            draw_pixel(x0 + x, y0 + y, true);
+            draw_pixel(x0 + y, y0 - x, true);
+
+            // 2
+            draw_pixel(x0 + x, y0 - y, true);
+            draw_pixel(x0 + y, y0 + x, true);
+
+            // 3
+            draw_pixel(x0 - x, y0 + y, true);
+            draw_pixel(x0 - y, y0 + x, true);
+            
+            // 4
+            draw_pixel(x0 - x, y0 - y, true);
+            draw_pixel(x0 - y, y0 - x, true);
+            
+            if (f >= 0)
+            {
+                x--;
+                f -= (x << 2);
+            }
+            y++;
+            f += (y << 2) + 2;
+        }
+    }
+
+    /**
+     * @brief Drawing rounded rectangle
+     * 
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position at bottom right
+     * @param r rounded corner radius
+     * @param fill If you want to fill the figure, set true
+     * @param on if true, set 1; if false, set 0
+     */
+    void draw_rectangle_rounded(int x0, int y0, int x1, int y1, int r, bool fill = false, bool on = true){
+        if (recorder_) {
+            record(mgui_draw_op::RectangleRounded, fill | (on << 1), x0, y0, x1, y1, r);
+            return;
+        }
+
+        if(fill){
+            draw_rectangle_rounded_fill(x0, y0, x1, y1, r, on);
+            return;
+        }
+
+        int x = r;
+        int y = 0;
+        int f = -(r << 1) + 3;
+
+        int px0 = x0 + r;
+        int px1 = x1 - r;
+        int py0 = y0 + r;
+        int py1 = y1 - r;
+
+        while (x >= y)
+        {
+            // 1
+            draw_pixel(px1 + x, py0 - y, on);
+            draw_pixel(px1 + y, py0 - x, on);
+            
+            // 2
+            draw_pixel(px1 + x, py1 + y, on);
+            draw_pixel(px1 + y, py1 + x, on);
+            
+            // 3
+            draw_pixel(px0 - x, py1 + y, on);
+            draw_pixel(px0 - y, py1 + x, on);
+
+            // 4
+            draw_pixel(px0 - x, py0 - y, on);
+            draw_pixel(px0 - y, py0 - x, on);
+            if (f >= 0)
+            {
+                x--;
+                f -= (x << 2);
+            }
+            y++;
+            f += (y << 2) + 2;
+        }
+
+        fill_span_h(px0, px1, y0, on);
+        fill_span_h(px0, px1, y1, on);
+        fill_span_v(x0, py0, py1, on);
+        fill_span_v(x1, py0, py1, on);
+    }
+
+    /**
+     * @brief Drawing rectangle
+     * 
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position at bottom right
+     * @param fill If you want to fill the figure, set true
+     * @param on if true, set 1; if false, set 0
+     */
+    void draw_rectangle(int x0, int y0, int x1, int y1, bool fill = false, bool on = true){
+        if (recorder_) {
+            record(mgui_draw_op::Rectangle, fill | (on << 1), x0, y0, x1, y1);
+            return;
+        }
+
+        if(fill){
+            draw_rectangle_fill(x0, y0, x1, y1, on);
+            return;
+        }
+
+        fill_span_h(x0, x1, y0, on);
+        fill_span_h(x0, x1, y1, on);
+        fill_span_v(x0, y0, y1, on);
+        fill_span_v(x1, y0, y1, on);
+    }
+
+    /**
+     * @brief Drawing triangle
+     * 
+     * @param x0 x position 0
+     * @param y0 y position 0
+     * @param x1 x position 1
+     * @param y1 y position 1
+     * @param x2 x position 2
+     * @param y2 y position 2
+     * @param invert if true, set 0; if false, set 1
+     */
+    void draw_triangle(int x0, int y0, int x1, int y1, int x2, int y2, bool invert = false) {
+        
+        draw_line(x0, y0, x1, y1, !invert);
+        draw_line(x0, y0, x2, y2, !invert);
+        draw_line(x1, y1, x2, y2, !invert);
+    }
+
+    /**
+     * @brief Drawing straight line
+     * 
+     * @param x0 x position at start
+     * @param y0 y position at start
+     * @param x1 x position at end
+     * @param y1 y position at end
+     * @param on if true, set 1; if false, set 0
+     */
+    void draw_line(int x0, int y0, int x1, int y1, bool on){
+        if (recorder_) {
+            record(mgui_draw_op::Line, on << 1, x0, y0, x1, y1);
+            return;
+        }
+
+        int sx = x0 < x1 ? 1 : -1;
+        int sy = y0 < y1 ? 1 : -1;
+        int dx = sx * (x1 - x0);
+        int dy = -sy * (y1 - y0);
+        int err = dx + dy;
+        int e2;
+
+        while (x0 != x1 || y0 != y1)
+        {
+            draw_pixel(x0, y0, on);
+
+            e2 = 2 * err;
+
+            if (e2 >= dy)
+            {
+                err += dy;
+                x0 += sx;
+            } else {
+                err += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    /**
+     * @brief Drawing straight line other than diagonals
+     * 
+     * @param x0 x position at start
+     * @param y0 y position at start
+     * @param length straight line length
+     * @param on if true, set 1; if false, set 0
+     * @param direction Direction for drawing a straight line
+     */
+    void draw_line_straight(int x0, int y0, int length, bool on, mgui_draw_line_dir direction) {
+        if (recorder_) {
+            record(mgui_draw_op::LineStraight, (on << 1) | (direction == mgui_draw_line_dir::Left ? 4 : 0),
+                   x0, y0, length);
+            return;
+        }
+
+        if (direction == mgui_draw_line_dir::Left) {
+            fill_span_h(x0, x0 + length - 1, y0, on);
+            return;
+        }
+
+        fill_span_v(x0, y0, y0 + length - 1, on);
+    }
+
+    /**
+     * @brief Sets the color at the specified position
+     * The point outside the set height and width are ignored.
+     * 
+     * @param x x position
+     * @param y y position
+     * @param on 
+     * If true, the bit at the position corresponding to (x,y) is set to 1;
+     * if false, it is set to 0
+     */
+    void draw_pixel(int x, int y, bool on){
+        if (recorder_) {
+            record(mgui_draw_op::Pixel, on << 1, x, y);
+            return;
+        }
+
+        put_pixel(x - origin_x_, y - origin_y_, on);
+    }
+
+    /**
+     * @brief 
+     * Draw an arbitrary character from mgui_font resource
+     * 
+     * @param font 
+     * @param x x position in the upper left corner of the text display
+     * @param y y position in the upper left corner of the text display
+     * @param index  Starting position of font resource loading (returned value of mgui_font::search)
+     * @param invert If true, invert buffer color of font resource
+     * @param font_start_x Starting pixel position x-coordinate of font resource setting to be displayed
+     * @param font_start_y Starting pixel position y-coordinate of font resource setting to be displayed
+     * @param font_end_x 
+     * End pixel position x-coordinate of the font resource setting to be displayed.
+     * (If 0, the size of the font resource setting is applied.)
+     * @param font_end_y
+     * End pixel position y-coordinate of the font resource setting to be displayed. 
+     * (If 0, the size of the font resource setting is applied.)
+     */
+    inline void draw_char(const mgui_font *font,
+                          const int& x,
+                          const int& y,
                           const int& index,
                           bool invert = false,
                           const int& font_start_x = 0,
                           const int& font_start_y = 0,
                           const int& font_end_x = 0,
                           const int& font_end_y = 0) {
-        
+        if (recorder_) {
+            record(mgui_draw_op::Char, invert << 2, x, y, font_start_x, font_start_y, font_end_x, font_end_y,
+                   font, index);
+            return;
+        }
+
         int x_end = ((font_end_x == 0)? font->width() : font_end_x);
         int y_end = ((font_end_y == 0)? font->height() : font_end_y);
 
-        for (int y1 = font_start_y; y1 < y_end; y1++) {
-            for (int x1 = font_start_x; x1 < x_end; x1++) {
-                int pos = index + y1 / 8 * font->width() + x1;
-                bool checkbit = check_bit_on(x1, y1, font->resource()[pos]);
-                if (checkbit) {
-                    draw_pixel(x + x1, y + y1, (invert) ? !checkbit : checkbit);
-                }
+        if (font->antialiased()) {
+            draw_char_aa(static_cast<const mgui_font_aa*>(font), x, y, index, invert,
+                         font_start_x, font_start_y, x_end, y_end);
+            return;
+        }
+
+        if (font->bits_per_pixel() > 1) {
+            draw_levels(font, font->resource() + index, x, y, invert,
+                        font_start_x, font_start_y, x_end, y_end);
+            return;
+        }
+
+        for (int y1 = font_start_y; y1 < y_end; y1++) {
+            for (int x1 = font_start_x; x1 < x_end; x1++) {
+                int pos = index + y1 / 8 * font->width() + x1;
+                bool checkbit = check_bit_on(x1, y1, font->resource()[pos]);
+                if (checkbit) {
+                    draw_pixel(x + x1, y + y1, (invert) ? !checkbit : checkbit);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Draw an image on the LCD buffer.
+     * 
+     * @param image A pointer to the image property object.
+     * @param x The x-coordinate of the upper left corner of the image.
+     * @param y The y-coordinate of the upper left corner of the image.
+     * @param invert If true, the buffer color of the image will be inverted. Default is false.
+     */
+    inline void draw_image(const mgui_image_property *image,
+                          const int& x,
+                          const int& y,
+                          bool invert = false) {
+        if (recorder_) {
+            record(mgui_draw_op::Image, invert << 2, x, y, 0, 0, 0, 0, image);
+            return;
+        }
+
+        if (image->bits_per_pixel() > 1) {
+            draw_levels(image, image->resource(), x, y, invert,
+                        0, 0, image->width(), image->height());
+            return;
+        }
+
+        // Iterate over the image height
+        for (int y1 = 0; y1 < image->height(); y1++) {
+            // Iterate over the image width
+            for (int x1 = 0; x1 < image->width(); x1++) {
+                // Calculate the position in the image resource
+                int pos = y1 / 8 * image->width() + x1;
+                // Check if the bit at the current position is set
+                bool checkbit = check_bit_on(x1, y1, image->resource()[pos]);
+                // Draw the pixel on the LCD buffer if the bit is set
+                if (checkbit) {
+                    draw_pixel(x + x1, y + y1, (invert) ? !checkbit : checkbit);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Set all pixels of the buffer.
+     *
+     * @param on if true, set 1; if false, set 0
+     */
+    inline void clear(bool on = false) {
+        if (recorder_) {
+            record(mgui_draw_op::Clear, on << 1);
+            return;
+        }
+
+        mgui_kernel::fill(lcd_buffer_, on ? 0xFF : 0x00, buffer_size());
+    }
+
+    /**
+     * @brief Invert all pixels of the buffer.
+     */
+    inline void invert() {
+        if (recorder_) {
+            record(mgui_draw_op::Invert, 0);
+            return;
+        }
+
+        mgui_kernel::invert(lcd_buffer_, buffer_size());
+        count_writes(0, 0, lcd_width_ - 1, lcd_height_ - 1);
+    }
+
+    /**
+     * @brief Composite a buffer of the same size over this buffer (OR).
+     * It is ignored while recording.
+     *
+     * @param src Buffer of the same width and height
+     */
+    inline void composite(const uint8_t* src) {
+        if (recorder_) {
+            return;
+        }
+
+        mgui_kernel::or_into(lcd_buffer_, src, buffer_size());
+        count_writes(0, 0, lcd_width_ - 1, lcd_height_ - 1);
+    }
+
+    /**
+     * @brief Fill a rectangle with a repeating 8x8 pattern.
+     *
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position at bottom right
+     * @param pattern
+     * 8 bytes, one per column. Bit n of a byte is row n of the tile.
+     * The tile is aligned to the screen origin.
+     * While recording, the pattern must remain valid until the list is drawn.
+     */
+    inline void fill_pattern(int x0, int y0, int x1, int y1, const uint8_t pattern[8]) {
+        if (recorder_) {
+            record(mgui_draw_op::Pattern, 0, x0, y0, x1, y1, 0, 0, pattern);
+            return;
+        }
+
+        if (!clip(x0, y0, x1, y1)) {
+            return;
+        }
+
+        if (format_ != mgui_pixel_format::Mono1) {
+            for (int y = y0; y <= y1; y++) {
+                const int row = (y + origin_y_) & 7;
+                for (int x = x0; x <= x1; x++) {
+                    put_level(x, y, ((pattern[(x + origin_x_) & 7] >> row) & 1) ? ink_ : 0);
+                }
+            }
+            return;
+        }
+
+        for (int page = y0 >> 3; page <= (y1 >> 3); page++) {
+            mgui_kernel::fill_pattern(lcd_buffer_ + page * lcd_width_ + x0,
+                pattern, (x0 + origin_x_) & 7, page_mask(page, y0, y1), x1 - x0 + 1);
+        }
+        count_writes(x0, y0, x1, y1);
+    }
+
+    /**
+     * @brief It returns the buffer size in bytes.
+     */
+    inline int buffer_size() const { return buffer_size(lcd_width_, lcd_height_, format_); }
+
+    /**
+     * @brief It returns the buffer size in bytes required for the screen.
+     *
+     * @param width Screen width (a multiple of 8 / bits per pixel for grayscale)
+     * @param height Screen height (a multiple of 8 for Mono1)
+     * @param format Pixel format of the buffer
+     */
+    static inline int buffer_size(int width, int height, mgui_pixel_format format) {
+        if (format == mgui_pixel_format::Mono1) {
+            return width * (height >> 3);
+        }
+        return ((width * bits_per_pixel(format)) >> 3) * height;
+    }
+
+    /**
+     * @brief Number of bits per pixel of the format.
+     */
+    static inline int bits_per_pixel(mgui_pixel_format format) {
+        return format == mgui_pixel_format::Gray4 ? 4
+             : format == mgui_pixel_format::Gray2 ? 2 : 1;
+    }
+
+    /**
+     * @brief It returns the pixel format of the buffer.
+     */
+    inline mgui_pixel_format format() const { return format_; }
+
+    /**
+     * @brief Set the intensity used to draw pixels that are on.
+     *
+     * @remarks
+     * The intensity is scaled to the levels of the pixel format
+     * (Gray2: intensity >> 6, Gray4: intensity >> 4). Mono1 ignores it.
+     *
+     * @param intensity 0 (black) to 255 (full)
+     */
+    inline void set_intensity(uint8_t intensity) {
+        intensity_ = intensity;
+        ink_ = (uint8_t)(intensity >> (8 - bpp_));
+    }
+
+    /**
+     * @brief It returns the intensity used to draw pixels that are on.
+     */
+    inline uint8_t intensity() const { return intensity_; }
+
+    /**
+     * @brief Sets the level at the specified position of a grayscale buffer.
+     * The point outside the set height and width are ignored.
+     *
+     * @param x x position
+     * @param y y position
+     * @param level Level of the pixel format (Gray2: 0-3, Gray4: 0-15)
+     */
+    inline void draw_pixel_level(int x, int y, uint8_t level) {
+        if (recorder_) {
+            record(mgui_draw_op::PixelLevel, 0, x, y, level);
+            return;
+        }
+
+        put_level(x - origin_x_, y - origin_y_, level);
+    }
+
+    /**
+     * @brief It returns the level at the specified position of a grayscale buffer.
+     * The position must be inside the buffer.
+     */
+    inline uint8_t pixel_level(int x, int y) const {
+        return level_at(x - origin_x_, y - origin_y_);
+    }
+
+    /**
+     * @brief Set the position drawn at the upper left corner of the buffer.
+     *
+     * @remarks
+     * Drawing is translated by (-x, -y) and clipped to the buffer.
+     * Used to draw a screen in bands with a buffer smaller than the screen.
+     * For Mono1, y should be a multiple of 8 so that patterns stay aligned.
+     *
+     * @param x x position of the screen at the left of the buffer
+     * @param y y position of the screen at the top of the buffer
+     */
+    inline void set_origin(int x, int y) {
+        origin_x_ = x;
+        origin_y_ = y;
+    }
+
+    inline int origin_x() const { return origin_x_; }
+    inline int origin_y() const { return origin_y_; }
+
+    /**
+     * @brief Record the drawing operations into the list instead of drawing them.
+     *
+     * @param list Destination list, or nullptr to draw again
+     */
+    inline void set_recorder(mgui_draw_list* list) { recorder_ = list; }
+
+    /**
+     * @brief Draw the recorded operations of the list.
+     *
+     * @param list Recorded list
+     */
+    inline void replay(const mgui_draw_list* list) {
+        mgui_draw_list* recorder = recorder_;
+        const uint8_t intensity = intensity_;
+        recorder_ = nullptr;
+
+        for (int i = 0; i < list->count(); i++) {
+            const mgui_draw_command& c = list->get(i);
+            const bool fill = c.flags & 1;
+            const bool on = (c.flags >> 1) & 1;
+            const bool flag = (c.flags >> 2) & 1;
+            set_intensity(c.intensity);
+
+            switch (c.op) {
+            case mgui_draw_op::Pixel:
+                draw_pixel(c.v[0], c.v[1], on);
+                break;
+            case mgui_draw_op::PixelLevel:
+                draw_pixel_level(c.v[0], c.v[1], (uint8_t)c.v[2]);
+                break;
+            case mgui_draw_op::Line:
+                draw_line(c.v[0], c.v[1], c.v[2], c.v[3], on);
+                break;
+            case mgui_draw_op::LineStraight:
+                draw_line_straight(c.v[0], c.v[1], c.v[2], on,
+                                   flag ? mgui_draw_line_dir::Left : mgui_draw_line_dir::Down);
+                break;
+            case mgui_draw_op::Circle:
+                draw_circle(c.v[0], c.v[1], c.v[2], fill);
+                break;
+            case mgui_draw_op::Rectangle:
+                draw_rectangle(c.v[0], c.v[1], c.v[2], c.v[3], fill, on);
+                break;
+            case mgui_draw_op::RectangleRounded:
+                draw_rectangle_rounded(c.v[0], c.v[1], c.v[2], c.v[3], c.v[4], fill, on);
+                break;
+            case mgui_draw_op::Char:
+                draw_char(static_cast<const mgui_font*>(c.resource), c.v[0], c.v[1], c.index, flag,
+                          c.v[2], c.v[3], c.v[4], c.v[5]);
+                break;
+            case mgui_draw_op::Image:
+                draw_image(static_cast<const mgui_image_property*>(c.resource), c.v[0], c.v[1], flag);
+                break;
+            case mgui_draw_op::Pattern:
+                fill_pattern(c.v[0], c.v[1], c.v[2], c.v[3], static_cast<const uint8_t*>(c.resource));
+                break;
+            case mgui_draw_op::Invert:
+                invert();
+                break;
+            case mgui_draw_op::Clear:
+                clear(on);
+                break;
+            }
+        }
+
+        set_intensity(intensity);
+        recorder_ = recorder;
+    }
+
+    /**
+     * @brief It returns generated buffer.
+     * 
+     * @return uint8_t* 
+     */
+    uint8_t * lcd() { return lcd_buffer_; }
+
+    /**
+     * @brief Change the buffer to draw in. It must have the same size and format.
+     */
+    inline void set_lcd(uint8_t* buffer) { lcd_buffer_ = buffer; }
+
+    /**
+     * @brief
+     * Called by an object whose drawing changes without input (for example a moving text),
+     * so that the adaptive refresh of mgui and mgui_multi draws the next frame.
+     */
+    inline void animate() { animating_ = true; }
+
+    /**
+     * @brief It returns true if an object called animate() since begin_frame().
+     */
+    inline bool animating() const { return animating_; }
+
+    /**
+     * @brief
+     * If true, the frame is running out of its budget (see mgui::set_frame_budget),
+     * so the object being drawn should postpone its optional work and call defer().
+     */
+    inline bool deferring() const { return deferring_; }
+    inline void set_deferring(bool on) { deferring_ = on; }
+
+    /**
+     * @brief Called by an object which postponed work to a later frame.
+     */
+    inline void defer() {
+        deferred_++;
+        animate();
+    }
+
+    /**
+     * @brief Number of defer() since begin_frame()
+     */
+    inline int deferred() const { return deferred_; }
+
+    /**
+     * @brief Clear the requests of the objects (animate() and defer()) for a new frame.
+     */
+    inline void begin_frame() {
+        animating_ = false;
+        deferred_ = 0;
+    }
+
+#ifdef MGUI_OVERDRAW
+    /**
+     * @brief Count the writes per pixel into the map (nullptr to stop).
+     * The map must have the size of the buffer.
+     */
+    inline void set_overdraw(mgui_overdraw* overdraw) { overdraw_ = overdraw; }
+    inline mgui_overdraw* overdraw() const { return overdraw_; }
+#endif
+
+    /**
+     * @brief It returns the drawing width.
+     */
+    inline int width() const { return lcd_width_; }
+
+    /**
+     * @brief It returns the drawing height.
+     */
+    inline int height() const { return lcd_height_; }
+
+private:
+    
+    /**
+     * @brief drawing filled circle
+     *
+     * @param x0 center point of X
+     * @param y0 center point of Y
+     * @param r  radius
+     */
+    inline void draw_circle_fill(int x0, int y0, int r) {
+        int x = r;
+        int y = 0;
+        int f = -2 * r + 3;
+
+        if (format_ != mgui_pixel_format::Mono1) {
+            draw_circle_fill_rows(x0, y0, r);
+            return;
+        }
+
+        while (x >= y)
+        {
+            // Each octant point is extended to the center line as a span.
+            int d = x - 1;
+            fill_span_h(x0 - d, x0 + d, y0 + y, true);
+            fill_span_h(x0 - d, x0 + d, y0 - y, true);
+            fill_span_v(x0 + y, y0 - d, y0 + d, true);
+            fill_span_v(x0 - y, y0 - d, y0 + d, true);
+            
+            if (f >= 0)
+            {
+                x--;
+                f -= 4 * x;
+            }
+            y++;
+            f += 4 * y + 2;
+        }
+    }
+
+    /**
+     * @brief
+     * Same pixels as draw_circle_fill, but only with horizontal spans.
+     * (Row-major buffers write a row of bytes at a time.)
+     *
+     * @param x0 center point of X
+     * @param y0 center point of Y
+     * @param r  radius
+     */
+    inline void draw_circle_fill_rows(int x0, int y0, int r) {
+        int x = r;
+        int y = 0;
+        int f = -2 * r + 3;
+        int last_x = x;
+        int last_y = y;
+
+        while (x >= y)
+        {
+            int d = x - 1;
+            fill_span_h(x0 - d, x0 + d, y0 + y, true);
+            fill_span_h(x0 - d, x0 + d, y0 - y, true);
+
+            last_x = x;
+            last_y = y;
+            if (f >= 0)
+            {
+                // The vertical spans of the columns x0 +- y end at the row d.
+                if (d >= 0) {
+                    fill_span_h(x0 - y, x0 + y, y0 + d, true);
+                    fill_span_h(x0 - y, x0 + y, y0 - d, true);
+                }
+                x--;
+                f -= 4 * x;
+            }
+            y++;
+            f += 4 * y + 2;
+        }
+
+        for (int k = 0; k < last_x; k++) {
+            fill_span_h(x0 - last_y, x0 + last_y, y0 + k, true);
+            fill_span_h(x0 - last_y, x0 + last_y, y0 - k, true);
+        }
+    }
+
+    /**
+     * @brief Draw a filled rounded corner rectangle
+     * 
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position of bottom right
+     * @param r rounded corner radius
+     */
+    inline void draw_rectangle_rounded_fill(int x0, int y0, int x1, int y1, int r, bool on){
+        int x = r;
+        int y = 0;
+        int f = -(r << 1) + 3;
+
+        int px0 = x0 + r;
+        int px1 = x1 - r;
+        int py0 = y0 + r;
+        int py1 = y1 - r;
+
+        while (x >= y)
+        {
+            // 1
+            fill_span_h(px1, px1 + x, py0 - y, on);
+            fill_span_v(px1 + y, py0 - x, py0, on);
+
+            // 2
+            fill_span_h(px1, px1 + x, py1 + y, on);
+            fill_span_v(px1 + y, py1, py1 + x, on);
+
+            // 3
+            fill_span_h(px0 - x, px0, py1 + y, on);
+            fill_span_v(px0 - y, py1, py1 + x, on);
+
+            // 4
+            fill_span_h(px0 - x, px0, py0 - y, on);
+            fill_span_v(px0 - y, py0 - x, py0, on);
+
+            if (f >= 0)
+            {
+                x--;
+                f -= (x << 2);
+            }
+            y++;
+            f += (y << 2) + 2;
+        }
+
+        // fill side
+        draw_rectangle_fill(x0, py0, x0 + r, py1, on);
+        draw_rectangle_fill(px1, py0, px1 + r, py1, on);
+
+        draw_rectangle_fill(px0, y0, px1, y1, on);
+    }
+
+    /**
+     * @brief Draw a filled rectangle
+     * 
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position at bottom right
+     * @param on if true, set 1; if false, set 0
+     */
+    inline void draw_rectangle_fill(int x0, int y0, int x1, int y1, bool on){
+        if (!clip(x0, y0, x1, y1)) {
+            return;
+        }
+
+        if (format_ != mgui_pixel_format::Mono1) {
+            for (int y = y0; y <= y1; y++) {
+                fill_row_level(x0, x1, y, on ? ink_ : 0);
+            }
+            return;
+        }
+
+        const int length = x1 - x0 + 1;
+        for (int page = y0 >> 3; page <= (y1 >> 3); page++) {
+            uint8_t mask = page_mask(page, y0, y1);
+            uint8_t* p = lcd_buffer_ + page * lcd_width_ + x0;
+            if (on) {
+                mgui_kernel::or_mask(p, mask, length);
+            } else {
+                mgui_kernel::and_mask(p, ~mask, length);
+            }
+        }
+        count_writes(x0, y0, x1, y1);
+    }
+
+    /**
+     * @brief Draw a horizontal span. The points outside the screen are ignored.
+     *
+     * @param x0 x position at start
+     * @param x1 x position at end (inclusive)
+     * @param y y position
+     * @param on if true, set 1; if false, set 0
+     */
+    inline void fill_span_h(int x0, int x1, int y, bool on) {
+        draw_rectangle_fill(x0, y, x1, y, on);
+    }
+
+    /**
+     * @brief Draw a vertical span. The points outside the screen are ignored.
+     *
+     * @param x x position
+     * @param y0 y position at start
+     * @param y1 y position at end (inclusive)
+     * @param on if true, set 1; if false, set 0
+     */
+    inline void fill_span_v(int x, int y0, int y1, bool on) {
+        int x1 = x;
+        if (!clip(x, y0, x1, y1)) {
+            return;
+        }
+
+        if (format_ != mgui_pixel_format::Mono1) {
+            for (int y = y0; y <= y1; y++) {
+                put_level(x, y, on ? ink_ : 0);
+            }
+            return;
+        }
+
+        for (int page = y0 >> 3; page <= (y1 >> 3); page++) {
+            uint8_t mask = page_mask(page, y0, y1);
+            uint8_t* p = lcd_buffer_ + page * lcd_width_ + x;
+            *p = on ? (*p | mask) : (*p & ~mask);
+        }
+        count_writes(x, y0, x, y1);
+    }
+
+    /**
+     * @brief Append an operation with the current intensity to the recorder.
+     */
+    inline void record(mgui_draw_op op, int flags, int a = 0, int b = 0, int c = 0, int d = 0,
+                       int e = 0, int f = 0, const void* resource = nullptr, int index = 0) {
+        mgui_draw_command* command = recorder_->add();
+        if (command == nullptr) {
+            return;
+        }
+        command->op = op;
+        command->flags = (uint8_t)flags;
+        command->intensity = intensity_;
+        command->v[0] = (short)a;
+        command->v[1] = (short)b;
+        command->v[2] = (short)c;
+        command->v[3] = (short)d;
+        command->v[4] = (short)e;
+        command->v[5] = (short)f;
+        command->index = index;
+        command->resource = resource;
+    }
+
+    /**
+     * @brief Set a pixel at a position of the buffer. The points outside the buffer are ignored.
+     */
+    inline void put_pixel(int x, int y, bool on) {
+        if (format_ != mgui_pixel_format::Mono1) {
+            put_level(x, y, on ? ink_ : 0);
+            return;
+        }
+
+        if (x >= 0 && y >= 0 && x < lcd_width_ && y < lcd_height_) {
+            // Calculate the byte index.
+            int byte_idx = (y >> 3) * lcd_width_ + x;
+            uint8_t bit_idx = (1 << (y % 8));
+
+            // Set or clear the bit at the specified index.
+            lcd_buffer_[byte_idx]
+                = on ? (lcd_buffer_[byte_idx] | bit_idx)
+                        : (lcd_buffer_[byte_idx] & ~bit_idx);
+            count_writes(x, y, x, y);
+        }
+    }
+
+    /**
+     * @brief Set a level at a position of a grayscale buffer. The points outside the buffer are ignored.
+     */
+    inline void put_level(int x, int y, uint8_t level) {
+        if (x < 0 || y < 0 || x >= lcd_width_ || y >= lcd_height_) {
+            return;
+        }
+
+        const int bit = x * bpp_;
+        const int shift = 8 - bpp_ - (bit & 7);
+        const uint8_t mask = (uint8_t)(((1 << bpp_) - 1) << shift);
+        uint8_t* p = lcd_buffer_ + y * stride_ + (bit >> 3);
+        *p = (uint8_t)((*p & ~mask) | ((level << shift) & mask));
+        count_writes(x, y, x, y);
+    }
+
+    /**
+     * @brief It returns the level at a position of a grayscale buffer.
+     */
+    inline uint8_t level_at(int x, int y) const {
+        const int bit = x * bpp_;
+        const int shift = 8 - bpp_ - (bit & 7);
+        return (uint8_t)((lcd_buffer_[y * stride_ + (bit >> 3)] >> shift) & ((1 << bpp_) - 1));
+    }
+
+    /**
+     * @brief Fill a clipped row of a grayscale buffer with a level.
+     * The partial bytes at both ends are written per pixel and
+     * the whole bytes between them with the buffer kernel.
+     */
+    inline void fill_row_level(int x0, int x1, int y, uint8_t level) {
+        const int ppb = 8 / bpp_;
+        while (x0 <= x1 && (x0 & (ppb - 1)) != 0) {
+            put_level(x0++, y, level);
+        }
+        while (x1 >= x0 && ((x1 + 1) & (ppb - 1)) != 0) {
+            put_level(x1--, y, level);
+        }
+        if (x0 <= x1) {
+            mgui_kernel::fill(lcd_buffer_ + y * stride_ + x0 / ppb,
+                              (uint8_t)(level * (bpp_ == 4 ? 0x11 : 0x55)), (x1 - x0 + 1) / ppb);
+            count_writes(x0, y, x1, y);
+        }
+    }
+
+    /**
+     * @brief Blend an anti-aliased glyph into the buffer.
+     *
+     * @param font Anti-aliased font
+     * @param x x position in the upper left corner
+     * @param y y position in the upper left corner
+     * @param index Starting position of the glyph (returned value of mgui_font::search)
+     * @param invert If true, the glyph is blended towards level 0 instead of the ink
+     * @param start_x Starting x-coordinate in the glyph
+     * @param start_y Starting y-coordinate in the glyph
+     * @param end_x End x-coordinate in the glyph (exclusive)
+     * @param end_y End y-coordinate in the glyph (exclusive)
+     */
+    inline void draw_char_aa(const mgui_font_aa* font, int x, int y, int index, bool invert,
+                             int start_x, int start_y, int end_x, int end_y) {
+        const int src_bits = font->bits_per_pixel();
+        const int src_max = (1 << src_bits) - 1;
+
+        x -= origin_x_;
+        y -= origin_y_;
+        if (format_ == mgui_pixel_format::Mono1) {
+            for (int y1 = start_y; y1 < end_y; y1++) {
+                const uint8_t* row = font->resource() + index + y1 * font->stride();
+                for (int x1 = start_x; x1 < end_x; x1++) {
+                    const int bit = x1 * src_bits;
+                    const int coverage = (row[bit >> 3] >> (8 - src_bits - (bit & 7))) & src_max;
+                    if ((coverage << 1) > src_max) {
+                        put_pixel(x + x1, y + y1, !invert);
+                    }
+                }
+            }
+            return;
+        }
+
+        if (y + start_y < 0) start_y = -y;
+        if (y + end_y > lcd_height_) end_y = lcd_height_ - y;
+
+        const int ppb = 8 / bpp_;
+        const int max = (1 << bpp_) - 1;
+        mgui_font_aa::lock_scope lock(font);
+        const uint8_t* blend = font->blend_table(invert ? 0 : ink_, bpp_);
+
+        // The whole width of the glyph is on the screen: blend pre-shifted bytes.
+        const int stride = font->glyph_stride(bpp_);
+        if (start_x == 0 && end_x == font->width() && x >= 0 && x / ppb + stride <= stride_) {
+            const uint8_t* glyph = font->glyph(index, x & (ppb - 1), bpp_);
+            for (int y1 = start_y; y1 < end_y; y1++) {
+                const uint8_t* src = glyph + y1 * stride;
+                uint8_t* dst = lcd_buffer_ + (y + y1) * stride_ + x / ppb;
+                count_levels(src, stride, x - (x & (ppb - 1)), y + y1);
+                for (int i = 0; i < stride; i++) {
+                    const int coverage = src[i];
+                    if (coverage == 0) {
+                        continue;
+                    }
+                    int d = dst[i];
+                    if (bpp_ == 4) {
+                        d = (d & 0x0F) | (blend[(coverage & 0xF0) | (d >> 4)] << 4);
+                        d = (d & 0xF0) | blend[((coverage & 0x0F) << 4) | (d & 0x0F)];
+                        dst[i] = (uint8_t)d;
+                        continue;
+                    }
+                    for (int shift = 8 - bpp_; shift >= 0; shift -= bpp_) {
+                        const int c = (coverage >> shift) & max;
+                        if (c != 0) {
+                            d = (d & ~(max << shift)) | (blend[(c << bpp_) | ((d >> shift) & max)] << shift);
+                        }
+                    }
+                    dst[i] = (uint8_t)d;
+                }
+            }
+            return;
+        }
+
+        for (int y1 = start_y; y1 < end_y; y1++) {
+            const uint8_t* row = font->resource() + index + y1 * font->stride();
+            for (int x1 = start_x; x1 < end_x; x1++) {
+                const int px = x + x1;
+                if (px < 0 || px >= lcd_width_) {
+                    continue;
+                }
+                const int bit = x1 * src_bits;
+                int coverage = (row[bit >> 3] >> (8 - src_bits - (bit & 7))) & src_max;
+                if (coverage == 0) {
+                    continue;
+                }
+                coverage = (src_bits >= bpp_) ? (coverage >> (src_bits - bpp_)) : coverage * (max / src_max);
+                put_level(px, y + y1, blend[(coverage << bpp_) | level_at(px, y + y1)]);
+            }
+        }
+    }
+
+    /**
+     * @brief Draw a multi-bit image. Level 0 of the source is transparent.
+     *
+     * @param image Image or font property
+     * @param resource First byte of the image (or glyph)
+     * @param x x position in the upper left corner
+     * @param y y position in the upper left corner
+     * @param invert
+     * If true, levels are drawn as (max - level). On a one-bit screen, the levels
+     * above half are drawn (cleared if inverted) and the others are skipped.
+     * @param start_x Starting x-coordinate in the image
+     * @param start_y Starting y-coordinate in the image
+     * @param end_x End x-coordinate in the image (exclusive)
+     * @param end_y End y-coordinate in the image (exclusive)
+     */
+    inline void draw_levels(const mgui_image_property* image, const uint8_t* resource,
+                            int x, int y, bool invert, int start_x, int start_y, int end_x, int end_y) {
+        const int src_bpp = image->bits_per_pixel();
+        const int src_stride = image->stride();
+        const int src_max = (1 << src_bpp) - 1;
+
+        x -= origin_x_;
+        y -= origin_y_;
+        if (y + start_y < 0) start_y = -y;
+        if (y + end_y > lcd_height_) end_y = lcd_height_ - y;
+
+        // Same format and whole source bytes on the screen: blit packed bytes.
+        const int ppb = 8 / bpp_;
+        if (src_bpp == bpp_ && (start_x & (ppb - 1)) == 0 && ((end_x - start_x) & (ppb - 1)) == 0
+            && x + start_x >= 0 && x + end_x <= lcd_width_) {
+            const int shift = ((x + start_x) & (ppb - 1)) * bpp_;
+            for (int y1 = start_y; y1 < end_y; y1++) {
+                blit_row_levels(lcd_buffer_ + (y + y1) * stride_ + (x + start_x) / ppb,
+                                resource + y1 * src_stride + start_x / ppb,
+                                (end_x - start_x) / ppb, shift, invert);
+                count_levels(resource + y1 * src_stride + start_x / ppb, (end_x - start_x) / ppb,
+                             x + start_x, y + y1);
+            }
+            return;
+        }
+
+        for (int y1 = start_y; y1 < end_y; y1++) {
+            const uint8_t* row = resource + y1 * src_stride;
+            for (int x1 = start_x; x1 < end_x; x1++) {
+                const int bit = x1 * src_bpp;
+                int level = (row[bit >> 3] >> (8 - src_bpp - (bit & 7))) & src_max;
+                if (level == 0) {
+                    continue;
+                }
+                if (format_ == mgui_pixel_format::Mono1) {
+                    // like the anti-aliased text: only the levels above half are drawn
+                    if ((level << 1) > src_max) {
+                        put_pixel(x + x1, y + y1, !invert);
+                    }
+                    continue;
+                }
+                if (invert) {
+                    level = src_max - level;
+                }
+
+                if (src_bpp >= bpp_) {
+                    put_level(x + x1, y + y1, (uint8_t)(level >> (src_bpp - bpp_)));
+                } else {
+                    put_level(x + x1, y + y1, (uint8_t)(level * (((1 << bpp_) - 1) / src_max)));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief
+     * Copy the non-zero levels of a packed row.
+     * Aligned rows are copied a 32-bit word at a time.
+     *
+     * @param dst Destination row
+     * @param src Source row of the same pixel format
+     * @param bytes Number of source bytes
+     * @param shift Bits the source is moved to the right in the destination bytes
+     * @param invert If true, levels are drawn as (max - level)
+     */
+    inline void blit_row_levels(uint8_t* dst, const uint8_t* src, int bytes, int shift, bool invert) {
+        int i = 0;
+        if (shift == 0) {
+            for (; i + 4 <= bytes; i += 4) {
+                mgui_word32 s, d;
+                memcpy(&s, src + i, 4);
+                if (s == 0) {
+                    continue;
+                }
+                memcpy(&d, dst + i, 4);
+                d = merge_levels(d, s, invert);
+                memcpy(dst + i, &d, 4);
+            }
+            for (; i < bytes; i++) {
+                dst[i] = (uint8_t)merge_levels(dst[i], src[i], invert);
+            }
+            return;
+        }
+
+        mgui_word32 previous = 0;
+        for (; i <= bytes; i++) {
+            mgui_word32 current = (i < bytes) ? src[i] : 0;
+            mgui_word32 s = ((previous << (8 - shift)) | (current >> shift)) & 0xFF;
+            if (s != 0) {
+                dst[i] = (uint8_t)merge_levels(dst[i], s, invert);
+            }
+            previous = current;
+        }
+    }
+
+    /**
+     * @brief Replace the fields of d by the non-zero fields of s.
+     */
+    inline mgui_word32 merge_levels(mgui_word32 d, mgui_word32 s, bool invert) const {
+        // Lowest bit of each field, the OR of its bits lands there.
+        const mgui_word32 low = (bpp_ == 4) ? 0x11111111u : 0x55555555u;
+        mgui_word32 t = s | (s >> 1);
+        if (bpp_ == 4) {
+            t |= t >> 2;
+        }
+        const mgui_word32 mask = (t & low) * ((1u << bpp_) - 1);
+        return (d & ~mask) | ((invert ? ~s : s) & mask);
+    }
+
+    /**
+     * @brief Count the writes of a rectangle of the buffer (only with MGUI_OVERDRAW).
+     */
+#ifdef MGUI_OVERDRAW
+    inline void count_writes(int x0, int y0, int x1, int y1) {
+        if (overdraw_ != nullptr) {
+            overdraw_->add_rect(x0, y0, x1, y1);
+        }
+    }
+#else
+    inline void count_writes(int, int, int, int) {}
+#endif
+
+    /**
+     * @brief Count the non-zero levels of a packed row written at (x, y) (only with MGUI_OVERDRAW).
+     */
+#ifdef MGUI_OVERDRAW
+    inline void count_levels(const uint8_t* row, int bytes, int x, int y) {
+        if (overdraw_ == nullptr) {
+            return;
+        }
+        const int max = (1 << bpp_) - 1;
+        for (int i = 0; i < bytes; i++) {
+            for (int f = 0; f < 8 / bpp_; f++) {
+                const int px = x + i * (8 / bpp_) + f;
+                if (((row[i] >> (8 - bpp_ - f * bpp_)) & max) != 0 && px >= 0 && px < lcd_width_) {
+                    overdraw_->add(px, y);
+                }
+            }
+        }
+    }
+#else
+    inline void count_levels(const uint8_t*, int, int, int) {}
+#endif
+
+    /**
+     * @brief Clip the rectangle to the buffer and convert it to buffer coordinates.
+     *
+     * @return true Part of the rectangle is on the screen
+     * @return false Nothing to draw
+     */
+    inline bool clip(int& x0, int& y0, int& x1, int& y1) const {
+        x0 -= origin_x_;
+        x1 -= origin_x_;
+        y0 -= origin_y_;
+        y1 -= origin_y_;
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 >= lcd_width_) x1 = lcd_width_ - 1;
+        if (y1 >= lcd_height_) y1 = lcd_height_ - 1;
+        return x0 <= x1 && y0 <= y1;
+    }
+
+    /**
+     * @brief Bits of the page that are between y0 and y1.
+     */
+    static inline uint8_t page_mask(int page, int y0, int y1) {
+        int top = (y0 > (page << 3)) ? (y0 & 7) : 0;
+        int bottom = (y1 < (page << 3) + 7) ? (y1 & 7) : 7;
+        return (uint8_t)((0xFF << top) & (0xFF >> (7 - bottom)));
+    }
+
+    /**
+     * @brief
+     * Check whether the data for the specified image display position is turned on.
+     * TODO: Excessive idx calculation
+     * 
+     * @param x x position of image
+     * @param y y position of image
+     * @param value a value containing the bits of the specified image
+    */
+    inline bool check_bit_on(int x, int y, uint8_t value) {
+       uint8_t bit_idx = (1 << (7 - y % 8));
+       bool on = (value & bit_idx) & bit_idx;
+       return on;
+    }
+
+    uint8_t *lcd_buffer_;
+    int lcd_width_;
+    int lcd_height_;
+    int stride_;
+    int bpp_;
+    mgui_pixel_format format_;
+    uint8_t intensity_;
+    uint8_t ink_;
+    int origin_x_;
+    int origin_y_;
+    mgui_draw_list* recorder_;
+    bool animating_;
+    bool deferring_;
+    int deferred_;
+#ifdef MGUI_OVERDRAW
+    mgui_overdraw* overdraw_;
+#endif
+};
+
+/**
+ * @brief 
+ * Common objects to reflect the set state
+ */
+class mgui_object {
+public:
+    virtual ~mgui_object() {}
+
+    /**
+     * @brief Specify a unique object name in the inherited class
+     * @return Name of object registered in enum
+     */
+    virtual mgui_object_type type() const = 0;
+
+    /**
+     * @brief 
+     * The inherited class configures the drawing operations required by that object.
+     * This is executed every time the mgi::update_lcd() function is called.
+     * 
+     * @param draw Objects that provide a method for drawing
+     * @param input_state Current input state
+     * @param current_group The name of the group that the object is currently being drawn in
+     */
+    virtual void update(mgui_draw* draw, mgui_input_state *input_state, mgui_string* current_group) = 0;
+};
+
+/**
+ * @brief
+ * Sequence of input states recorded by mgui_input, one set of states per update.
+ *
+ * @remarks
+ * Consecutive updates with the same states are stored as one entry with a repeat count,
+ * so an idle screen takes no space. The time is the clock value of the first update
+ * of the entry (for example time_us_32() on RP2040).
+ */
+class mgui_input_trace {
+public:
+    /**
+     * @brief Construct a new mgui input trace object
+     *
+     * @param channels Number of input callbacks (states per update)
+     * @param capacity Maximum number of entries
+     */
+    explicit mgui_input_trace(const int channels, const int capacity) {
+        channels_ = channels;
+        capacity_ = capacity;
+        times_ = mgui_alloc<unsigned long>(capacity, mgui_memory_tag::Input);
+        repeats_ = mgui_alloc<int>(capacity, mgui_memory_tag::Input);
+        states_ = mgui_alloc<mgui_input_state>(capacity * channels, mgui_memory_tag::Input);
+        clear();
+    }
+
+    ~mgui_input_trace() {
+        mgui_free(times_, capacity_, mgui_memory_tag::Input);
+        mgui_free(repeats_, capacity_, mgui_memory_tag::Input);
+        mgui_free(states_, capacity_ * channels_, mgui_memory_tag::Input);
+    }
+
+    inline void clear() {
+        count_ = 0;
+        updates_ = 0;
+        overflow_ = false;
+    }
+
+    /**
+     * @brief Record the states of an update.
+     *
+     * @return false The trace is full (overflow() is set)
+     */
+    inline bool record(unsigned long time, const mgui_input_state* states) {
+        if (count_ > 0 && same(states_ + (count_ - 1) * channels_, states)) {
+            repeats_[count_ - 1]++;
+            updates_++;
+            return true;
+        }
+        return add(time, 1, states);
+    }
+
+    /**
+     * @brief Add an entry, for example when a saved trace is loaded.
+     */
+    inline bool add(unsigned long time, int repeat, const mgui_input_state* states) {
+        if (count_ == capacity_) {
+            overflow_ = true;
+            return false;
+        }
+
+        times_[count_] = time;
+        repeats_[count_] = repeat;
+        memcpy(states_ + count_ * channels_, states, sizeof(mgui_input_state) * channels_);
+        count_++;
+        updates_ += repeat;
+        return true;
+    }
+
+    /**
+     * @brief Number of entries
+     */
+    inline int count() const { return count_; }
+
+    /**
+     * @brief Number of recorded updates (the sum of the repeat counts)
+     */
+    inline long updates() const { return updates_; }
+
+    inline unsigned long time(int index) const { return times_[index]; }
+    inline int repeat(int index) const { return repeats_[index]; }
+    inline const mgui_input_state* states(int index) const { return states_ + index * channels_; }
+    inline int channels() const { return channels_; }
+    inline int capacity() const { return capacity_; }
+    inline bool overflow() const { return overflow_; }
+
+private:
+    inline bool same(const mgui_input_state* a, const mgui_input_state* b) const {
+        for (int i = 0; i < channels_; i++) {
+            if (a[i].type != b[i].type || a[i].value_1 != b[i].value_1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    unsigned long* times_;
+    int* repeats_;
+    mgui_input_state* states_;
+    int channels_;
+    int capacity_;
+    int count_;
+    long updates_;
+    bool overflow_;
+};
+
+/**
+ * @brief
+ * - Register and update device inputs together.
+ */
+class mgui_input {
+public:
+    mgui_input() {
+        input_data_ = nullptr;
+        input_data_count_ = 0;
+        last_data_ = nullptr;
+        last_data_count_ = 0;
+        reader_ = nullptr;
+        channels_ = nullptr;
+        channel_count_ = 0;
+        active_ = false;
+        recorder_ = nullptr;
+        clock_ = nullptr;
+        player_ = nullptr;
+        play_entry_ = 0;
+        play_repeat_ = 0;
+    }
+    ~mgui_input() {
+        clear_data();
+    }
+
+    /**
+     * @brief Add callbacks to update input status.
+     * 
+     * @param input_read_function 
+     * A Function to execute a read process of SDK-specific inputs using GPIO or
+     * other communication methods and store a value reflecting the result of
+     * the read process in the argument mgui_input_state.
+     */
+    inline void add(void (*input_read_function)(mgui_input_state *result)) {
+        function_list_.add(input_read_function);
+        alloc_data(channel_count_ + function_list_.count());
+    }
+
+    /**
+     * @brief
+     * Set a function which reads all the channels of a table in one call,
+     * for example from one read of the GPIO register (gpio_get_all() on RP2040).
+     *
+     * @remarks
+     * The states of the channels are the first ones, in the order of the table,
+     * so the handlers can use the same indices (for example an enum next to the table)
+     * whatever order the callbacks are added in; the states of the callbacks follow them.
+     * The type of each state is set from the table before the call, so the reader sets only the values.
+     * 
+     * @param read_function Function reading the states (nullptr to remove the reader)
+     * @param channels Table of the channels (not copied: it must stay valid)
+     * @param count Number of channels in the table
+     */
+    inline void set_reader(void (*read_function)(mgui_input_state result[], int count),
+                           const mgui_input_channel* channels, int count) {
+        reader_ = read_function;
+        channels_ = read_function != nullptr ? channels : nullptr;
+        channel_count_ = read_function != nullptr ? count : 0;
+        alloc_data(channel_count_ + function_list_.count());
+    }
+
+    /**
+     * @brief Index of the state of a channel of the reader, or -1 if no channel has the name.
+     */
+    inline int find(const char* name) const {
+        for (int i = 0; i < channel_count_; i++) {
+            if (strcmp(channels_[i].name, name) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Number of the channels of the reader (the states of the callbacks start there).
+     */
+    inline int channel_count() const { return channel_count_; }
+
+    /**
+     * @brief Deletes a callback that has been set.
+     * 
+     * @param index 
+     * Setup number of the callback. Since callbacks are stored in the order 
+     * in which add is executed, the appropriate index depends on the order 
+     * in which the callbacks are set. The setting order starts from 0.
+     * (Its state is at channel_count() + index.)
+     */
+    inline void remove(int index) {
+
+        mgui_list_node<void (*)(mgui_input_state* result)>* node = function_list_.first();
+
+        for (int i = 0; i < index; i++) {
+            node = node->next;
+        }
+
+        function_list_.remove(node->obj);
+        alloc_data(channel_count_ + function_list_.count());
+    }
+
+    /**
+     * @brief 
+     * The reader and all registered callbacks are executed. mgui_input_type of the states
+     * of the callbacks is initially set to Single.
+     */
+    inline void update() {
+        MGUI_TRACE_SCOPE("input", "input");
+        active_ = false;
+        if (player_ != nullptr) {
+            play();
+            return;
+        }
+
+        if (reader_ != nullptr && channel_count_ > 0) {
+            read_channels();
+        }
+
+        mgui_list_node<void (*)(mgui_input_state* result)>* node = function_list_.first();
+
+        int counter = channel_count_;
+        while (node != nullptr) {
+            const mgui_input_state last = input_data_[counter];
+            {
+                MGUI_TRACE_SCOPE("input", "callback");
+                node->obj(&input_data_[counter]);
+            }
+            active_ |= changed(last, input_data_[counter]);
+            node = node->next;
+            counter++;
+        }
+
+        if (recorder_ != nullptr && input_data_ != nullptr) {
+            recorder_->record(clock_ != nullptr ? clock_() : 0, input_data_);
+        }
+    }
+
+    mgui_input_state* get_input_result() { return input_data_; }
+
+    /**
+     * @brief
+     * It returns true if the last update() read an input:
+     * a value which is not 0, or a value or type which changed.
+     * An Analog value is an input only when it changed.
+     */
+    inline bool active() const { return active_; }
+
+    /**
+     * @brief
+     * Number of input states (the channels of the reader and the callbacks,
+     * or the channels of the replayed trace)
+     */
+    inline int count() const {
+        return player_ != nullptr ? player_->channels() : channel_count_ + function_list_.count();
+    }
+
+    /**
+     * @brief Record the states of each update into the trace.
+     *
+     * @param trace Trace with the same number of channels as count() (nullptr to stop)
+     * @param clock Function returning the current time, or nullptr
+     */
+    inline void set_recorder(mgui_input_trace* trace, unsigned long (*clock)() = nullptr) {
+        recorder_ = trace;
+        clock_ = clock;
+    }
+
+    /**
+     * @brief
+     * Replay the trace: each update takes the states of the next recorded update
+     * instead of calling the callbacks. When the trace ends, the last states are kept.
+     *
+     * @param trace Recorded trace (nullptr to return to the callbacks)
+     */
+    inline void set_player(const mgui_input_trace* trace) {
+        player_ = trace;
+        play_entry_ = 0;
+        play_repeat_ = 0;
+        if (trace == nullptr) {
+            alloc_data(channel_count_ + function_list_.count());
+            return;
+        }
+
+        if (channel_count_ + function_list_.count() != trace->channels()) {
+            alloc_data(trace->channels());
+        }
+        for (int i = 0; i < trace->channels(); i++) {
+            input_data_[i].type = mgui_input_type::Single;
+            input_data_[i].value_1 = 0;
+        }
+    }
+
+    /**
+     * @brief It returns true when all updates of the trace have been replayed.
+     */
+    inline bool finished() const {
+        return player_ != nullptr && play_entry_ >= player_->count();
+    }
+
+private:
+    /**
+     * @brief Deletes all dynamically allocated memory used by the input_data_.
+     */
+    void clear_data() {
+        if (input_data_) {
+            mgui_free(input_data_, input_data_count_, mgui_memory_tag::Input);
+            input_data_ = nullptr;
+            input_data_count_ = 0;
+        }
+        if (last_data_) {
+            mgui_free(last_data_, last_data_count_, mgui_memory_tag::Input);
+            last_data_ = nullptr;
+            last_data_count_ = 0;
+        }
+    }
+
+    void alloc_data(int count) {
+        clear_data();
+        input_data_ = mgui_alloc<mgui_input_state>(count, mgui_memory_tag::Input);
+        input_data_count_ = count;
+        // the states before the read of the reader
+        if (channel_count_ > 0) {
+            last_data_ = mgui_alloc<mgui_input_state>(channel_count_, mgui_memory_tag::Input);
+            last_data_count_ = channel_count_;
+        }
+    }
+
+    /**
+     * @brief Read the channels of the reader in one call.
+     */
+    inline void read_channels() {
+        memcpy(last_data_, input_data_, sizeof(mgui_input_state) * channel_count_);
+        for (int i = 0; i < channel_count_; i++) {
+            input_data_[i].type = channels_[i].type;
+        }
+        {
+            MGUI_TRACE_SCOPE("input", "reader");
+            reader_(input_data_, channel_count_);
+        }
+        for (int i = 0; i < channel_count_; i++) {
+            active_ |= changed(last_data_[i], input_data_[i]);
+        }
+    }
+
+    static inline bool changed(const mgui_input_state& last, const mgui_input_state& state) {
+        if (state.type == mgui_input_type::Analog) {
+            return state.value_1 != last.value_1 || state.type != last.type;
+        }
+        return state.value_1 != 0 || state.value_1 != last.value_1 || state.type != last.type;
+    }
+
+    /**
+     * @brief Copy the states of the next recorded update.
+     */
+    void play() {
+        if (play_entry_ >= player_->count()) {
+            return;
+        }
+
+        const mgui_input_state* states = player_->states(play_entry_);
+        for (int i = 0; i < player_->channels(); i++) {
+            active_ |= changed(input_data_[i], states[i]);
+        }
+        memcpy(input_data_, states, sizeof(mgui_input_state) * player_->channels());
+        if (++play_repeat_ >= player_->repeat(play_entry_)) {
+            play_entry_++;
+            play_repeat_ = 0;
+        }
+    }
+
+    mgui_list<void (*)(mgui_input_state* result), mgui_memory_tag::Input> function_list_;
+    mgui_input_state *input_data_;
+    int input_data_count_;
+    mgui_input_state* last_data_;
+    int last_data_count_;
+    void (*reader_)(mgui_input_state result[], int count);
+    const mgui_input_channel* channels_;
+    int channel_count_;
+    bool active_;
+    mgui_input_trace* recorder_;
+    unsigned long (*clock_)();
+    const mgui_input_trace* player_;
+    int play_entry_;
+    int play_repeat_;
+};
+
+
+/**
+ * @brief
+ * Receives the progress of each update_lcd() of mgui and mgui_multi,
+ * for example to measure frame times (see mgui_telemetry.h).
+ */
+class mgui_frame_listener {
+public:
+    virtual ~mgui_frame_listener() {}
+
+    /**
+     * @brief Called at the beginning of update_lcd().
+     */
+    virtual void frame_begin() {}
+
+    /**
+     * @brief Called with the input states after they are updated.
+     */
+    virtual void frame_input(const mgui_input_state*, int) {}
+
+    /**
+     * @brief
+     * Called before frame_end() under a frame budget with the number of works
+     * postponed by the objects (see mgui_draw::defer()).
+     */
+    virtual void frame_deferred(int) {}
+
+    /**
+     * @brief Called when the frame is drawn (not for frames skipped by the adaptive refresh).
+     */
+    virtual void frame_end() {}
+};
+
+/**
+ * @brief
+ * Value written by another thread or core and applied to a widget
+ * by update_lcd() of mgui and mgui_multi (see mgui_binding.h).
+ */
+class mgui_binding {
+public:
+    virtual ~mgui_binding() {}
+
+    /**
+     * @brief
+     * Called by update_lcd() before the frame is drawn: set the latest value to the widget.
+     *
+     * @return true The widget was changed, so the frame is drawn
+     */
+    virtual bool apply() = 0;
+};
+
+/**
+ * @brief Priority of an object under a frame budget (see mgui::set_priority).
+ */
+enum class mgui_priority {
+    /**
+     * @brief Deferred when the frame approaches the budget
+     */
+    Low,
+    /**
+     * @brief Deferred when the frame would exceed the budget
+     */
+    Normal,
+    /**
+     * @brief Never deferred, and its time is kept free by the other objects
+     */
+    High
+};
+
+/**
+ * @brief Priority and measured time of an object under a frame budget.
+ */
+struct mgui_budget_entry {
+    const mgui_object* object;
+    mgui_priority priority;
+    unsigned long cost;
+
+    inline bool operator==(const mgui_budget_entry& other) const { return object == other.object; }
+};
+
+/**
+ * @brief
+ * Time budget of update_lcd() of mgui and mgui_multi (see mgui::set_frame_budget).
+ *
+ * @remarks
+ * Each object is timed with the clock. Before an object is drawn, the time of the frame
+ * so far, the last time of the object and the last time of the High objects not drawn yet
+ * are added; if the sum exceeds three quarters of the budget for a Low object, or the budget
+ * for a Normal object, the object is drawn with mgui_draw::deferring() set.
+ * The time of a deferred object is not measured, so its full time is used in the next frame.
+ * Only the objects added to mgui and mgui_multi are timed; the objects in a group or a menu
+ * are deferred with it. The entries are kept in the budget, so the objects keep their size.
+ */
+class mgui_frame_budget {
+public:
+    mgui_frame_budget() {
+        clock_ = nullptr;
+        budget_ = 0;
+        start_ = 0;
+        reserve_ = 0;
+        last_ = 0;
+    }
+
+    inline void set(unsigned long budget, unsigned long (*clock)()) {
+        budget_ = budget;
+        clock_ = clock;
+    }
+
+    inline bool enabled() const { return clock_ != nullptr && budget_ > 0; }
+
+    /**
+     * @brief Time of a frame in clock units
+     */
+    inline unsigned long budget() const { return budget_; }
+
+    /**
+     * @brief Time of the last frame in clock units
+     */
+    inline unsigned long last() const { return last_; }
+
+    inline void set_priority(const mgui_object* object, mgui_priority priority) {
+        entry(object)->priority = priority;
+    }
+
+    inline mgui_priority priority(const mgui_object* object) const {
+        const mgui_budget_entry* found = find(object);
+        return found != nullptr ? found->priority : mgui_priority::Normal;
+    }
+
+    /**
+     * @brief Time of the last update() of the object which was not deferred
+     */
+    inline unsigned long cost(const mgui_object* object) const {
+        const mgui_budget_entry* found = find(object);
+        return found != nullptr ? found->cost : 0;
+    }
+
+    /**
+     * @brief Remove the entry of an object which is no longer drawn.
+     */
+    inline void remove(const mgui_object* object) {
+        mgui_budget_entry removed = { object, mgui_priority::Normal, 0 };
+        entries_.remove(removed);
+    }
+
+    inline void clear() { entries_.clear(); }
+
+    /**
+     * @brief Start the time of a frame.
+     */
+    inline void start() {
+        if (enabled()) {
+            start_ = clock_();
+        }
+    }
+
+    /**
+     * @brief Keep the time of the High objects of the frame.
+     */
+    inline void reserve(const mgui_list_node<mgui_object*>* node) {
+        reserve_ = 0;
+        if (!enabled()) {
+            return;
+        }
+        for (; node != nullptr; node = node->next) {
+            const mgui_budget_entry* found = find(node->obj);
+            if (found != nullptr && found->priority == mgui_priority::High) {
+                reserve_ += found->cost;
+            }
+        }
+    }
+
+    /**
+     * @brief Update an object, deferred when the frame runs out of time.
+     */
+    inline void update(mgui_object* object, mgui_draw* draw, mgui_input_state* state, mgui_string* current_group) {
+        if (!enabled()) {
+            object->update(draw, state, current_group);
+            return;
+        }
+
+        mgui_budget_entry* timed = entry(object);
+        const unsigned long begin = clock_();
+        bool defer = false;
+        if (timed->priority == mgui_priority::High) {
+            reserve_ -= timed->cost;
+        } else {
+            const unsigned long limit = timed->priority == mgui_priority::Low ? budget_ - budget_ / 4 : budget_;
+            defer = (begin - start_) + timed->cost + reserve_ > limit;
+        }
+
+        draw->set_deferring(defer);
+        object->update(draw, state, current_group);
+        draw->set_deferring(false);
+        if (!defer) {
+            timed->cost = clock_() - begin;
+        }
+    }
+
+    /**
+     * @brief End the time of a frame.
+     */
+    inline void end() {
+        if (enabled()) {
+            last_ = clock_() - start_;
+        }
+    }
+
+private:
+    inline const mgui_budget_entry* find(const mgui_object* object) const {
+        for (const mgui_list_node<mgui_budget_entry>* node = entries_.first(); node != nullptr; node = node->next) {
+            if (node->obj.object == object) {
+                return &node->obj;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Find the entry of an object, or add it.
+     */
+    inline mgui_budget_entry* entry(const mgui_object* object) {
+        mgui_budget_entry* found = const_cast<mgui_budget_entry*>(find(object));
+        if (found != nullptr) {
+            return found;
+        }
+        const mgui_budget_entry added = { object, mgui_priority::Normal, 0 };
+        entries_.add(added);
+        return &entries_.last()->obj;
+    }
+
+    mgui_list<mgui_budget_entry> entries_;
+    unsigned long (*clock_)();
+    unsigned long budget_;
+    unsigned long start_;
+    unsigned long reserve_;
+    unsigned long last_;
+};
+
+/**
+ * @brief 
+ * Adds/deletes/updates drawing objects and provides drawing status.
+ */
+class mgui {
+public:
+    /**
+     * @brief Construct a new mgui draw object
+     *
+     * @param width Target screen width
+     * @param height Target screen height
+     * @param format Pixel format of the screen buffer
+     */
+    explicit mgui(const uint16_t width, const uint16_t height,
+                  const mgui_pixel_format format = mgui_pixel_format::Mono1) {
+        buffer_size = mgui_draw::buffer_size(width, height, format);
+        lcd_buffer = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+        draw_ = (lcd_buffer != nullptr)
+            ? mgui_create<mgui_draw>(mgui_memory_tag::Screen, width, height, lcd_buffer, format) : nullptr;
+        if (draw_ == nullptr) {
+            // no memory for the screen (see allocated())
+            mgui_free(lcd_buffer, buffer_size, mgui_memory_tag::Screen);
+            lcd_buffer = nullptr;
+        }
+        input_ = nullptr;
+        output_buffer_ = nullptr;
+        shown_buffer_ = nullptr;
+        previous_ = nullptr;
+        listener_ = nullptr;
+        screen_width_ = width;
+        screen_height_ = height;
+        adaptive_ = false;
+        invalid_ = true;
+    }
+
+    ~mgui() {
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        mgui_free(lcd_buffer, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(output_buffer_, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(shown_buffer_, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief
+     * It returns false if the allocator had no memory for the screen.
+     * Then update_lcd() draws nothing and returns false.
+     */
+    inline bool allocated() const { return draw_ != nullptr; }
+
+    inline bool operator==(mgui& gui) {
+        if (buffer_size != gui.buffer_size) return false;
+        if (list.count() != gui.list.count()) return false;
+        int counter = list.count();
+        for (int i = 0; i < counter; i++) {
+            if (list.get(i)->type() != gui.list.get(i)->type()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline void set_input(mgui_input* input){
+        input_ = input;
+        invalid_ = true;
+    }
+
+    /**
+     * @brief It returns true if the last update_lcd() read an input.
+     */
+    inline bool input_active() const { return input_ != nullptr && input_->active(); }
+
+    /**
+     * @brief Set the rotation and mirroring of the screen.
+     *
+     * @remarks
+     * When rotated by 90 or 270 degrees, the drawing width and height are swapped.
+     * Objects are placed in the rotated coordinate system (see width() and height()).
+     * Only mgui_pixel_format::Mono1 screens can be rotated, and any rotation or mirroring
+     * needs a screen width and height that are multiples of 8; otherwise this is ignored.
+     *
+     * @param rotation Clockwise rotation
+     * @param mirror_x If true, the rotated screen is flipped left and right
+     * @param mirror_y If true, the rotated screen is flipped up and down
+     */
+    inline void set_rotation(mgui_rotation rotation, bool mirror_x = false, bool mirror_y = false) {
+        if (draw_ == nullptr || draw_->format() != mgui_pixel_format::Mono1) {
+            return;
+        }
+
+        mgui_orientation orientation;
+        orientation.set(rotation, mirror_x, mirror_y);
+        if (!orientation.supports(screen_width_, screen_height_)) {
+            return;
+        }
+        orientation_ = orientation;
+
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        if (orientation_.transpose()) {
+            draw_ = mgui_create<mgui_draw>(mgui_memory_tag::Screen, screen_height_, screen_width_, lcd_buffer);
+        } else {
+            draw_ = mgui_create<mgui_draw>(mgui_memory_tag::Screen, screen_width_, screen_height_, lcd_buffer);
+        }
+
+        if (!orientation_.identity() && output_buffer_ == nullptr) {
+            output_buffer_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+        }
+        invalid_ = true;
+    }
+
+    /**
+     * @brief Draw the next frame in a second buffer.
+     *
+     * @remarks
+     * After update_lcd(), lcd() returns the finished frame and the next update_lcd()
+     * draws in the other buffer, so the frame can be sent by an asynchronous bus
+     * while the next one is drawn. update_lcd() draws over the frame returned by lcd()
+     * before the last update_lcd(), so its transfer must be finished.
+     */
+    inline void set_double_buffer(bool on) {
+        if (draw_ == nullptr || on == (shown_buffer_ != nullptr)) {
+            return;
+        }
+
+        invalid_ = true;
+        if (on) {
+            shown_buffer_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+            if (shown_buffer_ == nullptr) {
+                return;
+            }
+            memcpy(shown_buffer_, lcd(), buffer_size);
+            // the shown frame is compared instead
+            mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+            previous_ = nullptr;
+            return;
+        }
+
+        // keep the last frame in lcd()
+        memcpy(orientation_.identity() ? lcd_buffer : output_buffer_, shown_buffer_, buffer_size);
+        mgui_free(shown_buffer_, buffer_size, mgui_memory_tag::Screen);
+        shown_buffer_ = nullptr;
+        alloc_previous();
+    }
+
+    inline bool double_buffer() const { return shown_buffer_ != nullptr; }
+
+    /**
+     * @brief Draw a frame only when it can change, and report if it changed.
+     *
+     * @remarks
+     * update_lcd() skips the drawing unless an input is active (see mgui_input::active()),
+     * an object is animating (see mgui_draw::animate()) or invalidate() was called,
+     * and returns true only when the new frame differs from the last one or was invalidated,
+     * so the frame needs to be transferred only then.
+     * Without double buffering, the last frame is kept in another buffer to compare with.
+     */
+    inline void set_adaptive_refresh(bool on) {
+        adaptive_ = on;
+        invalid_ = true;
+        if (on) {
+            alloc_previous();
+            return;
+        }
+
+        mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+        previous_ = nullptr;
+    }
+
+    inline bool adaptive_refresh() const { return adaptive_; }
+
+    /**
+     * @brief
+     * Draw the next frame with the adaptive refresh.
+     * Call it after changing an object outside of its input event handler.
+     */
+    inline void invalidate() { invalid_ = true; }
+
+    /**
+     * @brief It returns true if an object of the last frame requested the next frame.
+     */
+    inline bool animating() const { return draw_ != nullptr && draw_->animating(); }
+
+    /**
+     * @brief Keep update_lcd() within a time, deferring the optional work of the objects.
+     *
+     * @remarks
+     * The objects are timed and drawn by their priority (see set_priority()
+     * and mgui_frame_budget). A deferred object postpones its work, for example the move
+     * of a text, and the count of the frame is sent to mgui_frame_listener::frame_deferred.
+     *
+     * @param budget Time of a frame in clock units (0 to disable)
+     * @param clock Clock, for example time_us_32
+     */
+    inline void set_frame_budget(unsigned long budget, unsigned long (*clock)()) {
+        budget_.set(budget, clock);
+    }
+
+    inline const mgui_frame_budget& frame_budget() const { return budget_; }
+
+    /**
+     * @brief Set the priority of an object under the frame budget (mgui_priority::Normal by default).
+     * It is forgotten when the object is removed.
+     */
+    inline void set_priority(mgui_object* item, mgui_priority priority) {
+        budget_.set_priority(item, priority);
+    }
+
+    /**
+     * @brief Set the listener notified by update_lcd() (nullptr to remove it)
+     */
+    inline void set_frame_listener(mgui_frame_listener* listener) {
+        listener_ = listener;
+    }
+
+    /**
+     * @brief Apply the binding at the beginning of each update_lcd()
+     */
+    inline void bind(mgui_binding* binding) {
+        bindings_.add(binding);
+    }
+
+    inline void unbind(mgui_binding* binding) {
+        bindings_.remove(binding);
+    }
+
+#ifdef MGUI_OVERDRAW
+    /**
+     * @brief Count the writes per pixel of each frame (nullptr to stop)
+     *
+     * @param overdraw Map of the drawing size (width() x height())
+     */
+    inline void set_overdraw(mgui_overdraw* overdraw) {
+        if (draw_ != nullptr) {
+            draw_->set_overdraw(overdraw);
+        }
+    }
+#endif
+
+    inline const mgui_orientation& orientation() const { return orientation_; }
+
+    /**
+     * @brief Get the drawing width after rotation
+     */
+    inline int width() const { return draw_ != nullptr ? draw_->width() : 0; }
+
+    /**
+     * @brief Get the drawing height after rotation
+     */
+    inline int height() const { return draw_ != nullptr ? draw_->height() : 0; }
+
+    /**
+     * @brief Get the pixel format of the screen buffer
+     */
+    inline mgui_pixel_format format() const { return draw_ != nullptr ? draw_->format() : mgui_pixel_format::Mono1; }
+
+    inline void add(mgui_object *item){
+        list.add(item);
+        invalid_ = true;
+    }
+
+    inline void remove(mgui_object *item){
+        list.remove(item);
+        budget_.remove(item);
+        invalid_ = true;
+    }
+
+    inline void clear(){
+        list.clear();
+        budget_.clear();
+        invalid_ = true;
+    }
+
+    /**
+     * @brief 
+     * Update screen drawing
+     *
+     * @return true lcd() has a new frame (always, unless the adaptive refresh is set)
+     */
+    inline bool update_lcd() {
+        MGUI_TRACE_SCOPE("frame", "update_lcd");
+        if (draw_ == nullptr) {
+            return false;
+        }
+        budget_.start();
+        if (listener_ != nullptr) {
+            listener_->frame_begin();
+        }
+
+        // update input state
+        mgui_input_state* state = nullptr;
+        if(input_ != nullptr){
+            input_->update();
+            state = input_->get_input_result();
+            if (listener_ != nullptr) {
+                listener_->frame_input(state, input_->count());
+            }
+        }
+
+        if (apply_bindings()) {
+            invalid_ = true;
+        }
+
+        if (adaptive_ && !invalid_ && !input_active() && !draw_->animating()) {
+            return false;
+        }
+        const bool invalid = invalid_;
+        invalid_ = false;
+        draw_->begin_frame();
+        MGUI_OVERDRAW_FRAME(draw_);
+
+        mgui_list_node<mgui_object*>* node = list.first();
+        budget_.reserve(node);
+
+        // clear buffer
+        {
+            MGUI_TRACE_SCOPE("frame", "clear");
+            draw_->clear();
+        }
+
+        // set settings
+        while(node != nullptr){
+            MGUI_TRACE_SCOPE("object", mgui_object_type_name(node->obj->type()));
+            MGUI_OVERDRAW_OBJECT(draw_, node->obj->type());
+            budget_.update(node->obj, draw_, state, nullptr);
+            node = node->next;
+        }
+
+        if (!orientation_.identity()) {
+            MGUI_TRACE_SCOPE("frame", "rotate");
+            orientation_.apply(lcd_buffer, draw_->width(), draw_->height(), output_buffer_);
+        }
+
+        const bool changed = present(invalid);
+
+        budget_.end();
+        if (listener_ != nullptr) {
+            if (budget_.enabled()) {
+                listener_->frame_deferred(draw_->deferred());
             }
+            listener_->frame_end();
         }
+        return changed;
     }
 
     /**
-     * @brief Draw an image on the LCD buffer.
+     * @brief Get the buffer for the set screen size
      * 
-     * @param image A pointer to the image property object.
-     * @param x The x-coordinate of the upper left corner of the image.
-     * @param y The y-coordinate of the upper left corner of the image.
-     * @param invert If true, the buffer color of the image will be inverted. Default is false.
+     * @return uint8_t* A pointer to a screen buffer.
      */
-    inline void draw_image(const mgui_image_property *image,
-                          const int& x,
-                          const int& y,
-                          bool invert = false) {
-        
-        // Iterate over the image height
-        for (int y1 = 0; y1 < image->height(); y1++) {
-            // Iterate over the image width
-            for (int x1 = 0; x1 < image->width(); x1++) {
-                // Calculate the position in the image resource
-                int pos = y1 / 8 * image->width() + x1;
-                // Check if the bit at the current position is set
-                bool checkbit = check_bit_on(x1, y1, image->resource()[pos]);
-                // Draw the pixel on the LCD buffer if the bit is set
-                if (checkbit) {
-                    draw_pixel(x + x1, y + y1, (invert) ? !checkbit : checkbit);
-                }
+    inline uint8_t *lcd() {
+        if (shown_buffer_ != nullptr) {
+            return shown_buffer_;
+        }
+        return orientation_.identity() ? lcd_buffer : output_buffer_;
+    }
+
+private:
+    /**
+     * @brief Apply the bindings. It returns true if a widget was changed.
+     */
+    inline bool apply_bindings() {
+        bool changed = false;
+        for (mgui_list_node<mgui_binding*>* node = bindings_.first(); node != nullptr; node = node->next) {
+            changed |= node->obj->apply();
+        }
+        return changed;
+    }
+
+    /**
+     * @brief
+     * Show the finished frame. With the adaptive refresh, a frame which is the same
+     * as the last one is not shown unless it is forced.
+     *
+     * @return true lcd() has a new frame
+     */
+    inline bool present(bool force) {
+        if (!adaptive_) {
+            swap_buffer();
+            return true;
+        }
+
+        const uint8_t* finished = orientation_.identity() ? lcd_buffer : output_buffer_;
+        const uint8_t* last = shown_buffer_ != nullptr ? shown_buffer_ : previous_;
+        if (!force && mgui_kernel::equal(finished, last, buffer_size)) {
+            return false;
+        }
+
+        if (shown_buffer_ != nullptr) {
+            swap_buffer();
+        } else {
+            mgui_kernel::copy(previous_, finished, buffer_size);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Allocate the last frame of the adaptive refresh (the double buffer keeps its own).
+     */
+    inline void alloc_previous() {
+        if (adaptive_ && shown_buffer_ == nullptr && previous_ == nullptr) {
+            previous_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+        }
+    }
+
+    /**
+     * @brief Show the finished frame and draw the next one in the other buffer.
+     */
+    inline void swap_buffer() {
+        if (shown_buffer_ == nullptr) {
+            return;
+        }
+
+        uint8_t* finished = orientation_.identity() ? lcd_buffer : output_buffer_;
+        if (orientation_.identity()) {
+            lcd_buffer = shown_buffer_;
+            draw_->set_lcd(lcd_buffer);
+        } else {
+            output_buffer_ = shown_buffer_;
+        }
+        shown_buffer_ = finished;
+    }
+
+    mgui_draw* draw_;
+    mgui_input* input_;
+    mgui_list<mgui_object*> list;
+    uint8_t* lcd_buffer;
+    uint8_t* output_buffer_;
+    uint8_t* shown_buffer_;
+    uint8_t* previous_;
+    mgui_frame_listener* listener_;
+    mgui_frame_budget budget_;
+    mgui_list<mgui_binding*> bindings_;
+    int buffer_size;
+    int screen_width_;
+    int screen_height_;
+    bool adaptive_;
+    bool invalid_;
+    mgui_orientation orientation_;
+};
+
+/**
+ * @brief Rectangle of an mgui_multi screen which shows a group (see mgui_multi::add_viewport).
+ *
+ * @remarks
+ * The group is drawn with its own mgui_draw into a buffer of the viewport size,
+ * so the objects are placed relative to the viewport and clipped to it.
+ * The buffer keeps the drawing, so the group is drawn again only when the viewport is dirty
+ * and the other frames copy it into the screen buffer.
+ */
+class mgui_viewport {
+public:
+    /**
+     * @brief Construct a new mgui viewport object
+     *
+     * @param group_name Group to show, or nullptr to show the selected group
+     * @param x x position on the screen
+     * @param y y position on the screen
+     * @param width Width of the viewport
+     * @param height Height of the viewport
+     * @param format Pixel format of the screen buffer
+     */
+    mgui_viewport(const char* group_name, int x, int y, int width, int height, mgui_pixel_format format) {
+        follow_ = group_name == nullptr;
+        if (!follow_) {
+            group_ = group_name;
+        }
+        x_ = x;
+        y_ = y;
+        size_ = mgui_draw::buffer_size(width, height, format);
+        buffer_ = mgui_alloc<uint8_t>(size_, mgui_memory_tag::Screen);
+        draw_ = (buffer_ != nullptr)
+            ? mgui_create<mgui_draw>(mgui_memory_tag::Screen, width, height, buffer_, format) : nullptr;
+        if (draw_ == nullptr) {
+            // no memory (see allocated())
+            mgui_free(buffer_, size_, mgui_memory_tag::Screen);
+            buffer_ = nullptr;
+        }
+        dirty_ = true;
+        redraws_ = 0;
+    }
+
+    ~mgui_viewport() {
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        mgui_free(buffer_, size_, mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief It returns true if a rectangle can be a viewport of the screen.
+     *
+     * @remarks
+     * The rows of a viewport are copied by bytes: for Mono1, y and height must be
+     * multiples of 8; for the other formats, x and width must fill whole bytes.
+     */
+    static inline bool fits(int x, int y, int width, int height,
+                            int screen_width, int screen_height, mgui_pixel_format format) {
+        if (x < 0 || y < 0 || width <= 0 || height <= 0
+            || x + width > screen_width || y + height > screen_height) {
+            return false;
+        }
+        if (format == mgui_pixel_format::Mono1) {
+            return (y & 7) == 0 && (height & 7) == 0;
+        }
+        const int ppb = 8 / mgui_draw::bits_per_pixel(format);
+        return (x % ppb) == 0 && (width % ppb) == 0;
+    }
+
+    /**
+     * @brief It returns true if the viewport follows mgui_multi::select().
+     */
+    inline bool follows_selection() const { return follow_; }
+
+    /**
+     * @brief Name of the group shown (empty if it follows the selection)
+     */
+    inline const mgui_string& group() const { return group_; }
+
+    /**
+     * @brief It returns true if the viewport shows the group when the selected group is selected.
+     */
+    inline bool shows(const mgui_string& group, const mgui_string& selected) const {
+        return (follow_ ? selected : group_) == group;
+    }
+
+    /**
+     * @brief It returns false if the allocator had no memory for the viewport.
+     */
+    inline bool allocated() const { return draw_ != nullptr; }
+
+    inline int x() const { return x_; }
+    inline int y() const { return y_; }
+    inline int width() const { return draw_->width(); }
+    inline int height() const { return draw_->height(); }
+    inline mgui_draw* draw() const { return draw_; }
+
+    /**
+     * @brief The drawing of the viewport (the same layout as a screen buffer of its size).
+     */
+    inline const uint8_t* buffer() const { return buffer_; }
+
+    /**
+     * @brief Draw the group again in the next update_lcd().
+     */
+    inline void invalidate() { dirty_ = true; }
+
+    inline bool dirty() const { return dirty_; }
+
+    /**
+     * @brief Number of times the group was drawn
+     */
+    inline unsigned long redraws() const { return redraws_; }
+
+    /**
+     * @brief Start a drawing of the group.
+     */
+    inline void begin() {
+        dirty_ = false;
+        redraws_++;
+        draw_->begin_frame();
+        draw_->clear();
+    }
+
+    /**
+     * @brief Copy the drawing into a screen buffer.
+     *
+     * @param screen Screen buffer of the pixel format of the viewport
+     * @param screen_width Width of the screen
+     */
+    inline void show(uint8_t* screen, int screen_width) const {
+        copy_rows(screen, screen_width, buffer_, true);
+    }
+
+protected:
+    /**
+     * @brief Copy the rectangle of the viewport between a screen buffer and a buffer of the viewport size.
+     *
+     * @param screen Screen buffer of the pixel format of the viewport
+     * @param screen_width Width of the screen
+     * @param buffer Buffer of the viewport size
+     * @param into_screen If true, the buffer is copied into the screen; otherwise the screen into the buffer
+     */
+    inline void copy_rows(uint8_t* screen, int screen_width, uint8_t* buffer, bool into_screen) const {
+        const int bpp = mgui_draw::bits_per_pixel(draw_->format());
+        const bool mono = draw_->format() == mgui_pixel_format::Mono1;
+        // Mono1 rows are pages of 8 lines
+        const int rows = mono ? (height() >> 3) : height();
+        const int stride = mono ? width() : ((width() * bpp) >> 3);
+        for (int row = 0; row < rows; row++) {
+            uint8_t* area = mono
+                ? screen + ((y_ >> 3) + row) * screen_width + x_
+                : screen + (y_ + row) * ((screen_width * bpp) >> 3) + ((x_ * bpp) >> 3);
+            if (into_screen) {
+                mgui_kernel::copy(area, buffer + row * stride, stride);
+            } else {
+                mgui_kernel::copy(buffer + row * stride, area, stride);
             }
         }
     }
 
+private:
+    mgui_draw* draw_;
+    uint8_t* buffer_;
+    int size_;
+    int x_;
+    int y_;
+    bool follow_;
+    bool dirty_;
+    unsigned long redraws_;
+    mgui_string group_;
+};
+
+/**
+ * @brief Modal dialog of an mgui_multi screen (see mgui_multi::open_dialog).
+ *
+ * @remarks
+ * A viewport which also keeps the screen under it: the area is saved when the dialog
+ * opens and copied back when it closes, so the group under the dialog is not drawn again.
+ * It uses two buffers of the dialog size.
+ */
+class mgui_dialog : public mgui_viewport {
+public:
+    mgui_dialog(const char* group_name, int x, int y, int width, int height, mgui_pixel_format format)
+     : mgui_viewport(group_name, x, y, width, height, format) {
+        saved_ = mgui_viewport::allocated() ? mgui_alloc<uint8_t>(draw()->buffer_size(), mgui_memory_tag::Screen) : nullptr;
+    }
+
+    ~mgui_dialog() {
+        if (saved_ != nullptr) {
+            mgui_free(saved_, draw()->buffer_size(), mgui_memory_tag::Screen);
+        }
+    }
+
     /**
-     * @brief It returns generated buffer.
-     * 
-     * @return uint8_t* 
+     * @brief It returns false if the allocator had no memory for the dialog.
      */
-    uint8_t * lcd() { return lcd_buffer_; }
+    inline bool allocated() const { return mgui_viewport::allocated() && saved_ != nullptr; }
+
+    /**
+     * @brief Save the area of the screen under the dialog.
+     */
+    inline void save(uint8_t* screen, int screen_width) {
+        copy_rows(screen, screen_width, saved_, false);
+    }
+
+    /**
+     * @brief Copy the saved area back into the screen.
+     */
+    inline void restore(uint8_t* screen, int screen_width) const {
+        copy_rows(screen, screen_width, saved_, true);
+    }
+
+    /**
+     * @brief The saved area (the same layout as a screen buffer of the dialog size).
+     */
+    inline const uint8_t* saved() const { return saved_; }
 
 private:
-    
+    uint8_t* saved_;
+};
+
+/**
+ * @brief
+ * Adds/deletes/updates drawing objects and provides drawing status.
+ */
+class mgui_multi {
+public:
     /**
-     * @brief drawing filled circle
+     * @brief Construct a new mgui draw object
      *
-     * @param x0 center point of X
-     * @param y0 center point of Y
-     * @param r  radius
+     * @param width Target screen width
+     * @param height Target screen height
+     * @param format Pixel format of the screen buffer
+     */
+    explicit mgui_multi(const uint16_t width, const uint16_t height,
+                        const mgui_pixel_format format = mgui_pixel_format::Mono1) {
+        buffer_size = mgui_draw::buffer_size(width, height, format);
+
+        lcd_buffer = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+        draw_ = (lcd_buffer != nullptr)
+            ? mgui_create<mgui_draw>(mgui_memory_tag::Screen, width, height, lcd_buffer, format) : nullptr;
+        if (draw_ == nullptr) {
+            // no memory for the screen (see allocated())
+            mgui_free(lcd_buffer, buffer_size, mgui_memory_tag::Screen);
+            lcd_buffer = nullptr;
+        }
+        output_buffer_ = nullptr;
+        shown_buffer_ = nullptr;
+        previous_ = nullptr;
+        listener_ = nullptr;
+        dialog_ = nullptr;
+        screen_width_ = width;
+        screen_height_ = height;
+        adaptive_ = false;
+        invalid_ = true;
+        restored_ = false;
+    }
+
+    ~mgui_multi() {
+        clear_viewports();
+        mgui_destroy(dialog_, mgui_memory_tag::Screen);
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        mgui_free(lcd_buffer, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(output_buffer_, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(shown_buffer_, buffer_size, mgui_memory_tag::Screen);
+        mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief
+     * It returns false if the allocator had no memory for the screen.
+     * Then update_lcd() draws nothing and returns false.
      */
-    inline void draw_circle_fill(int x0, int y0, int r) {
-        int x = r;
-        int y = 0;
-        int f = -(r << 1) + 3;
+    inline bool allocated() const { return draw_ != nullptr; }
 
-        while (x >= y)
-        {
+    inline void add(const char *group_name, mgui_object* item) {
+        mgui_list<mgui_object*>* list =  map.get(group_name);
+        if (list == nullptr) {
+            mgui_list<mgui_object*> new_list;
+            new_list.add(item);
+            map.insert(group_name, new_list);
+            selected_ = group_name;
+            invalidate(group_name);
+            return;
+        }
 
-            for(int xd = 0; xd < x; xd++){
-                // 1
-                draw_pixel(x0 + xd, y0 + y, true);
-                draw_pixel(x0 + y, y0 - xd, true);
+        list->add(item);
+        invalidate(group_name);
+    }
 
-                // 2
-                draw_pixel(x0 + xd, y0 - y, true);
-                draw_pixel(x0 + y, y0 + xd, true);
+    inline void remove(const char* group_name, mgui_object* item) {
+        mgui_list<mgui_object*>* list = map.get(group_name);
+        if (list != nullptr) {
+            list->remove(item);
+            budget_.remove(item);
+            invalidate(group_name);
+        }
+    }
 
-                // 3
-                draw_pixel(x0 - xd, y0 + y, true);
-                draw_pixel(x0 - y, y0 + xd, true);
-                
-                // 4
-                draw_pixel(x0 - xd, y0 - y, true);
-                draw_pixel(x0 - y, y0 - xd, true);
+    inline void clear(const char* group_name) {
+        mgui_list<mgui_object*>* list = map.get(group_name);
+        if (list != nullptr) {
+            for (mgui_list_node<mgui_object*>* node = list->first(); node != nullptr; node = node->next) {
+                budget_.remove(node->obj);
             }
-            
-            if (f >= 0)
-            {
-                x--;
-                f -= (x << 2);
+            list->clear();
+            map.remove(group_name);
+            invalidate(group_name);
+        }
+    }
+
+    /**
+     * @brief Set the rotation and mirroring of the screen.
+     *
+     * @remarks
+     * When rotated by 90 or 270 degrees, the drawing width and height are swapped.
+     * Objects are placed in the rotated coordinate system (see width() and height()).
+     * Only mgui_pixel_format::Mono1 screens can be rotated, and any rotation or mirroring
+     * needs a screen width and height that are multiples of 8; otherwise this is ignored.
+     * The viewports and the dialog are removed, so add them after the rotation.
+     *
+     * @param rotation Clockwise rotation
+     * @param mirror_x If true, the rotated screen is flipped left and right
+     * @param mirror_y If true, the rotated screen is flipped up and down
+     */
+    inline void set_rotation(mgui_rotation rotation, bool mirror_x = false, bool mirror_y = false) {
+        if (draw_ == nullptr || draw_->format() != mgui_pixel_format::Mono1) {
+            return;
+        }
+
+        mgui_orientation orientation;
+        orientation.set(rotation, mirror_x, mirror_y);
+        if (!orientation.supports(screen_width_, screen_height_)) {
+            return;
+        }
+        orientation_ = orientation;
+        clear_viewports();
+        mgui_destroy(dialog_, mgui_memory_tag::Screen);
+        dialog_ = nullptr;
+
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        if (orientation_.transpose()) {
+            draw_ = mgui_create<mgui_draw>(mgui_memory_tag::Screen, screen_height_, screen_width_, lcd_buffer);
+        } else {
+            draw_ = mgui_create<mgui_draw>(mgui_memory_tag::Screen, screen_width_, screen_height_, lcd_buffer);
+        }
+
+        if (!orientation_.identity() && output_buffer_ == nullptr) {
+            output_buffer_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+        }
+        invalid_ = true;
+    }
+
+    /**
+     * @brief Draw the next frame in a second buffer.
+     *
+     * @remarks
+     * After update_lcd(), lcd() returns the finished frame and the next update_lcd()
+     * draws in the other buffer, so the frame can be sent by an asynchronous bus
+     * while the next one is drawn. update_lcd() draws over the frame returned by lcd()
+     * before the last update_lcd(), so its transfer must be finished.
+     */
+    inline void set_double_buffer(bool on) {
+        if (draw_ == nullptr || on == (shown_buffer_ != nullptr)) {
+            return;
+        }
+
+        invalid_ = true;
+        if (on) {
+            shown_buffer_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
+            if (shown_buffer_ == nullptr) {
+                return;
             }
-            y++;
-            f += (y << 2) + 2;
+            memcpy(shown_buffer_, lcd(), buffer_size);
+            // the shown frame is compared instead
+            mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+            previous_ = nullptr;
+            return;
         }
+
+        // keep the last frame in lcd()
+        memcpy(orientation_.identity() ? lcd_buffer : output_buffer_, shown_buffer_, buffer_size);
+        mgui_free(shown_buffer_, buffer_size, mgui_memory_tag::Screen);
+        shown_buffer_ = nullptr;
+        alloc_previous();
     }
 
+    inline bool double_buffer() const { return shown_buffer_ != nullptr; }
+
     /**
-     * @brief Draw a filled rounded corner rectangle
-     * 
-     * @param x0 x position at upper left
-     * @param y0 y position at upper left
-     * @param x1 x position at bottom right
-     * @param y1 y position of bottom right
-     * @param r rounded corner radius
-     */
-    inline void draw_rectangle_rounded_fill(int x0, int y0, int x1, int y1, int r, bool on){
-        int x = r;
-        int y = 0;
-        int f = -(r << 1) + 3;
+     * @brief Draw a frame only when it can change, and report if it changed.
+     *
+     * @remarks
+     * update_lcd() skips the drawing unless an input is active (see mgui_input::active()),
+     * an object is animating (see mgui_draw::animate()) or invalidate() was called,
+     * and returns true only when the new frame differs from the last one or was invalidated,
+     * so the frame needs to be transferred only then.
+     * Without double buffering, the last frame is kept in another buffer to compare with.
+     */
+    inline void set_adaptive_refresh(bool on) {
+        adaptive_ = on;
+        invalid_ = true;
+        if (on) {
+            alloc_previous();
+            return;
+        }
 
-        int px0 = x0 + r;
-        int px1 = x1 - r;
-        int py0 = y0 + r;
-        int py1 = y1 - r;
+        mgui_free(previous_, buffer_size, mgui_memory_tag::Screen);
+        previous_ = nullptr;
+    }
 
-        while (x >= y)
-        {
-            for(int xd = 0; xd <= x; xd++){
-                // 1
-                draw_pixel(px1 + xd, py0 - y, on);
-                draw_pixel(px1 + y, py0 - xd, on);
-                
-                // 2
-                draw_pixel(px1 + xd, py1 + y, on);
-                draw_pixel(px1 + y, py1 + xd, on);
-                
-                // 3
-                draw_pixel(px0 - xd, py1 + y, on);
-                draw_pixel(px0 - y, py1 + xd, on);
-
-                // 4
-                draw_pixel(px0 - xd, py0 - y, on);
-                draw_pixel(px0 - y, py0 - xd, on);
-            }
+    inline bool adaptive_refresh() const { return adaptive_; }
 
-            if (f >= 0)
-            {
-                x--;
-                f -= (x << 2);
-            }
-            y++;
-            f += (y << 2) + 2;
+    /**
+     * @brief
+     * Draw the next frame with the adaptive refresh.
+     * Call it after changing an object outside of its input event handler.
+     * An open dialog is drawn again too.
+     */
+    inline void invalidate() {
+        invalid_ = true;
+        if (dialog_ != nullptr) {
+            dialog_->invalidate();
         }
+    }
 
-        // fill side
-        for(int dx = 0; dx <= r; dx++){
-            for(int dy = py0; dy <= py1; dy++){
-                draw_pixel(x0 + dx, dy, on);
-                draw_pixel(px1 + dx, dy, on);
+    /**
+     * @brief
+     * Draw the viewports or the dialog of a group in the next frame.
+     * Otherwise, it is the same as invalidate().
+     */
+    inline void invalidate(const char* group_name) {
+        const mgui_string group(group_name);
+        const bool dialog = dialog_ != nullptr && dialog_->shows(group, selected_);
+        if (dialog) {
+            dialog_->invalidate();
+        }
+        if (viewports_.count() == 0) {
+            // the screen under the dialog is kept
+            if (!dialog || group == selected_) {
+                invalid_ = true;
             }
+            return;
         }
 
-        draw_rectangle_fill(px0, y0, px1, y1, on);
+        for (mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            if (node->obj->shows(group, selected_)) {
+                node->obj->invalidate();
+            }
+        }
     }
 
     /**
-     * @brief Draw a filled rectangle
-     * 
-     * @param x0 x position at upper left
-     * @param y0 y position at upper left
-     * @param x1 x position at bottom right
-     * @param y1 y position at bottom right
-     * @param on if true, set 1; if false, set 0
+     * @brief It returns true if an object of the last frame requested the next frame.
      */
-    inline void draw_rectangle_fill(int x0, int y0, int x1, int y1, bool on){
-        for(int x = x0; x <= x1; x++){
-            for(int y = y0; y <= y1; y++){
-                draw_pixel(x, y, on);
+    inline bool animating() const {
+        if (draw_ == nullptr) {
+            return false;
+        }
+        if (draw_->animating()) {
+            return true;
+        }
+        for (const mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            if (node->obj->draw()->animating()) {
+                return true;
             }
         }
+        return false;
     }
 
     /**
-     * @brief
-     * Check whether the data for the specified image display position is turned on.
-     * TODO: Excessive idx calculation
-     * 
-     * @param x x position of image
-     * @param y y position of image
-     * @param value a value containing the bits of the specified image
-    */
-    inline bool check_bit_on(int x, int y, uint8_t value) {
-       uint8_t bit_idx = (1 << (7 - y % 8));
-       bool on = (value & bit_idx) & bit_idx;
-       return on;
-    }
+     * @brief Show a group in a rectangle of the screen, together with the other viewports.
+     *
+     * @remarks
+     * With viewports, update_lcd() draws only the viewports instead of the selected group.
+     * Each group is drawn relative to its viewport and clipped to it, and a viewport is drawn
+     * again only when it is dirty: when its group is added to, removed from or invalidated,
+     * when one of its objects is animating, or, for the viewports of the selected group,
+     * when an input is active. The other viewports keep their last drawing, so for example
+     * a status bar is not drawn again when select() switches the main area.
+     * Like with the adaptive refresh, call invalidate() after changing an object
+     * outside of its input event handler. Only the viewports of the selected group
+     * receive the input. The screen outside the viewports is cleared.
+     * The objects of the viewports are not counted by set_overdraw().
+     *
+     * @param group_name Group to show, or nullptr to show the selected group (see select())
+     * @param x x position on the screen
+     * @param y y position on the screen
+     * @param width Width of the viewport
+     * @param height Height of the viewport
+     * @return int Index of the viewport, or -1 if it is outside the screen or not aligned
+     * (see mgui_viewport::fits), or there is no memory for it
+     */
+    inline int add_viewport(const char* group_name, int x, int y, int width, int height) {
+        if (!mgui_viewport::fits(x, y, width, height, this->width(), this->height(), format())) {
+            return -1;
+        }
 
-    uint8_t *lcd_buffer_;
-    int lcd_width_;
-    int lcd_height_;
-};
+        mgui_viewport* viewport = mgui_create<mgui_viewport>(mgui_memory_tag::Screen, group_name, x, y, width, height, format());
+        if (viewport == nullptr || !viewport->allocated() || !viewports_.add(viewport)) {
+            mgui_destroy(viewport, mgui_memory_tag::Screen);
+            return -1;
+        }
+        invalid_ = true;
+        return viewports_.count() - 1;
+    }
 
-/**
- * @brief 
- * Common objects to reflect the set state
- */
-class mgui_object {
-public:
     /**
-     * @brief Specify a unique object name in the inherited class
-     * @return Name of object registered in enum
+     * @brief Remove the viewports; update_lcd() draws the selected group on the whole screen again.
      */
-    virtual mgui_object_type type() const = 0;
+    inline void clear_viewports() {
+        for (mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            mgui_destroy(node->obj, mgui_memory_tag::Screen);
+        }
+        viewports_.clear();
+        invalid_ = true;
+    }
+
+    inline int viewport_count() const { return viewports_.count(); }
+
+    inline mgui_viewport* viewport(int index) { return viewports_.get(index); }
 
     /**
-     * @brief 
-     * The inherited class configures the drawing operations required by that object.
-     * This is executed every time the mgi::update_lcd() function is called.
-     * 
-     * @param draw Objects that provide a method for drawing
-     * @param input_state Current input state
-     * @param current_group The name of the group that the object is currently being drawn in
-     */
-    virtual void update(mgui_draw* draw, mgui_input_state *input_state, mgui_string* current_group) = 0;
-};
+     * @brief Open a modal dialog which shows a group over the screen.
+     *
+     * @remarks
+     * The area of the last frame under the dialog is saved. While the dialog is open,
+     * update_lcd() draws only the dialog, like a viewport (see add_viewport()),
+     * and only the dialog receives the input. The dialog is closed by close_dialog(),
+     * or when a handler of the dialog changes the current group; if it names another group
+     * than the selected one, that group is selected.
+     * On close, the saved area is copied back and the group under the dialog is not drawn again,
+     * unless it was changed or invalidated while the dialog was open.
+     * The rectangle follows the rules of mgui_viewport::fits, so for Mono1 the area is whole pages.
+     *
+     * @param group_name Group of the dialog
+     * @param x x position on the screen
+     * @param y y position on the screen
+     * @param width Width of the dialog
+     * @param height Height of the dialog
+     * @return true The dialog is open
+     * @return false A dialog is already open, the group does not exist,
+     * the rectangle is outside the screen or not aligned, or there is no memory for the dialog
+     */
+    inline bool open_dialog(const char* group_name, int x, int y, int width, int height) {
+        if (dialog_ != nullptr || map.get(group_name) == nullptr
+            || !mgui_viewport::fits(x, y, width, height, this->width(), this->height(), format())) {
+            return false;
+        }
 
-/**
- * @brief
- * - Register and update device inputs together.
- */
-class mgui_input {
-public:
-    mgui_input() {
-        input_data_ = nullptr;
-    }
-    ~mgui_input() {
-        clear_data();
+        // the dialog is drawn over the last frame in the buffer drawn next
+        if (shown_buffer_ != nullptr && orientation_.identity()) {
+            mgui_kernel::copy(lcd_buffer, shown_buffer_, buffer_size);
+        }
+        dialog_ = mgui_create<mgui_dialog>(mgui_memory_tag::Screen, group_name, x, y, width, height, format());
+        if (dialog_ == nullptr || !dialog_->allocated()) {
+            mgui_destroy(dialog_, mgui_memory_tag::Screen);
+            dialog_ = nullptr;
+            return false;
+        }
+        dialog_->save(lcd_buffer, draw_->width());
+        return true;
     }
 
     /**
-     * @brief Add callbacks to update input status.
-     * 
-     * @param input_read_function 
-     * A Function to execute a read process of SDK-specific inputs using GPIO or
-     * other communication methods and store a value reflecting the result of
-     * the read process in the argument mgui_input_state.
+     * @brief Close the dialog and show the saved area in the next update_lcd().
      */
-    inline void add(void (*input_read_function)(mgui_input_state *result)) {
-        function_list_.add(input_read_function);
-        clear_data();
-        input_data_ = new mgui_input_state[function_list_.count()];
+    inline void close_dialog() {
+        if (dialog_ == nullptr) {
+            return;
+        }
+
+        dialog_->restore(lcd_buffer, draw_->width());
+        mgui_destroy(dialog_, mgui_memory_tag::Screen);
+        dialog_ = nullptr;
+        restored_ = true;
     }
 
     /**
-     * @brief Deletes a callback that has been set.
-     * 
-     * @param index 
-     * Setup number of the callback. Since callbacks are stored in the order 
-     * in which add is executed, the appropriate index depends on the order 
-     * in which the callbacks are set. The setting order starts from 0.
+     * @brief The open dialog, or nullptr
      */
-    inline void remove(int index) {
+    inline const mgui_dialog* dialog() const { return dialog_; }
 
-        mgui_list_node<void (*)(mgui_input_state* result)>* node = function_list_.first();
+    /**
+     * @brief Keep update_lcd() within a time, deferring the optional work of the objects.
+     *
+     * @remarks
+     * The objects are timed and drawn by their priority (see set_priority()
+     * and mgui_frame_budget). A deferred object postpones its work, for example the move
+     * of a text, and the count of the frame is sent to mgui_frame_listener::frame_deferred.
+     *
+     * @param budget Time of a frame in clock units (0 to disable)
+     * @param clock Clock, for example time_us_32
+     */
+    inline void set_frame_budget(unsigned long budget, unsigned long (*clock)()) {
+        budget_.set(budget, clock);
+    }
 
-        for (int i = 0; i < index; i++) {
-            node = node->next;
-        }
+    inline const mgui_frame_budget& frame_budget() const { return budget_; }
 
-        function_list_.remove(node->obj);
-        clear_data();
-        input_data_ = new mgui_input_state[function_list_.count()];
+    /**
+     * @brief Set the priority of an object under the frame budget (mgui_priority::Normal by default).
+     * It is forgotten when the object is removed.
+     */
+    inline void set_priority(mgui_object* item, mgui_priority priority) {
+        budget_.set_priority(item, priority);
     }
 
     /**
-     * @brief 
-     * All registered callbacks are executed. mgui_input_type is initially set to Single.
+     * @brief Set the listener notified by update_lcd() (nullptr to remove it)
      */
-    inline void update() {
-        mgui_list_node<void (*)(mgui_input_state* result)>* node = function_list_.first();
+    inline void set_frame_listener(mgui_frame_listener* listener) {
+        listener_ = listener;
+    }
 
-        int counter = 0;
-        while (node != nullptr) {
-            node->obj(&input_data_[counter]);
-            node = node->next;
-            counter++;
-        }
+    /**
+     * @brief Apply the binding at the beginning of each update_lcd()
+     */
+    inline void bind(mgui_binding* binding) {
+        bindings_.add(binding);
     }
 
-    mgui_input_state* get_input_result() { return input_data_; }
+    inline void unbind(mgui_binding* binding) {
+        bindings_.remove(binding);
+    }
 
-private:
+#ifdef MGUI_OVERDRAW
     /**
-     * @brief Deletes all dynamically allocated memory used by the input_data_.
+     * @brief Count the writes per pixel of each frame (nullptr to stop)
+     *
+     * @param overdraw Map of the drawing size (width() x height())
      */
-    void clear_data() {
-        if (input_data_) {
-            delete[] input_data_;
-            input_data_ = nullptr;
+    inline void set_overdraw(mgui_overdraw* overdraw) {
+        if (draw_ != nullptr) {
+            draw_->set_overdraw(overdraw);
         }
     }
+#endif
 
-    mgui_list<void (*)(mgui_input_state* result)> function_list_;
-    mgui_input_state *input_data_;
-};
+    inline const mgui_orientation& orientation() const { return orientation_; }
 
+    /**
+     * @brief Get the drawing width after rotation
+     */
+    inline int width() const { return draw_ != nullptr ? draw_->width() : 0; }
 
-/**
- * @brief 
- * Adds/deletes/updates drawing objects and provides drawing status.
- */
-class mgui {
-public:
     /**
-     * @brief Construct a new mgui draw object
-     *
-     * @param width Target screen width
-     * @param height Target screen height
+     * @brief Get the drawing height after rotation
      */
-    explicit mgui(const uint8_t width, const uint8_t height) {
-        buffer_size = width * (height >> 3);
-        lcd_buffer = new uint8_t[buffer_size]();
-        memset(lcd_buffer, 0, buffer_size);
-        draw_ = new mgui_draw(width, height, lcd_buffer);
-        input_ = nullptr;
-    }
+    inline int height() const { return draw_ != nullptr ? draw_->height() : 0; }
 
-    ~mgui() {
-        delete draw_;
-        delete[] lcd_buffer;
-    }
+    /**
+     * @brief Get the pixel format of the screen buffer
+     */
+    inline mgui_pixel_format format() const { return draw_ != nullptr ? draw_->format() : mgui_pixel_format::Mono1; }
 
-    inline bool operator==(mgui& gui) {
-        if (buffer_size != gui.buffer_size) return false;
-        if (list.count() != gui.list.count()) return false;
-        int counter = list.count();
-        for (int i = 0; i < counter; i++) {
-            if (list.get(i)->type() != gui.list.get(i)->type()) {
-                return false;
+    inline bool select(const char* group_name) {
+        mgui_list<mgui_object*>* list = map.get(group_name);
+        if (list != nullptr) {
+            selected_ = group_name;
+            if (viewports_.count() == 0) {
+                invalid_ = true;
             }
+            invalidate_selection();
+            return true;
         }
 
-        return true;
-    }
-
-    inline void set_input(mgui_input* input){
-        input_ = input;
-    }
-
-    inline void add(mgui_object *item){
-        list.add(item);
-    }
-
-    inline void remove(mgui_object *item){
-        list.remove(item);
+        return false;
     }
 
-    inline void clear(){
-        list.clear();
-    }
+    /**
+     * @brief Get the name of the group drawn by update_lcd()
+     */
+    inline const mgui_string& selected() const { return selected_; }
 
     /**
-     * @brief 
+     * @brief
      * Update screen drawing
+     *
+     * @return true lcd() has a new frame (always when a group is selected, unless the adaptive refresh is set)
      */
-    inline void update_lcd() {
+    inline bool update_lcd() {
+        MGUI_TRACE_SCOPE("frame", "update_lcd");
+        if (draw_ == nullptr) {
+            return false;
+        }
+        budget_.start();
+        if (listener_ != nullptr) {
+            listener_->frame_begin();
+        }
+
         // update input state
         mgui_input_state* state = nullptr;
-        if(input_ != nullptr){
-            input_->update();
-            state = input_->get_input_result();
+        input_.update();
+        state = input_.get_input_result();
+        if (listener_ != nullptr) {
+            listener_->frame_input(state, input_.count());
+        }
+
+        if (apply_bindings()) {
+            // a binding may target the dialog or the screen under it
+            invalidate();
+        }
+
+        if (adaptive_ && !frame_needed()) {
+            return false;
+        }
+        draw_->begin_frame();
+        MGUI_OVERDRAW_FRAME(draw_);
+
+        // the screen under a dialog is kept until the dialog is closed
+        const bool dialog = dialog_ != nullptr;
+        if (dialog && update_dialog(state)) {
+            // a handler closed it with this input
+            state = nullptr;
+        }
+        const bool invalid = dialog_ == nullptr && invalid_;
+        const bool restored = dialog_ == nullptr && restored_;
+        if (dialog_ == nullptr) {
+            invalid_ = false;
+            restored_ = false;
+        }
+
+        mgui_list<mgui_object*>* list = nullptr;
+        if (dialog_ != nullptr) {
+            // only the dialog is drawn
+        } else if (viewports_.count() > 0) {
+            update_viewports(state, invalid);
+        } else if (restored && !invalid) {
+            // the dialog was closed: its area is restored and the group is not drawn
+        } else if ((list = map.get(selected_)) != nullptr) {
+            mgui_list_node<mgui_object*>* node = list->first();
+            budget_.reserve(node);
+
+            // clear buffer
+            {
+                MGUI_TRACE_SCOPE("frame", "clear");
+                draw_->clear();
+            }
+
+            // set settings
+            while (node != nullptr) {
+                MGUI_TRACE_SCOPE("object", mgui_object_type_name(node->obj->type()));
+                MGUI_OVERDRAW_OBJECT(draw_, node->obj->type());
+                budget_.update(node->obj, draw_, state, &selected_);
+                node = node->next;
+            }
+
+            // a handler moved to another group
+            if (map.get(selected_) != list) {
+                invalid_ = true;
+            }
         }
 
-        mgui_list_node<mgui_object*>* node = list.first();
+        if (!orientation_.identity()) {
+            MGUI_TRACE_SCOPE("frame", "rotate");
+            orientation_.apply(lcd_buffer, draw_->width(), draw_->height(), output_buffer_);
+        }
 
-        // clear buffer
-        memset(lcd_buffer, 0, buffer_size);
+        // without a group nothing is drawn, so the shown frame is kept
+        const bool drawn = list != nullptr || viewports_.count() > 0 || dialog || restored;
+        const bool changed = drawn && present(invalid || restored);
 
-        // set settings
-        while(node != nullptr){
-            node->obj->update(draw_, state, nullptr);
-            node = node->next;
+        budget_.end();
+        if (listener_ != nullptr) {
+            if (budget_.enabled()) {
+                listener_->frame_deferred(deferred());
+            }
+            listener_->frame_end();
         }
+        return changed;
     }
 
     /**
      * @brief Get the buffer for the set screen size
-     * 
+     *
      * @return uint8_t* A pointer to a screen buffer.
      */
-    inline uint8_t *lcd() { return lcd_buffer; }
+    inline uint8_t* lcd() {
+        if (shown_buffer_ != nullptr) {
+            return shown_buffer_;
+        }
+        return orientation_.identity() ? lcd_buffer : output_buffer_;
+    }
 
-private:
-    mgui_draw* draw_;
-    mgui_input* input_;
-    mgui_list<mgui_object*> list;
-    uint8_t* lcd_buffer;
-    int buffer_size;
-};
+    inline mgui_input* input() { return &input_; }
 
-/**
- * @brief
- * Adds/deletes/updates drawing objects and provides drawing status.
- */
-class mgui_multi {
-public:
     /**
-     * @brief Construct a new mgui draw object
-     *
-     * @param width Target screen width
-     * @param height Target screen height
+     * @brief It returns true if the last update_lcd() read an input.
      */
-    explicit mgui_multi(const uint8_t width, const uint8_t height) {
-        buffer_size = width * (height >> 3);
+    inline bool input_active() const { return input_.active(); }
 
-        lcd_buffer = new uint8_t[buffer_size]();
-        memset(lcd_buffer, 0, buffer_size);
-        
-        draw_ = new mgui_draw(width, height, lcd_buffer);
+private:
+    /**
+     * @brief Apply the bindings. It returns true if a widget was changed.
+     */
+    inline bool apply_bindings() {
+        bool changed = false;
+        for (mgui_list_node<mgui_binding*>* node = bindings_.first(); node != nullptr; node = node->next) {
+            changed |= node->obj->apply();
+        }
+        return changed;
     }
 
-    ~mgui_multi() {
-        delete draw_;
-        delete[] lcd_buffer;
+    /**
+     * @brief It returns true if the adaptive refresh must draw a frame.
+     */
+    inline bool frame_needed() const {
+        if (input_.active()) {
+            return true;
+        }
+        if (dialog_ != nullptr) {
+            return dialog_->dirty() || dialog_->draw()->animating();
+        }
+        return invalid_ || restored_ || animating() || viewports_dirty();
     }
 
-    inline void add(const char *group_name, mgui_object* item) {
-        mgui_list<mgui_object*>* list =  map.get(group_name);
-        if (list == nullptr) {
-            mgui_list<mgui_object*> new_list;
-            new_list.add(item);
-            map.insert(group_name, new_list);
-            selected_ = group_name;
-            return;
+    /**
+     * @brief
+     * Draw the dialog over the screen buffer.
+     * It returns true if a handler closed the dialog; then the buffer has the saved area instead.
+     */
+    inline bool update_dialog(mgui_input_state* state) {
+        MGUI_TRACE_SCOPE("frame", "dialog");
+        // the assignment reuses the memory of the last frame
+        dialog_group_ = dialog_->group();
+        mgui_string& current = dialog_group_;
+        dialog_->begin();
+        mgui_list<mgui_object*>* list = map.get(dialog_->group().c_str());
+        mgui_list_node<mgui_object*>* item = list != nullptr ? list->first() : nullptr;
+        budget_.reserve(item);
+        for (; item != nullptr; item = item->next) {
+            MGUI_TRACE_SCOPE("object", mgui_object_type_name(item->obj->type()));
+            budget_.update(item->obj, dialog_->draw(), state, &current);
         }
 
-        list->add(item);
+        // a handler of the dialog moved to another group
+        if (!(current == dialog_->group())) {
+            close_dialog();
+            if (!(current == selected_)) {
+                select(current.c_str());
+            }
+            return true;
+        }
+
+        dialog_->show(lcd_buffer, draw_->width());
+        return false;
     }
 
-    inline void remove(const char* group_name, mgui_object* item) {
-        mgui_list<mgui_object*>* list = map.get(group_name);
-        if (list != nullptr) {
-            list->remove(item);
+    /**
+     * @brief It returns true if a viewport must be drawn again.
+     */
+    inline bool viewports_dirty() const {
+        for (const mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            if (node->obj->dirty()) {
+                return true;
+            }
         }
+        return false;
     }
 
-    inline void clear(const char* group_name) {
-        mgui_list<mgui_object*>* list = map.get(group_name);
-        if (list != nullptr) {
-            list->clear();
-            map.remove(group_name);
+    /**
+     * @brief Mark the viewports which follow the selection dirty.
+     */
+    inline void invalidate_selection() {
+        for (mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            if (node->obj->follows_selection()) {
+                node->obj->invalidate();
+            }
         }
     }
 
-    inline bool select(const char* group_name) {
-        mgui_list<mgui_object*>* list = map.get(group_name);
-        if (list != nullptr) {
-            selected_ = group_name;
-            return true;
+    /**
+     * @brief Number of defer() of the objects drawn in the frame.
+     */
+    inline int deferred() const {
+        int total = draw_->deferred();
+        for (const mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            total += node->obj->draw()->deferred();
         }
+        return total;
+    }
 
-        return false;
+    /**
+     * @brief
+     * Draw the dirty viewports and copy the viewports into the screen buffer.
+     * A viewport which is not drawn is copied only if the buffer does not hold it yet.
+     *
+     * @param state Input of the frame
+     * @param invalid If true, the screen is cleared and every viewport is drawn
+     */
+    inline void update_viewports(mgui_input_state* state, bool invalid) {
+        // the other buffer of the double buffering holds an older frame
+        const bool whole = invalid || shown_buffer_ != nullptr;
+        if (whole) {
+            MGUI_TRACE_SCOPE("frame", "clear");
+            draw_->clear();
+        }
+
+        // the selection at the start of the frame (the assignment reuses the memory of the last frame)
+        frame_selected_ = selected_;
+        const mgui_string& selected = frame_selected_;
+        for (mgui_list_node<mgui_viewport*>* node = viewports_.first(); node != nullptr; node = node->next) {
+            mgui_viewport* viewport = node->obj;
+            const bool focus = viewport->shows(selected, selected);
+            if (invalid || viewport->dirty() || viewport->draw()->animating() || (focus && input_.active())) {
+                MGUI_TRACE_SCOPE("frame", "viewport");
+                viewport->begin();
+                mgui_list<mgui_object*>* list = map.get(viewport->follows_selection() ? selected.c_str() : viewport->group().c_str());
+                mgui_list_node<mgui_object*>* item = list != nullptr ? list->first() : nullptr;
+                budget_.reserve(item);
+                for (; item != nullptr; item = item->next) {
+                    MGUI_TRACE_SCOPE("object", mgui_object_type_name(item->obj->type()));
+                    budget_.update(item->obj, viewport->draw(), focus ? state : nullptr, &selected_);
+                }
+            } else if (!whole) {
+                continue;
+            }
+            viewport->show(lcd_buffer, draw_->width());
+        }
+
+        // a handler moved to another group
+        if (!(selected_ == selected)) {
+            invalidate_selection();
+        }
     }
 
     /**
      * @brief
-     * Update screen drawing
+     * Show the finished frame. With the adaptive refresh, a frame which is the same
+     * as the last one is not shown unless it is forced.
+     *
+     * @return true lcd() has a new frame
      */
-    inline void update_lcd() {
-        // update input state
-        mgui_input_state* state = nullptr;
-        input_.update();
-        state = input_.get_input_result();
+    inline bool present(bool force) {
+        if (!adaptive_) {
+            swap_buffer();
+            return true;
+        }
 
-        mgui_list<mgui_object*>* list = map.get(selected_);
-        if (list != nullptr) {
-            mgui_list_node<mgui_object*>* node = list->first();
+        const uint8_t* finished = orientation_.identity() ? lcd_buffer : output_buffer_;
+        const uint8_t* last = shown_buffer_ != nullptr ? shown_buffer_ : previous_;
+        if (!force && mgui_kernel::equal(finished, last, buffer_size)) {
+            return false;
+        }
 
-            // clear buffer
-            memset(lcd_buffer, 0, buffer_size);
+        if (shown_buffer_ != nullptr) {
+            swap_buffer();
+        } else {
+            mgui_kernel::copy(previous_, finished, buffer_size);
+        }
+        return true;
+    }
 
-            // set settings
-            while (node != nullptr) {
-                node->obj->update(draw_, state, &selected_);
-                node = node->next;
-            }
+    /**
+     * @brief Allocate the last frame of the adaptive refresh (the double buffer keeps its own).
+     */
+    inline void alloc_previous() {
+        if (adaptive_ && shown_buffer_ == nullptr && previous_ == nullptr) {
+            previous_ = mgui_alloc<uint8_t>(buffer_size, mgui_memory_tag::Screen);
         }
     }
 
     /**
-     * @brief Get the buffer for the set screen size
-     *
-     * @return uint8_t* A pointer to a screen buffer.
+     * @brief Show the finished frame and draw the next one in the other buffer.
      */
-    inline uint8_t* lcd() { return lcd_buffer; }
+    inline void swap_buffer() {
+        if (shown_buffer_ == nullptr) {
+            return;
+        }
 
-    inline mgui_input* input() { return &input_; }
+        uint8_t* finished = orientation_.identity() ? lcd_buffer : output_buffer_;
+        if (orientation_.identity()) {
+            lcd_buffer = shown_buffer_;
+            draw_->set_lcd(lcd_buffer);
+        } else {
+            output_buffer_ = shown_buffer_;
+        }
+        shown_buffer_ = finished;
+    }
 
-private:
     mgui_draw* draw_;
     mgui_input input_;
     mgui_string_map<mgui_list<mgui_object*>> map;
     uint8_t* lcd_buffer;
+    uint8_t* output_buffer_;
+    uint8_t* shown_buffer_;
+    uint8_t* previous_;
+    mgui_frame_listener* listener_;
+    mgui_frame_budget budget_;
+    mgui_list<mgui_binding*> bindings_;
+    mgui_list<mgui_viewport*> viewports_;
+    mgui_dialog* dialog_;
     int buffer_size;
+    int screen_width_;
+    int screen_height_;
+    bool adaptive_;
+    bool invalid_;
+    bool restored_;
     mgui_string selected_;
+    mgui_string frame_selected_;
+    mgui_string dialog_group_;
+    mgui_orientation orientation_;
 };
 
 class mgui_padding_property {
@@ -1801,6 +6006,7 @@ public:
         text_ = nullptr;
         text_index_ = nullptr;
         text_length = 0;
+        text_capacity_ = 0;
 
         if (text) {
             set_text(text);
@@ -1824,6 +6030,7 @@ public:
             this->text_ = other.text_;
             this->text_index_ = other.text_index_;
             this->text_length = other.text_length;
+            this->text_capacity_ = other.text_capacity_;
         }
         return *this;
     }
@@ -1836,12 +6043,21 @@ public:
     }
 
     inline char* get_text() const { return text_; }
+    /**
+     * @brief Set the text. The memory is reused when the text is not longer than before.
+     */
     inline void set_text(const char* text) {
-        clear();
-        text_length = strlen(text);
-        text_ = new char[text_length + 1];
-        text_index_ = new int[text_length];
-        memcpy(text_, text, text_length);
+        const int length = strlen(text);
+        if (text_ == nullptr || length > text_capacity_) {
+            clear();
+            text_capacity_ = length;
+            text_ = mgui_alloc<char>(text_capacity_ + 1, mgui_memory_tag::TextProperty);
+            text_index_ = mgui_alloc<int>(text_capacity_, mgui_memory_tag::TextProperty);
+        }
+        text_length = length;
+        if (text != text_) {
+            memcpy(text_, text, text_length);
+        }
         text_[text_length] = '\0';
 
         for (int i = 0; i < text_length; i++) {
@@ -1856,11 +6072,12 @@ public:
 private:
     inline void clear() {
         if (text_) {
-            delete[] text_index_;
-            delete[] text_;
+            mgui_free(text_index_, text_capacity_, mgui_memory_tag::TextProperty);
+            mgui_free(text_, text_capacity_ + 1, mgui_memory_tag::TextProperty);
             text_index_ = nullptr;
             text_ = nullptr;
             text_length = 0;
+            text_capacity_ = 0;
         }
     }
 
@@ -1877,6 +6094,7 @@ private:
     char* text_;
     int* text_index_;
     int text_length;
+    int text_capacity_;
 };
 
 /**
@@ -1894,6 +6112,7 @@ public:
         y_ = y;
         on_ = on;
         invert_ = invert;
+        intensity_ = 0xFF;
     }
     virtual ~mgui_pixel(){}
 
@@ -1903,6 +6122,7 @@ public:
             this->y_ = other.y_;
             this->on_ = other.on_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
         }
         return *this;
     }
@@ -1921,13 +6141,14 @@ public:
     inline bool invert() const { return invert_; }
     inline void set_invert(bool invert) { invert_ = invert; }
 
-    void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
-        if(invert_) {
-            draw->draw_pixel(x_, y_, !on_);
-            return;
-        }
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
 
-        draw->draw_pixel(x_, y_, on_);
+    void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
+        draw->draw_pixel(x_, y_, invert_ ? !on_ : on_);
+        draw->set_intensity(ink);
     }
 
 private:
@@ -1935,6 +6156,7 @@ private:
     uint16_t y_;
     bool on_;
     bool invert_;
+    uint8_t intensity_;
 };
 
 /**
@@ -1949,6 +6171,7 @@ public:
         x1_ = 0;
         y1_ = 0;
         invert_ = 0;
+        intensity_ = 0xFF;
     }
     virtual ~mgui_line() {}
 
@@ -1959,6 +6182,7 @@ public:
             this->x1_ = other.x1_;
             this->y1_ = other.y1_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
         }
         return *this;
     }
@@ -1980,8 +6204,14 @@ public:
     inline uint8_t invert() const { return invert_; }
     inline void set_invert(uint8_t invert) { invert_ = invert; }
 
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
         draw->draw_line(x0_, y0_, x1_, y1_, !invert_);
+        draw->set_intensity(ink);
     }
 
 private:
@@ -1990,6 +6220,7 @@ private:
     uint16_t x1_;
     uint16_t y1_;
     uint8_t invert_;
+    uint8_t intensity_;
 };
 
 /**
@@ -2003,6 +6234,7 @@ public:
         y_ = 0;
         r_ = 0;
         fill_ = 0;
+        intensity_ = 0xFF;
     }
     virtual ~mgui_circle(){}
 
@@ -2012,6 +6244,7 @@ public:
             this->y_ = other.y_;
             this->r_ = other.r_;
             this->fill_ = other.fill_;
+            this->intensity_ = other.intensity_;
         }
         return *this;
     }
@@ -2030,8 +6263,14 @@ public:
     inline uint8_t fill() const { return fill_; }
     inline void set_fill(uint8_t fill) { fill_ = fill; }
 
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
         draw->draw_circle(x_, y_, r_, fill_);
+        draw->set_intensity(ink);
     }
 
 private:
@@ -2039,6 +6278,7 @@ private:
     uint16_t y_;
     uint16_t r_;
     uint8_t fill_;
+    uint8_t intensity_;
 };
 
 /**
@@ -2055,6 +6295,7 @@ public:
         r_ = 0;
         fill_ = false;
         invert_ = false;
+        intensity_ = 0xFF;
     }
     virtual ~mgui_rectangle() {}
 
@@ -2067,6 +6308,7 @@ public:
             this->r_ = other.r_;
             this->fill_ = other.fill_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
         }
         return *this;
     }
@@ -2074,14 +6316,17 @@ public:
     mgui_object_type type() const { return mgui_object_type::Rectangle; }
 
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
 
         if (r_ > 0) {
             draw->draw_rectangle_rounded(
                 x_, y_, x_ + width_ - 1, y_ + height_ - 1, r_, fill_, !invert_);
-            return;
+        } else {
+            draw->draw_rectangle(x_, y_, x_ + width_ - 1, y_ + height_ - 1, fill_, !invert_);
         }
 
-        draw->draw_rectangle(x_, y_, x_ + width_ - 1, y_ + height_ - 1, fill_, !invert_);
+        draw->set_intensity(ink);
     }
 
     inline uint16_t radius() const { return r_; }
@@ -2105,6 +6350,9 @@ public:
     inline bool invert() const { return invert_; }
     inline void set_invert(bool invert) { invert_ = invert; }
 
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
 private:
     uint16_t width_;
     uint16_t height_;
@@ -2113,6 +6361,7 @@ private:
     uint16_t r_;
     bool fill_;
     bool invert_;
+    uint8_t intensity_;
 };
 
 /**
@@ -2129,6 +6378,7 @@ public:
         x2_ = 0;
         y2_ = 0;
         invert_ = 0;
+        intensity_ = 0xFF;
     }
     virtual ~mgui_triangle() {}
 
@@ -2141,6 +6391,7 @@ public:
             this->x2_ = other.x2_;
             this->y2_ = other.y2_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
         }
         return *this;
     }
@@ -2168,8 +6419,14 @@ public:
     inline uint8_t invert() const { return invert_; }
     inline void set_invert(uint8_t invert) { invert_ = invert; }
 
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
         draw->draw_triangle(x0_, y0_, x1_, y1_, x2_, y2_, invert_);
+        draw->set_intensity(ink);
     }
 
 private:
@@ -2180,6 +6437,7 @@ private:
     uint16_t x2_;
     uint16_t y2_;
     uint8_t invert_;
+    uint8_t intensity_;
 };
 
 /**
@@ -2199,6 +6457,7 @@ public:
         x_ = x;
         y_ = y;
         invert_ = false;
+        intensity_ = 0xFF;
         image_property_ = image;
     }
 
@@ -2209,6 +6468,7 @@ public:
             this->x_ = other.x_;
             this->y_ = other.y_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
             this->image_property_ = other.image_property_;
         }
         return *this;
@@ -2224,7 +6484,10 @@ public:
     mgui_object_type type() const { return mgui_object_type::Image; }
     
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
         draw->draw_image(image_property_, x_, y_, invert_);
+        draw->set_intensity(ink);
     }
 
     inline uint16_t width() const { return image_property_->width(); }
@@ -2239,11 +6502,18 @@ public:
     inline bool invert() const { return invert_; }
     inline void set_invert(bool invert) { invert_ = invert; }
 
+    /**
+     * @brief Intensity of the set bits of a 1-bit image on a grayscale screen
+     */
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
 private:
 
     uint16_t x_;
     uint16_t y_;
     bool invert_;
+    uint8_t intensity_;
     mgui_image_property *image_property_;
 };
 
@@ -2266,7 +6536,7 @@ public:
      * @param y Y position in the upper left corner where mgui_font_property resource is displayed
      */
     explicit mgui_text(mgui_font *font, const char* text = nullptr, uint16_t x = 0, uint16_t y = 0) {
-        text_property_ = new mgui_text_property(font, text);
+        text_property_ = mgui_create<mgui_text_property>(mgui_memory_tag::TextProperty, font, text);
         set_x(x);
         set_y(y);
         if (text) {
@@ -2279,11 +6549,12 @@ public:
         moved_per_frame_ = 0;
         frame_counter_ = 0;
         invert_ = false;
+        intensity_ = 0xFF;
         moved_x_counter_ = 0;
     }
 
     ~mgui_text() {
-        delete text_property_;
+        mgui_destroy(text_property_, mgui_memory_tag::TextProperty);
     }
 
     mgui_text operator=(const mgui_text& other) noexcept {
@@ -2297,6 +6568,7 @@ public:
             this->moved_amount_of_movement_ = other.moved_amount_of_movement_;
             this->moved_per_frame_ = other.moved_per_frame_;
             this->invert_ = other.invert_;
+            this->intensity_ = other.intensity_;
             this->frame_counter_ = other.frame_counter_;
             this->text_property_ = other.text_property_;
         }
@@ -2319,9 +6591,12 @@ public:
     mgui_object_type type() const { return mgui_object_type::Text; }
     
     void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+        uint8_t ink = draw->intensity();
+        draw->set_intensity(intensity_);
 
         if(move_ && 0 < view_width_ && view_width_ < text_width_) {
-            
+            draw->animate();
+
             int first_char = moved_x_counter_ / font()->width();
             int first_pos = moved_x_counter_ % font()->width();
             int end_char = view_width_ / font()->width() + first_char;
@@ -2341,15 +6616,20 @@ public:
                 }
             }
 
-            if(frame_counter_ == moved_per_frame_){
-                moved_x_counter_+=moved_amount_of_movement_;            
-                if((text_width_- moved_x_counter_) < view_width_) {
-                    moved_x_counter_ = 0;
+            if (draw->deferring()) {
+                // the move waits for a frame with time left
+                draw->defer();
+            } else {
+                if(frame_counter_ == moved_per_frame_){
+                    moved_x_counter_+=moved_amount_of_movement_;
+                    if((text_width_- moved_x_counter_) < view_width_) {
+                        moved_x_counter_ = 0;
+                    }
+                    frame_counter_ = 0;
                 }
-                frame_counter_ = 0;
-            }
 
-            frame_counter_++;
+                frame_counter_++;
+            }
 
         } else {
             int view_length = view_width_ / font()->width();
@@ -2364,6 +6644,8 @@ public:
                 draw->draw_char(font(), x0, y_, text_property_->get_text_index(i), invert_);
             }
         }
+
+        draw->set_intensity(ink);
     }
 
     inline char* text() const { return text_property_->get_text(); }
@@ -2399,6 +6681,9 @@ public:
     inline bool invert() const { return invert_; }
     inline void set_invert(bool invert) { invert_ = invert; }
 
+    inline uint8_t intensity() const { return intensity_; }
+    inline void set_intensity(uint8_t intensity) { intensity_ = intensity; }
+
     inline bool move() const { return move_; }
 
     inline void set_move(bool move, uint8_t per_frame = 1, uint8_t amount_of_movement = 1) {  
@@ -2418,6 +6703,7 @@ private:
     uint16_t x_;
     uint16_t y_;
     bool invert_;
+    uint8_t intensity_;
     bool move_;
     uint8_t moved_per_frame_;
     uint8_t moved_amount_of_movement_;
@@ -2425,6 +6711,28 @@ private:
     mgui_text_property *text_property_;
 };
 
+/**
+ * @brief Position and size of an element on the screen
+ */
+struct mgui_bounds {
+    int x;
+    int y;
+    int width;
+    int height;
+
+    inline bool empty() const { return width <= 0 || height <= 0; }
+};
+
+/**
+ * @brief Direction of the spatial navigation (see mgui_ui_group::move_selection)
+ */
+enum class mgui_direction {
+    Up,
+    Down,
+    Left,
+    Right
+};
+
 /**
  * @brief 
  * UI that requires operation such as buttons and menus are always objects that
@@ -2475,7 +6783,49 @@ public:
      */
     inline bool get_on_selected() const { return on_selected_; }
 
+    /**
+     * @brief
+     * Position and size of the element on the screen, used by the spatial navigation
+     * of mgui_ui_group. An element without bounds (the default) is not reached by it.
+     * An element which changes its bounds must call layout_changed().
+     */
+    virtual mgui_bounds bounds() const {
+        mgui_bounds none = { 0, 0, 0, 0 };
+        return none;
+    }
+
+    /**
+     * @brief
+     * Number which changes when the bounds of any element change.
+     * mgui_ui_group builds its navigation table again when it changed.
+     */
+    static inline unsigned long layout_serial() { return serial(); }
+
+protected:
+    /**
+     * @brief Report a change of the bounds.
+     */
+    static inline void layout_changed() {
+#ifdef MGUI_THREADS
+        serial().fetch_add(1, std::memory_order_relaxed);
+#else
+        serial()++;
+#endif
+    }
+
 private:
+#ifdef MGUI_THREADS
+    static inline std::atomic<unsigned long>& serial() {
+        static std::atomic<unsigned long> value(0);
+        return value;
+    }
+#else
+    static inline unsigned long& serial() {
+        static unsigned long value = 0;
+        return value;
+    }
+#endif
+
     bool on_press_;
     bool on_selected_;
 };
@@ -2541,6 +6891,7 @@ class mgui_button : public mgui_core_ui {
          text_rel_x_ = text_rel_x;
          text_rel_y_ = text_rel_y;
          update_property();
+         layout_changed();
      }
 
      /**
@@ -2563,9 +6914,28 @@ class mgui_button : public mgui_core_ui {
          padding_.set_right(right);
          padding_.set_down(down);
          update_property();
+         layout_changed();
      }
      inline mgui_padding_property padding() const { return padding_; }
 
+     inline uint16_t x() const { return rect_.x(); }
+     inline void set_x(uint16_t x) {
+         rect_.set_x(x);
+         if (text_) {
+             update_property();
+         }
+         layout_changed();
+     }
+
+     inline uint16_t y() const { return rect_.y(); }
+     inline void set_y(uint16_t y) {
+         rect_.set_y(y);
+         if (text_) {
+             update_property();
+         }
+         layout_changed();
+     }
+
      inline uint16_t width() const { return rect_.width(); }
      inline void set_width(uint16_t width) {
          rect_.set_width(width);
@@ -2573,6 +6943,7 @@ class mgui_button : public mgui_core_ui {
              text_->set_view_width(width);
              update_property();
          }
+         layout_changed();
      }
 
      inline uint16_t height() const { return rect_.height(); }
@@ -2582,6 +6953,12 @@ class mgui_button : public mgui_core_ui {
              text_->set_view_height(height);
              update_property();
          }
+         layout_changed();
+     }
+
+     mgui_bounds bounds() const {
+         mgui_bounds result = { rect_.x(), rect_.y(), rect_.width(), rect_.height() };
+         return result;
      }
 
      inline uint16_t radius() const { return rect_.radius(); }
@@ -2710,7 +7087,12 @@ public:
         if (text_) {
             text_->set_invert(focus);
             text_->set_move(focus);
+
+            // the focused item is never deferred
+            const bool deferring = draw->deferring();
+            draw->set_deferring(deferring && !focus);
             text_->update(draw, input, current_group);
+            draw->set_deferring(deferring);
         }
 
         switch (item_type_) {
@@ -2905,7 +7287,7 @@ public:
      * @param item_view_count Count of items in each view
      */
     explicit mgui_menu(const uint16_t width, const uint16_t height, const uint16_t item_view_count = 4){
-        moved_from_ = new mgui_stack<mgui_menu_property>();
+        current_ = &root_;
         window_width_ = width;
         window_height_ = height;
         item_first_node_ = nullptr;
@@ -2919,7 +7301,6 @@ public:
      * @brief Destructor.
      */
     ~mgui_menu(){
-        delete moved_from_;
     }
 
     /**
@@ -2927,7 +7308,6 @@ public:
      */
     mgui_menu operator=(const mgui_menu& other) noexcept {
         if (this != &other) {
-            this->moved_from_ = other.moved_from_;
             this->window_width_ = other.window_width_;
             this->window_height_ = other.window_height_;
             this->item_first_node_ = other.item_first_node_;
@@ -2961,6 +7341,8 @@ public:
             if (node == nullptr) {
                 break;
             }
+            MGUI_TRACE_SCOPE("object", "MenuItem");
+            MGUI_OVERDRAW_OBJECT(draw, mgui_object_type::MenuItem);
             node->obj->_set_draw_position(i, item_view_count_, window_width_, window_height_);
             node->obj->update(draw, input, current_group);
             node = node->next;
@@ -2972,9 +7354,9 @@ public:
      * @param item pointer to the menu item to add
      */
     inline void add(mgui_menu_item* item) {
-        p.menu_item_.add(item);
+        current_->menu_item_.add(item);
 
-        if(p.menu_item_.count() == 1){
+        if(current_->menu_item_.count() == 1){
             set_selected_index(0);
             item->set_on_selected(true);
         }
@@ -2989,9 +7371,9 @@ public:
             item_first_node_ = nullptr;
         }
 
-        p.menu_item_.remove(item);
+        current_->menu_item_.remove(item);
 
-        if(p.menu_item_.count() == 0) {
+        if(current_->menu_item_.count() == 0) {
             item_first_node_ = nullptr;
         }
     }
@@ -2999,18 +7381,18 @@ public:
     /**
      * @brief Return the index of the currently selected item.
      */
-    inline uint16_t selected_index() const { return p.selected_index_; }
+    inline uint16_t selected_index() const { return current_->selected_index_; }
     
     /**
      * @brief Set the index of the currently selected item.
      * @param index_ index of the selected item.
      */
     inline void set_selected_index(uint16_t index_){
-        p.selected_index_ = index_;
+        current_->selected_index_ = index_;
         int first = ((index_ + 1 - item_view_count_) > 0)? index_ + 1 - item_view_count_ : 0;
 
-        if (first < p.menu_item_.count()) {
-            item_first_node_ = p.menu_item_.get_node(first);
+        if (first < current_->menu_item_.count()) {
+            item_first_node_ = current_->menu_item_.get_node(first);
         }
         else {
             item_first_node_ = nullptr;
@@ -3020,13 +7402,13 @@ public:
     /**
      * @brief Return the property of the menu.
      */
-    inline mgui_menu_property* get_property() { return p.get_property(); }
+    inline mgui_menu_property* get_property() { return current_->get_property(); }
 
     /**
      * @brief Return the currently selected menu item.
      */
     inline mgui_menu_item* get_selected_item() {
-        return static_cast<mgui_menu_item*>(p.menu_item_.get(p.selected_index_));
+        return static_cast<mgui_menu_item*>(current_->menu_item_.get(current_->selected_index_));
     }
 
     /**
@@ -3040,8 +7422,9 @@ public:
 
         on_return_ = on_return;
 
-        if (on_return && moved_from_->is_empty() == false) {
-            p = static_cast<mgui_menu_property&&>(moved_from_->pop());
+        if (on_return && moved_from_.is_empty() == false) {
+            current_ = moved_from_.pop();
+            set_selected_index(current_->selected_index_);
         }
     }
      
@@ -3056,25 +7439,24 @@ public:
 
         on_enter_ = on_enter;
 
-        mgui_menu_item *item = p.menu_item_.get(p.selected_index_);
+        mgui_menu_item *item = current_->menu_item_.get(current_->selected_index_);
 
         // Return from item
         if (on_enter
          && item->item_type() == mgui_menu_item_type::ReturnToParent
-         && moved_from_->is_empty() == false) {
-            p = static_cast<mgui_menu_property&&>(moved_from_->pop());
+         && moved_from_.is_empty() == false) {
+            current_ = moved_from_.pop();
+            set_selected_index(current_->selected_index_);
             return;
         }
 
         item->set_on_press(on_enter);
         mgui_menu_property *menu = get_selected_item()->menu();
         if (on_enter && menu) {
-            // set own copy
-            moved_from_->push(p);
-
-            // update
-            p.menu_item_ = menu->menu_item_;
-            p.selected_index_ = menu->selected_index_;
+            // the items are shown from the property of the submenu, so nothing is copied
+            moved_from_.push(current_);
+            current_ = menu;
+            set_selected_index(current_->selected_index_);
         }
     }
 
@@ -3091,11 +7473,11 @@ public:
             return;
         }
 
-        if (p.selected_index_ < p.menu_item_.count() - 1) {
-            p.menu_item_.get(p.selected_index_)->set_on_selected(false);
-            p.menu_item_.get(p.selected_index_)->set_on_press(false);
-            set_selected_index(p.selected_index_ + 1);
-            p.menu_item_.get(p.selected_index_)->set_on_selected(true);
+        if (current_->selected_index_ < current_->menu_item_.count() - 1) {
+            current_->menu_item_.get(current_->selected_index_)->set_on_selected(false);
+            current_->menu_item_.get(current_->selected_index_)->set_on_press(false);
+            set_selected_index(current_->selected_index_ + 1);
+            current_->menu_item_.get(current_->selected_index_)->set_on_selected(true);
         }
     }
 
@@ -3112,11 +7494,11 @@ public:
             return;
         }
 
-        if (p.selected_index_ > 0) {
-            p.menu_item_.get(p.selected_index_)->set_on_selected(false);
-            p.menu_item_.get(p.selected_index_)->set_on_press(false);
-            set_selected_index(p.selected_index_ - 1);
-            p.menu_item_.get(p.selected_index_)->set_on_selected(true);
+        if (current_->selected_index_ > 0) {
+            current_->menu_item_.get(current_->selected_index_)->set_on_selected(false);
+            current_->menu_item_.get(current_->selected_index_)->set_on_press(false);
+            set_selected_index(current_->selected_index_ - 1);
+            current_->menu_item_.get(current_->selected_index_)->set_on_selected(true);
         }
     }
 
@@ -3137,7 +7519,7 @@ public:
     inline uint16_t item_view_count() const { return item_view_count_; }
     inline void set_item_view_count(uint16_t item_view_count) { item_view_count_ = item_view_count; }
 
-    inline int menu_item_count() const { return p.menu_item_.count(); }
+    inline int menu_item_count() const { return current_->menu_item_.count(); }
 
     inline uint16_t width() const { return window_width_; }
     inline void set_width(uint16_t width) { window_width_ = width; }
@@ -3154,8 +7536,9 @@ private:
     uint16_t item_view_count_;
     uint16_t window_height_;
     uint16_t window_width_;
-    mgui_menu_property p;
-    mgui_stack<mgui_menu_property> *moved_from_;
+    mgui_menu_property root_;
+    mgui_menu_property* current_;
+    mgui_stack<mgui_menu_property*> moved_from_;
 };
 
 /**
@@ -3180,12 +7563,18 @@ private:
 class mgui_ui_group : mgui_object {
 public:
     mgui_ui_group() {
-        list = new mgui_list<mgui_core_ui*>();
+        list = mgui_create<mgui_list<mgui_core_ui*>>(mgui_memory_tag::List);
         selected_index_ = 0;
         input_event_callback_ = nullptr;
+        items_ = nullptr;
+        neighbors_ = nullptr;
+        table_count_ = 0;
+        table_serial_ = 0;
+        table_valid_ = false;
     }
     ~mgui_ui_group() {
-        delete list;
+        free_table();
+        mgui_destroy(list, mgui_memory_tag::List);
     }
 
     mgui_object_type type() const { return mgui_object_type::UiGroup; }
@@ -3218,6 +7607,8 @@ public:
 
         mgui_list_node<mgui_core_ui*>* node = list->first();
         while (node != nullptr) {
+            MGUI_TRACE_SCOPE("object", mgui_object_type_name(node->obj->type()));
+            MGUI_OVERDRAW_OBJECT(draw, node->obj->type());
             node->obj->update(draw, input, current_group);
             node = node->next;
         }
@@ -3230,6 +7621,7 @@ public:
     */
     inline void add(mgui_core_ui* item) { 
         list->add(item);
+        table_valid_ = false;
         reset_selection();
     }
 
@@ -3240,12 +7632,45 @@ public:
     */
     inline void remove(mgui_core_ui* item) {
         list->remove(item);
+        table_valid_ = false;
         reset_selection();
     }
 
     inline void set_selected_index(uint16_t index_) { selected_index_ = index_; }
     inline uint16_t get_selected_index() const { return selected_index_; }
 
+    /**
+    * @brief Number of registered elements
+    */
+    inline int count() const { return list->count(); }
+
+    /**
+    * @brief Registered elements, in the order of add
+    */
+    inline const mgui_list<mgui_core_ui*>* elements() const { return list; }
+
+    /**
+    * @brief
+    * Select the element of the index, for example the one touched.
+    * The press state of the element selected before is released.
+    * 
+    * @return true The index is valid
+    */
+    inline bool select(int index) {
+        if (index < 0 || index >= list->count()) {
+            return false;
+        }
+
+        if (index != selected_index_ && selected_index_ < list->count()) {
+            mgui_core_ui* selected = list->get(selected_index_);
+            selected->set_on_selected(false);
+            selected->set_on_press(false);
+        }
+        selected_index_ = (uint16_t)index;
+        list->get(selected_index_)->set_on_selected(true);
+        return true;
+    }
+
     /**
     * @brief
     * Change the element selection to one after the other. If there is no element
@@ -3307,7 +7732,133 @@ public:
         return ((mgui_core_ui*)list->get(selected_index_))->get_on_press();
     }
 
+    /**
+     * @brief
+     * Move the selection to the nearest element in a direction, for example with a joystick.
+     * If there is no element in the direction, nothing is done.
+     *
+     * @remarks
+     * The neighbours of each element are found from the bounds (see mgui_core_ui::bounds)
+     * and kept in a table, which is built again only when an element is added or removed
+     * or the layout changed, so a move is a lookup.
+     * An element is in the direction if its centre is beyond the centre of the selected one.
+     * The elements which overlap the selected one across the direction come first,
+     * then the nearest by the distance between the edges, then by the offset of the centres.
+     *
+     * @return true The selection moved
+     */
+    inline bool move_selection(mgui_direction direction) {
+        const int next = neighbor(selected_index_, direction);
+        if (next < 0) {
+            return false;
+        }
+
+        items_[selected_index_]->set_on_selected(false);
+        items_[selected_index_]->set_on_press(false);
+        selected_index_ = (uint16_t)next;
+        items_[selected_index_]->set_on_selected(true);
+        return true;
+    }
+
+    /**
+     * @brief Index of the nearest element in a direction, or -1 if there is none.
+     */
+    inline int neighbor(int index, mgui_direction direction) {
+        if (!table_valid_ || table_serial_ != mgui_core_ui::layout_serial()) {
+            build_table();
+        }
+        if (index < 0 || index >= table_count_) {
+            return -1;
+        }
+        return neighbors_[index * 4 + (int)direction];
+    }
+
 private:
+    /**
+     * @brief Find the neighbours of each element in each direction.
+     */
+    inline void build_table() {
+        MGUI_TRACE_SCOPE("layout", "navigation");
+        free_table();
+        table_count_ = list->count();
+        table_serial_ = mgui_core_ui::layout_serial();
+        table_valid_ = true;
+        if (table_count_ == 0) {
+            return;
+        }
+
+        items_ = mgui_alloc<mgui_core_ui*>(table_count_, mgui_memory_tag::List);
+        neighbors_ = mgui_alloc<int16_t>(table_count_ * 4, mgui_memory_tag::List);
+        mgui_bounds* bounds = mgui_alloc<mgui_bounds>(table_count_, mgui_memory_tag::List);
+        int index = 0;
+        for (mgui_list_node<mgui_core_ui*>* node = list->first(); node != nullptr; node = node->next) {
+            items_[index] = node->obj;
+            bounds[index] = node->obj->bounds();
+            index++;
+        }
+
+        for (int from = 0; from < table_count_; from++) {
+            for (int direction = 0; direction < 4; direction++) {
+                int best = -1;
+                long long best_score = 0;
+                for (int to = 0; to < table_count_; to++) {
+                    if (to == from || bounds[from].empty() || bounds[to].empty()) {
+                        continue;
+                    }
+                    const long long score = distance(bounds[from], bounds[to], (mgui_direction)direction);
+                    if (score >= 0 && (best < 0 || score < best_score)) {
+                        best = to;
+                        best_score = score;
+                    }
+                }
+                neighbors_[from * 4 + direction] = (int16_t)best;
+            }
+        }
+        mgui_free(bounds, table_count_, mgui_memory_tag::List);
+    }
+
+    /**
+     * @brief
+     * Score of an element seen from another in a direction (lower is nearer),
+     * or -1 if it is not in the direction.
+     */
+    static inline long long distance(const mgui_bounds& from, const mgui_bounds& to, mgui_direction direction) {
+        // twice the centres, so they stay integers
+        const long from_x = 2L * from.x + from.width, from_y = 2L * from.y + from.height;
+        const long to_x = 2L * to.x + to.width, to_y = 2L * to.y + to.height;
+        const bool vertical = direction == mgui_direction::Up || direction == mgui_direction::Down;
+        long ahead;
+        long gap;
+        if (vertical) {
+            ahead = direction == mgui_direction::Down ? to_y - from_y : from_y - to_y;
+            gap = direction == mgui_direction::Down ? to.y - (from.y + from.height) : from.y - (to.y + to.height);
+        } else {
+            ahead = direction == mgui_direction::Right ? to_x - from_x : from_x - to_x;
+            gap = direction == mgui_direction::Right ? to.x - (from.x + from.width) : from.x - (to.x + to.width);
+        }
+        if (ahead <= 0) {
+            return -1;
+        }
+
+        const bool overlap = vertical
+            ? to.x < from.x + from.width && from.x < to.x + to.width
+            : to.y < from.y + from.height && from.y < to.y + to.height;
+        long offset = vertical ? to_x - from_x : to_y - from_y;
+        offset = offset < 0 ? -offset : offset;
+        if (gap < 0) {
+            gap = 0;
+        }
+        // overlapping first, then the gap, then the offset (both below 2^20)
+        return ((overlap ? 0LL : 1LL) << 40) | ((long long)gap << 20) | offset;
+    }
+
+    inline void free_table() {
+        mgui_free(items_, table_count_, mgui_memory_tag::List);
+        mgui_free(neighbors_, table_count_ * 4, mgui_memory_tag::List);
+        items_ = nullptr;
+        neighbors_ = nullptr;
+        table_count_ = 0;
+    }
      
     /**
     * @brief 
@@ -3336,6 +7887,11 @@ private:
 
     mgui_list<mgui_core_ui*>* list;
     uint16_t selected_index_;
+    mgui_core_ui** items_;
+    int16_t* neighbors_;
+    int table_count_;
+    unsigned long table_serial_;
+    bool table_valid_;
 };
 
 class mgui_vertical_scrollbar : public mgui_object {
@@ -0,0 +1,258 @@
+/**
+ * @file mgui_binding.h
+ * @author karakirimu
+ * @brief Lock-free values written by other threads or cores and applied to widgets
+ * @version 0.1
+ * @date 2024-08-06
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_BINDING_H
+#define MGUI_BINDING_H
+
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "mgui.h"
+
+/**
+ * @brief
+ * Sequence lock of a trivially copyable value: one writer, any number of readers,
+ * and no one waits for the other.
+ *
+ * @remarks
+ * The sequence is odd while the value is written. A reader copies the value and
+ * retries if the sequence was odd or changed meanwhile. The value is kept in
+ * atomic words (release stores and acquire loads order them after the odd
+ * sequence), so a torn copy is detected instead of being a data race, and only
+ * loads and stores are used (Cortex-M0+ has no atomic read-modify-write).
+ * Each value needs its own writer: two threads writing the same value must use two cells.
+ *
+ * @tparam T Value type (copied with memcpy)
+ */
+template <typename T>
+class mgui_seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "mgui_seqlock needs a trivially copyable type");
+    enum { WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t) };
+
+public:
+    mgui_seqlock() {
+        sequence_.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < WORDS; i++) {
+            words_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    explicit mgui_seqlock(const T& value) : mgui_seqlock() {
+        write(value);
+    }
+
+    /**
+     * @brief Replace the value (writer).
+     */
+    inline void write(const T& value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        for (int i = 0; i < WORDS; i++) {
+            words_[i].store(words[i], std::memory_order_release);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy the value (reader). It returns false if the value was being written.
+     *
+     * @param value Copy of the value
+     * @param version Version of the copy (see version())
+     */
+    inline bool try_read(T* value, uint32_t* version = nullptr) const {
+        const uint32_t before = sequence_.load(std::memory_order_acquire);
+        if ((before & 1) != 0) {
+            return false;
+        }
+
+        uint32_t words[WORDS];
+        for (int i = 0; i < WORDS; i++) {
+            words[i] = words_[i].load(std::memory_order_acquire);
+        }
+        if (sequence_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+
+        memcpy(value, words, sizeof(T));
+        if (version != nullptr) {
+            *version = before;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Copy the value, retrying while it is written.
+     */
+    inline T read() const {
+        T value;
+        while (!try_read(&value)) {
+        }
+        return value;
+    }
+
+    /**
+     * @brief Number that changes with each write (even while no write is running).
+     */
+    inline uint32_t version() const { return sequence_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint32_t> sequence_;
+    std::atomic<uint32_t> words_[WORDS];
+};
+
+/**
+ * @brief
+ * Value set by a producer (another thread, core or interrupt) and applied to
+ * a widget by update_lcd() when it changed (see mgui::bind).
+ *
+ * @remarks
+ * set() never waits. update_lcd() applies only the latest value, once per frame;
+ * if the value is being written at that moment, it is applied in the next frame.
+ * Only the changed bindings call their function, and only they make the adaptive
+ * refresh draw a frame.
+ *
+ * @tparam T Value type (trivially copyable)
+ * @tparam Target Widget type
+ */
+template <typename T, typename Target>
+class mgui_value_binding : public mgui_binding {
+public:
+    typedef void (*apply_function)(Target* target, const T& value);
+
+    /**
+     * @brief Construct a new mgui value binding object
+     *
+     * @param target Widget changed by the function
+     * @param function Sets the value to the widget (on the thread of update_lcd())
+     * @param initial Value applied by the first update_lcd()
+     */
+    explicit mgui_value_binding(Target* target, apply_function function, const T& initial = T())
+     : cell_(initial) {
+        target_ = target;
+        function_ = function;
+        applied_ = 0;
+        applies_ = 0;
+    }
+
+    /**
+     * @brief Set the value (producer).
+     */
+    inline void set(const T& value) { cell_.write(value); }
+
+    /**
+     * @brief The latest value.
+     */
+    inline T get() const { return cell_.read(); }
+
+    bool apply() {
+        if (cell_.version() == applied_) {
+            return false;
+        }
+
+        T value;
+        uint32_t version;
+        if (!cell_.try_read(&value, &version)) {
+            return false;
+        }
+        applied_ = version;
+        applies_++;
+        function_(target_, value);
+        return true;
+    }
+
+    /**
+     * @brief Number of values applied to the widget.
+     */
+    inline unsigned long applies() const { return applies_; }
+
+    inline Target* target() const { return target_; }
+
+private:
+    mgui_seqlock<T> cell_;
+    Target* target_;
+    apply_function function_;
+    uint32_t applied_;
+    unsigned long applies_;
+};
+
+/**
+ * @brief Characters of an mgui_text_binding.
+ */
+template <int Capacity>
+struct mgui_bound_text {
+    char text[Capacity];
+};
+
+/**
+ * @brief
+ * Text of an mgui_text set by a producer. The text is cut to Capacity - 1 characters.
+ *
+ * @tparam Capacity Size of the text with the terminating null character
+ */
+template <int Capacity>
+class mgui_text_binding : public mgui_value_binding<mgui_bound_text<Capacity>, mgui_text> {
+    typedef mgui_value_binding<mgui_bound_text<Capacity>, mgui_text> base;
+
+public:
+    explicit mgui_text_binding(mgui_text* text) : base(text, &mgui_text_binding::apply_text, bound(text->text())) {}
+
+    /**
+     * @brief Set the text (producer).
+     */
+    inline void set(const char* text) { base::set(bound(text)); }
+
+    /**
+     * @brief Set the text to a decimal number (producer).
+     */
+    inline void set_number(long value) {
+        char digits[24];
+        int length = 0;
+        unsigned long rest = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+        do {
+            digits[length++] = (char)('0' + rest % 10);
+            rest /= 10;
+        } while (rest > 0);
+
+        mgui_bound_text<Capacity> result;
+        int index = 0;
+        if (value < 0 && index < Capacity - 1) {
+            result.text[index++] = '-';
+        }
+        while (length > 0 && index < Capacity - 1) {
+            result.text[index++] = digits[--length];
+        }
+        result.text[index] = '\0';
+        base::set(result);
+    }
+
+private:
+    static inline mgui_bound_text<Capacity> bound(const char* text) {
+        mgui_bound_text<Capacity> result;
+        int index = 0;
+        if (text != nullptr) {
+            for (; index < Capacity - 1 && text[index] != '\0'; index++) {
+                result.text[index] = text[index];
+            }
+        }
+        result.text[index] = '\0';
+        return result;
+    }
+
+    static void apply_text(mgui_text* target, const mgui_bound_text<Capacity>& value) {
+        target->set_text(value.text);
+    }
+};
+
+#endif // MGUI_BINDING_H
@@ -0,0 +1,321 @@
+/**
+ * @file mgui_color.h
+ * @author karakirimu
+ * @brief Line-buffered RGB565 output of mgui objects for color TFTs
+ * @version 0.1
+ * @date 2024-07-26
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_COLOR_H
+#define MGUI_COLOR_H
+
+#include "mgui.h"
+
+/**
+ * @brief
+ * Destination of the RGB565 pixels (ST7735, ILI9341 and other TFT controllers).
+ * Implement it with the SPI or parallel bus of the SDK.
+ */
+class mgui_color_transport {
+public:
+    virtual ~mgui_color_transport() {}
+
+    /**
+     * @brief Start a frame. The pixels of the window follow row by row from the upper left.
+     *
+     * @param x0 x position at upper left
+     * @param y0 y position at upper left
+     * @param x1 x position at bottom right
+     * @param y1 y position at bottom right
+     */
+    virtual void begin(int x0, int y0, int x1, int y1) = 0;
+
+    /**
+     * @brief Send the pixels of a line.
+     *
+     * @remarks
+     * The pixels stay valid until the next call of write() returns,
+     * so a DMA transfer may continue after this function returns.
+     *
+     * @param pixels RGB565 pixels
+     * @param count Number of pixels
+     */
+    virtual void write(const uint16_t* pixels, int count) = 0;
+
+    /**
+     * @brief End the frame.
+     */
+    virtual void end() {}
+};
+
+/**
+ * @brief
+ * Draws mgui objects on a color screen a band of lines at a time.
+ *
+ * @remarks
+ * Objects are updated once per frame into a draw list (mgui_draw_list).
+ * The list is drawn again for each band in Mono1 or grayscale format,
+ * and each line is expanded to RGB565 with a palette lookup table.
+ * RAM use is the band, two lines of RGB565 and the draw list instead of a whole frame.
+ * The band is drawn in blocks of 8 pixels, so for another screen width it is wider
+ * than the screen and only the screen width is sent.
+ */
+class mgui_color {
+public:
+    /**
+     * @brief Construct a new mgui color object
+     *
+     * @param width Target screen width
+     * @param height Target screen height
+     * @param transport Destination of the pixels
+     * @param format
+     * Format of the band. Mono1 uses palette entries 0 and 1,
+     * Gray2 entries 0-3 and Gray4 entries 0-15 (the intensity selects the entry).
+     * @param band_height Number of lines drawn at a time (rounded up to a multiple of 8 for Mono1)
+     * @param capacity Maximum number of drawing operations in a frame
+     */
+    explicit mgui_color(const uint16_t width, const uint16_t height, mgui_color_transport* transport,
+                        const mgui_pixel_format format = mgui_pixel_format::Mono1,
+                        const uint16_t band_height = 8, const int capacity = 128)
+     : list_(capacity) {
+        width_ = width;
+        height_ = height;
+        band_width_ = (width + 7) & ~7;
+        // the pages of a Mono1 band are transposed 8 lines at a time
+        band_height_ = band_height > 0 ? band_height : 1;
+        if (format == mgui_pixel_format::Mono1) {
+            band_height_ = (band_height_ + 7) & ~7;
+        }
+        transport_ = transport;
+        input_ = nullptr;
+
+        band_ = mgui_alloc<uint8_t>(mgui_draw::buffer_size(band_width_, band_height_, format), mgui_memory_tag::Screen);
+        draw_ = mgui_create<mgui_draw>(mgui_memory_tag::Screen, band_width_, band_height_, band_, format);
+        rows_ = (format == mgui_pixel_format::Mono1) ? mgui_alloc<uint8_t>(row_bytes(), mgui_memory_tag::Screen) : nullptr;
+        lines_ = mgui_alloc<uint16_t>(band_width_ * 2, mgui_memory_tag::Screen);
+
+        const int bpp = mgui_draw::bits_per_pixel(format);
+        lut_ = mgui_alloc<uint16_t>(lut_size(bpp), mgui_memory_tag::Screen);
+        swap_bytes_ = false;
+        for (int i = 0; i < 16; i++) {
+            // gray ramp
+            int v = (bpp == 1) ? (i ? 255 : 0) : i * 255 / ((1 << bpp) - 1);
+            palette_[i] = rgb565(v, v, v);
+        }
+        build_lut();
+    }
+
+    ~mgui_color() {
+        const mgui_pixel_format format = draw_->format();
+        mgui_destroy(draw_, mgui_memory_tag::Screen);
+        mgui_free(band_, mgui_draw::buffer_size(band_width_, band_height_, format), mgui_memory_tag::Screen);
+        mgui_free(rows_, row_bytes(), mgui_memory_tag::Screen);
+        mgui_free(lines_, band_width_ * 2, mgui_memory_tag::Screen);
+        mgui_free(lut_, lut_size(mgui_draw::bits_per_pixel(format)), mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief Convert 8-bit RGB to RGB565.
+     */
+    static inline uint16_t rgb565(int r, int g, int b) {
+        return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+    }
+
+    /**
+     * @brief Set a palette entry.
+     *
+     * @param index Level of the band format (Mono1: 0-1, Gray2: 0-3, Gray4: 0-15)
+     * @param color RGB565 color
+     */
+    inline void set_color(int index, uint16_t color) {
+        palette_[index & 15] = color;
+        build_lut();
+    }
+
+    inline uint16_t color(int index) const { return palette_[index & 15]; }
+
+    /**
+     * @brief
+     * If true, each pixel is stored with the high byte first in memory,
+     * the order of SPI transfers of 8-bit words.
+     */
+    inline void set_swap_bytes(bool swap) {
+        swap_bytes_ = swap;
+        build_lut();
+    }
+
+    inline void set_input(mgui_input* input) {
+        input_ = input;
+    }
+
+    inline void add(mgui_object* item) {
+        list.add(item);
+    }
+
+    inline void remove(mgui_object* item) {
+        list.remove(item);
+    }
+
+    inline void clear() {
+        list.clear();
+    }
+
+    /**
+     * @brief
+     * Update objects and send the screen to the transport
+     */
+    inline void update_lcd() {
+        // update input state
+        mgui_input_state* state = nullptr;
+        if (input_ != nullptr) {
+            input_->update();
+            state = input_->get_input_result();
+        }
+
+        // record the frame
+        list_.clear();
+        draw_->set_origin(0, 0);
+        draw_->set_recorder(&list_);
+        mgui_list_node<mgui_object*>* node = list.first();
+        while (node != nullptr) {
+            node->obj->update(draw_, state, nullptr);
+            node = node->next;
+        }
+        draw_->set_recorder(nullptr);
+
+        // draw and send each band
+        transport_->begin(0, 0, width_ - 1, height_ - 1);
+        int line = 0;
+        for (int y = 0; y < height_; y += band_height_) {
+            draw_->set_origin(0, y);
+            draw_->clear();
+            draw_->replay(&list_);
+
+            const int rows = (height_ - y < band_height_) ? height_ - y : band_height_;
+            if (rows_ != nullptr) {
+                transpose_band(rows);
+            }
+
+            for (int row = 0; row < rows; row++) {
+                uint16_t* pixels = lines_ + (line & 1) * band_width_;
+                expand_row(row, pixels);
+                transport_->write(pixels, width_);
+                line++;
+            }
+        }
+        transport_->end();
+    }
+
+    /**
+     * @brief It returns the operations recorded in the last frame.
+     * If overflow() is true, increase the capacity.
+     */
+    inline const mgui_draw_list& draw_list() const { return list_; }
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline mgui_pixel_format format() const { return draw_->format(); }
+
+private:
+    inline int row_bytes() const { return (band_width_ >> 3) * band_height_; }
+
+    /**
+     * @brief Entries of the table of build_lut()
+     */
+    static inline int lut_size(int bpp) { return (bpp == 1) ? 16 * 4 : 256 * (8 / bpp); }
+
+    /**
+     * @brief Rebuild the table that expands a byte of the band to RGB565 pixels.
+     */
+    inline void build_lut() {
+        const int bpp = mgui_draw::bits_per_pixel(draw_->format());
+        uint16_t colors[16];
+        for (int i = 0; i < 16; i++) {
+            colors[i] = swap_bytes_ ? (uint16_t)((palette_[i] >> 8) | (palette_[i] << 8)) : palette_[i];
+        }
+
+        if (bpp == 1) {
+            // A nibble of a row, bit 0 is the leftmost pixel.
+            for (int n = 0; n < 16; n++) {
+                for (int x = 0; x < 4; x++) {
+                    lut_[n * 4 + x] = colors[(n >> x) & 1];
+                }
+            }
+            return;
+        }
+
+        // A byte of a row, the most significant bits are the leftmost pixel.
+        const int ppb = 8 / bpp;
+        const int max = (1 << bpp) - 1;
+        for (int b = 0; b < 256; b++) {
+            for (int x = 0; x < ppb; x++) {
+                lut_[b * ppb + x] = colors[(b >> (8 - bpp * (x + 1))) & max];
+            }
+        }
+    }
+
+    /**
+     * @brief Transpose the pages of a Mono1 band to rows (bit 0 is the leftmost pixel).
+     */
+    inline void transpose_band(int rows) {
+        const int blocks = band_width_ >> 3;
+        for (int page = 0; page < ((rows + 7) >> 3); page++) {
+            for (int block = 0; block < blocks; block++) {
+                mgui_word64 columns;
+                memcpy(&columns, band_ + page * band_width_ + (block << 3), 8);
+                mgui_word64 r = mgui_bit_matrix::transpose8x8(columns);
+                for (int i = 0; i < 8; i++) {
+                    rows_[((page << 3) + i) * blocks + block] = (uint8_t)(r >> (i << 3));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Expand a line of the band to RGB565.
+     */
+    inline void expand_row(int row, uint16_t* pixels) {
+        if (rows_ != nullptr) {
+            const uint8_t* src = rows_ + row * (band_width_ >> 3);
+            for (int i = 0; i < (band_width_ >> 3); i++) {
+                memcpy(pixels + (i << 3), lut_ + (src[i] & 0x0F) * 4, 8);
+                memcpy(pixels + (i << 3) + 4, lut_ + (src[i] >> 4) * 4, 8);
+            }
+            return;
+        }
+
+        const int bpp = mgui_draw::bits_per_pixel(draw_->format());
+        const int ppb = 8 / bpp;
+        const int stride = (band_width_ * bpp) >> 3;
+        const uint8_t* src = band_ + row * stride;
+        if (ppb == 2) {
+            for (int i = 0; i < stride; i++) {
+                memcpy(pixels + (i << 1), lut_ + (src[i] << 1), 4);
+            }
+            return;
+        }
+        for (int i = 0; i < stride; i++) {
+            memcpy(pixels + (i << 2), lut_ + (src[i] << 2), 8);
+        }
+    }
+
+    mgui_draw* draw_;
+    mgui_draw_list list_;
+    mgui_input* input_;
+    mgui_list<mgui_object*> list;
+    mgui_color_transport* transport_;
+    uint8_t* band_;
+    uint8_t* rows_;
+    uint16_t* lines_;
+    uint16_t* lut_;
+    uint16_t palette_[16];
+    bool swap_bytes_;
+    int width_;
+    int height_;
+    int band_width_;
+    int band_height_;
+};
+
+#endif // MGUI_COLOR_H
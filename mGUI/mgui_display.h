@@ -0,0 +1,1425 @@
+/**
+ * @file mgui_display.h
+ * @author karakirimu
+ * @brief Display drivers for monochrome OLED/LCD controllers
+ * @version 0.1
+ * @date 2024-07-27
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_DISPLAY_H
+#define MGUI_DISPLAY_H
+
+#include "mgui.h"
+
+/**
+ * @brief
+ * Connection to the display controller.
+ * Implement it with the I2C or SPI of the SDK.
+ *
+ * @remarks
+ * On I2C, a transaction begins with the control byte 0x00 for commands
+ * and 0x40 for data. On SPI, the D/C pin is low for commands and high for data.
+ */
+class mgui_display_bus {
+public:
+    virtual ~mgui_display_bus() {}
+
+    /**
+     * @brief Send command bytes (with their arguments) in one transaction.
+     */
+    virtual void command(const uint8_t* commands, int count) = 0;
+
+    /**
+     * @brief Send display RAM data in one transaction.
+     */
+    virtual void data(const uint8_t* data, int count) = 0;
+};
+
+/**
+ * @brief Kind of the wire in mgui_bus_model.
+ */
+enum class mgui_bus_type {
+    I2C,
+    SPI
+};
+
+/**
+ * @brief
+ * Estimates the time of display transactions on the wire.
+ *
+ * @remarks
+ * I2C sends 9 clocks per byte (with ACK) after the address byte and the control byte,
+ * plus the start, stop and bus free time as the transaction overhead.
+ * SPI sends 8 clocks per byte, plus the chip select and D/C setup as the overhead.
+ */
+class mgui_bus_model {
+public:
+    /**
+     * @brief Construct a new mgui bus model object
+     *
+     * @param type Kind of the wire
+     * @param clock_hz Clock frequency
+     * @param overhead_ns Time added to each transaction
+     */
+    explicit mgui_bus_model(mgui_bus_type type = mgui_bus_type::I2C, long clock_hz = 400000, long overhead_ns = -1) {
+        type_ = type;
+        clock_hz_ = clock_hz;
+        if (overhead_ns >= 0) {
+            overhead_ns_ = overhead_ns;
+        } else if (type == mgui_bus_type::I2C) {
+            // start and stop conditions and the bus free time, about 3 clocks
+            overhead_ns_ = 3 * 1000000000LL / clock_hz;
+        } else {
+            overhead_ns_ = 0;
+        }
+    }
+
+    /**
+     * @brief I2C at 100 kHz, 400 kHz or 1 MHz (fast mode plus).
+     */
+    static inline mgui_bus_model i2c(long clock_hz) {
+        return mgui_bus_model(mgui_bus_type::I2C, clock_hz);
+    }
+
+    /**
+     * @brief SPI with the clock frequency in MHz.
+     */
+    static inline mgui_bus_model spi(long clock_mhz, long overhead_ns = 200) {
+        return mgui_bus_model(mgui_bus_type::SPI, clock_mhz * 1000000L, overhead_ns);
+    }
+
+    /**
+     * @brief Time of a transaction of the bytes in nanoseconds.
+     */
+    inline long long transaction_ns(int bytes) const {
+        long long clocks;
+        if (type_ == mgui_bus_type::I2C) {
+            // address byte, control byte and the bytes
+            clocks = (long long)(bytes + 2) * 9;
+        } else {
+            clocks = (long long)bytes * 8;
+        }
+        return overhead_ns_ + clocks * 1000000000LL / clock_hz_;
+    }
+
+    inline mgui_bus_type type() const { return type_; }
+    inline long clock_hz() const { return clock_hz_; }
+    inline long long overhead_ns() const { return overhead_ns_; }
+
+private:
+    mgui_bus_type type_;
+    long clock_hz_;
+    long long overhead_ns_;
+};
+
+#ifndef MGUI_TRANSFER_INLINE_BYTES
+/**
+ * @brief Bytes of a transfer which are copied into the queue (commands).
+ */
+#define MGUI_TRANSFER_INLINE_BYTES 32
+#endif
+
+/**
+ * @brief Called when a transfer is finished (in interrupt or worker thread context).
+ */
+typedef void (*mgui_transfer_callback)(void* context);
+
+/**
+ * @brief A queued transfer of mgui_transport.
+ */
+struct mgui_transfer {
+    const uint8_t* buffer;
+    int length;
+    bool data;
+    mgui_transfer_callback callback;
+    void* context;
+    uint8_t bytes[MGUI_TRANSFER_INLINE_BYTES];
+};
+
+/**
+ * @brief
+ * Asynchronous transfers by DMA or another thread.
+ * Transfers are queued and sent in order; an implementation starts
+ * the hardware in start() and calls complete() when it is finished.
+ */
+class mgui_transport {
+public:
+    /**
+     * @brief Construct a new mgui transport object
+     *
+     * @param capacity Maximum number of queued transfers
+     */
+    explicit mgui_transport(const int capacity = 16) {
+        queue_ = mgui_alloc<mgui_transfer>(capacity, mgui_memory_tag::Transfer);
+        capacity_ = capacity;
+        head_ = 0;
+        tail_ = 0;
+        count_ = 0;
+    }
+
+    virtual ~mgui_transport() {
+        mgui_free(queue_, capacity_, mgui_memory_tag::Transfer);
+    }
+
+    /**
+     * @brief Queue a transfer without copying. It waits while the queue is full.
+     *
+     * @param buffer Bytes to send. They must not be changed until the transfer is finished.
+     * @param length Number of bytes
+     * @param data If true, display data; otherwise commands
+     * @param callback Called when the transfer is finished
+     * @param context Argument of the callback
+     */
+    inline void submit(const uint8_t* buffer, int length, bool data,
+                       mgui_transfer_callback callback = nullptr, void* context = nullptr) {
+        if (length <= 0) {
+            return;
+        }
+
+        mgui_transfer* transfer = reserve();
+        transfer->buffer = buffer;
+        transfer->length = length;
+        transfer->data = data;
+        transfer->callback = callback;
+        transfer->context = context;
+        push();
+    }
+
+    /**
+     * @brief
+     * Queue a copy of the bytes, so they can be changed after the call.
+     * More than MGUI_TRANSFER_INLINE_BYTES bytes are split into several transfers.
+     */
+    inline void submit_copy(const uint8_t* bytes, int length, bool data) {
+        while (length > 0) {
+            const int size = (length < MGUI_TRANSFER_INLINE_BYTES) ? length : MGUI_TRANSFER_INLINE_BYTES;
+            mgui_transfer* transfer = reserve();
+            memcpy(transfer->bytes, bytes, size);
+            transfer->buffer = transfer->bytes;
+            transfer->length = size;
+            transfer->data = data;
+            transfer->callback = nullptr;
+            transfer->context = nullptr;
+            push();
+            bytes += size;
+            length -= size;
+        }
+    }
+
+    /**
+     * @brief It returns true while transfers are queued or running.
+     */
+    inline bool busy() {
+        lock();
+        const bool result = count_ > 0;
+        unlock();
+        return result;
+    }
+
+    /**
+     * @brief Wait until all transfers are finished.
+     */
+    inline void wait() {
+        MGUI_TRACE_SCOPE("transfer", "wait");
+        while (busy()) {
+            idle();
+        }
+    }
+
+    inline int capacity() const { return capacity_; }
+
+protected:
+    /**
+     * @brief Start sending a transfer. It is called with the lock held.
+     */
+    virtual void start(const mgui_transfer* transfer) = 0;
+
+    /**
+     * @brief Exclude complete() from the queue operations (disable the interrupt or lock a mutex).
+     */
+    virtual void lock() {}
+    virtual void unlock() {}
+
+    /**
+     * @brief Called while waiting for the queue.
+     */
+    virtual void idle() {}
+
+    /**
+     * @brief
+     * Called by the implementation when the running transfer is finished.
+     * The next transfer is started before the callback is called.
+     * A call without a running transfer (a spurious interrupt) is ignored.
+     */
+    inline void complete() {
+        lock();
+        if (count_ == 0) {
+            unlock();
+            return;
+        }
+        const mgui_transfer* done = &queue_[tail_];
+        mgui_transfer_callback callback = done->callback;
+        void* context = done->context;
+        tail_ = (tail_ + 1) % capacity_;
+        count_--;
+        if (count_ > 0) {
+            start(&queue_[tail_]);
+        }
+        unlock();
+
+        if (callback != nullptr) {
+            callback(context);
+        }
+    }
+
+private:
+    /**
+     * @brief Wait for a free slot and return it.
+     */
+    inline mgui_transfer* reserve() {
+        lock();
+        while (count_ == capacity_) {
+            unlock();
+            idle();
+            lock();
+        }
+        mgui_transfer* transfer = &queue_[head_];
+        unlock();
+        return transfer;
+    }
+
+    inline void push() {
+        lock();
+        head_ = (head_ + 1) % capacity_;
+        count_++;
+        if (count_ == 1) {
+            start(&queue_[tail_]);
+        }
+        unlock();
+    }
+
+    mgui_transfer* queue_;
+    int capacity_;
+    int head_;
+    int tail_;
+    int count_;
+};
+
+/**
+ * @brief
+ * Display bus over an mgui_transport.
+ * Commands are copied into the queue, and display data is sent from the frame buffer
+ * without copying, so the frame buffer must not be changed until wait() returns
+ * (see mgui::set_double_buffer).
+ */
+class mgui_async_bus : public mgui_display_bus {
+public:
+    explicit mgui_async_bus(mgui_transport* transport) {
+        transport_ = transport;
+    }
+
+    virtual ~mgui_async_bus() {}
+
+    void command(const uint8_t* commands, int count) {
+        transport_->submit_copy(commands, count, false);
+    }
+
+    void data(const uint8_t* data, int count) {
+        transport_->submit(data, count, true);
+    }
+
+    /**
+     * @brief Wait until the queued commands and data are sent.
+     */
+    inline void wait() { transport_->wait(); }
+
+    inline bool busy() { return transport_->busy(); }
+
+    inline mgui_transport* transport() const { return transport_; }
+
+private:
+    mgui_transport* transport_;
+};
+
+/**
+ * @brief
+ * Display with a page-ordered frame buffer (mgui_pixel_format::Mono1).
+ * The buffer is the same as mgui::lcd().
+ */
+class mgui_display {
+public:
+    /**
+     * @brief Construct a new mgui display object
+     *
+     * @param width Screen width
+     * @param height Screen height (a multiple of 8)
+     * @param bus Connection to the controller
+     */
+    explicit mgui_display(const uint16_t width, const uint16_t height, mgui_display_bus* bus) {
+        width_ = width;
+        height_ = height;
+        bus_ = bus;
+    }
+
+    virtual ~mgui_display() {}
+
+    /**
+     * @brief Send the initialization sequence and turn on the display.
+     */
+    virtual void init() = 0;
+
+    /**
+     * @brief Send the whole frame buffer.
+     */
+    inline void transfer(const uint8_t* buffer) {
+        MGUI_TRACE_SCOPE("transfer", "transfer");
+        transfer_window(buffer, 0, 0, width_ - 1, pages() - 1);
+    }
+
+    /**
+     * @brief Send a window of the frame buffer.
+     *
+     * @param buffer Whole frame buffer
+     * @param x0 Left column
+     * @param page0 Top page (8 lines)
+     * @param x1 Right column (inclusive)
+     * @param page1 Bottom page (inclusive)
+     */
+    virtual void transfer_window(const uint8_t* buffer, int x0, int page0, int x1, int page1) = 0;
+
+    /**
+     * @brief
+     * Send only what differs from the previous frame on the display.
+     *
+     * @param buffer Frame to show
+     * @param previous Frame shown on the display
+     * @param per_page
+     * If true, the changed columns of each page are sent as separate windows;
+     * if false, one window which covers all changes is sent.
+     * @return false Nothing has changed
+     */
+    inline bool transfer_diff(const uint8_t* buffer, const uint8_t* previous, bool per_page = true) {
+        MGUI_TRACE_SCOPE("transfer", "transfer_diff");
+        int left = width_;
+        int right = -1;
+        int top = -1;
+        int bottom = -1;
+        for (int page = 0; page < pages(); page++) {
+            int first;
+            int last;
+            const int offset = page * width_;
+            if (!mgui_kernel::diff(buffer + offset, previous + offset, width_, &first, &last)) {
+                continue;
+            }
+
+            if (per_page) {
+                transfer_window(buffer, first, page, last, page);
+                top = page;
+                continue;
+            }
+
+            if (first < left) left = first;
+            if (last > right) right = last;
+            if (top < 0) top = page;
+            bottom = page;
+        }
+
+        if (!per_page && top >= 0) {
+            transfer_window(buffer, left, top, right, bottom);
+        }
+        return top >= 0;
+    }
+
+    /**
+     * @brief Set the contrast (0 - 255).
+     */
+    virtual void set_contrast(uint8_t value) {
+        const uint8_t cmds[] = { 0x81, value };
+        bus_->command(cmds, sizeof(cmds));
+    }
+
+    /**
+     * @brief Invert all pixels without changing the display RAM.
+     */
+    virtual void set_invert(bool on) {
+        const uint8_t cmd = on ? 0xA7 : 0xA6;
+        bus_->command(&cmd, 1);
+    }
+
+    /**
+     * @brief Scroll vertically in hardware: the line of the RAM shown at the top.
+     */
+    virtual void set_start_line(int line) {
+        const uint8_t cmd = (uint8_t)(0x40 | (line & 0x3F));
+        bus_->command(&cmd, 1);
+    }
+
+    /**
+     * @brief Turn the display on or off (sleep). The display RAM is kept.
+     */
+    virtual void set_power(bool on) {
+        const uint8_t cmd = on ? 0xAF : 0xAE;
+        bus_->command(&cmd, 1);
+    }
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline int pages() const { return height_ >> 3; }
+    inline mgui_display_bus* bus() const { return bus_; }
+
+protected:
+    /**
+     * @brief Limit the window to the screen. It returns false if nothing is left.
+     */
+    inline bool clip_window(int& x0, int& page0, int& x1, int& page1) const {
+        if (x0 < 0) x0 = 0;
+        if (page0 < 0) page0 = 0;
+        if (x1 >= width_) x1 = width_ - 1;
+        if (page1 >= pages()) page1 = pages() - 1;
+        return x0 <= x1 && page0 <= page1;
+    }
+
+    /**
+     * @brief
+     * Send a window page by page for controllers with only page addressing (SH1106, ST7565).
+     * Each page is 3 command bytes in one transaction followed by one data transaction.
+     */
+    inline void transfer_pages(const uint8_t* buffer, int x0, int page0, int x1, int page1, int column_offset) {
+        if (!clip_window(x0, page0, x1, page1)) {
+            return;
+        }
+
+        const int column = x0 + column_offset;
+        for (int page = page0; page <= page1; page++) {
+            const uint8_t cmds[] = {
+                (uint8_t)(0xB0 | page),                   // page address
+                (uint8_t)(0x10 | ((column >> 4) & 0x0F)), // column address, upper nibble
+                (uint8_t)(column & 0x0F)                  // column address, lower nibble
+            };
+            bus_->command(cmds, sizeof(cmds));
+            bus_->data(buffer + page * width_ + x0, x1 - x0 + 1);
+        }
+    }
+
+    mgui_display_bus* bus_;
+    int width_;
+    int height_;
+};
+
+/**
+ * @brief
+ * SSD1306 (128x64, 128x32 and 96x16 OLED).
+ *
+ * @remarks
+ * The controller is set to horizontal addressing, so a window is sent
+ * with one command transaction and the data of all pages in one transaction
+ * when it has the full width. The window command is skipped when the same window
+ * as the last transfer is sent again, as the address returns to its start.
+ */
+class mgui_ssd1306 : public mgui_display {
+public:
+    /**
+     * @brief Construct a new mgui ssd1306 object
+     *
+     * @param width Screen width
+     * @param height Screen height
+     * @param bus I2C (address 0x3C or 0x3D) or SPI connection
+     * @param external_vcc If true, the charge pump is disabled
+     */
+    explicit mgui_ssd1306(const uint16_t width, const uint16_t height, mgui_display_bus* bus,
+                          bool external_vcc = false)
+     : mgui_display(width, height, bus) {
+        external_vcc_ = external_vcc;
+        window_valid_ = false;
+    }
+
+    virtual ~mgui_ssd1306() {}
+
+    void init() {
+        const uint8_t cmds[] = {
+            0xAE,                              // display off
+            0xD5, 0x80,                        // clock divide ratio, standard frequency
+            0xA8, (uint8_t)(height_ - 1),      // multiplex ratio
+            0xD3, 0x00,                        // display offset
+            0x40,                              // start line 0
+            0x8D, external_vcc_ ? (uint8_t)0x10 : (uint8_t)0x14, // charge pump
+            0x20, 0x00,                        // horizontal addressing mode
+            0xA1,                              // column 127 is mapped to SEG0
+            0xC8,                              // scan from COM[N-1] to COM0
+            0xDA, (height_ == 64) ? (uint8_t)0x12 : (uint8_t)0x02, // COM pins configuration
+            0x81, 0xCF,                        // contrast
+            0xD9, external_vcc_ ? (uint8_t)0x22 : (uint8_t)0xF1, // pre-charge period
+            0xDB, 0x30,                        // VCOMH deselect level
+            0xA4,                              // follow the RAM content
+            0xA6,                              // not inverted
+            0x2E,                              // stop scrolling
+            0xAF                               // display on
+        };
+        bus_->command(cmds, sizeof(cmds));
+        window_valid_ = false;
+    }
+
+    void transfer_window(const uint8_t* buffer, int x0, int page0, int x1, int page1) {
+        if (!clip_window(x0, page0, x1, page1)) {
+            return;
+        }
+
+        if (!window_valid_ || window_[0] != x0 || window_[1] != x1
+            || window_[2] != page0 || window_[3] != page1) {
+            const uint8_t cmds[] = {
+                0x21, (uint8_t)x0, (uint8_t)x1,      // column address
+                0x22, (uint8_t)page0, (uint8_t)page1 // page address
+            };
+            bus_->command(cmds, sizeof(cmds));
+            window_[0] = x0;
+            window_[1] = x1;
+            window_[2] = page0;
+            window_[3] = page1;
+            window_valid_ = true;
+        }
+
+        // the pages are continuous in the buffer
+        if (x0 == 0 && x1 == width_ - 1) {
+            bus_->data(buffer + page0 * width_, (page1 - page0 + 1) * width_);
+            return;
+        }
+
+        for (int page = page0; page <= page1; page++) {
+            bus_->data(buffer + page * width_ + x0, x1 - x0 + 1);
+        }
+    }
+
+    /**
+     * @brief Scroll all pages horizontally in hardware.
+     *
+     * @remarks
+     * The display RAM must not be written while scrolling, and it should be sent again
+     * after the scrolling stops.
+     *
+     * @param on Start or stop scrolling
+     * @param left Direction
+     * @param interval Frames between steps (0: 5, 1: 64, 2: 128, 3: 256, 4: 3, 5: 4, 6: 25, 7: 2)
+     */
+    inline void set_horizontal_scroll(bool on, bool left = false, int interval = 0) {
+        if (!on) {
+            const uint8_t cmd = 0x2E;
+            bus_->command(&cmd, 1);
+            return;
+        }
+
+        const uint8_t cmds[] = {
+            0x2E,                              // stop before the setup
+            (uint8_t)(left ? 0x27 : 0x26),     // direction
+            0x00,                              // dummy
+            0x00,                              // start page
+            (uint8_t)(interval & 0x07),        // interval
+            (uint8_t)(pages() - 1),            // end page
+            0x00, 0xFF,                        // dummy
+            0x2F                               // start
+        };
+        bus_->command(cmds, sizeof(cmds));
+    }
+
+private:
+    bool external_vcc_;
+    bool window_valid_;
+    int window_[4];
+};
+
+/**
+ * @brief
+ * SH1106 (132x64 RAM OLED, usually a 128x64 panel in columns 2 - 129).
+ *
+ * @remarks
+ * The controller only has page addressing, so each page of a window
+ * is sent after its page and column address.
+ */
+class mgui_sh1106 : public mgui_display {
+public:
+    /**
+     * @brief Construct a new mgui sh1106 object
+     *
+     * @param width Screen width
+     * @param height Screen height
+     * @param bus I2C (address 0x3C) or SPI connection
+     * @param column_offset RAM column of the left edge of the panel
+     */
+    explicit mgui_sh1106(const uint16_t width, const uint16_t height, mgui_display_bus* bus,
+                         int column_offset = 2)
+     : mgui_display(width, height, bus) {
+        column_offset_ = column_offset;
+    }
+
+    virtual ~mgui_sh1106() {}
+
+    void init() {
+        const uint8_t cmds[] = {
+            0xAE,                              // display off
+            0xD5, 0x80,                        // clock divide ratio
+            0xA8, (uint8_t)(height_ - 1),      // multiplex ratio
+            0xD3, 0x00,                        // display offset
+            0x40,                              // start line 0
+            0xAD, 0x8B,                        // DC-DC converter on
+            0x32,                              // pump voltage 8.0V
+            0xA1,                              // segment remap
+            0xC8,                              // scan from COM[N-1] to COM0
+            0xDA, 0x12,                        // COM pins configuration
+            0x81, 0x80,                        // contrast
+            0xD9, 0x22,                        // pre-charge period
+            0xDB, 0x35,                        // VCOM deselect level
+            0xA4,                              // follow the RAM content
+            0xA6,                              // not inverted
+            0xAF                               // display on
+        };
+        bus_->command(cmds, sizeof(cmds));
+    }
+
+    void transfer_window(const uint8_t* buffer, int x0, int page0, int x1, int page1) {
+        transfer_pages(buffer, x0, page0, x1, page1, column_offset_);
+    }
+
+    inline int column_offset() const { return column_offset_; }
+
+private:
+    int column_offset_;
+};
+
+/**
+ * @brief
+ * ST7565 (132x65 RAM LCD, usually a 128x64 panel).
+ *
+ * @remarks
+ * Like SH1106, each page of a window is sent after its page and column address.
+ * Modules which mirror the segments (ADC select 0xA1) show the panel from column 4.
+ */
+class mgui_st7565 : public mgui_display {
+public:
+    /**
+     * @brief Construct a new mgui st7565 object
+     *
+     * @param width Screen width
+     * @param height Screen height
+     * @param bus SPI connection
+     * @param column_offset RAM column of the left edge of the panel
+     */
+    explicit mgui_st7565(const uint16_t width, const uint16_t height, mgui_display_bus* bus,
+                         int column_offset = 0)
+     : mgui_display(width, height, bus) {
+        column_offset_ = column_offset;
+    }
+
+    virtual ~mgui_st7565() {}
+
+    void init() {
+        const uint8_t cmds[] = {
+            0xA2,                              // LCD bias 1/9
+            0xA0,                              // ADC normal
+            0xC8,                              // COM reverse
+            0xA6,                              // not inverted
+            0x2F,                              // booster, regulator and follower on
+            0xF8, 0x00,                        // booster ratio 4x
+            0x27,                              // regulator resistor ratio
+            0x81, 0x18,                        // electronic volume
+            0x40,                              // start line 0
+            0xA4,                              // follow the RAM content
+            0xAF                               // display on
+        };
+        bus_->command(cmds, sizeof(cmds));
+    }
+
+    void transfer_window(const uint8_t* buffer, int x0, int page0, int x1, int page1) {
+        transfer_pages(buffer, x0, page0, x1, page1, column_offset_);
+    }
+
+    /**
+     * @brief Set the contrast (0 - 255) with the 6-bit electronic volume.
+     */
+    void set_contrast(uint8_t value) {
+        const uint8_t cmds[] = { 0x81, (uint8_t)(value >> 2) };
+        bus_->command(cmds, sizeof(cmds));
+    }
+
+    inline int column_offset() const { return column_offset_; }
+
+private:
+    int column_offset_;
+};
+
+/**
+ * @brief Panel state set by mgui_idle_power.
+ */
+enum class mgui_power_state {
+    On,
+    Dimmed,
+    Off
+};
+
+/**
+ * @brief
+ * Dims the display and then turns it off after a time without input.
+ *
+ * @remarks
+ * Call update() once per frame with the activity of the frame, for example
+ * mgui::input_active(). The commands are sent only when the state changes.
+ * While the display is off the frames need not be sent; when update() returns true
+ * it was turned on again, and the current frame should be sent.
+ */
+class mgui_idle_power {
+public:
+    /**
+     * @brief Construct a new mgui idle power object
+     *
+     * @param display Display to control
+     * @param clock_us Clock in microseconds (time_us_32 on the Pico)
+     * @param contrast Contrast while the display is on
+     */
+    explicit mgui_idle_power(mgui_display* display, unsigned long (*clock_us)(), uint8_t contrast = 0x7F) {
+        display_ = display;
+        clock_ = clock_us;
+        contrast_ = contrast;
+        dim_contrast_ = contrast;
+        dim_after_ms_ = 0;
+        off_after_ms_ = 0;
+        state_ = mgui_power_state::On;
+        last_active_ = (uint32_t)clock_();
+    }
+
+    /**
+     * @brief Lower the contrast after a time without input (0 ms to disable).
+     */
+    inline void set_dim(uint32_t after_ms, uint8_t contrast) {
+        dim_after_ms_ = after_ms;
+        dim_contrast_ = contrast;
+    }
+
+    /**
+     * @brief Turn the display off after a time without input (0 ms to disable).
+     */
+    inline void set_off(uint32_t after_ms) { off_after_ms_ = after_ms; }
+
+    /**
+     * @brief Update the state with the activity of the frame.
+     *
+     * @param active True if there was an input
+     * @return true The display was turned on again
+     */
+    inline bool update(bool active) {
+        const uint32_t now = (uint32_t)clock_();
+        if (active) {
+            last_active_ = now;
+            return wake();
+        }
+
+        const uint32_t idle_ms = (now - last_active_) / 1000;
+        if (off_after_ms_ > 0 && idle_ms >= off_after_ms_) {
+            if (state_ != mgui_power_state::Off) {
+                display_->set_power(false);
+                state_ = mgui_power_state::Off;
+            }
+        } else if (dim_after_ms_ > 0 && idle_ms >= dim_after_ms_) {
+            if (state_ == mgui_power_state::On) {
+                display_->set_contrast(dim_contrast_);
+                state_ = mgui_power_state::Dimmed;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Restore the contrast and turn the display on.
+     *
+     * @return true The display was off
+     */
+    inline bool wake() {
+        const bool off = state_ == mgui_power_state::Off;
+        if (state_ != mgui_power_state::On) {
+            display_->set_contrast(contrast_);
+        }
+        if (off) {
+            display_->set_power(true);
+        }
+        state_ = mgui_power_state::On;
+        return off;
+    }
+
+    inline mgui_power_state state() const { return state_; }
+
+    /**
+     * @brief It returns true unless the display is off, so the frames are shown.
+     */
+    inline bool on() const { return state_ != mgui_power_state::Off; }
+
+private:
+    mgui_display* display_;
+    unsigned long (*clock_)();
+    uint8_t contrast_;
+    uint8_t dim_contrast_;
+    uint32_t dim_after_ms_;
+    uint32_t off_after_ms_;
+    uint32_t last_active_;
+    mgui_power_state state_;
+};
+
+/**
+ * @brief
+ * Shows one frame of mgui or mgui_multi on several displays: each display shows
+ * a region of the frame (the canvas) with its size, or mirrors another display.
+ *
+ * @remarks
+ * The scene is drawn once with one input, for example on a 128x128 canvas for
+ * a 128x64 main display at (0, 0) and a 128x64 status display at (0, 64).
+ * present() copies each region out of the canvas (except a full-width region at
+ * a multiple of 8 lines, which is used in place), and sends it only to the displays
+ * on which it changed since their last transfer. A mirror uses the region of its
+ * source, so it costs a transfer but no copy (unless the source is disabled). The canvas and the displays are
+ * Mono1 (pages of 8 lines). With an mgui_async_bus, wait for the buses before
+ * the next present(), as the regions are sent from buffers reused by it.
+ */
+class mgui_display_set {
+public:
+    /**
+     * @brief Construct a new mgui display set object
+     *
+     * @param canvas_width Width of the frame of mgui
+     * @param canvas_height Height of the frame of mgui (a multiple of 8)
+     * @param capacity Maximum number of displays
+     */
+    explicit mgui_display_set(const uint16_t canvas_width, const uint16_t canvas_height, const int capacity = 4) {
+        canvas_width_ = canvas_width;
+        canvas_height_ = canvas_height;
+        capacity_ = capacity;
+        count_ = 0;
+        presents_ = 0;
+        entries_ = mgui_alloc<entry>(capacity, mgui_memory_tag::Screen);
+    }
+
+    ~mgui_display_set() {
+        for (int i = 0; i < count_; i++) {
+            mgui_free(entries_[i].region, entries_[i].size, mgui_memory_tag::Screen);
+            mgui_free(entries_[i].previous, entries_[i].size, mgui_memory_tag::Screen);
+        }
+        mgui_free(entries_, capacity_, mgui_memory_tag::Screen);
+    }
+
+    /**
+     * @brief Show the region of the canvas at (x, y) with the size of the display.
+     *
+     * @param display Display showing the region (initialized by the caller)
+     * @param x Left of the region on the canvas
+     * @param y Top of the region on the canvas (any line)
+     * @param diff If true, only the changed columns of each page are sent (see mgui_display::transfer_diff)
+     * @return int Index of the display, or -1 if the set is full
+     */
+    inline int add(mgui_display* display, int x = 0, int y = 0, bool diff = true) {
+        if (count_ == capacity_) {
+            return -1;
+        }
+
+        entry& e = entries_[count_];
+        e.display = display;
+        e.x = x;
+        e.y = y;
+        e.source = count_;
+        e.diff = diff;
+        e.size = display->width() * display->pages();
+        // a full-width region on a page boundary is a part of the canvas
+        if (x == 0 && (y & 7) == 0 && display->width() == canvas_width_ && y + display->height() <= canvas_height_) {
+            e.region = nullptr;
+        } else {
+            e.region = mgui_alloc<uint8_t>(e.size, mgui_memory_tag::Screen);
+        }
+        e.previous = mgui_alloc<uint8_t>(e.size, mgui_memory_tag::Screen);
+        reset(e);
+        return count_++;
+    }
+
+    /**
+     * @brief Show the region of another display. The displays must have the same size.
+     *
+     * @return int Index of the display, or -1 if the set is full or the size differs
+     */
+    inline int add_mirror(mgui_display* display, int source, bool diff = true) {
+        if (count_ == capacity_ || source < 0 || source >= count_) {
+            return -1;
+        }
+        const entry& original = entries_[entries_[source].source];
+        if (display->width() != original.display->width() || display->height() != original.display->height()) {
+            return -1;
+        }
+
+        entry& e = entries_[count_];
+        e.display = display;
+        e.x = original.x;
+        e.y = original.y;
+        e.source = original.source;
+        e.diff = diff;
+        e.size = original.size;
+        e.region = nullptr;
+        e.previous = mgui_alloc<uint8_t>(e.size, mgui_memory_tag::Screen);
+        reset(e);
+        return count_++;
+    }
+
+    /**
+     * @brief Send the canvas to the displays on which their region changed.
+     *
+     * @param canvas Frame of mgui (mgui::lcd())
+     * @param force If true, every enabled display is sent in full
+     * @return int Number of displays sent
+     */
+    inline int present(const uint8_t* canvas, bool force = false) {
+        MGUI_TRACE_SCOPE("transfer", "display set");
+        int sent = 0;
+        presents_++;
+        for (int i = 0; i < count_; i++) {
+            entry& e = entries_[i];
+            if (!e.enabled) {
+                continue;
+            }
+
+            const uint8_t* frame = region(canvas, entries_[e.source]);
+            bool changed;
+            if (force || !e.valid) {
+                e.display->transfer(frame);
+                changed = true;
+            } else if (e.diff) {
+                changed = e.display->transfer_diff(frame, e.previous);
+            } else {
+                changed = !mgui_kernel::equal(frame, e.previous, e.size);
+                if (changed) {
+                    e.display->transfer(frame);
+                }
+            }
+
+            e.sent = changed;
+            if (changed) {
+                memcpy(e.previous, frame, e.size);
+                e.valid = true;
+                e.transfers++;
+                sent++;
+            }
+        }
+        return sent;
+    }
+
+    /**
+     * @brief Stop or restart sending to a display (for example while it is off).
+     * A restarted display is sent in full.
+     */
+    inline void set_enabled(int index, bool enabled) {
+        if (enabled && !entries_[index].enabled) {
+            entries_[index].valid = false;
+        }
+        entries_[index].enabled = enabled;
+    }
+
+    inline bool enabled(int index) const { return entries_[index].enabled; }
+
+    /**
+     * @brief Send the display in full with the next present() (for example after init()).
+     */
+    inline void invalidate(int index) { entries_[index].valid = false; }
+
+    /**
+     * @brief It returns true if the display was sent by the last present().
+     */
+    inline bool sent(int index) const { return entries_[index].sent; }
+
+    /**
+     * @brief Number of present() calls which sent the display.
+     */
+    inline long transfers(int index) const { return entries_[index].transfers; }
+
+    inline mgui_display* display(int index) const { return entries_[index].display; }
+    inline int count() const { return count_; }
+    inline int canvas_width() const { return canvas_width_; }
+    inline int canvas_height() const { return canvas_height_; }
+
+private:
+    struct entry {
+        mgui_display* display;
+        int x;
+        int y;
+        int source;
+        int size;
+        uint8_t* region;
+        uint8_t* previous;
+        long transfers;
+        unsigned long copied;
+        bool diff;
+        bool enabled;
+        bool valid;
+        bool sent;
+    };
+
+    static inline void reset(entry& e) {
+        e.transfers = 0;
+        e.copied = 0;
+        e.enabled = true;
+        e.valid = false;
+        e.sent = false;
+    }
+
+    /**
+     * @brief
+     * The region of a source display. It is copied out of the canvas once per present(),
+     * by the source or by the first mirror if the source is disabled.
+     */
+    inline const uint8_t* region(const uint8_t* canvas, entry& e) {
+        if (e.region == nullptr) {
+            return canvas + (e.y >> 3) * canvas_width_;
+        }
+        if (e.copied == presents_) {
+            return e.region;
+        }
+        e.copied = presents_;
+
+        MGUI_TRACE_SCOPE("transfer", "copy region");
+        const int width = e.display->width();
+        const int pages = e.display->pages();
+        const int canvas_pages = canvas_height_ >> 3;
+        const int shift = e.y & 7;
+        for (int page = 0; page < pages; page++) {
+            uint8_t* out = e.region + page * width;
+            const int upper = (e.y >> 3) + page;
+            for (int column = 0; column < width; column++) {
+                const int x = e.x + column;
+                if (x < 0 || x >= canvas_width_) {
+                    out[column] = 0;
+                    continue;
+                }
+                uint8_t bits = (upper >= 0 && upper < canvas_pages) ? (uint8_t)(canvas[upper * canvas_width_ + x] >> shift) : 0;
+                if (shift != 0 && upper + 1 >= 0 && upper + 1 < canvas_pages) {
+                    bits |= (uint8_t)(canvas[(upper + 1) * canvas_width_ + x] << (8 - shift));
+                }
+                out[column] = bits;
+            }
+        }
+        return e.region;
+    }
+
+    entry* entries_;
+    int capacity_;
+    int count_;
+    int canvas_width_;
+    int canvas_height_;
+    unsigned long presents_;
+};
+
+/**
+ * @brief Command set decoded by mgui_display_simulator.
+ */
+enum class mgui_display_controller {
+    SSD1306,
+    SH1106,
+    ST7565
+};
+
+/**
+ * @brief
+ * Host simulator of a display controller.
+ * It is connected in place of the bus and decodes the commands and data
+ * into the display RAM and the display state.
+ */
+class mgui_display_simulator : public mgui_display_bus {
+public:
+    /**
+     * @brief Construct a new mgui display simulator object
+     *
+     * @param controller Command set
+     * @param width Panel width
+     * @param height Panel height (a multiple of 8)
+     * @param ram_columns Columns of the display RAM (SSD1306: 128, SH1106 and ST7565: 132)
+     * @param column_offset RAM column of the left edge of the panel
+     */
+    explicit mgui_display_simulator(mgui_display_controller controller, const uint16_t width, const uint16_t height,
+                                    int ram_columns = 128, int column_offset = 0) {
+        controller_ = controller;
+        width_ = width;
+        height_ = height;
+        ram_columns_ = ram_columns;
+        column_offset_ = column_offset;
+        ram_pages_ = 8;
+        ram_ = new uint8_t[ram_columns_ * ram_pages_]();
+        reset();
+    }
+
+    ~mgui_display_simulator() {
+        delete[] ram_;
+    }
+
+    /**
+     * @brief Clear the display RAM and return to the state after power on.
+     */
+    inline void reset() {
+        memset(ram_, 0, ram_columns_ * ram_pages_);
+        pending_ = 0;
+        arguments_ = 0;
+        received_ = 0;
+        mode_ = 2;
+        column_ = 0;
+        page_ = 0;
+        column_start_ = 0;
+        column_end_ = ram_columns_ - 1;
+        page_start_ = 0;
+        page_end_ = ram_pages_ - 1;
+        start_line_ = 0;
+        contrast_ = 0x7F;
+        inverted_ = false;
+        power_ = false;
+        entire_on_ = false;
+        scrolling_ = false;
+        segment_remap_ = false;
+        com_reverse_ = false;
+    }
+
+    void command(const uint8_t* commands, int count) {
+        for (int i = 0; i < count; i++) {
+            if (received_ < arguments_) {
+                args_[received_++] = commands[i];
+                if (received_ == arguments_) {
+                    execute();
+                }
+                continue;
+            }
+
+            pending_ = commands[i];
+            arguments_ = argument_count(pending_);
+            received_ = 0;
+            if (arguments_ == 0) {
+                execute();
+            }
+        }
+    }
+
+    void data(const uint8_t* data, int count) {
+        for (int i = 0; i < count; i++) {
+            if (column_ < ram_columns_ && page_ < ram_pages_) {
+                ram_[page_ * ram_columns_ + column_] = data[i];
+            }
+            advance();
+        }
+    }
+
+    /**
+     * @brief It returns a byte of the display RAM (bit 0 is the top line of the page).
+     */
+    inline uint8_t ram(int column, int page) const {
+        return ram_[page * ram_columns_ + column];
+    }
+
+    /**
+     * @brief
+     * It returns the pixel seen at (x, y) of the panel, with the column offset,
+     * start line, inversion and power applied. The segment remap and COM scan direction
+     * depend on the module and are not applied.
+     */
+    inline bool pixel(int x, int y) const {
+        if (!power_) {
+            return false;
+        }
+        if (entire_on_) {
+            return true;
+        }
+        const int line = (y + start_line_) % (ram_pages_ << 3);
+        const bool on = (ram(x + column_offset_, line >> 3) >> (line & 7)) & 1;
+        return on != inverted_;
+    }
+
+    /**
+     * @brief Compare the panel with a page-ordered frame buffer.
+     */
+    inline bool equals(const uint8_t* buffer) const {
+        for (int y = 0; y < height_; y++) {
+            for (int x = 0; x < width_; x++) {
+                if (pixel(x, y) != (bool)((buffer[(y >> 3) * width_ + x] >> (y & 7)) & 1)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    inline mgui_display_controller controller() const { return controller_; }
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline int start_line() const { return start_line_; }
+    inline uint8_t contrast() const { return contrast_; }
+    inline bool inverted() const { return inverted_; }
+    inline bool power() const { return power_; }
+    inline bool scrolling() const { return scrolling_; }
+    inline bool segment_remap() const { return segment_remap_; }
+    inline bool com_reverse() const { return com_reverse_; }
+
+private:
+    /**
+     * @brief Number of argument bytes following a command.
+     */
+    inline int argument_count(uint8_t cmd) const {
+        switch (controller_) {
+        case mgui_display_controller::SSD1306:
+            switch (cmd) {
+            case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+            case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+                return 1;
+            case 0x21: case 0x22: case 0xA3:
+                return 2;
+            case 0x29: case 0x2A:
+                return 5;
+            case 0x26: case 0x27:
+                return 6;
+            default:
+                return 0;
+            }
+        case mgui_display_controller::SH1106:
+            switch (cmd) {
+            case 0x81: case 0xA8: case 0xAD: case 0xD3:
+            case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+                return 1;
+            default:
+                return 0;
+            }
+        case mgui_display_controller::ST7565:
+            switch (cmd) {
+            case 0x81: case 0xAC: case 0xAD: case 0xF8:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    inline void execute() {
+        const uint8_t cmd = pending_;
+        arguments_ = 0;
+        received_ = 0;
+
+        if (controller_ == mgui_display_controller::SSD1306) {
+            switch (cmd) {
+            case 0x20:
+                mode_ = args_[0] & 0x03;
+                return;
+            case 0x21:
+                column_start_ = args_[0];
+                column_end_ = args_[1];
+                column_ = column_start_;
+                return;
+            case 0x22:
+                page_start_ = args_[0] & 0x07;
+                page_end_ = args_[1] & 0x07;
+                page_ = page_start_;
+                return;
+            case 0x26: case 0x27: case 0x29: case 0x2A: case 0x2E:
+                scrolling_ = false;
+                return;
+            case 0x2F:
+                scrolling_ = true;
+                return;
+            default:
+                break;
+            }
+        }
+
+        if (controller_ == mgui_display_controller::ST7565 && cmd == 0xE2) {
+            // software reset keeps the display RAM
+            start_line_ = 0;
+            column_ = 0;
+            page_ = 0;
+            return;
+        }
+
+        if (cmd <= 0x0F) {
+            column_ = (column_ & 0xF0) | cmd;
+        } else if (cmd <= 0x1F) {
+            column_ = (column_ & 0x0F) | ((cmd & 0x0F) << 4);
+        } else if (cmd >= 0x40 && cmd <= 0x7F) {
+            start_line_ = cmd & 0x3F;
+        } else if (cmd == 0x81) {
+            contrast_ = args_[0];
+        } else if (cmd == 0xA0 || cmd == 0xA1) {
+            segment_remap_ = cmd & 1;
+        } else if (cmd == 0xA4 || cmd == 0xA5) {
+            entire_on_ = cmd & 1;
+        } else if (cmd == 0xA6 || cmd == 0xA7) {
+            inverted_ = cmd & 1;
+        } else if (cmd == 0xAE || cmd == 0xAF) {
+            power_ = cmd & 1;
+        } else if (cmd >= 0xB0 && cmd <= 0xB8) {
+            page_ = cmd & 0x0F;
+        } else if (cmd >= 0xC0 && cmd <= 0xCF) {
+            com_reverse_ = (cmd >> 3) & 1;
+        }
+    }
+
+    /**
+     * @brief Move the RAM address after a data byte.
+     */
+    inline void advance() {
+        if (controller_ != mgui_display_controller::SSD1306 || mode_ == 2) {
+            // page addressing
+            if (controller_ == mgui_display_controller::SSD1306) {
+                column_ = (column_ >= column_end_) ? column_start_ : column_ + 1;
+            } else if (column_ < ram_columns_) {
+                column_++;
+            }
+            return;
+        }
+
+        if (mode_ == 0) {
+            // horizontal addressing
+            if (column_ < column_end_) {
+                column_++;
+                return;
+            }
+            column_ = column_start_;
+            page_ = (page_ < page_end_) ? page_ + 1 : page_start_;
+            return;
+        }
+
+        // vertical addressing
+        if (page_ < page_end_) {
+            page_++;
+            return;
+        }
+        page_ = page_start_;
+        column_ = (column_ < column_end_) ? column_ + 1 : column_start_;
+    }
+
+    mgui_display_controller controller_;
+    uint8_t* ram_;
+    int width_;
+    int height_;
+    int ram_columns_;
+    int ram_pages_;
+    int column_offset_;
+
+    // command decoder
+    uint8_t pending_;
+    uint8_t args_[6];
+    int arguments_;
+    int received_;
+
+    // address
+    int mode_;
+    int column_;
+    int page_;
+    int column_start_;
+    int column_end_;
+    int page_start_;
+    int page_end_;
+
+    // display state
+    int start_line_;
+    uint8_t contrast_;
+    bool inverted_;
+    bool power_;
+    bool entire_on_;
+    bool scrolling_;
+    bool segment_remap_;
+    bool com_reverse_;
+};
+
+#endif // MGUI_DISPLAY_H
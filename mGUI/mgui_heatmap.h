@@ -0,0 +1,92 @@
+/**
+ * @file mgui_heatmap.h
+ * @author karakirimu
+ * @brief Overdraw heatmap images and statistics on the host
+ * @version 0.1
+ * @date 2024-08-02
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_HEATMAP_H
+#define MGUI_HEATMAP_H
+
+#include <stdio.h>
+
+#include "mgui.h"
+
+#ifndef MGUI_OVERDRAW
+#error "mgui_heatmap.h needs MGUI_OVERDRAW defined for all files including mgui.h"
+#endif
+
+/**
+ * @brief
+ * Color of a write count: black (not written), blue (1), green (2), yellow (3),
+ * orange (4), red (5-7) and magenta (8 or more).
+ */
+inline void mgui_heatmap_color(int count, uint8_t rgb[3]) {
+    static const uint8_t ramp[][3] = {
+        { 0, 0, 0 }, { 0, 64, 255 }, { 0, 192, 0 }, { 255, 224, 0 },
+        { 255, 128, 0 }, { 255, 0, 0 }, { 255, 0, 0 }, { 255, 0, 0 }, { 255, 0, 255 }
+    };
+    const int index = count < 8 ? count : 8;
+    rgb[0] = ramp[index][0];
+    rgb[1] = ramp[index][1];
+    rgb[2] = ramp[index][2];
+}
+
+/**
+ * @brief Write the counts of the frame as a binary PPM image.
+ *
+ * @param scale Size of a pixel in the image
+ */
+inline bool mgui_save_heatmap(const mgui_overdraw& overdraw, FILE* file, int scale = 1) {
+    const int width = overdraw.width() * scale;
+    const int height = overdraw.height() * scale;
+    if (fprintf(file, "P6\n%d %d\n255\n", width, height) < 0) {
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t rgb[3];
+            mgui_heatmap_color(overdraw.count(x / scale, y / scale), rgb);
+            if (fwrite(rgb, 1, 3, file) != 3) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+inline bool mgui_save_heatmap(const mgui_overdraw& overdraw, const char* path, int scale = 1) {
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool result = mgui_save_heatmap(overdraw, file, scale);
+    return fclose(file) == 0 && result;
+}
+
+/**
+ * @brief Print the writes of the frame, then the types that have written.
+ */
+inline void mgui_print_overdraw(const mgui_overdraw& overdraw, FILE* file = stdout) {
+    const long writes = overdraw.writes();
+    const int unique = overdraw.unique();
+    fprintf(file, "overdraw: %ld writes, %d pixels, %.2f writes/pixel, max %d\n",
+            writes, unique, unique > 0 ? (double)writes / unique : 0.0, overdraw.max());
+
+    for (int type = 0; type < mgui_overdraw::TYPES; type++) {
+        const long type_writes = overdraw.writes(type);
+        if (type_writes == 0) {
+            continue;
+        }
+        const int type_unique = overdraw.unique(type);
+        const char* name = (type == mgui_overdraw::OTHER) ? "Other" : mgui_object_type_name((mgui_object_type)type);
+        fprintf(file, "  %-16s %8ld writes, %6d pixels, %.2f writes/pixel\n",
+                name, type_writes, type_unique, type_unique > 0 ? (double)type_writes / type_unique : 0.0);
+    }
+}
+
+#endif // MGUI_HEATMAP_H
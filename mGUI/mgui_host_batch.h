@@ -0,0 +1,160 @@
+/**
+ * @file mgui_host_batch.h
+ * @author karakirimu
+ * @brief Thread pool rendering many independent screens on the host
+ * @version 0.1
+ * @date 2024-08-07
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_HOST_BATCH_H
+#define MGUI_HOST_BATCH_H
+
+#ifndef MGUI_THREADS
+#error "Define MGUI_THREADS for the whole program to render on several threads"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mgui.h"
+
+/**
+ * @brief
+ * Runs screen jobs (for example the variants of a screen for documentation
+ * or regression images) on a pool of threads.
+ *
+ * @remarks
+ * Each job must use its own mgui or mgui_multi and its own widgets; fonts may be shared
+ * (the glyph caches of mgui_font_aa are locked while drawing, at the cost of waiting
+ * for each other). Input callbacks and handlers have no context: they must not keep
+ * their state in (non thread_local) statics.
+ */
+class mgui_batch_renderer {
+public:
+    typedef std::function<void(int index)> job_function;
+
+    /**
+     * @brief Construct a new mgui batch renderer object
+     *
+     * @param threads Number of threads (0: the number of hardware threads)
+     */
+    explicit mgui_batch_renderer(int threads = 0) {
+        if (threads <= 0) {
+            threads = (int)std::thread::hardware_concurrency();
+        }
+        if (threads <= 0) {
+            threads = 1;
+        }
+        job_ = nullptr;
+        count_ = 0;
+        next_.store(0, std::memory_order_relaxed);
+        remaining_ = 0;
+        active_ = 0;
+        generation_ = 0;
+        stop_ = false;
+        finished_ = 0;
+        for (int i = 0; i < threads; i++) {
+            workers_.emplace_back(&mgui_batch_renderer::work, this);
+        }
+    }
+
+    ~mgui_batch_renderer() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Call job(index) for each index from 0 to count - 1 on the threads.
+     * It returns when all of them are finished.
+     */
+    inline void run(int count, const job_function& job) {
+        if (count <= 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> guard(mutex_);
+        job_ = &job;
+        count_ = count;
+        remaining_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        generation_++;
+        start_.notify_all();
+        // a thread which found no job may still be taking the next index
+        done_.wait(guard, [this] { return remaining_ == 0 && active_ == 0; });
+        job_ = nullptr;
+        count_ = 0;
+    }
+
+    inline int threads() const { return (int)workers_.size(); }
+
+    /**
+     * @brief Number of jobs finished since the construction.
+     */
+    inline long finished() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return finished_;
+    }
+
+private:
+    void work() {
+#ifdef MGUI_TRACE
+        mgui_tracer::instance().set_thread_name("batch");
+#endif
+        unsigned long generation = 0;
+        std::unique_lock<std::mutex> guard(mutex_);
+        while (true) {
+            start_.wait(guard, [this, generation] { return stop_ || generation_ != generation; });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+            const job_function* job = job_;
+            const int count = count_;
+            active_++;
+            guard.unlock();
+
+            // the jobs are taken one by one, so long and short jobs are balanced
+            int done = 0;
+            for (int index = next_.fetch_add(1); index < count; index = next_.fetch_add(1)) {
+                MGUI_TRACE_SCOPE("batch", "job");
+                (*job)(index);
+                done++;
+            }
+
+            guard.lock();
+            finished_ += done;
+            remaining_ -= done;
+            active_--;
+            if (remaining_ == 0 && active_ == 0) {
+                done_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const job_function* job_;
+    int count_;
+    std::atomic<int> next_;
+    int remaining_;
+    int active_;
+    unsigned long generation_;
+    bool stop_;
+    long finished_;
+};
+
+#endif // MGUI_HOST_BATCH_H
@@ -0,0 +1,176 @@
+/**
+ * @file mgui_host_bus.h
+ * @author karakirimu
+ * @brief Recording display bus with a wire time estimate for host benchmarks
+ * @version 0.1
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_HOST_BUS_H
+#define MGUI_HOST_BUS_H
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "mgui_display.h"
+
+/**
+ * @brief A transaction recorded by mgui_recording_bus.
+ */
+struct mgui_bus_transaction {
+    bool data;
+    int offset;
+    int length;
+    long long wire_ns;
+};
+
+/**
+ * @brief
+ * Records every transaction issued by a display driver and estimates
+ * its time on the wire with an mgui_bus_model.
+ * The transactions can be forwarded to another bus (for example mgui_display_simulator).
+ */
+class mgui_recording_bus : public mgui_display_bus {
+public:
+    /**
+     * @brief Construct a new mgui recording bus object
+     *
+     * @param model Wire to estimate
+     * @param next Bus receiving the transactions (nullptr to discard them)
+     * @param keep_bytes If false, only the counters are kept
+     */
+    explicit mgui_recording_bus(const mgui_bus_model& model = mgui_bus_model(),
+                                mgui_display_bus* next = nullptr, bool keep_bytes = true)
+     : model_(model) {
+        next_ = next;
+        keep_bytes_ = keep_bytes;
+        realtime_ = false;
+        reset();
+    }
+
+    void command(const uint8_t* commands, int count) {
+        record(false, commands, count);
+        command_transactions_++;
+        command_bytes_ += count;
+        if (next_ != nullptr) {
+            next_->command(commands, count);
+        }
+    }
+
+    void data(const uint8_t* data, int count) {
+        record(true, data, count);
+        data_transactions_++;
+        data_bytes_ += count;
+        if (next_ != nullptr) {
+            next_->data(data, count);
+        }
+    }
+
+    /**
+     * @brief Clear the transactions, the counters and the frames.
+     */
+    inline void reset() {
+        log_.clear();
+        bytes_.clear();
+        frames_.clear();
+        command_transactions_ = 0;
+        data_transactions_ = 0;
+        command_bytes_ = 0;
+        data_bytes_ = 0;
+        wire_ns_ = 0;
+        frame_start_ns_ = 0;
+    }
+
+    /**
+     * @brief End a frame: the wire time since the last mark is stored as a frame.
+     */
+    inline void mark_frame() {
+        frames_.push_back(wire_ns_ - frame_start_ns_);
+        frame_start_ns_ = wire_ns_;
+    }
+
+    inline void set_model(const mgui_bus_model& model) { model_ = model; }
+
+    /**
+     * @brief If true, each transaction sleeps its estimated wire time like a blocking bus.
+     */
+    inline void set_realtime(bool enable) { realtime_ = enable; }
+    inline bool realtime() const { return realtime_; }
+    inline const mgui_bus_model& model() const { return model_; }
+
+    inline int transactions() const { return command_transactions_ + data_transactions_; }
+    inline int command_transactions() const { return command_transactions_; }
+    inline int data_transactions() const { return data_transactions_; }
+    inline long long command_bytes() const { return command_bytes_; }
+    inline long long data_bytes() const { return data_bytes_; }
+
+    /**
+     * @brief Estimated time of all transactions on the wire.
+     */
+    inline long long wire_ns() const { return wire_ns_; }
+    inline double wire_ms() const { return wire_ns_ / 1e6; }
+
+    /**
+     * @brief Recorded transactions (only when the bytes are kept).
+     */
+    inline int count() const { return (int)log_.size(); }
+    inline const mgui_bus_transaction& get(int index) const { return log_[index]; }
+    inline const uint8_t* bytes(int index) const { return bytes_.data() + log_[index].offset; }
+
+    inline int frame_count() const { return (int)frames_.size(); }
+    inline long long frame_ns(int index) const { return frames_[index]; }
+
+    /**
+     * @brief Average wire time of the marked frames in milliseconds.
+     */
+    inline double frame_ms() const {
+        if (frames_.empty()) {
+            return 0;
+        }
+        long long total = 0;
+        for (long long ns : frames_) {
+            total += ns;
+        }
+        return total / 1e6 / frames_.size();
+    }
+
+private:
+    inline void record(bool data, const uint8_t* bytes, int count) {
+        const long long ns = model_.transaction_ns(count);
+        wire_ns_ += ns;
+        if (realtime_) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+        }
+        if (!keep_bytes_) {
+            return;
+        }
+
+        mgui_bus_transaction transaction;
+        transaction.data = data;
+        transaction.offset = (int)bytes_.size();
+        transaction.length = count;
+        transaction.wire_ns = ns;
+        log_.push_back(transaction);
+        bytes_.insert(bytes_.end(), bytes, bytes + count);
+    }
+
+    mgui_bus_model model_;
+    mgui_display_bus* next_;
+    bool keep_bytes_;
+    bool realtime_;
+
+    std::vector<mgui_bus_transaction> log_;
+    std::vector<uint8_t> bytes_;
+    std::vector<long long> frames_;
+    int command_transactions_;
+    int data_transactions_;
+    long long command_bytes_;
+    long long data_bytes_;
+    long long wire_ns_;
+    long long frame_start_ns_;
+};
+
+#endif // MGUI_HOST_BUS_H
@@ -0,0 +1,79 @@
+/**
+ * @file mgui_host_pipeline.h
+ * @author karakirimu
+ * @brief Thread-backed mgui_pipeline for host simulation
+ * @version 0.1
+ * @date 2024-08-05
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_HOST_PIPELINE_H
+#define MGUI_HOST_PIPELINE_H
+
+#include <atomic>
+#include <thread>
+
+#include "mgui_pipeline.h"
+
+/**
+ * @brief
+ * Runs the two stages of an mgui_pipeline on two threads,
+ * like the two cores of RP2040 on the host.
+ *
+ * @tparam Gui mgui or mgui_multi
+ */
+template <typename Gui>
+class mgui_thread_pipeline : public mgui_pipeline<Gui> {
+public:
+    explicit mgui_thread_pipeline(Gui* gui, mgui_display* display)
+     : mgui_pipeline<Gui>(gui, display, &mgui_thread_pipeline::yield) {}
+
+    /**
+     * @brief Render the frames on one thread and send them on another one.
+     * It returns when every frame is sent.
+     *
+     * @param frames Number of calls to render()
+     * @param frame_start Called on the render thread before each frame (for example to set the input)
+     */
+    inline void run(int frames, void (*frame_start)(int frame) = nullptr) {
+        std::atomic<bool> done(false);
+
+        std::thread transmitter([this, &done] {
+#ifdef MGUI_TRACE
+            mgui_tracer::instance().set_thread_name("transmit");
+#endif
+            while (true) {
+                // the last frame may be published after transmit() found none
+                const bool finished = done.load(std::memory_order_acquire);
+                if (!this->transmit()) {
+                    if (finished) {
+                        return;
+                    }
+                    yield();
+                }
+            }
+        });
+
+        std::thread renderer([this, &done, frames, frame_start] {
+#ifdef MGUI_TRACE
+            mgui_tracer::instance().set_thread_name("render");
+#endif
+            for (int i = 0; i < frames; i++) {
+                if (frame_start != nullptr) {
+                    frame_start(i);
+                }
+                this->render();
+            }
+            done.store(true, std::memory_order_release);
+        });
+
+        renderer.join();
+        transmitter.join();
+    }
+
+private:
+    static void yield() { std::this_thread::yield(); }
+};
+
+#endif // MGUI_HOST_PIPELINE_H
@@ -0,0 +1,147 @@
+/**
+ * @file mgui_host_transport.h
+ * @author karakirimu
+ * @brief Thread-backed mgui_transport for host simulation
+ * @version 0.1
+ * @date 2024-07-28
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_HOST_TRANSPORT_H
+#define MGUI_HOST_TRANSPORT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "mgui_display.h"
+
+/**
+ * @brief
+ * Sends the queued transfers on a worker thread at a configured bandwidth,
+ * like a DMA channel on the host. The bytes are passed to a bus
+ * (for example mgui_display_simulator) when each transfer is finished.
+ */
+class mgui_thread_transport : public mgui_transport {
+public:
+    /**
+     * @brief Construct a new mgui thread transport object
+     *
+     * @param next Bus receiving the bytes (nullptr to discard them)
+     * @param bytes_per_second Bandwidth of the wire (0: no delay)
+     * @param overhead_us Time added to each transfer (address, D/C switch)
+     * @param capacity Maximum number of queued transfers
+     */
+    explicit mgui_thread_transport(mgui_display_bus* next, long bytes_per_second = 0,
+                                   long overhead_us = 0, const int capacity = 16)
+     : mgui_transport(capacity) {
+        next_ = next;
+        bytes_per_second_ = bytes_per_second;
+        overhead_us_ = overhead_us;
+        current_ = nullptr;
+        stop_ = false;
+        transfers_ = 0;
+        bytes_ = 0;
+        worker_ = std::thread(&mgui_thread_transport::run, this);
+    }
+
+    ~mgui_thread_transport() {
+        wait();
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_one();
+        worker_.join();
+    }
+
+    inline void set_bandwidth(long bytes_per_second, long overhead_us = 0) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        bytes_per_second_ = bytes_per_second;
+        overhead_us_ = overhead_us;
+    }
+
+    /**
+     * @brief Number of finished transfers.
+     */
+    inline long transfers() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return transfers_;
+    }
+
+    /**
+     * @brief Number of bytes in the finished transfers.
+     */
+    inline long long bytes() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return bytes_;
+    }
+
+protected:
+    void start(const mgui_transfer* transfer) {
+        current_ = transfer;
+        ready_.notify_one();
+    }
+
+    void lock() { mutex_.lock(); }
+    void unlock() { mutex_.unlock(); }
+    void idle() { std::this_thread::yield(); }
+
+private:
+    void run() {
+#ifdef MGUI_TRACE
+        mgui_tracer::instance().set_thread_name("transport");
+#endif
+        std::unique_lock<std::mutex> guard(mutex_);
+        while (true) {
+            ready_.wait(guard, [this] { return stop_ || current_ != nullptr; });
+            if (stop_) {
+                return;
+            }
+
+            const mgui_transfer* transfer = current_;
+            current_ = nullptr;
+            const long long wire_us = overhead_us_
+                + (bytes_per_second_ > 0 ? transfer->length * 1000000LL / bytes_per_second_ : 0);
+            guard.unlock();
+
+            {
+                MGUI_TRACE_SCOPE("transfer", transfer->data ? "wire data" : "wire command");
+                if (wire_us > 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(wire_us));
+                }
+                if (next_ != nullptr) {
+                    if (transfer->data) {
+                        next_->data(transfer->buffer, transfer->length);
+                    } else {
+                        next_->command(transfer->buffer, transfer->length);
+                    }
+                }
+            }
+
+            guard.lock();
+            transfers_++;
+            bytes_ += transfer->length;
+            guard.unlock();
+
+            complete();
+            guard.lock();
+        }
+    }
+
+    mgui_display_bus* next_;
+    long bytes_per_second_;
+    long overhead_us_;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    const mgui_transfer* current_;
+    bool stop_;
+    long transfers_;
+    long long bytes_;
+};
+
+#endif // MGUI_HOST_TRANSPORT_H
@@ -0,0 +1,93 @@
+/**
+ * @file mgui_memory_report.h
+ * @author karakirimu
+ * @brief Memory footprint of the objects and the allocations of mgui
+ * @version 0.1
+ * @date 2024-08-03
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_MEMORY_REPORT_H
+#define MGUI_MEMORY_REPORT_H
+
+#include <stdio.h>
+
+#include "mgui.h"
+
+/**
+ * @brief Size of a class of mgui
+ */
+struct mgui_size_entry {
+    const char* name;
+    long size;
+};
+
+#define MGUI_SIZE_ENTRY(type) { #type, (long)sizeof(type) }
+
+/**
+ * @brief Sizes of the widgets and the classes that own them.
+ *
+ * @param count Number of entries
+ */
+inline const mgui_size_entry* mgui_sizes(int* count) {
+    static const mgui_size_entry sizes[] = {
+        MGUI_SIZE_ENTRY(mgui_pixel),
+        MGUI_SIZE_ENTRY(mgui_line),
+        MGUI_SIZE_ENTRY(mgui_circle),
+        MGUI_SIZE_ENTRY(mgui_rectangle),
+        MGUI_SIZE_ENTRY(mgui_triangle),
+        MGUI_SIZE_ENTRY(mgui_image),
+        MGUI_SIZE_ENTRY(mgui_text),
+        MGUI_SIZE_ENTRY(mgui_button),
+        MGUI_SIZE_ENTRY(mgui_menu_item),
+        MGUI_SIZE_ENTRY(mgui_menu),
+        MGUI_SIZE_ENTRY(mgui_ui_group),
+        MGUI_SIZE_ENTRY(mgui_vertical_scrollbar),
+        MGUI_SIZE_ENTRY(mgui_text_property),
+        MGUI_SIZE_ENTRY(mgui_menu_property),
+        MGUI_SIZE_ENTRY(mgui_image_property),
+        MGUI_SIZE_ENTRY(mgui_font_aa),
+        MGUI_SIZE_ENTRY(mgui_string),
+        MGUI_SIZE_ENTRY(mgui_list<mgui_object*>),
+        MGUI_SIZE_ENTRY(mgui_string_map<mgui_list<mgui_object*>>),
+        MGUI_SIZE_ENTRY(mgui_input),
+        MGUI_SIZE_ENTRY(mgui_draw),
+        MGUI_SIZE_ENTRY(mgui),
+        MGUI_SIZE_ENTRY(mgui_multi)
+    };
+    *count = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    return sizes;
+}
+
+/**
+ * @brief Print the sizes of mgui_sizes().
+ */
+inline void mgui_print_sizes(FILE* file = stdout) {
+    int count = 0;
+    const mgui_size_entry* sizes = mgui_sizes(&count);
+    fprintf(file, "sizeof:\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "  %-44s %6ld bytes\n", sizes[i].name, sizes[i].size);
+    }
+}
+
+/**
+ * @brief Print the allocations of each subsystem, then the total.
+ */
+inline void mgui_print_memory(FILE* file = stdout) {
+    fprintf(file, "heap: %-12s %8s %8s %8s %8s\n", "", "current", "peak", "allocs", "frees");
+    for (int tag = 0; tag < mgui_memory::TAGS; tag++) {
+        const mgui_memory_stats stats = mgui_memory::stats((mgui_memory_tag)tag);
+        if (stats.allocations == 0) {
+            continue;
+        }
+        fprintf(file, "  %-16s %8ld %8ld %8ld %8ld\n", mgui_memory::tag_name((mgui_memory_tag)tag),
+                stats.current, stats.peak, stats.allocations, stats.frees);
+    }
+    const mgui_memory_stats total = mgui_memory::total();
+    fprintf(file, "  %-16s %8ld %8ld %8ld %8ld\n", "Total",
+            total.current, total.peak, total.allocations, total.frees);
+}
+
+#endif // MGUI_MEMORY_REPORT_H
@@ -0,0 +1,220 @@
+/**
+ * @file mgui_pipeline.h
+ * @author karakirimu
+ * @brief Two-stage render/transmit pipeline for two cores
+ * @version 0.1
+ * @date 2024-08-05
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_PIPELINE_H
+#define MGUI_PIPELINE_H
+
+#include <atomic>
+
+#include "mgui_display.h"
+
+/**
+ * @brief
+ * Lock-free exchange of frame buffers from one producer to one consumer
+ * (for example the two cores of RP2040).
+ *
+ * @remarks
+ * A ring of frame pointers: the producer writes only the head and the consumer
+ * only the tail, so only loads and stores of aligned words are used
+ * (Cortex-M0+ has no atomic read-modify-write). A frame stays in the ring until
+ * the consumer releases it, so the producer knows which buffers are still read.
+ *
+ * @tparam Capacity Maximum number of frames handed over and not released
+ */
+template <int Capacity>
+class mgui_frame_exchange {
+public:
+    mgui_frame_exchange() {
+        for (int i = 0; i < Capacity; i++) {
+            frames_[i] = nullptr;
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Hand a frame over (producer). It returns false if the ring is full.
+     */
+    inline bool publish(const uint8_t* frame) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == (uint32_t)Capacity) {
+            return false;
+        }
+        frames_[head % Capacity] = frame;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief The oldest frame which is not released (consumer), or nullptr.
+     */
+    inline const uint8_t* peek() const {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) {
+            return nullptr;
+        }
+        return frames_[tail % Capacity];
+    }
+
+    /**
+     * @brief Give the frame of peek() back to the producer (consumer).
+     */
+    inline void release() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Number of frames handed over and not released.
+     */
+    inline int count() const {
+        return (int)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+
+    inline bool full() const { return count() == Capacity; }
+    inline bool empty() const { return count() == 0; }
+    inline int capacity() const { return Capacity; }
+
+private:
+    const uint8_t* frames_[Capacity];
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+};
+
+/**
+ * @brief
+ * Two-stage frame pipeline: render() reads the input and draws the next frame
+ * while transmit() sends the last one, on the other core or thread.
+ *
+ * @remarks
+ * The gui draws with double buffering, and its two buffers are handed over by an
+ * mgui_frame_exchange, so nothing is copied. render() waits while both buffers
+ * are in use, so a frame takes the time of the slower stage instead of the sum
+ * of both. The display must be on a blocking bus: a frame is released when
+ * transfer() returns. Only transmit() may use the bus while the pipeline runs.
+ *
+ * @tparam Gui mgui or mgui_multi
+ */
+template <typename Gui>
+class mgui_pipeline {
+public:
+    /**
+     * @brief Construct a new mgui pipeline object
+     *
+     * @param gui Gui drawn by render(). It is set to double buffering.
+     * @param display Display sent by transmit()
+     * @param idle Called while render() waits for a buffer (for example __wfe on RP2040)
+     * @param notify Called when a stage hands a buffer to the other one (for example __sev)
+     */
+    explicit mgui_pipeline(Gui* gui, mgui_display* display, void (*idle)() = nullptr, void (*notify)() = nullptr) {
+        gui_ = gui;
+        display_ = display;
+        idle_ = idle;
+        notify_ = notify;
+        rendered_.store(0, std::memory_order_relaxed);
+        transmitted_.store(0, std::memory_order_relaxed);
+        gui_->set_double_buffer(true);
+    }
+
+    /**
+     * @brief
+     * Stage one: update_lcd() and hand the frame to transmit().
+     * It waits while the other buffer is sent.
+     *
+     * @return true A new frame was handed over (false if the adaptive refresh skipped it)
+     */
+    inline bool render() {
+        MGUI_TRACE_SCOPE("pipeline", "render");
+        {
+            MGUI_TRACE_SCOPE("pipeline", "wait buffer");
+            while (exchange_.full()) {
+                wait();
+            }
+        }
+
+        if (!gui_->update_lcd()) {
+            return false;
+        }
+        exchange_.publish(gui_->lcd());
+        rendered_.store(rendered_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        signal();
+        return true;
+    }
+
+    /**
+     * @brief Stage two: send the oldest frame handed over by render().
+     *
+     * @return true A frame was sent (false if there was none)
+     */
+    inline bool transmit() {
+        const uint8_t* frame = exchange_.peek();
+        if (frame == nullptr) {
+            return false;
+        }
+
+        {
+            MGUI_TRACE_SCOPE("pipeline", "transmit");
+            display_->transfer(frame);
+        }
+        exchange_.release();
+        transmitted_.store(transmitted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        signal();
+        return true;
+    }
+
+    /**
+     * @brief It returns true if every frame handed over was sent.
+     */
+    inline bool drained() const { return exchange_.empty(); }
+
+    /**
+     * @brief Wait until every frame handed over is sent (by the other stage).
+     */
+    inline void flush() {
+        while (!drained()) {
+            wait();
+        }
+    }
+
+    inline void wait() const {
+        if (idle_ != nullptr) {
+            idle_();
+        }
+    }
+
+    /**
+     * @brief Number of frames handed over by render()
+     */
+    inline uint32_t rendered() const { return rendered_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of frames sent by transmit()
+     */
+    inline uint32_t transmitted() const { return transmitted_.load(std::memory_order_relaxed); }
+
+    inline Gui* gui() const { return gui_; }
+    inline mgui_display* display() const { return display_; }
+
+private:
+    inline void signal() const {
+        if (notify_ != nullptr) {
+            notify_();
+        }
+    }
+
+    Gui* gui_;
+    mgui_display* display_;
+    void (*idle_)();
+    void (*notify_)();
+    mgui_frame_exchange<2> exchange_;
+    std::atomic<uint32_t> rendered_;
+    std::atomic<uint32_t> transmitted_;
+};
+
+#endif // MGUI_PIPELINE_H
@@ -0,0 +1,168 @@
+/**
+ * @file mgui_replay.h
+ * @author karakirimu
+ * @brief Saving, loading and replaying input traces on the host
+ * @version 0.1
+ * @date 2024-07-30
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_REPLAY_H
+#define MGUI_REPLAY_H
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "mgui.h"
+
+/**
+ * @brief FNV-1a checksum of a frame buffer.
+ */
+inline mgui_word32 mgui_frame_checksum(const uint8_t* buffer, int size) {
+    mgui_word32 hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash = (hash ^ buffer[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief
+ * Write the trace as text: a header line "mgui-input-trace 1 <channels> <entries>"
+ * and a line "<time> <repeat> <type> <value>..." per entry.
+ */
+inline bool mgui_save_trace(const mgui_input_trace& trace, FILE* file) {
+    if (fprintf(file, "mgui-input-trace 1 %d %d\n", trace.channels(), trace.count()) < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < trace.count(); i++) {
+        fprintf(file, "%lu %d", trace.time(i), trace.repeat(i));
+        const mgui_input_state* states = trace.states(i);
+        for (int c = 0; c < trace.channels(); c++) {
+            fprintf(file, " %d %d", (int)states[c].type, states[c].value_1);
+        }
+        if (fputc('\n', file) == EOF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read a trace written by mgui_save_trace() after the entries of the trace.
+ *
+ * @return false The format or the number of channels differs, or the trace is full
+ */
+inline bool mgui_load_trace(mgui_input_trace* trace, FILE* file) {
+    int version;
+    int channels;
+    int count;
+    if (fscanf(file, "mgui-input-trace %d %d %d", &version, &channels, &count) != 3
+        || version != 1 || channels != trace->channels()) {
+        return false;
+    }
+
+    std::vector<mgui_input_state> states(channels);
+    for (int i = 0; i < count; i++) {
+        unsigned long time;
+        int repeat;
+        if (fscanf(file, "%lu %d", &time, &repeat) != 2) {
+            return false;
+        }
+        for (int c = 0; c < channels; c++) {
+            int type;
+            if (fscanf(file, "%d %d", &type, &states[c].value_1) != 2) {
+                return false;
+            }
+            states[c].type = (mgui_input_type)type;
+        }
+        if (!trace->add(time, repeat, states.data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Frame times and the final frame of a replay.
+ */
+struct mgui_replay_result {
+    long frames;
+    double total_ms;
+    double min_us;
+    double mean_us;
+    double p50_us;
+    double p95_us;
+    double p99_us;
+    double max_us;
+    mgui_word32 checksum;
+};
+
+/**
+ * @brief
+ * Replay the trace through the screens as fast as possible.
+ * update_lcd() is called once per recorded update and timed.
+ *
+ * @param gui mgui or mgui_multi
+ * @param input Input of the gui (mgui::set_input or mgui_multi::input)
+ * @param trace Recorded trace
+ * @return Frame time statistics and the checksum of the last frame
+ */
+template <typename G>
+inline mgui_replay_result mgui_replay(G& gui, mgui_input& input, const mgui_input_trace& trace) {
+    mgui_replay_result result = {};
+    std::vector<double> times;
+    times.reserve(trace.updates());
+
+    input.set_player(&trace);
+    while (!input.finished()) {
+        const auto start = std::chrono::steady_clock::now();
+        gui.update_lcd();
+        const auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    input.set_player(nullptr);
+
+    result.checksum = mgui_frame_checksum(gui.lcd(), mgui_draw::buffer_size(gui.width(), gui.height(), gui.format()));
+    result.frames = (long)times.size();
+    if (times.empty()) {
+        return result;
+    }
+
+    double total = 0;
+    for (double t : times) {
+        total += t;
+    }
+    std::sort(times.begin(), times.end());
+
+    // nearest rank
+    auto percentile = [&times](int p) {
+        size_t rank = (times.size() * p + 99) / 100;
+        return times[rank > 0 ? rank - 1 : 0];
+    };
+
+    result.total_ms = total / 1000;
+    result.min_us = times.front();
+    result.mean_us = total / times.size();
+    result.p50_us = percentile(50);
+    result.p95_us = percentile(95);
+    result.p99_us = percentile(99);
+    result.max_us = times.back();
+    return result;
+}
+
+/**
+ * @brief Print the result of mgui_replay() in a line.
+ */
+inline void mgui_print_replay(const char* name, const mgui_replay_result& result, FILE* file = stdout) {
+    fprintf(file, "%s: %ld frames, mean %.2f us, p50 %.2f us, p95 %.2f us, p99 %.2f us, max %.2f us, checksum %08lx\n",
+            name, result.frames, result.mean_us, result.p50_us, result.p95_us, result.p99_us, result.max_us,
+            (unsigned long)result.checksum);
+}
+
+#endif // MGUI_REPLAY_H
@@ -0,0 +1,398 @@
+/**
+ * @file mgui_telemetry.h
+ * @author karakirimu
+ * @brief Frame time histograms and input latency telemetry
+ * @version 0.1
+ * @date 2024-07-31
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_TELEMETRY_H
+#define MGUI_TELEMETRY_H
+
+#include <stdio.h>
+
+#include <atomic>
+
+#include "mgui.h"
+
+/**
+ * @brief Number of input states compared to detect an input event
+ */
+#ifndef MGUI_TELEMETRY_CHANNELS
+#define MGUI_TELEMETRY_CHANNELS 8
+#endif
+
+/**
+ * @brief
+ * Streaming histogram of durations in microseconds with fixed log-spaced buckets.
+ * Each power of two is split into 4 buckets, so a value is known within 25%.
+ *
+ * @remarks
+ * Only one thread (or core) may record, so a counter is updated by a load and a store
+ * of an aligned 32-bit word. Other cores can read the counters at any time
+ * without a lock; Cortex-M0+ has no atomic read-modify-write, but 32-bit loads
+ * and stores are atomic. A reading may mix two updates, but never a torn counter.
+ */
+class mgui_histogram {
+public:
+    /**
+     * @brief Buckets 0-3 hold the values 0-3, then 4 buckets per power of two up to 2^32.
+     */
+    static const int BUCKETS = 124;
+
+    mgui_histogram() {
+        reset();
+    }
+
+    /**
+     * @brief Clear the counters (from the recording side).
+     */
+    inline void reset() {
+        for (int i = 0; i < BUCKETS; i++) {
+            buckets_[i].store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        min_.store(0xFFFFFFFFu, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add a value.
+     */
+    inline void record(mgui_word32 value) {
+        std::atomic<mgui_word32>& bucket = buckets_[bucket_index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value < min_.load(std::memory_order_relaxed)) {
+            min_.store(value, std::memory_order_relaxed);
+        }
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    inline mgui_word32 count() const { return count_.load(std::memory_order_acquire); }
+    inline mgui_word32 bucket(int index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+    inline mgui_word32 min() const {
+        return count() > 0 ? min_.load(std::memory_order_relaxed) : 0;
+    }
+
+    inline mgui_word32 max() const { return max_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief
+     * Nearest rank percentile. The upper end of the bucket is returned,
+     * so the result is never below the exact percentile.
+     *
+     * @param percent 0 to 100
+     * @return 0 If no value is recorded
+     */
+    inline mgui_word32 percentile(int percent) const {
+        mgui_word32 counts[BUCKETS];
+        unsigned long long total = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            counts[i] = bucket(i);
+            total += counts[i];
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        unsigned long long rank = (total * percent + 99) / 100;
+        if (rank == 0) {
+            rank = 1;
+        }
+
+        unsigned long long seen = 0;
+        int index = BUCKETS - 1;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                index = i;
+                break;
+            }
+        }
+
+        // the extremes are exact
+        const mgui_word32 value = bucket_upper(index);
+        const mgui_word32 low = min();
+        const mgui_word32 high = max();
+        return value > high ? high : (value < low ? low : value);
+    }
+
+    /**
+     * @brief Bucket of a value.
+     */
+    static inline int bucket_index(mgui_word32 value) {
+        if (value < 4) {
+            return (int)value;
+        }
+
+        int msb = 0;
+        for (int shift = 16; shift > 0; shift >>= 1) {
+            if ((value >> (msb + shift)) != 0) {
+                msb += shift;
+            }
+        }
+        return (msb - 1) * 4 + (int)((value >> (msb - 2)) & 3);
+    }
+
+    /**
+     * @brief Smallest value of a bucket.
+     */
+    static inline mgui_word32 bucket_lower(int index) {
+        if (index < 4) {
+            return (mgui_word32)index;
+        }
+        return (mgui_word32)(4 + (index & 3)) << (index / 4 - 1);
+    }
+
+    /**
+     * @brief Largest value of a bucket.
+     */
+    static inline mgui_word32 bucket_upper(int index) {
+        if (index == BUCKETS - 1) {
+            return 0xFFFFFFFFu;
+        }
+        return bucket_lower(index + 1) - 1;
+    }
+
+    /**
+     * @brief
+     * Write the histogram in a line:
+     * "<name> <count> <min> <max> <p50> <p95> <p99> <bucket>:<count>..."
+     * with the non-empty buckets only.
+     *
+     * @return Length of the line, or -1 if the buffer is too small
+     */
+    inline int write(const char* name, char* buffer, int size) const {
+        int length = snprintf(buffer, size, "%s %lu %lu %lu %lu %lu %lu", name,
+                              (unsigned long)count(), (unsigned long)min(), (unsigned long)max(),
+                              (unsigned long)percentile(50), (unsigned long)percentile(95),
+                              (unsigned long)percentile(99));
+        for (int i = 0; i < BUCKETS && length >= 0 && length < size; i++) {
+            const mgui_word32 n = bucket(i);
+            if (n != 0) {
+                length += snprintf(buffer + length, size - length, " %d:%lu", i, (unsigned long)n);
+            }
+        }
+        if (length < 0 || length + 1 >= size) {
+            return -1;
+        }
+        buffer[length++] = '\n';
+        buffer[length] = '\0';
+        return length;
+    }
+
+private:
+    std::atomic<mgui_word32> buckets_[BUCKETS];
+    std::atomic<mgui_word32> count_;
+    std::atomic<mgui_word32> min_;
+    std::atomic<mgui_word32> max_;
+};
+
+/**
+ * @brief
+ * Measures the update_lcd() time, the transfer time and the latency from an
+ * input event to the end of the transfer of the frame showing it.
+ * Set it with mgui::set_frame_listener and call begin_transfer() / end_transfer()
+ * around the transfer of each frame.
+ *
+ * @remarks
+ * An input event is a change of the input states from the previous update.
+ * Its time is the beginning of the update_lcd() that read it, and the latency
+ * is recorded by the end_transfer() of the next transfer.
+ * end_transfer() may be called from the completion callback of an mgui_transport.
+ * Under a frame budget, the frames with deferred work and the deferred works are counted.
+ */
+class mgui_telemetry : public mgui_frame_listener {
+public:
+    /**
+     * @brief Construct a new mgui telemetry object
+     *
+     * @param clock_us Clock in microseconds (time_us_32 on the Pico)
+     */
+    explicit mgui_telemetry(unsigned long (*clock_us)()) {
+        clock_ = clock_us;
+        reset();
+    }
+
+    void frame_begin() {
+        frame_start_ = (mgui_word32)clock_();
+    }
+
+    void frame_input(const mgui_input_state* states, int count) {
+        if (count > MGUI_TELEMETRY_CHANNELS) {
+            count = MGUI_TELEMETRY_CHANNELS;
+        }
+
+        // the first update is not an event
+        bool changed = false;
+        if (input_count_ == count) {
+            for (int i = 0; i < count; i++) {
+                if (states[i].type != last_[i].type || states[i].value_1 != last_[i].value_1) {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            last_[i] = states[i];
+        }
+        input_count_ = count;
+
+        // the oldest event waiting for a transfer is measured
+        if (changed && !input_pending_) {
+            input_pending_ = true;
+            input_time_ = frame_start_;
+        }
+    }
+
+    void frame_deferred(int count) {
+        if (count > 0) {
+            deferred_frames_.store(deferred_frames_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            deferrals_.store(deferrals_.load(std::memory_order_relaxed) + (mgui_word32)count, std::memory_order_relaxed);
+        }
+    }
+
+    void frame_end() {
+        frame_.record((mgui_word32)clock_() - frame_start_);
+    }
+
+    /**
+     * @brief Call before the frame is sent.
+     */
+    inline void begin_transfer() {
+        transfer_start_ = (mgui_word32)clock_();
+        sending_input_ = input_pending_;
+        sending_input_time_ = input_time_;
+        input_pending_ = false;
+    }
+
+    /**
+     * @brief Call when the frame is sent.
+     */
+    inline void end_transfer() {
+        const mgui_word32 now = (mgui_word32)clock_();
+        transfer_.record(now - transfer_start_);
+        if (sending_input_) {
+            latency_.record(now - sending_input_time_);
+            sending_input_ = false;
+        }
+    }
+
+    /**
+     * @brief Clear the histograms and the pending input event.
+     */
+    inline void reset() {
+        frame_.reset();
+        transfer_.reset();
+        latency_.reset();
+        frame_start_ = 0;
+        transfer_start_ = 0;
+        input_count_ = -1;
+        input_pending_ = false;
+        input_time_ = 0;
+        sending_input_ = false;
+        sending_input_time_ = 0;
+        deferred_frames_.store(0, std::memory_order_relaxed);
+        deferrals_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Duration of update_lcd() in microseconds
+     */
+    inline const mgui_histogram& frame() const { return frame_; }
+
+    /**
+     * @brief Duration from begin_transfer() to end_transfer() in microseconds
+     */
+    inline const mgui_histogram& transfer() const { return transfer_; }
+
+    /**
+     * @brief Duration from an input event to the end of its transfer in microseconds
+     */
+    inline const mgui_histogram& latency() const { return latency_; }
+
+    /**
+     * @brief Number of frames which deferred work under the frame budget
+     */
+    inline mgui_word32 deferred_frames() const { return deferred_frames_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of works deferred under the frame budget
+     */
+    inline mgui_word32 deferrals() const { return deferrals_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief
+     * Write the compact export: a header line "mgui-telemetry 1",
+     * a line per histogram (see mgui_histogram::write) and
+     * the line "deferred <frames> <works>".
+     *
+     * @return Length of the text, or -1 if the buffer is too small
+     */
+    inline int write(char* buffer, int size) const {
+        int length = snprintf(buffer, size, "mgui-telemetry 1\n");
+        if (length < 0 || length >= size) {
+            return -1;
+        }
+
+        const mgui_histogram* histograms[] = { &frame_, &transfer_, &latency_ };
+        const char* names[] = { "frame", "transfer", "latency" };
+        for (int i = 0; i < 3; i++) {
+            const int written = histograms[i]->write(names[i], buffer + length, size - length);
+            if (written < 0) {
+                return -1;
+            }
+            length += written;
+        }
+
+        const int written = snprintf(buffer + length, size - length, "deferred %lu %lu\n",
+                                     (unsigned long)deferred_frames(), (unsigned long)deferrals());
+        if (written < 0 || written >= size - length) {
+            return -1;
+        }
+        return length + written;
+    }
+
+    /**
+     * @brief Print the percentiles of the histograms.
+     */
+    inline void print(FILE* file = stdout) const {
+        const mgui_histogram* histograms[] = { &frame_, &transfer_, &latency_ };
+        const char* names[] = { "frame", "transfer", "latency" };
+        for (int i = 0; i < 3; i++) {
+            const mgui_histogram& h = *histograms[i];
+            fprintf(file, "%-8s: %lu samples, min %lu us, p50 %lu us, p95 %lu us, p99 %lu us, max %lu us\n",
+                    names[i], (unsigned long)h.count(), (unsigned long)h.min(),
+                    (unsigned long)h.percentile(50), (unsigned long)h.percentile(95),
+                    (unsigned long)h.percentile(99), (unsigned long)h.max());
+        }
+        fprintf(file, "%-8s: %lu frames, %lu works\n", "deferred",
+                (unsigned long)deferred_frames(), (unsigned long)deferrals());
+    }
+
+private:
+    unsigned long (*clock_)();
+
+    mgui_histogram frame_;
+    mgui_histogram transfer_;
+    mgui_histogram latency_;
+
+    mgui_word32 frame_start_;
+    mgui_word32 transfer_start_;
+    mgui_input_state last_[MGUI_TELEMETRY_CHANNELS];
+    int input_count_;
+    bool input_pending_;
+    mgui_word32 input_time_;
+    volatile bool sending_input_;
+    volatile mgui_word32 sending_input_time_;
+    std::atomic<mgui_word32> deferred_frames_;
+    std::atomic<mgui_word32> deferrals_;
+};
+
+#endif // MGUI_TELEMETRY_H
@@ -0,0 +1,665 @@
+/**
+ * @file mgui_touch.h
+ * @author karakirimu
+ * @brief Touch panel input: hit testing of the elements and gestures
+ * @version 0.1
+ * @date 2024-08-08
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ */
+#ifndef MGUI_TOUCH_H
+#define MGUI_TOUCH_H
+
+#include "mgui.h"
+
+/**
+ * @brief
+ * One reading of a touch panel. In mgui_input_state (type Touch) it is packed
+ * into value_1; the time is added by the reader (see mgui_touch_controller).
+ */
+struct mgui_touch_sample {
+    uint16_t x;
+    uint16_t y;
+    /**
+     * @brief Pressure from 0 (not touched) to 127
+     */
+    uint8_t pressure;
+    unsigned long time;
+
+    inline bool down() const { return pressure > 0; }
+
+    /**
+     * @brief Value of mgui_input_state for a touch (0 if the pressure is 0).
+     *
+     * @param x X position (0 to 4095)
+     * @param y Y position (0 to 4095)
+     * @param pressure Pressure (0 to 127, larger values are cut)
+     */
+    static inline int pack(int x, int y, int pressure) {
+        if (pressure <= 0) {
+            return 0;
+        }
+        pressure = pressure > 127 ? 127 : pressure;
+        return (x & 0xFFF) | ((y & 0xFFF) << 12) | (pressure << 24);
+    }
+
+    static inline mgui_touch_sample unpack(int value, unsigned long time) {
+        mgui_touch_sample sample;
+        sample.x = (uint16_t)(value & 0xFFF);
+        sample.y = (uint16_t)((value >> 12) & 0xFFF);
+        sample.pressure = (uint8_t)((value >> 24) & 0x7F);
+        sample.time = time;
+        return sample;
+    }
+};
+
+/**
+ * @brief Kinds of mgui_gesture
+ */
+enum class mgui_gesture_type {
+    None,
+    /**
+     * @brief The panel was touched
+     */
+    Down,
+    /**
+     * @brief Released near the position of Down before the long press time
+     */
+    Tap,
+    /**
+     * @brief Held near the position of Down for the long press time (the touch goes on)
+     */
+    LongPress,
+    /**
+     * @brief Moved further than the slop from Down; dx and dy are the move since the last sample
+     */
+    Drag,
+    /**
+     * @brief Released after a fast and long enough drag
+     */
+    Swipe,
+    /**
+     * @brief Released after a drag or a long press
+     */
+    Up
+};
+
+/**
+ * @brief Event of mgui_gesture_recognizer
+ */
+struct mgui_gesture {
+    mgui_gesture_type type;
+    /**
+     * @brief Position of the touch
+     */
+    int x;
+    int y;
+    /**
+     * @brief Move of Drag, or the whole move for Swipe and Up
+     */
+    int dx;
+    int dy;
+    /**
+     * @brief Main direction of Swipe
+     */
+    mgui_direction direction;
+    /**
+     * @brief Time since Down
+     */
+    unsigned long duration;
+};
+
+/**
+ * @brief
+ * Turns the touch samples into taps, long presses, drags and swipes.
+ * It keeps only the state of the current touch, so a sample takes constant time.
+ *
+ * @remarks
+ * A drag starts when the touch moves further than the slop from the position of Down
+ * in x or y, so the noise of a resistive panel does not cancel a tap.
+ * The release of a resistive panel is often read at a wrong position,
+ * so the position of the last touched sample is used for it.
+ */
+class mgui_gesture_recognizer {
+public:
+    /**
+     * @brief Construct a new mgui gesture recognizer object
+     *
+     * @param slop Move in pixels below which a touch is still a tap
+     * @param long_press Time of a long press (in the unit of the sample time)
+     * @param swipe_distance Minimum move of a swipe in pixels
+     * @param swipe_time Maximum time of a swipe
+     */
+    explicit mgui_gesture_recognizer(int slop = 6, unsigned long long_press = 500,
+                                     int swipe_distance = 24, unsigned long swipe_time = 250) {
+        slop_ = slop;
+        long_press_ = long_press;
+        swipe_distance_ = swipe_distance;
+        swipe_time_ = swipe_time;
+        reset();
+    }
+
+    /**
+     * @brief Forget the current touch.
+     */
+    inline void reset() {
+        touching_ = false;
+        dragging_ = false;
+        long_pressed_ = false;
+        start_ = mgui_touch_sample::unpack(0, 0);
+        last_ = start_;
+    }
+
+    /**
+     * @brief Read the next sample.
+     *
+     * @return The event of the sample (type None if there is none)
+     */
+    inline mgui_gesture update(const mgui_touch_sample& sample) {
+        if (!touching_) {
+            if (!sample.down()) {
+                return event(mgui_gesture_type::None, sample, 0, 0);
+            }
+            touching_ = true;
+            dragging_ = false;
+            long_pressed_ = false;
+            start_ = sample;
+            last_ = sample;
+            return event(mgui_gesture_type::Down, sample, 0, 0);
+        }
+
+        if (!sample.down()) {
+            touching_ = false;
+            const int dx = (int)last_.x - start_.x;
+            const int dy = (int)last_.y - start_.y;
+            mgui_gesture gesture = event(mgui_gesture_type::Up, last_, dx, dy);
+            gesture.duration = sample.time - start_.time;
+            if (!dragging_) {
+                gesture.type = long_pressed_ ? mgui_gesture_type::Up : mgui_gesture_type::Tap;
+            } else if (gesture.duration <= swipe_time_ && (abs(dx) >= swipe_distance_ || abs(dy) >= swipe_distance_)) {
+                gesture.type = mgui_gesture_type::Swipe;
+                if (abs(dx) > abs(dy)) {
+                    gesture.direction = dx > 0 ? mgui_direction::Right : mgui_direction::Left;
+                } else {
+                    gesture.direction = dy > 0 ? mgui_direction::Down : mgui_direction::Up;
+                }
+            }
+            return gesture;
+        }
+
+        const mgui_touch_sample last = last_;
+        last_ = sample;
+        if (!dragging_ && (abs((int)sample.x - start_.x) > slop_ || abs((int)sample.y - start_.y) > slop_)) {
+            dragging_ = true;
+            // the first drag moves from the position of Down
+            return event(mgui_gesture_type::Drag, sample, (int)sample.x - start_.x, (int)sample.y - start_.y);
+        }
+        if (dragging_) {
+            if (sample.x == last.x && sample.y == last.y) {
+                return event(mgui_gesture_type::None, sample, 0, 0);
+            }
+            return event(mgui_gesture_type::Drag, sample, (int)sample.x - last.x, (int)sample.y - last.y);
+        }
+        if (!long_pressed_ && sample.time - start_.time >= long_press_) {
+            long_pressed_ = true;
+            return event(mgui_gesture_type::LongPress, sample, 0, 0);
+        }
+        return event(mgui_gesture_type::None, sample, 0, 0);
+    }
+
+    /**
+     * @brief It returns true while the panel is touched.
+     */
+    inline bool touching() const { return touching_; }
+    inline bool dragging() const { return dragging_; }
+
+private:
+    inline mgui_gesture event(mgui_gesture_type type, const mgui_touch_sample& sample, int dx, int dy) const {
+        mgui_gesture gesture;
+        gesture.type = type;
+        gesture.x = sample.x;
+        gesture.y = sample.y;
+        gesture.dx = dx;
+        gesture.dy = dy;
+        gesture.direction = mgui_direction::Up;
+        gesture.duration = touching_ ? sample.time - start_.time : 0;
+        return gesture;
+    }
+
+    static inline int abs(int value) { return value < 0 ? -value : value; }
+
+    int slop_;
+    unsigned long long_press_;
+    int swipe_distance_;
+    unsigned long swipe_time_;
+    bool touching_;
+    bool dragging_;
+    bool long_pressed_;
+    mgui_touch_sample start_;
+    mgui_touch_sample last_;
+};
+
+/**
+ * @brief Element found by mgui_hit_grid::hit
+ */
+struct mgui_hit {
+    mgui_core_ui* item;
+    mgui_ui_group* group;
+    /**
+     * @brief Index of the element in the group
+     */
+    int index;
+};
+
+/**
+ * @brief
+ * Uniform grid of the bounds of the elements of UI groups (see mgui_core_ui::bounds),
+ * so the element at a position is found by looking at one cell.
+ *
+ * @remarks
+ * Each cell lists the elements which overlap it, in one array indexed by the cell
+ * (the starts of the cells, then the elements), built again on the first hit test
+ * after a group is added or removed or the layout changed. A hit test checks only
+ * the elements of its cell, so it does not depend on the number of elements
+ * as long as they do not all overlap the same cell.
+ */
+class mgui_hit_grid {
+public:
+    /**
+     * @brief Construct a new mgui hit grid object
+     *
+     * @param width Width of the screen
+     * @param height Height of the screen
+     * @param cell Size of a cell in pixels (about the size of the smallest element)
+     */
+    explicit mgui_hit_grid(uint16_t width, uint16_t height, uint16_t cell = 16) {
+        width_ = width;
+        height_ = height;
+        cell_ = cell > 0 ? cell : 1;
+        columns_ = width_ > 0 ? (width_ + cell_ - 1) / cell_ : 1;
+        rows_ = height_ > 0 ? (height_ + cell_ - 1) / cell_ : 1;
+        cell_start_ = mgui_alloc<int>(columns_ * rows_ + 1, mgui_memory_tag::Input);
+        cell_entries_ = nullptr;
+        entry_count_ = 0;
+        hits_ = nullptr;
+        bounds_ = nullptr;
+        hit_count_ = 0;
+        capacity_ = 0;
+        serial_ = 0;
+        valid_ = false;
+    }
+
+    ~mgui_hit_grid() {
+        free_table();
+        mgui_free(cell_start_, columns_ * rows_ + 1, mgui_memory_tag::Input);
+    }
+
+    /**
+     * @brief
+     * Add the elements of a group. The elements of groups added later are on top.
+     * The group must not be deleted while it is added.
+     */
+    inline void add(mgui_ui_group* group) {
+        groups_.add(group);
+        valid_ = false;
+    }
+
+    inline void remove(mgui_ui_group* group) {
+        groups_.remove(group);
+        valid_ = false;
+    }
+
+    inline void clear() {
+        groups_.clear();
+        valid_ = false;
+    }
+
+    /**
+     * @brief Build the grid again on the next hit test (after elements were added to a group).
+     */
+    inline void invalidate() { valid_ = false; }
+
+    /**
+     * @brief
+     * The element at a position, or nullptr. Where elements overlap,
+     * the last one added is found.
+     */
+    inline const mgui_hit* hit(int x, int y) {
+        if (!valid_ || serial_ != mgui_core_ui::layout_serial()) {
+            build();
+        }
+        if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+            return nullptr;
+        }
+
+        const int cell = (y / cell_) * columns_ + x / cell_;
+        for (int i = cell_start_[cell + 1] - 1; i >= cell_start_[cell]; i--) {
+            const int index = cell_entries_[i];
+            const mgui_bounds& bounds = bounds_[index];
+            if (x >= bounds.x && x < bounds.x + bounds.width && y >= bounds.y && y < bounds.y + bounds.height) {
+                return &hits_[index];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Number of elements with bounds in the grid (after a hit test).
+     */
+    inline int count() const { return hit_count_; }
+
+    /**
+     * @brief Number of the cell entries (each element is listed in each cell it overlaps).
+     */
+    inline int entries() const { return entry_count_; }
+
+    inline int columns() const { return columns_; }
+    inline int rows() const { return rows_; }
+
+private:
+    inline void build() {
+        MGUI_TRACE_SCOPE("layout", "hit grid");
+        free_table();
+        serial_ = mgui_core_ui::layout_serial();
+        valid_ = true;
+
+        int total = 0;
+        for (const mgui_list_node<mgui_ui_group*>* node = groups_.first(); node != nullptr; node = node->next) {
+            total += node->obj->count();
+        }
+        if (total > 0) {
+            hits_ = mgui_alloc<mgui_hit>(total, mgui_memory_tag::Input);
+            bounds_ = mgui_alloc<mgui_bounds>(total, mgui_memory_tag::Input);
+            capacity_ = total;
+        }
+
+        for (const mgui_list_node<mgui_ui_group*>* node = groups_.first(); node != nullptr; node = node->next) {
+            int index = 0;
+            for (const mgui_list_node<mgui_core_ui*>* item = node->obj->elements()->first(); item != nullptr; item = item->next) {
+                const mgui_bounds bounds = clip(item->obj->bounds());
+                if (!bounds.empty()) {
+                    hits_[hit_count_].item = item->obj;
+                    hits_[hit_count_].group = node->obj;
+                    hits_[hit_count_].index = index;
+                    bounds_[hit_count_] = bounds;
+                    hit_count_++;
+                }
+                index++;
+            }
+        }
+
+        // count the elements of each cell and sum them up to the end of each cell
+        const int cells = columns_ * rows_;
+        for (int cell = 0; cell <= cells; cell++) {
+            cell_start_[cell] = 0;
+        }
+        for (int i = 0; i < hit_count_; i++) {
+            for_cells(i, nullptr);
+        }
+        for (int cell = 1; cell < cells; cell++) {
+            cell_start_[cell] += cell_start_[cell - 1];
+        }
+        entry_count_ = cell_start_[cells - 1];
+        cell_start_[cells] = entry_count_;
+        if (entry_count_ > 0) {
+            cell_entries_ = mgui_alloc<int>(entry_count_, mgui_memory_tag::Input);
+        }
+
+        // placed from the end of each cell, which leaves its start;
+        // in reverse, so each cell lists the elements in the order they were added
+        for (int i = hit_count_ - 1; i >= 0; i--) {
+            for_cells(i, cell_entries_);
+        }
+    }
+
+    /**
+     * @brief
+     * Count the element in the cells it overlaps (entries == nullptr),
+     * or place it before the elements already placed in them.
+     */
+    inline void for_cells(int index, int* entries) {
+        const mgui_bounds& bounds = bounds_[index];
+        const int left = bounds.x / cell_, right = (bounds.x + bounds.width - 1) / cell_;
+        const int top = bounds.y / cell_, bottom = (bounds.y + bounds.height - 1) / cell_;
+        for (int row = top; row <= bottom; row++) {
+            for (int column = left; column <= right; column++) {
+                const int cell = row * columns_ + column;
+                if (entries == nullptr) {
+                    cell_start_[cell]++;
+                } else {
+                    entries[--cell_start_[cell]] = index;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief The part of the bounds on the screen.
+     */
+    inline mgui_bounds clip(mgui_bounds bounds) const {
+        if (bounds.x < 0) {
+            bounds.width += bounds.x;
+            bounds.x = 0;
+        }
+        if (bounds.y < 0) {
+            bounds.height += bounds.y;
+            bounds.y = 0;
+        }
+        if (bounds.x + bounds.width > width_) {
+            bounds.width = width_ - bounds.x;
+        }
+        if (bounds.y + bounds.height > height_) {
+            bounds.height = height_ - bounds.y;
+        }
+        return bounds;
+    }
+
+    inline void free_table() {
+        mgui_free(hits_, capacity_, mgui_memory_tag::Input);
+        mgui_free(bounds_, capacity_, mgui_memory_tag::Input);
+        mgui_free(cell_entries_, entry_count_, mgui_memory_tag::Input);
+        hits_ = nullptr;
+        bounds_ = nullptr;
+        cell_entries_ = nullptr;
+        hit_count_ = 0;
+        capacity_ = 0;
+        entry_count_ = 0;
+    }
+
+    mgui_list<mgui_ui_group*, mgui_memory_tag::Input> groups_;
+    int width_;
+    int height_;
+    int cell_;
+    int columns_;
+    int rows_;
+    int* cell_start_;
+    int* cell_entries_;
+    int entry_count_;
+    mgui_hit* hits_;
+    mgui_bounds* bounds_;
+    int hit_count_;
+    int capacity_;
+    unsigned long serial_;
+    bool valid_;
+};
+
+/**
+ * @brief
+ * Object reading a touch channel of the input: it finds the touched element
+ * with an mgui_hit_grid and sets the select and press states of its group,
+ * like the buttons and the encoder do through the handlers.
+ *
+ * @remarks
+ * - Down selects the touched element and presses it.
+ * - Tap, Swipe and Up release it. LongPress keeps it pressed.
+ * - Drag releases it without a click (the touch became a scroll), and scrolls
+ *   the menu set with set_scroll_target: one item per step of the move.
+ * Add it to the screen before the groups, so they draw the new states in the same frame.
+ * The elements must stay in their groups while they are touched.
+ */
+class mgui_touch_controller : mgui_object {
+public:
+    typedef void (*gesture_handler)(mgui_touch_controller* sender, const mgui_gesture& gesture, mgui_string* current_group);
+
+    /**
+     * @brief Construct a new mgui touch controller object
+     *
+     * @param grid Grid of the touchable elements (nullptr to only recognize the gestures)
+     * @param channel Index of the input state of the touch panel
+     * @param clock
+     * Function returning the current time (for example to_ms_since_boot on RP2040),
+     * or nullptr to count the updates instead (the times of the recognizer are then in frames)
+     * @param recognizer Gesture settings
+     */
+    explicit mgui_touch_controller(mgui_hit_grid* grid, int channel = 0, unsigned long (*clock)() = nullptr,
+                                   const mgui_gesture_recognizer& recognizer = mgui_gesture_recognizer())
+     : recognizer_(recognizer) {
+        grid_ = grid;
+        channel_ = channel;
+        clock_ = clock;
+        updates_ = 0;
+        handler_ = nullptr;
+        scroll_target_ = nullptr;
+        scroll_step_ = 16;
+        scroll_ = 0;
+        pressed_ = false;
+        target_.item = nullptr;
+        target_.group = nullptr;
+        target_.index = -1;
+        last_ = recognizer_.update(mgui_touch_sample::unpack(0, 0));
+    }
+
+    mgui_object_type type() const { return mgui_object_type::TouchController; }
+
+    void update(mgui_draw*, mgui_input_state* input, mgui_string* current_group) {
+        if (input == nullptr || input[channel_].type != mgui_input_type::Touch) {
+            return;
+        }
+        const unsigned long time = clock_ != nullptr ? clock_() : updates_;
+        updates_++;
+        feed(mgui_touch_sample::unpack(input[channel_].value_1, time), current_group);
+    }
+
+    /**
+     * @brief Read a sample (update() does it with the input state of the channel).
+     *
+     * @return The recognized event
+     */
+    inline mgui_gesture feed(const mgui_touch_sample& sample, mgui_string* current_group = nullptr) {
+        last_ = recognizer_.update(sample);
+        switch (last_.type) {
+        case mgui_gesture_type::Down:
+            touch(last_.x, last_.y);
+            break;
+        case mgui_gesture_type::Drag:
+            release();
+            scroll(last_.dy);
+            break;
+        case mgui_gesture_type::Tap:
+        case mgui_gesture_type::Swipe:
+        case mgui_gesture_type::Up:
+            release();
+            break;
+        default:
+            break;
+        }
+
+        if (handler_ != nullptr && last_.type != mgui_gesture_type::None) {
+            handler_(this, last_, current_group);
+        }
+        return last_;
+    }
+
+    /**
+     * @brief Set the function called with each event (after the states are set).
+     */
+    inline void set_gesture_handler(gesture_handler handler) { handler_ = handler; }
+
+    /**
+     * @brief
+     * Scroll a menu by dragging: moving the touch up by step pixels selects the next item,
+     * moving it down the previous one.
+     *
+     * @param menu Menu to scroll (nullptr for none)
+     * @param step Move in pixels per item (about the height of an item)
+     */
+    inline void set_scroll_target(mgui_menu* menu, int step = 16) {
+        scroll_target_ = menu;
+        scroll_step_ = step > 0 ? step : 1;
+        scroll_ = 0;
+    }
+
+    /**
+     * @brief The element of the current (or last) touch, or nullptr if it touched none.
+     */
+    inline const mgui_hit* target() const { return target_.item != nullptr ? &target_ : nullptr; }
+
+    /**
+     * @brief It returns true while the touched element is pressed.
+     */
+    inline bool pressed() const { return pressed_; }
+
+    /**
+     * @brief The event of the last sample.
+     */
+    inline const mgui_gesture& last() const { return last_; }
+
+    inline const mgui_gesture_recognizer& recognizer() const { return recognizer_; }
+    inline int channel() const { return channel_; }
+
+private:
+    inline void touch(int x, int y) {
+        pressed_ = false;
+        scroll_ = 0;
+        target_.item = nullptr;
+        target_.group = nullptr;
+        target_.index = -1;
+
+        const mgui_hit* hit = grid_ != nullptr ? grid_->hit(x, y) : nullptr;
+        if (hit == nullptr) {
+            return;
+        }
+        target_ = *hit;
+        target_.group->select(target_.index);
+        target_.item->set_on_press(true);
+        pressed_ = true;
+    }
+
+    inline void release() {
+        if (pressed_) {
+            target_.item->set_on_press(false);
+            pressed_ = false;
+        }
+    }
+
+    inline void scroll(int dy) {
+        if (scroll_target_ == nullptr) {
+            return;
+        }
+        scroll_ += dy;
+        while (scroll_ <= -scroll_step_) {
+            scroll_target_->set_on_select_next(true);
+            scroll_ += scroll_step_;
+        }
+        while (scroll_ >= scroll_step_) {
+            scroll_target_->set_on_select_prev(true);
+            scroll_ -= scroll_step_;
+        }
+    }
+
+    mgui_gesture_recognizer recognizer_;
+    mgui_hit_grid* grid_;
+    int channel_;
+    unsigned long (*clock_)();
+    unsigned long updates_;
+    gesture_handler handler_;
+    mgui_menu* scroll_target_;
+    int scroll_step_;
+    int scroll_;
+    bool pressed_;
+    mgui_hit target_;
+    mgui_gesture last_;
+};
+
+#endif // MGUI_TOUCH_H
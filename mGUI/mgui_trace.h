@@ -0,0 +1,307 @@
+/**
+ * @file mgui_trace.h
+ * @author karakirimu
+ * @brief Trace events in Chrome trace JSON for host profiling
+ * @version 0.1
+ * @date 2024-08-01
+ *
+ * @copyright Copyright (c) 2024 karakirimu
+ *
+ * @remarks
+ * Define MGUI_TRACE for all files including mgui.h (-DMGUI_TRACE) to enable
+ * the trace points of mgui. Open the file written by mgui_tracer::flush()
+ * in chrome://tracing or https://ui.perfetto.dev.
+ */
+#ifndef MGUI_TRACE_H
+#define MGUI_TRACE_H
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Default number of events kept per thread until the next flush
+ */
+#ifndef MGUI_TRACE_CAPACITY
+#define MGUI_TRACE_CAPACITY 65536
+#endif
+
+/**
+ * @brief A finished scope.
+ */
+struct mgui_trace_event {
+    const char* category;
+    const char* name;
+    long long start_ns;
+    long long duration_ns;
+};
+
+/**
+ * @brief A trace event with the thread that recorded it.
+ */
+struct mgui_trace_record {
+    int thread;
+    mgui_trace_event event;
+};
+
+/**
+ * @brief
+ * Ring buffer of the events of one thread.
+ * The thread pushes without a lock and mgui_tracer drains it from any thread.
+ * When it is full, new events are dropped and counted.
+ */
+class mgui_trace_buffer {
+public:
+    mgui_trace_buffer(int thread, size_t capacity) : events_(capacity + 1) {
+        thread_ = thread;
+        head_ = 0;
+        tail_ = 0;
+        dropped_ = 0;
+    }
+
+    inline void push(const mgui_trace_event& event) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t next = (head + 1) % events_.size();
+        if (next == tail_.load(std::memory_order_acquire)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events_[head] = event;
+        head_.store(next, std::memory_order_release);
+    }
+
+    /**
+     * @brief Move the events to records (one consumer at a time).
+     */
+    inline void drain(std::vector<mgui_trace_record>* records) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        while (tail != head) {
+            mgui_trace_record record;
+            record.thread = thread_;
+            record.event = events_[tail];
+            records->push_back(record);
+            tail = (tail + 1) % events_.size();
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    inline int thread() const { return thread_; }
+    inline long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    inline void clear_dropped() { dropped_.store(0, std::memory_order_relaxed); }
+
+private:
+    std::vector<mgui_trace_event> events_;
+    int thread_;
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+    std::atomic<long> dropped_;
+};
+
+/**
+ * @brief
+ * Collects the trace events of all threads. Each thread gets its own
+ * mgui_trace_buffer at its first event.
+ */
+class mgui_tracer {
+public:
+    /**
+     * @brief The tracer of the process.
+     */
+    static inline mgui_tracer& instance() {
+        static mgui_tracer tracer;
+        return tracer;
+    }
+
+    /**
+     * @brief Nanoseconds since the tracer was created.
+     */
+    inline long long now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch_).count();
+    }
+
+    /**
+     * @brief Record a finished scope on the calling thread.
+     */
+    inline void record(const char* category, const char* name, long long start_ns, long long end_ns) {
+        mgui_trace_event event;
+        event.category = category;
+        event.name = name;
+        event.start_ns = start_ns;
+        event.duration_ns = end_ns - start_ns;
+        thread_buffer()->push(event);
+    }
+
+    /**
+     * @brief Events are recorded only while enabled (default true).
+     */
+    inline void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    inline bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of events of the buffers created after this call.
+     */
+    inline void set_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        capacity_ = capacity;
+    }
+
+    /**
+     * @brief Name of the calling thread in the trace viewer.
+     */
+    inline void set_thread_name(const char* name) {
+        mgui_trace_buffer* buffer = thread_buffer();
+        std::lock_guard<std::mutex> guard(mutex_);
+        names_[buffer->thread() - 1] = name;
+    }
+
+    /**
+     * @brief Take the recorded events of all threads.
+     */
+    inline std::vector<mgui_trace_record> drain() {
+        std::vector<mgui_trace_record> records;
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto& buffer : buffers_) {
+            buffer->drain(&records);
+        }
+        return records;
+    }
+
+    /**
+     * @brief Number of events dropped because a buffer was full.
+     */
+    inline long dropped() {
+        long total = 0;
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto& buffer : buffers_) {
+            total += buffer->dropped();
+        }
+        return total;
+    }
+
+    /**
+     * @brief Discard the recorded events and the dropped count.
+     */
+    inline void clear() {
+        std::vector<mgui_trace_record> records = drain();
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto& buffer : buffers_) {
+            buffer->clear_dropped();
+        }
+    }
+
+    /**
+     * @brief Write the recorded events as Chrome trace JSON and remove them.
+     */
+    inline bool flush(FILE* file) {
+        const std::vector<mgui_trace_record> records = drain();
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            names = names_;
+        }
+
+        fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        for (size_t i = 0; i < names.size(); i++) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", (int)i + 1, escape(names[i]).c_str());
+            first = false;
+        }
+        for (const mgui_trace_record& record : records) {
+            const mgui_trace_event& e = record.event;
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                    first ? "" : ",\n", escape(e.name).c_str(), escape(e.category).c_str(),
+                    e.start_ns / 1000.0, e.duration_ns / 1000.0, record.thread);
+            first = false;
+        }
+        return fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file) >= 0;
+    }
+
+    inline bool flush(const char* path) {
+        FILE* file = fopen(path, "w");
+        if (file == nullptr) {
+            return false;
+        }
+        const bool result = flush(file);
+        return fclose(file) == 0 && result;
+    }
+
+private:
+    mgui_tracer() : epoch_(std::chrono::steady_clock::now()) {
+        enabled_ = true;
+        capacity_ = MGUI_TRACE_CAPACITY;
+    }
+
+    inline mgui_trace_buffer* thread_buffer() {
+        static thread_local mgui_trace_buffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            // buffers stay until the end of the process, so the events of finished threads are kept
+            std::lock_guard<std::mutex> guard(mutex_);
+            const int thread = (int)buffers_.size() + 1;
+            buffers_.emplace_back(new mgui_trace_buffer(thread, capacity_));
+            names_.push_back(thread == 1 ? "main" : "thread " + std::to_string(thread));
+            buffer = buffers_.back().get();
+        }
+        return buffer;
+    }
+
+    static inline std::string escape(const std::string& text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    const std::chrono::steady_clock::time_point epoch_;
+    std::atomic<bool> enabled_;
+    size_t capacity_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<mgui_trace_buffer>> buffers_;
+    std::vector<std::string> names_;
+};
+
+/**
+ * @brief Records the lifetime of the scope as a trace event.
+ */
+class mgui_trace_scope {
+public:
+    mgui_trace_scope(const char* category, const char* name) {
+        category_ = category;
+        name_ = name;
+        start_ns_ = mgui_tracer::instance().enabled() ? mgui_tracer::instance().now_ns() : -1;
+    }
+
+    ~mgui_trace_scope() {
+        if (start_ns_ >= 0) {
+            mgui_tracer& tracer = mgui_tracer::instance();
+            tracer.record(category_, name_, start_ns_, tracer.now_ns());
+        }
+    }
+
+private:
+    const char* category_;
+    const char* name_;
+    long long start_ns_;
+};
+
+#define MGUI_TRACE_CONCAT_(a, b) a##b
+#define MGUI_TRACE_CONCAT(a, b) MGUI_TRACE_CONCAT_(a, b)
+
+/**
+ * @brief Trace the rest of the enclosing block.
+ */
+#define MGUI_TRACE_SCOPE(category, name) \
+    mgui_trace_scope MGUI_TRACE_CONCAT(mgui_trace_scope_, __LINE__)(category, name)
+
+#endif // MGUI_TRACE_H
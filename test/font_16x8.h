@@ -2,9 +2,12 @@
 // font_16x8.h
 // Orientation: Vertical
 //
+#ifndef FONT_16X8_H
+#define FONT_16X8_H
+
 #include "../mGUI/mgui.h"
 
-static uint8_t font[] = {
+static const uint8_t font[] = {
     0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, //   8x16
     0x00,0x00,0x00,0x3F,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x60,0x00,0x00,0x00,0x00, // ! 8x16
     0x00,0x00,0x3C,0x00,0x3C,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00, // " 8x16
@@ -118,4 +121,6 @@ public:
         }
         return -1;
     }
-};
\ No newline at end of file
+};
+
+#endif // FONT_16X8_H
@@ -0,0 +1,51 @@
+// /////
+// font_16x8_aa.h
+// Orientation: Horizontal, 4 bits of coverage per pixel
+// Generated from font_16x8.h: the set pixels have full coverage and
+// the pixels next to them have a quarter coverage.
+//
+#ifndef FONT_16X8_AA_H
+#define FONT_16X8_AA_H
+
+#include "font_16x8.h"
+
+class font_16x8_aa : public mgui_font_aa {
+public:
+    font_16x8_aa(int cache_slots = 32): mgui_font_aa(8, 16, coverage_, 4, cache_slots) {
+        const int glyphs = sizeof(font) / 16;
+        for (int g = 0; g < glyphs; g++) {
+            for (int y = 0; y < 16; y++) {
+                for (int x = 0; x < 8; x++) {
+                    int level = 0;
+                    if (on(g, x, y)) {
+                        level = 15;
+                    } else if (on(g, x - 1, y) || on(g, x + 1, y) || on(g, x, y - 1) || on(g, x, y + 1)) {
+                        level = 4;
+                    }
+                    uint8_t& data = coverage_[g * 64 + y * 4 + x / 2];
+                    data = (x & 1) ? (uint8_t)((data & 0xF0) | level) : (uint8_t)(level << 4);
+                }
+            }
+        }
+    }
+    virtual ~font_16x8_aa() {}
+
+    int search(const char *c){
+        if (*c < ' ' || *c > '~') {
+            return -1;
+        }
+        return (*c - ' ') * 64;
+    }
+
+private:
+    static bool on(int g, int x, int y) {
+        if (x < 0 || x >= 8 || y < 0 || y >= 16) {
+            return false;
+        }
+        return (font[g * 16 + (y >> 3) * 8 + x] >> (7 - (y & 7))) & 1;
+    }
+
+    uint8_t coverage_[sizeof(font) / 16 * 64];
+};
+
+#endif // FONT_16X8_AA_H
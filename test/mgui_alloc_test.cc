@@ -0,0 +1,141 @@
+// Built as a separate program because it replaces the global operator new (see CMakeLists.txt).
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "mgui_example_screens.h"
+
+static long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+namespace Alloc {
+
+    TEST(ZeroAllocation, ExampleSession) {
+        Example::screens screens;
+
+        // the first session allocates the nodes of the menu history
+        EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+        EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+
+        const long before = allocations;
+        int visited = 0;
+        for (int i = 0; i < 10; i++) {
+            visited += screens.session();
+        }
+        const long after = allocations;
+
+        EXPECT_EQ(10 * Example::screens::SESSION_SCREENS, visited);
+        EXPECT_EQ(0, after - before);
+    }
+
+    TEST(ZeroAllocation, Viewports) {
+        Example::screens screens;
+        mgui_text status(&screens.font, "status");
+        screens.gui.add("status", (mgui_object*)&status);
+        screens.gui.select("main");
+        ASSERT_EQ(0, screens.gui.add_viewport("status", 0, 0, 128, 16));
+        ASSERT_EQ(1, screens.gui.add_viewport(nullptr, 0, 16, 128, 48));
+
+        EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+        EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+
+        // the selection is kept for each frame of the viewports
+        const long before = allocations;
+        int visited = 0;
+        for (int i = 0; i < 10; i++) {
+            visited += screens.session();
+        }
+        const long after = allocations;
+
+        EXPECT_EQ(10 * Example::screens::SESSION_SCREENS, visited);
+        EXPECT_EQ(0, after - before);
+    }
+
+    TEST(ZeroAllocation, OpenDialog) {
+        Example::screens screens;
+        mgui_text saved(&screens.font, "Saved");
+        screens.gui.add("dialog", (mgui_object*)&saved);
+        screens.gui.select("main");
+        EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+        ASSERT_TRUE(screens.gui.open_dialog("dialog", 32, 16, 64, 24));
+        screens.press();
+
+        // the group of the dialog is kept for each frame
+        const long before = allocations;
+        for (int i = 0; i < 10; i++) {
+            screens.press();
+            screens.turn(1);
+        }
+        const long after = allocations;
+
+        EXPECT_EQ(0, after - before);
+        EXPECT_NE(nullptr, screens.gui.dialog());
+        EXPECT_STREQ("main", screens.gui.selected().c_str());
+    }
+
+    TEST(ZeroAllocation, Strings) {
+        font_16x8 font;
+        mgui_string group("image");
+        mgui_text text(&font, "12345");
+        mgui_multi gui(128, 64);
+        gui.add("main", (mgui_object*)&text);
+        gui.add("menu", (mgui_object*)&text);
+
+        const long before = allocations;
+        group = "main";
+        group = "menu";
+        group = "text";
+        text.set_text("123");
+        text.set_text("abcde");
+        gui.select("menu");
+        gui.select("main");
+        gui.update_lcd();
+        const long after = allocations;
+
+        EXPECT_EQ(0, after - before);
+        EXPECT_STREQ("text", group.c_str());
+        EXPECT_STREQ("abcde", text.text());
+        EXPECT_EQ(5 * font.width(), text.text_width());
+        EXPECT_STREQ("main", gui.selected().c_str());
+
+        // longer strings need memory (the characters of the string, and the characters and glyphs of the text)
+        group = "a longer group name";
+        text.set_text("123456");
+        EXPECT_EQ(3, allocations - after);
+    }
+
+    TEST(ZeroAllocation, StackReserve) {
+        mgui_stack<int> stack;
+        stack.reserve(3);
+
+        const long before = allocations;
+        for (int i = 0; i < 10; i++) {
+            stack.push(1);
+            stack.push(2);
+            stack.push(3);
+            EXPECT_EQ(3, stack.pop());
+            EXPECT_EQ(2, stack.pop());
+            EXPECT_EQ(1, stack.pop());
+        }
+        EXPECT_EQ(0, allocations - before);
+        EXPECT_TRUE(stack.is_empty());
+    }
+}
@@ -0,0 +1,691 @@
+/**
+ * @file mgui_bench.cc
+ * @brief Micro benchmarks of mGUI drawing kernels on the host.
+ *
+ * Each benchmark prints the average time per operation.
+ * Build in Release mode for meaningful numbers.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../mGUI/mgui.h"
+#include "../mGUI/mgui_color.h"
+#include "../mGUI/mgui_host_batch.h"
+#include "../mGUI/mgui_host_bus.h"
+#include "../mGUI/mgui_host_pipeline.h"
+#include "../mGUI/mgui_replay.h"
+#include "../mGUI/mgui_telemetry.h"
+#include "../mGUI/mgui_touch.h"
+#include "font_16x8_aa.h"
+#include "mgui_example_screens.h"
+
+constexpr int WIDTH = 128;
+constexpr int HEIGHT = 64;
+
+constexpr int BUFFER_SIZE = (HEIGHT >> 3) * WIDTH;
+
+// Keeps the optimizer from removing the measured work.
+static volatile unsigned long long sink;
+
+/**
+ * @brief Run the function repeatedly and return the average time in nanoseconds.
+ */
+template <typename F>
+static double measure_ns(F&& function, int iterations) {
+    // warm up
+    for (int i = 0; i < iterations / 10 + 1; i++) {
+        function();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        function();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static void report(const char* name, double ns) {
+    printf("%-40s %12.1f ns\n", name, ns);
+}
+
+static void fill_random(unsigned char* buffer, int size) {
+    unsigned int seed = 12345;
+    for (int i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        buffer[i] = (unsigned char)(seed >> 16);
+    }
+}
+
+static void bench_transpose() {
+    printf("== 8x8 bit-matrix transpose (1024 blocks)\n");
+
+    static unsigned char blocks[1024 * 8];
+    fill_random(blocks, sizeof(blocks));
+
+    report("swar64", measure_ns([&] {
+        mgui_word64 acc = 0;
+        for (int i = 0; i < 1024; i++) {
+            mgui_word64 x;
+            memcpy(&x, blocks + i * 8, 8);
+            acc ^= mgui_bit_matrix::transpose8x8_64(x);
+        }
+        sink = acc;
+    }, 2000));
+
+    report("swar32", measure_ns([&] {
+        mgui_word32 acc = 0;
+        for (int i = 0; i < 1024; i++) {
+            mgui_word32 lo, hi;
+            memcpy(&lo, blocks + i * 8, 4);
+            memcpy(&hi, blocks + i * 8 + 4, 4);
+            mgui_bit_matrix::transpose8x8_32(lo, hi);
+            acc ^= lo ^ hi;
+        }
+        sink = acc;
+    }, 2000));
+
+#ifdef MGUI_USE_SSE2
+    report("sse2", measure_ns([&] {
+        mgui_word64 acc = 0;
+        for (int i = 0; i < 1024; i += 2) {
+            mgui_word64 first, second;
+            mgui_bit_matrix::transpose8x8x2_sse2(blocks + i * 8, first, second);
+            acc ^= first ^ second;
+        }
+        sink = acc;
+    }, 2000));
+#endif
+}
+
+static void bench_rotation() {
+    printf("== %dx%d frame orientation post-pass\n", WIDTH, HEIGHT);
+
+    static unsigned char src[BUFFER_SIZE];
+    static unsigned char dst[BUFFER_SIZE];
+    fill_random(src, BUFFER_SIZE);
+
+    const struct {
+        const char* name;
+        mgui_rotation rotation;
+        bool mirror_x;
+        bool mirror_y;
+    } cases[] = {
+        { "rotate0 + mirror x", mgui_rotation::Rotate0, true, false },
+        { "rotate0 + mirror y", mgui_rotation::Rotate0, false, true },
+        { "rotate90", mgui_rotation::Rotate90, false, false },
+        { "rotate180", mgui_rotation::Rotate180, false, false },
+        { "rotate270", mgui_rotation::Rotate270, false, false },
+        { "rotate90 + mirror x", mgui_rotation::Rotate90, true, false },
+    };
+
+    for (const auto& c : cases) {
+        mgui_orientation orientation;
+        orientation.set(c.rotation, c.mirror_x, c.mirror_y);
+        // The drawn buffer of a 90/270 degree rotation is HEIGHT wide and WIDTH high.
+        int width = orientation.transpose() ? HEIGHT : WIDTH;
+        int height = orientation.transpose() ? WIDTH : HEIGHT;
+
+        report(c.name, measure_ns([&] {
+            orientation.apply(src, width, height, dst);
+            sink = dst[0];
+        }, 20000));
+    }
+
+    report("memcpy (reference)", measure_ns([&] {
+        memcpy(dst, src, BUFFER_SIZE);
+        sink = dst[0];
+    }, 20000));
+}
+
+static const int KERNEL_SIZES[] = { 512, 1024, 4096, 16384, 49152 };
+
+template <typename K>
+static void bench_kernel(const char* variant) {
+    static unsigned char a[49152];
+    static unsigned char b[49152];
+    fill_random(a, sizeof(a));
+    memcpy(b, a, sizeof(b));
+
+    char name[64];
+    for (int size : KERNEL_SIZES) {
+        // Keep the total amount of work roughly constant.
+        const int iterations = 20000000 / size + 10;
+
+        snprintf(name, sizeof(name), "%s fill %d", variant, size);
+        report(name, measure_ns([&] { K::fill(a, 0, size); sink = a[0]; }, iterations));
+
+        snprintf(name, sizeof(name), "%s copy %d", variant, size);
+        report(name, measure_ns([&] { K::copy(a, b, size); sink = a[0]; }, iterations));
+
+        snprintf(name, sizeof(name), "%s equal %d", variant, size);
+        report(name, measure_ns([&] { sink = K::equal(a, b, size); }, iterations));
+
+        snprintf(name, sizeof(name), "%s invert %d", variant, size);
+        report(name, measure_ns([&] { K::invert(a, size); sink = a[0]; }, iterations));
+
+        snprintf(name, sizeof(name), "%s or %d", variant, size);
+        report(name, measure_ns([&] { K::or_into(a, b, size); sink = a[0]; }, iterations));
+
+        snprintf(name, sizeof(name), "%s span %d", variant, size);
+        report(name, measure_ns([&] { K::or_mask(a, 0x18, size); sink = a[0]; }, iterations));
+    }
+}
+
+static void bench_kernels() {
+    printf("== buffer kernels\n");
+
+    bench_kernel<mgui_buffer_kernel<mgui_simd_swar32>>("swar32");
+    bench_kernel<mgui_buffer_kernel<mgui_simd_swar64>>("swar64");
+#ifdef MGUI_USE_SSE2
+    bench_kernel<mgui_buffer_kernel<mgui_simd_sse2>>("sse2");
+#endif
+#ifdef MGUI_USE_AVX2
+    bench_kernel<mgui_buffer_kernel<mgui_simd_avx2>>("avx2");
+#endif
+#ifdef MGUI_USE_NEON
+    bench_kernel<mgui_buffer_kernel<mgui_simd_neon>>("neon");
+#endif
+
+    static unsigned char a[49152];
+    static unsigned char b[49152];
+    fill_random(b, sizeof(b));
+
+    char name[64];
+    for (int size : KERNEL_SIZES) {
+        const int iterations = 20000000 / size + 10;
+        memcpy(a, b, sizeof(a));
+
+        snprintf(name, sizeof(name), "memcmp %d", size);
+        report(name, measure_ns([&] { sink = memcmp(a, b, size); }, iterations));
+
+        snprintf(name, sizeof(name), "memcpy %d", size);
+        report(name, measure_ns([&] { memcpy(a, b, size); sink = a[0]; }, iterations));
+
+        snprintf(name, sizeof(name), "memset %d", size);
+        report(name, measure_ns([&] { memset(a, 0, size); sink = a[0]; }, iterations));
+    }
+}
+
+static void bench_draw() {
+    printf("== drawing primitives on %dx%d\n", WIDTH, HEIGHT);
+
+    static unsigned char buffer[BUFFER_SIZE];
+    mgui_draw draw(WIDTH, HEIGHT, buffer);
+
+    report("clear", measure_ns([&] { draw.clear(); sink = buffer[0]; }, 100000));
+    report("filled rectangle 120x56", measure_ns([&] {
+        draw.draw_rectangle(4, 4, 123, 59, true);
+        sink = buffer[0];
+    }, 100000));
+    report("filled circle r=30", measure_ns([&] {
+        draw.draw_circle(64, 32, 30, true);
+        sink = buffer[0];
+    }, 100000));
+    report("filled rounded rectangle r=8", measure_ns([&] {
+        draw.draw_rectangle_rounded(4, 4, 123, 59, 8, true);
+        sink = buffer[0];
+    }, 100000));
+}
+
+static void bench_gray() {
+    printf("== grayscale (Gray4) on 256x64\n");
+
+    static unsigned char buffer[256 * 64 / 2];
+    mgui_draw draw(256, 64, buffer, mgui_pixel_format::Gray4);
+    draw.set_intensity(0xA0);
+
+    report("clear", measure_ns([&] { draw.clear(); sink = buffer[0]; }, 100000));
+    report("filled rectangle 247x56", measure_ns([&] {
+        draw.draw_rectangle(4, 4, 250, 59, true);
+        sink = buffer[0];
+    }, 100000));
+    report("filled circle r=30", measure_ns([&] {
+        draw.draw_circle(128, 32, 30, true);
+        sink = buffer[0];
+    }, 100000));
+
+    static unsigned char pixels[64 * 64 / 2];
+    fill_random(pixels, sizeof(pixels));
+    mgui_image_property image(64, 64, pixels, 4);
+    report("image 64x64 aligned", measure_ns([&] {
+        draw.draw_image(&image, 32, 0);
+        sink = buffer[0];
+    }, 100000));
+    report("image 64x64 unaligned", measure_ns([&] {
+        draw.draw_image(&image, 33, 0);
+        sink = buffer[0];
+    }, 10000));
+}
+
+static void bench_aa_text() {
+    printf("== anti-aliased text (8x16, 4-bit coverage)\n");
+
+    static unsigned char buffer[256 * 64 / 2];
+    const char text[] = "The quick brown fox jumps over the lazy dog 0123456789";
+    const int length = sizeof(text) - 1;
+
+    // One line of text, glyphs at odd and even pixel positions.
+    auto draw_line = [&](mgui_draw& draw, mgui_font& font) {
+        for (int i = 0; i < length; i++) {
+            draw.draw_char(&font, (i * 9) % 240, (i / 26) * 16, font.search(&text[i]));
+        }
+        sink = buffer[0];
+    };
+
+    mgui_pixel_format formats[] = { mgui_pixel_format::Gray4, mgui_pixel_format::Gray2 };
+    const char* names[] = { "Gray4", "Gray2" };
+    for (int f = 0; f < 2; f++) {
+        mgui_draw draw(256, 64, buffer, formats[f]);
+        char name[64];
+
+        font_16x8_aa cached(128);
+        double ns = measure_ns([&] { draw_line(draw, cached); }, 20000) / length;
+        snprintf(name, sizeof(name), "%s glyph, cached", names[f]);
+        report(name, ns);
+        printf("%-40s %12.0f glyphs/s\n", "", 1e9 / ns);
+
+        // Every glyph misses the cache
+        font_16x8_aa uncached(1);
+        ns = measure_ns([&] { draw_line(draw, uncached); }, 20000) / length;
+        snprintf(name, sizeof(name), "%s glyph, cache miss", names[f]);
+        report(name, ns);
+        printf("%-40s %12.0f glyphs/s\n", "", 1e9 / ns);
+    }
+
+    // 1-bit font on a Gray4 screen for comparison
+    mgui_draw draw(256, 64, buffer, mgui_pixel_format::Gray4);
+    font_16x8 mono;
+    double ns = measure_ns([&] { draw_line(draw, mono); }, 20000) / length;
+    report("Gray4 glyph, 1-bit font", ns);
+    printf("%-40s %12.0f glyphs/s\n", "", 1e9 / ns);
+}
+
+// Host mock of an SPI transport: only reads the pixels.
+class null_transport : public mgui_color_transport {
+public:
+    void begin(int, int, int, int) {}
+    void write(const uint16_t* pixels, int count) {
+        bytes += count * 2;
+        sink = pixels[count - 1];
+    }
+    long long bytes = 0;
+};
+
+static void bench_color() {
+    printf("== RGB565 line output 320x240\n");
+
+    font_16x8 font;
+    mgui_text text(&font, "The quick brown fox", 8, 8);
+    mgui_rectangle rect;
+    rect.set_x(10);
+    rect.set_y(40);
+    rect.set_width(300);
+    rect.set_height(150);
+    rect.set_radius(12);
+    rect.set_fill(true);
+    mgui_circle circle;
+    circle.set_x(160);
+    circle.set_y(120);
+    circle.set_radius(60);
+    circle.set_fill(true);
+
+    const mgui_pixel_format formats[] = {
+        mgui_pixel_format::Mono1, mgui_pixel_format::Gray2, mgui_pixel_format::Gray4 };
+    const char* names[] = { "Mono1", "Gray2", "Gray4" };
+    for (int f = 0; f < 3; f++) {
+        const int bands[] = { 8, 16, 32 };
+        for (int band : bands) {
+            null_transport transport;
+            mgui_color color(320, 240, &transport, formats[f], band);
+            color.add((mgui_object*)&rect);
+            color.add((mgui_object*)&circle);
+            color.add((mgui_object*)&text);
+
+            char name[64];
+            double ns = measure_ns([&] { color.update_lcd(); }, 200);
+            snprintf(name, sizeof(name), "%s frame, band %d", names[f], band);
+            report(name, ns);
+            printf("%-40s %12.1f MB/s\n", "", 320 * 240 * 2 / ns * 1e3);
+        }
+    }
+}
+
+// Scripted encoder session: move down through the menu, then back up.
+static int session_frame = 0;
+
+static void session_button(mgui_input_state* result) {
+    result->type = mgui_input_type::Single;
+    result->value_1 = 0;
+}
+
+static void session_encoder(mgui_input_state* result) {
+    result->type = mgui_input_type::Single;
+    const int step = session_frame % 40;
+    result->value_1 = (step % 5 != 0) ? 0 : (step < 20 ? 1 : -1);
+}
+
+static void session_menu_handler(mgui_menu* sender, const mgui_input_state state[], mgui_string*) {
+    sender->set_on_select_prev(state[1].value_1 < 0);
+    sender->set_on_select_next(state[1].value_1 > 0);
+}
+
+enum class wire_strategy { Full, DiffPages, DiffWindow };
+
+/**
+ * @brief Replay the session and return the average wire time per frame in ms.
+ */
+static double session_wire_ms(mgui_display_controller controller, const mgui_bus_model& model,
+                              wire_strategy strategy, int frames) {
+    mgui_recording_bus bus(model, nullptr, false);
+    mgui_display* display;
+    if (controller == mgui_display_controller::SSD1306) {
+        display = new mgui_ssd1306(WIDTH, HEIGHT, &bus);
+    } else {
+        display = new mgui_sh1106(WIDTH, HEIGHT, &bus);
+    }
+
+    font_16x8 font;
+    mgui_multi gui(WIDTH, HEIGHT);
+    gui.input()->add(&session_button);
+    gui.input()->add(&session_encoder);
+
+    mgui_menu menu(WIDTH - 16, HEIGHT);
+    menu.set_input_event_handler(&session_menu_handler);
+    const char* names[] = { "Item 1", "Item 2", "Item 3", "Item 4", "Item 5", "Item 6" };
+    mgui_text* texts[6];
+    mgui_menu_item* items[6];
+    for (int i = 0; i < 6; i++) {
+        texts[i] = new mgui_text(&font, names[i]);
+        items[i] = new mgui_menu_item(texts[i]);
+        menu.add(items[i]);
+    }
+    gui.add("menu", (mgui_object*)&menu);
+
+    static unsigned char shown[BUFFER_SIZE];
+    session_frame = 0;
+    gui.update_lcd();
+    display->transfer(gui.lcd());
+    memcpy(shown, gui.lcd(), BUFFER_SIZE);
+    bus.reset();
+
+    for (session_frame = 1; session_frame <= frames; session_frame++) {
+        gui.update_lcd();
+        switch (strategy) {
+        case wire_strategy::Full:
+            display->transfer(gui.lcd());
+            break;
+        case wire_strategy::DiffPages:
+            display->transfer_diff(gui.lcd(), shown, true);
+            break;
+        case wire_strategy::DiffWindow:
+            display->transfer_diff(gui.lcd(), shown, false);
+            break;
+        }
+        memcpy(shown, gui.lcd(), BUFFER_SIZE);
+        bus.mark_frame();
+    }
+
+    for (int i = 0; i < 6; i++) {
+        delete items[i];
+        delete texts[i];
+    }
+    delete display;
+    return bus.frame_ms();
+}
+
+static void bench_wire() {
+    printf("== wire time per frame, %dx%d menu session (200 frames)\n", WIDTH, HEIGHT);
+
+    struct bus_case { const char* name; mgui_bus_model model; };
+    const bus_case buses[] = {
+        { "I2C 100k", mgui_bus_model::i2c(100000) },
+        { "I2C 400k", mgui_bus_model::i2c(400000) },
+        { "I2C 1M", mgui_bus_model::i2c(1000000) },
+        { "SPI 8MHz", mgui_bus_model::spi(8) },
+    };
+    const char* strategies[] = { "full", "diff pages", "diff window" };
+    const mgui_display_controller controllers[] = {
+        mgui_display_controller::SSD1306, mgui_display_controller::SH1106 };
+    const char* controller_names[] = { "SSD1306", "SH1106" };
+
+    for (int c = 0; c < 2; c++) {
+        for (const bus_case& bus : buses) {
+            for (int s = 0; s < 3; s++) {
+                const double ms = session_wire_ms(controllers[c], bus.model, (wire_strategy)s, 200);
+                printf("%-8s %-9s %-12s %19.3f ms/frame\n", controller_names[c], bus.name, strategies[s], ms);
+            }
+        }
+    }
+}
+
+static int pipeline_render_us = 0;
+
+// Stands for the drawing work of a frame.
+static void pipeline_frame(int) {
+    std::this_thread::sleep_for(std::chrono::microseconds(pipeline_render_us));
+}
+
+static void bench_pipeline() {
+    printf("== render/transmit pipeline, %dx%d SSD1306 on I2C 1M (30 frames)\n", WIDTH, HEIGHT);
+
+    const int frames = 30;
+    const int render_us[] = { 2000, 8000, 16000 };
+    for (int us : render_us) {
+        mgui_display_simulator panel(mgui_display_controller::SSD1306, WIDTH, HEIGHT);
+        mgui_recording_bus bus(mgui_bus_model::i2c(1000000), &panel, false);
+        bus.set_realtime(true);
+        mgui_ssd1306 display(WIDTH, HEIGHT, &bus);
+        display.init();
+        bus.reset();
+        mgui gui(WIDTH, HEIGHT);
+        pipeline_render_us = us;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            pipeline_frame(i);
+            gui.update_lcd();
+            display.transfer(gui.lcd());
+        }
+        const double serial = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        mgui_thread_pipeline<mgui> pipeline(&gui, &display);
+        start = std::chrono::steady_clock::now();
+        pipeline.run(frames, &pipeline_frame);
+        const double pipelined = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        printf("render %5.1f ms  wire %5.1f ms  serial %6.2f ms/frame  pipelined %6.2f ms/frame\n",
+               us / 1000.0, bus.wire_ms() / (2 * frames),
+               serial / frames, pipelined / frames);
+    }
+}
+
+static void bench_batch() {
+    const int jobs = 128;
+    printf("== batch rendering, %d variants of the example screens (%u hardware threads)\n",
+           jobs, std::thread::hardware_concurrency());
+
+    const int threads[] = { 1, 2, 4, 0 };
+    for (int count : threads) {
+        mgui_batch_renderer batch(count);
+        std::vector<unsigned long long> checksums(jobs);
+        auto start = std::chrono::steady_clock::now();
+        batch.run(jobs, [&](int index) {
+            Example::screens screens;
+            screens.session();
+            screens.turn(index % 3);
+            unsigned long long sum = 0;
+            for (int i = 0; i < BUFFER_SIZE; i++) {
+                sum = sum * 31 + screens.gui.lcd()[i];
+            }
+            checksums[index] = sum;
+        });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (unsigned long long sum : checksums) {
+            sink += sum;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "%d threads", batch.threads());
+        printf("%-40s %12.1f screens/s\n", name, jobs / seconds);
+    }
+}
+
+static unsigned long host_clock_us() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void bench_replay() {
+    printf("== input trace replay, %dx%d menu session\n", WIDTH, HEIGHT);
+
+    mgui_input_trace trace(2, 1024);
+    font_16x8 font;
+    const char* names[] = { "Item 1", "Item 2", "Item 3", "Item 4", "Item 5", "Item 6" };
+
+    // record the scripted session, then replay it on fresh screens
+    for (int run = 0; run < 3; run++) {
+        mgui_multi gui(WIDTH, HEIGHT);
+        gui.input()->add(&session_button);
+        gui.input()->add(&session_encoder);
+        mgui_menu menu(WIDTH - 16, HEIGHT);
+        menu.set_input_event_handler(&session_menu_handler);
+        mgui_text* texts[6];
+        mgui_menu_item* items[6];
+        for (int i = 0; i < 6; i++) {
+            texts[i] = new mgui_text(&font, names[i]);
+            items[i] = new mgui_menu_item(texts[i]);
+            menu.add(items[i]);
+        }
+        gui.add("menu", (mgui_object*)&menu);
+
+        if (run == 0) {
+            gui.input()->set_recorder(&trace);
+            for (session_frame = 0; session_frame < 2000; session_frame++) {
+                gui.update_lcd();
+            }
+            gui.input()->set_recorder(nullptr);
+            printf("%-40s %8d entries for %ld frames\n", "recorded", trace.count(), trace.updates());
+        } else if (run == 1) {
+            mgui_print_replay("replay", mgui_replay(gui, *gui.input(), trace));
+        } else {
+            // frame by frame with the transfer to a simulated SSD1306
+            mgui_display_simulator panel(mgui_display_controller::SSD1306, WIDTH, HEIGHT);
+            mgui_recording_bus bus(mgui_bus_model::i2c(400000), &panel, false);
+            mgui_ssd1306 display(WIDTH, HEIGHT, &bus);
+            display.init();
+
+            mgui_telemetry telemetry(&host_clock_us);
+            gui.set_frame_listener(&telemetry);
+            gui.input()->set_player(&trace);
+            while (!gui.input()->finished()) {
+                gui.update_lcd();
+                telemetry.begin_transfer();
+                display.transfer(gui.lcd());
+                telemetry.end_transfer();
+            }
+            gui.input()->set_player(nullptr);
+            gui.set_frame_listener(nullptr);
+            telemetry.print();
+        }
+
+        for (int i = 0; i < 6; i++) {
+            delete items[i];
+            delete texts[i];
+        }
+    }
+}
+
+static void bench_hit_test() {
+    const int count = 1000;
+    printf("== hit test, %d buttons on 320x240\n", count);
+
+    std::vector<mgui_button*> buttons;
+    mgui_ui_group group;
+    unsigned int seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int x = (seed >> 8) % 320;
+        seed = seed * 1103515245 + 12345;
+        const int y = (seed >> 8) % 240;
+        buttons.push_back(new mgui_button(x, y, 4 + (seed >> 20) % 24, 4 + (seed >> 26) % 16));
+        group.add(buttons.back());
+    }
+
+    // the positions of a touch trace
+    int xs[256], ys[256];
+    for (int i = 0; i < 256; i++) {
+        seed = seed * 1103515245 + 12345;
+        xs[i] = (seed >> 8) % 320;
+        ys[i] = (seed >> 20) % 240;
+    }
+
+    report("linear scan", measure_ns([&] {
+        unsigned long long found = 0;
+        for (int i = 0; i < 256; i++) {
+            for (int index = count - 1; index >= 0; index--) {
+                const mgui_bounds bounds = buttons[index]->bounds();
+                if (xs[i] >= bounds.x && xs[i] < bounds.x + bounds.width
+                 && ys[i] >= bounds.y && ys[i] < bounds.y + bounds.height) {
+                    found += index;
+                    break;
+                }
+            }
+        }
+        sink = found;
+    }, 200) / 256);
+
+    const int cells[] = { 8, 16, 32 };
+    for (int cell : cells) {
+        mgui_hit_grid grid(320, 240, cell);
+        grid.add(&group);
+        char name[64];
+        snprintf(name, sizeof(name), "grid build, %d px cells", cell);
+        report(name, measure_ns([&] {
+            grid.invalidate();
+            sink = grid.hit(0, 0) != nullptr;
+        }, 200));
+
+        snprintf(name, sizeof(name), "grid, %d px cells (%d entries)", cell, grid.entries());
+        report(name, measure_ns([&] {
+            unsigned long long found = 0;
+            for (int i = 0; i < 256; i++) {
+                const mgui_hit* hit = grid.hit(xs[i], ys[i]);
+                found += hit != nullptr ? hit->index : 0;
+            }
+            sink = found;
+        }, 2000) / 256);
+    }
+
+    for (mgui_button* button : buttons) {
+        delete button;
+    }
+}
+
+int main() {
+    bench_transpose();
+    bench_rotation();
+    bench_kernels();
+    bench_draw();
+    bench_gray();
+    bench_aa_text();
+    bench_color();
+    bench_wire();
+    bench_pipeline();
+    bench_batch();
+    bench_hit_test();
+#ifdef MGUI_TRACE
+    // only the replay fits in the trace buffer
+    mgui_tracer::instance().clear();
+#endif
+    bench_replay();
+#ifdef MGUI_TRACE
+    mgui_tracer::instance().flush("mgui-bench-trace.json");
+    printf("trace written to mgui-bench-trace.json (%ld events dropped)\n", mgui_tracer::instance().dropped());
+#endif
+    return 0;
+}
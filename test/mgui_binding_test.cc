@@ -0,0 +1,265 @@
+// Part of mGUI-thread-test, built with ThreadSanitizer when the compiler has it (see CMakeLists.txt).
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../mGUI/mgui_binding.h"
+#include "font_16x8.h"
+
+namespace Binding {
+
+    // Wide enough that a torn read of an unprotected copy is likely.
+    struct sample {
+        uint32_t sequence;
+        uint32_t check[15];
+        int width;
+    };
+
+    static inline uint32_t check_of(uint32_t sequence) { return ~sequence * 2654435761u; }
+
+    static inline sample make_sample(uint32_t sequence) {
+        sample value;
+        value.sequence = sequence;
+        for (int i = 0; i < 15; i++) {
+            value.check[i] = check_of(sequence) + i;
+        }
+        value.width = 1 + (int)(sequence % 40);
+        return value;
+    }
+
+    TEST(Seqlock, ReadWrite) {
+        mgui_seqlock<sample> cell(make_sample(1));
+        const uint32_t version = cell.version();
+        EXPECT_EQ(0u, version & 1);
+        EXPECT_EQ(1u, cell.read().sequence);
+
+        cell.write(make_sample(7));
+        EXPECT_NE(version, cell.version());
+        sample value;
+        uint32_t read_version = 0;
+        ASSERT_TRUE(cell.try_read(&value, &read_version));
+        EXPECT_EQ(cell.version(), read_version);
+        EXPECT_EQ(7u, value.sequence);
+        EXPECT_EQ(check_of(7) + 14, value.check[14]);
+        EXPECT_EQ(8, value.width);
+
+        // not a multiple of the word size
+        mgui_seqlock<char> letter('a');
+        letter.write('z');
+        EXPECT_EQ('z', letter.read());
+    }
+
+    static void set_width(mgui_rectangle* target, const int& width) {
+        target->set_width(width);
+    }
+
+    TEST(ValueBinding, AppliedOncePerChange) {
+        mgui_rectangle rect;
+        rect.set_height(4);
+        rect.set_fill(true);
+        mgui_value_binding<int, mgui_rectangle> width(&rect, &set_width, 10);
+        EXPECT_EQ(&rect, width.target());
+
+        mgui gui(128, 64);
+        gui.set_adaptive_refresh(true);
+        gui.add((mgui_object*)&rect);
+        gui.bind(&width);
+
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(10, rect.width());
+        EXPECT_EQ(1ul, width.applies());
+        EXPECT_FALSE(gui.update_lcd());
+        EXPECT_EQ(1ul, width.applies());
+
+        // only the latest value is applied
+        width.set(20);
+        width.set(30);
+        EXPECT_EQ(30, width.get());
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(30, rect.width());
+        EXPECT_EQ(2ul, width.applies());
+        EXPECT_EQ(0x0F, gui.lcd()[29]);
+        EXPECT_EQ(0x00, gui.lcd()[30]);
+        EXPECT_FALSE(gui.update_lcd());
+
+        // an unbound value waits for the next bind
+        gui.unbind(&width);
+        width.set(40);
+        EXPECT_FALSE(gui.update_lcd());
+        EXPECT_EQ(30, rect.width());
+        gui.bind(&width);
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(40, rect.width());
+    }
+
+    TEST(ValueBinding, OpenDialog) {
+        mgui_rectangle frame;
+        frame.set_width(64);
+        frame.set_height(16);
+        mgui_rectangle rect;
+        rect.set_height(4);
+        rect.set_fill(true);
+        mgui_value_binding<int, mgui_rectangle> width(&rect, &set_width, 10);
+
+        mgui_multi gui(128, 64);
+        gui.set_adaptive_refresh(true);
+        gui.add("main", (mgui_object*)&frame);
+        gui.add("dialog", (mgui_object*)&rect);
+        gui.select("main");
+        gui.bind(&width);
+        EXPECT_TRUE(gui.update_lcd());
+        ASSERT_TRUE(gui.open_dialog("dialog", 0, 32, 64, 16));
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_FALSE(gui.update_lcd());
+
+        // the dialog shows the value of its binding at once
+        width.set(20);
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(20, rect.width());
+        EXPECT_EQ(0x0F, gui.lcd()[4 * 128 + 19]);
+        EXPECT_EQ(0x00, gui.lcd()[4 * 128 + 20]);
+        EXPECT_FALSE(gui.update_lcd());
+    }
+
+    TEST(TextBinding, TextAndNumber) {
+        font_16x8 font;
+        mgui_text text(&font, "init");
+        mgui_text_binding<6> label(&text);
+        EXPECT_STREQ("init", label.get().text);
+
+        mgui_multi gui(128, 64);
+        gui.set_adaptive_refresh(true);
+        gui.add("main", (mgui_object*)&text);
+        gui.bind(&label);
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_FALSE(gui.update_lcd());
+
+        label.set("12.5C");
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_STREQ("12.5C", text.text());
+        EXPECT_EQ(5 * font.width(), text.text_width());
+
+        // cut to the capacity
+        label.set("123456789");
+        gui.update_lcd();
+        EXPECT_STREQ("12345", text.text());
+
+        label.set_number(0);
+        gui.update_lcd();
+        EXPECT_STREQ("0", text.text());
+        label.set_number(-4096);
+        gui.update_lcd();
+        EXPECT_STREQ("-4096", text.text());
+        label.set_number(1234567);
+        gui.update_lcd();
+        EXPECT_STREQ("12345", text.text());
+        label.set(nullptr);
+        gui.update_lcd();
+        EXPECT_STREQ("", text.text());
+    }
+
+    // Widgets of a producer, and what the UI thread saw of its values.
+    struct meter {
+        mgui_rectangle bar;
+        uint32_t last;
+        int torn;
+        int backwards;
+    };
+
+    static void set_meter(meter* target, const sample& value) {
+        for (int i = 0; i < 15; i++) {
+            if (value.check[i] != check_of(value.sequence) + i) {
+                target->torn++;
+                break;
+            }
+        }
+        if (value.sequence < target->last) {
+            target->backwards++;
+        }
+        target->last = value.sequence;
+        target->bar.set_width(value.width);
+    }
+
+    TEST(Binding, ProducersAndUiThread) {
+        const int producers = 4;
+        const uint32_t writes = 20000;
+        font_16x8 font;
+
+        std::vector<meter> meters(producers);
+        std::vector<mgui_text*> labels;
+        std::vector<mgui_value_binding<sample, meter>*> values;
+        std::vector<mgui_text_binding<12>*> texts;
+
+        mgui gui(128, 64);
+        gui.set_adaptive_refresh(true);
+        for (int i = 0; i < producers; i++) {
+            meters[i].bar.set_y(i * 16);
+            meters[i].bar.set_height(4);
+            meters[i].bar.set_fill(true);
+            meters[i].last = 0;
+            meters[i].torn = 0;
+            meters[i].backwards = 0;
+            labels.push_back(new mgui_text(&font, "-", 48, i * 16));
+            gui.add((mgui_object*)&meters[i].bar);
+            gui.add((mgui_object*)labels[i]);
+
+            values.push_back(new mgui_value_binding<sample, meter>(&meters[i], &set_meter, make_sample(0)));
+            texts.push_back(new mgui_text_binding<12>(labels[i]));
+            gui.bind(values[i]);
+            gui.bind(texts[i]);
+        }
+
+        // each producer owns its bindings; the UI thread draws until all of them are done
+        std::atomic<int> running(producers);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < producers; i++) {
+            threads.emplace_back([&, i] {
+                for (uint32_t sequence = 1; sequence <= writes; sequence++) {
+                    values[i]->set(make_sample(sequence));
+                    if (sequence % 16 == 0 || sequence == writes) {
+                        texts[i]->set_number((long)sequence * (i + 1));
+                    }
+                }
+                running.fetch_sub(1, std::memory_order_release);
+            });
+        }
+
+        int frames = 0;
+        while (running.load(std::memory_order_acquire) > 0) {
+            frames += gui.update_lcd() ? 1 : 0;
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        gui.update_lcd();
+
+        EXPECT_GT(frames, 0);
+        for (int i = 0; i < producers; i++) {
+            EXPECT_EQ(0, meters[i].torn) << i;
+            EXPECT_EQ(0, meters[i].backwards) << i;
+            EXPECT_EQ(writes, meters[i].last) << i;
+            EXPECT_EQ(make_sample(writes).width, meters[i].bar.width()) << i;
+            EXPECT_LE(values[i]->applies(), (unsigned long)writes + 1) << i;
+
+            char expected[16];
+            snprintf(expected, sizeof(expected), "%ld", (long)writes * (i + 1));
+            EXPECT_STREQ(expected, labels[i]->text()) << i;
+        }
+
+        // nothing changes any more
+        EXPECT_FALSE(gui.update_lcd());
+
+        for (int i = 0; i < producers; i++) {
+            gui.unbind(values[i]);
+            gui.unbind(texts[i]);
+            delete values[i];
+            delete texts[i];
+            delete labels[i];
+        }
+    }
+}
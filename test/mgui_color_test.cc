@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "../mGUI/mgui_color.h"
+#include "font_16x8.h"
+
+namespace Color {
+
+    // Collects a whole frame on the host.
+    class frame_transport : public mgui_color_transport {
+    public:
+        frame_transport(int width, int height) : frame(width * height), width_(width) {}
+
+        void begin(int x0, int y0, int x1, int y1) {
+            window[0] = x0;
+            window[1] = y0;
+            window[2] = x1;
+            window[3] = y1;
+            position = 0;
+            frames++;
+        }
+
+        void write(const uint16_t* pixels, int count) {
+            EXPECT_EQ(count, width_);
+            for (int i = 0; i < count && position < (int)frame.size(); i++) {
+                frame[position++] = pixels[i];
+            }
+            lines++;
+        }
+
+        std::vector<uint16_t> frame;
+        int window[4] = {};
+        int position = 0;
+        int frames = 0;
+        int lines = 0;
+
+    private:
+        int width_;
+    };
+
+    static int menu_updates = 0;
+
+    static void count_updates(mgui_menu*, const mgui_input_state[], mgui_string*) {
+        menu_updates++;
+    }
+
+    class ColorTest :
+        public testing::TestWithParam<std::tuple<mgui_pixel_format, int, int>> {};
+
+    TEST_P(ColorTest, SameAsFrameBuffer) {
+        mgui_pixel_format format = std::get<0>(GetParam());
+        int height = std::get<1>(GetParam());
+        int band = std::get<2>(GetParam());
+        const int width = 160;
+
+        font_16x8 font;
+        mgui_text text(&font, "Color TFT", 5, 3);
+        mgui_rectangle rect;
+        rect.set_x(2);
+        rect.set_y(20);
+        rect.set_width(100);
+        rect.set_height(height - 22);
+        rect.set_radius(7);
+        rect.set_fill(true);
+        rect.set_intensity(0x90);
+        mgui_circle circle;
+        circle.set_x(120);
+        circle.set_y(height / 2);
+        circle.set_radius(30);
+        circle.set_fill(true);
+        mgui_line line;
+        line.set_x0(0);
+        line.set_y0(height - 1);
+        line.set_x1(159);
+        line.set_y1(0);
+
+        mgui reference(width, height, format);
+        frame_transport transport(width, height);
+        mgui_color color(width, height, &transport, format, band);
+        color.set_color(0, mgui_color::rgb565(0, 0, 64));
+        color.set_color(1, mgui_color::rgb565(255, 0, 0));
+        color.set_swap_bytes(false);
+
+        mgui_object* objects[] = {
+            (mgui_object*)&rect, (mgui_object*)&circle, (mgui_object*)&line, (mgui_object*)&text };
+        for (mgui_object* object : objects) {
+            reference.add(object);
+            color.add(object);
+        }
+        reference.update_lcd();
+        color.update_lcd();
+
+        EXPECT_FALSE(color.draw_list().overflow());
+        EXPECT_EQ(transport.frames, 1);
+        EXPECT_EQ(transport.lines, height);
+        EXPECT_EQ(transport.window[2], width - 1);
+        EXPECT_EQ(transport.window[3], height - 1);
+
+        mgui_draw levels(width, height, reference.lcd(), format);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int level;
+                if (format == mgui_pixel_format::Mono1) {
+                    level = (reference.lcd()[(y >> 3) * width + x] >> (y & 7)) & 1;
+                } else {
+                    level = levels.pixel_level(x, y);
+                }
+                ASSERT_EQ(transport.frame[y * width + x], color.color(level)) << x << "," << y;
+            }
+        }
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Band,
+        ColorTest,
+        testing::Combine(
+            testing::Values(mgui_pixel_format::Mono1, mgui_pixel_format::Gray2, mgui_pixel_format::Gray4),
+            testing::Values(64, 128),
+            testing::Values(8, 16, 24, 48)
+        )
+    );
+
+    TEST(ColorTest, SwapBytes) {
+        frame_transport transport(8, 8);
+        mgui_color color(8, 8, &transport);
+        color.set_color(1, 0x1234);
+        color.set_swap_bytes(true);
+
+        mgui_pixel pixel(3, 2, true);
+        color.add((mgui_object*)&pixel);
+        color.update_lcd();
+        EXPECT_EQ(transport.frame[2 * 8 + 3], 0x3412);
+        EXPECT_EQ(transport.frame[0], 0x0000);
+    }
+
+    TEST(ColorTest, UpdateOncePerFrame) {
+        frame_transport transport(128, 64);
+        mgui_color color(128, 64, &transport, mgui_pixel_format::Mono1, 8);
+
+        mgui_menu menu(128, 64, 4);
+        menu.set_input_event_handler(count_updates);
+        color.add((mgui_object*)&menu);
+
+        menu_updates = 0;
+        color.update_lcd();
+        color.update_lcd();
+        EXPECT_EQ(menu_updates, 2);
+    }
+
+    TEST(ColorTest, Overflow) {
+        frame_transport transport(64, 16);
+        mgui_color color(64, 16, &transport, mgui_pixel_format::Mono1, 8, 2);
+        mgui_pixel pixels[3];
+        for (mgui_pixel& pixel : pixels) {
+            pixel.set_on(true);
+            color.add((mgui_object*)&pixel);
+        }
+        color.update_lcd();
+        EXPECT_TRUE(color.draw_list().overflow());
+        EXPECT_EQ(color.draw_list().count(), 2);
+    }
+
+    TEST(ColorTest, UnalignedSize) {
+        // neither the width nor the band height is a multiple of 8
+        const int width = 100;
+        const int height = 32;
+        mgui_rectangle rect;
+        rect.set_x(3);
+        rect.set_y(2);
+        rect.set_width(97);
+        rect.set_height(27);
+        rect.set_fill(true);
+        rect.set_intensity(0x90);
+        mgui_line line;
+        line.set_x0(0);
+        line.set_y0(height - 1);
+        line.set_x1(width + 10);
+        line.set_y1(0);
+
+        const mgui_pixel_format formats[] = {
+            mgui_pixel_format::Mono1, mgui_pixel_format::Gray2, mgui_pixel_format::Gray4 };
+        for (mgui_pixel_format format : formats) {
+            mgui reference(width, height, format);
+            frame_transport transport(width, height);
+            mgui_color color(width, height, &transport, format, 5);
+            color.set_color(1, mgui_color::rgb565(255, 0, 0));
+            reference.add((mgui_object*)&rect);
+            reference.add((mgui_object*)&line);
+            color.add((mgui_object*)&rect);
+            color.add((mgui_object*)&line);
+            reference.update_lcd();
+            color.update_lcd();
+            EXPECT_EQ(transport.lines, height);
+
+            mgui_draw levels(width, height, reference.lcd(), format);
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    int level;
+                    if (format == mgui_pixel_format::Mono1) {
+                        level = (reference.lcd()[(y >> 3) * width + x] >> (y & 7)) & 1;
+                    } else {
+                        level = levels.pixel_level(x, y);
+                    }
+                    ASSERT_EQ(transport.frame[y * width + x], color.color(level)) << x << "," << y;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,1195 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../mGUI/mgui_display.h"
+#include "../mGUI/mgui_host_bus.h"
+#include "../mGUI/mgui_host_pipeline.h"
+#include "../mGUI/mgui_host_transport.h"
+#include "font_16x8.h"
+
+namespace Display {
+
+    // Records the transactions and forwards them to the simulator.
+    class recording_bus : public mgui_display_bus {
+    public:
+        explicit recording_bus(mgui_display_bus* next) : next_(next) {}
+
+        void command(const uint8_t* commands, int count) {
+            command_transactions++;
+            command_bytes.insert(command_bytes.end(), commands, commands + count);
+            next_->command(commands, count);
+        }
+
+        void data(const uint8_t* data, int count) {
+            data_transactions++;
+            data_bytes += count;
+            next_->data(data, count);
+        }
+
+        std::vector<uint8_t> command_bytes;
+        int command_transactions = 0;
+        int data_transactions = 0;
+        int data_bytes = 0;
+
+    private:
+        mgui_display_bus* next_;
+    };
+
+    static void draw_screen(mgui* gui, font_16x8* font, int shift) {
+        mgui_text text(font, "Display", 4 + shift, 2 + shift);
+        mgui_circle circle;
+        circle.set_x(90 - shift);
+        circle.set_y(30);
+        circle.set_radius(20);
+        circle.set_fill(true);
+        mgui_rectangle rect;
+        rect.set_x(10);
+        rect.set_y(40 - shift);
+        rect.set_width(50);
+        rect.set_height(20);
+
+        gui->add((mgui_object*)&text);
+        gui->add((mgui_object*)&circle);
+        gui->add((mgui_object*)&rect);
+        gui->update_lcd();
+        gui->clear();
+    }
+
+    struct controller_param {
+        mgui_display_controller controller;
+        int height;
+        int ram_columns;
+        int column_offset;
+    };
+
+    static mgui_display* create(const controller_param& p, mgui_display_bus* bus) {
+        switch (p.controller) {
+        case mgui_display_controller::SSD1306:
+            return new mgui_ssd1306(128, p.height, bus);
+        case mgui_display_controller::SH1106:
+            return new mgui_sh1106(128, p.height, bus, p.column_offset);
+        default:
+            return new mgui_st7565(128, p.height, bus, p.column_offset);
+        }
+    }
+
+    class DisplayTest : public testing::TestWithParam<controller_param> {};
+
+    TEST_P(DisplayTest, FullFrame) {
+        const controller_param p = GetParam();
+        mgui_display_simulator sim(p.controller, 128, p.height, p.ram_columns, p.column_offset);
+        mgui_display* display = create(p, &sim);
+        display->init();
+        EXPECT_TRUE(sim.power());
+
+        font_16x8 font;
+        mgui gui(128, p.height);
+        draw_screen(&gui, &font, 0);
+        display->transfer(gui.lcd());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+
+        // a second frame is written over the first one
+        draw_screen(&gui, &font, 3);
+        display->transfer(gui.lcd());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+
+        delete display;
+    }
+
+    TEST_P(DisplayTest, Window) {
+        const controller_param p = GetParam();
+        mgui_display_simulator sim(p.controller, 128, p.height, p.ram_columns, p.column_offset);
+        mgui_display* display = create(p, &sim);
+        display->init();
+
+        font_16x8 font;
+        mgui gui(128, p.height);
+        draw_screen(&gui, &font, 0);
+        display->transfer(gui.lcd());
+
+        std::vector<uint8_t> before(gui.lcd(), gui.lcd() + 128 * (p.height >> 3));
+        draw_screen(&gui, &font, 5);
+
+        // only the window is updated
+        display->transfer_window(gui.lcd(), 8, 1, 71, 2);
+        std::vector<uint8_t> expected = before;
+        for (int page = 1; page <= 2; page++) {
+            for (int x = 8; x <= 71; x++) {
+                expected[page * 128 + x] = gui.lcd()[page * 128 + x];
+            }
+        }
+        EXPECT_TRUE(sim.equals(expected.data()));
+
+        // windows outside of the screen are clipped
+        display->transfer_window(gui.lcd(), -10, -1, 200, 20);
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+
+        delete display;
+    }
+
+    TEST_P(DisplayTest, State) {
+        const controller_param p = GetParam();
+        mgui_display_simulator sim(p.controller, 128, p.height, p.ram_columns, p.column_offset);
+        mgui_display* display = create(p, &sim);
+        display->init();
+
+        display->set_invert(true);
+        EXPECT_TRUE(sim.inverted());
+        display->set_invert(false);
+        EXPECT_FALSE(sim.inverted());
+
+        display->set_start_line(9);
+        EXPECT_EQ(9, sim.start_line());
+
+        display->set_power(false);
+        EXPECT_FALSE(sim.power());
+        display->set_power(true);
+        EXPECT_TRUE(sim.power());
+
+        display->set_contrast(0xC8);
+        if (p.controller == mgui_display_controller::ST7565) {
+            EXPECT_EQ(0xC8 >> 2, sim.contrast());
+        } else {
+            EXPECT_EQ(0xC8, sim.contrast());
+        }
+
+        delete display;
+    }
+
+    TEST_P(DisplayTest, StartLine) {
+        const controller_param p = GetParam();
+        mgui_display_simulator sim(p.controller, 128, p.height, p.ram_columns, p.column_offset);
+        mgui_display* display = create(p, &sim);
+        display->init();
+
+        mgui gui(128, p.height);
+        gui.lcd()[0] = 0x01; // (0, 0)
+        display->transfer(gui.lcd());
+        EXPECT_TRUE(sim.pixel(0, 0));
+
+        // the line 0 of the RAM moves up
+        display->set_start_line(1);
+        EXPECT_FALSE(sim.pixel(0, 0));
+        EXPECT_TRUE(sim.pixel(0, 63));
+
+        delete display;
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Controllers,
+        DisplayTest,
+        testing::Values(
+            controller_param{ mgui_display_controller::SSD1306, 64, 128, 0 },
+            controller_param{ mgui_display_controller::SSD1306, 32, 128, 0 },
+            controller_param{ mgui_display_controller::SH1106, 64, 132, 2 },
+            controller_param{ mgui_display_controller::ST7565, 64, 132, 0 },
+            controller_param{ mgui_display_controller::ST7565, 64, 132, 4 }
+        )
+    );
+
+    TEST(Transactions, SSD1306) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        recording_bus bus(&sim);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+        EXPECT_EQ(1, bus.command_transactions);
+
+        // a full frame is one window command and one data transaction
+        mgui gui(128, 64);
+        display.transfer(gui.lcd());
+        EXPECT_EQ(2, bus.command_transactions);
+        EXPECT_EQ(1, bus.data_transactions);
+        EXPECT_EQ(1024, bus.data_bytes);
+
+        // the same window again does not need the command
+        display.transfer(gui.lcd());
+        EXPECT_EQ(2, bus.command_transactions);
+        EXPECT_EQ(2, bus.data_transactions);
+
+        // a narrow window is sent page by page
+        display.transfer_window(gui.lcd(), 0, 2, 15, 5);
+        EXPECT_EQ(3, bus.command_transactions);
+        EXPECT_EQ(6, bus.data_transactions);
+        EXPECT_EQ(2048 + 64, bus.data_bytes);
+
+        // after init the window is set again
+        display.init();
+        display.transfer(gui.lcd());
+        EXPECT_EQ(5, bus.command_transactions);
+    }
+
+    TEST(Transactions, SH1106) {
+        mgui_display_simulator sim(mgui_display_controller::SH1106, 128, 64, 132, 2);
+        recording_bus bus(&sim);
+        mgui_sh1106 display(128, 64, &bus);
+        display.init();
+
+        mgui gui(128, 64);
+        bus.command_bytes.clear();
+        display.transfer(gui.lcd());
+        EXPECT_EQ(1 + 8, bus.command_transactions);
+        EXPECT_EQ(8, bus.data_transactions);
+
+        // page 0, column 2
+        ASSERT_EQ(24u, bus.command_bytes.size());
+        EXPECT_EQ(0xB0, bus.command_bytes[0]);
+        EXPECT_EQ(0x10, bus.command_bytes[1]);
+        EXPECT_EQ(0x02, bus.command_bytes[2]);
+        EXPECT_EQ(0xB7, bus.command_bytes[21]);
+    }
+
+    TEST(Transactions, HorizontalScroll) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_ssd1306 display(128, 64, &sim);
+        display.init();
+        EXPECT_FALSE(sim.scrolling());
+
+        display.set_horizontal_scroll(true, true, 7);
+        EXPECT_TRUE(sim.scrolling());
+        display.set_horizontal_scroll(false);
+        EXPECT_FALSE(sim.scrolling());
+    }
+
+    TEST(Simulator, CommandsAcrossTransactions) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+
+        // an argument may follow in the next transaction
+        const uint8_t contrast = 0x81;
+        const uint8_t value = 0x42;
+        sim.command(&contrast, 1);
+        sim.command(&value, 1);
+        EXPECT_EQ(0x42, sim.contrast());
+        EXPECT_EQ(0, sim.start_line());
+    }
+
+    TEST(Simulator, PageAddressing) {
+        mgui_display_simulator sim(mgui_display_controller::ST7565, 128, 64, 132);
+
+        // the column stops at the end of the RAM
+        const uint8_t cmds[] = { 0xB3, 0x18, 0x02 };
+        sim.command(cmds, sizeof(cmds));
+        uint8_t data[8];
+        memset(data, 0xFF, sizeof(data));
+        sim.data(data, sizeof(data));
+        EXPECT_EQ(0xFF, sim.ram(131, 3));
+        EXPECT_EQ(0x00, sim.ram(0, 4));
+        EXPECT_EQ(0xFF, sim.ram(130, 3));
+        EXPECT_EQ(0x00, sim.ram(129, 3));
+    }
+
+    static void append_order(void* context) {
+        std::vector<int>* order = (std::vector<int>*)((void**)context)[0];
+        order->push_back((int)(long)((void**)context)[1]);
+    }
+
+    TEST(Async, SameAsBlocking) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_thread_transport transport(&sim);
+        mgui_async_bus bus(&transport);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+
+        font_16x8 font;
+        mgui gui(128, 64);
+        draw_screen(&gui, &font, 2);
+        display.transfer(gui.lcd());
+        bus.wait();
+        EXPECT_FALSE(bus.busy());
+        EXPECT_TRUE(sim.power());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+    }
+
+    TEST(Async, CallbackOrder) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_thread_transport transport(&sim, 0, 0, 2);
+
+        std::vector<int> order;
+        void* contexts[8][2];
+        uint8_t bytes[8] = {};
+        for (int i = 0; i < 8; i++) {
+            contexts[i][0] = &order;
+            contexts[i][1] = (void*)(long)i;
+            // more than the capacity: submit waits for a free slot
+            transport.submit(bytes, 8, true, &append_order, contexts[i]);
+        }
+        transport.wait();
+
+        ASSERT_EQ(8u, order.size());
+        for (int i = 0; i < 8; i++) {
+            EXPECT_EQ(i, order[i]);
+        }
+        EXPECT_EQ(8, transport.transfers());
+        EXPECT_EQ(64, transport.bytes());
+    }
+
+    // Completes the transfers when the test says so, like an interrupt.
+    class manual_transport : public mgui_transport {
+    public:
+        manual_transport() : started(0) {}
+        void finish() { complete(); }
+        int started;
+
+    protected:
+        void start(const mgui_transfer*) { started++; }
+    };
+
+    TEST(Async, CompleteWithoutTransfer) {
+        manual_transport transport;
+        std::vector<int> order;
+        void* context[2] = { &order, (void*)0L };
+        uint8_t bytes[4] = {};
+
+        // a spurious interrupt leaves the queue as it is
+        transport.finish();
+        EXPECT_FALSE(transport.busy());
+        transport.submit(bytes, 4, true, &append_order, context);
+        EXPECT_EQ(1, transport.started);
+        EXPECT_TRUE(transport.busy());
+        transport.finish();
+        EXPECT_FALSE(transport.busy());
+        transport.finish();
+        EXPECT_FALSE(transport.busy());
+        ASSERT_EQ(1u, order.size());
+
+        transport.submit(bytes, 4, true);
+        EXPECT_EQ(2, transport.started);
+        transport.finish();
+        EXPECT_EQ(1u, order.size());
+        EXPECT_FALSE(transport.busy());
+    }
+
+    TEST(Async, CommandsAreCopied) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        recording_bus recorder(&sim);
+        mgui_thread_transport transport(&recorder, 200000);
+        mgui_async_bus bus(&transport);
+
+        uint8_t cmds[MGUI_TRANSFER_INLINE_BYTES * 2 + 6];
+        for (int i = 0; i < (int)sizeof(cmds); i++) {
+            cmds[i] = 0xE3; // NOP
+        }
+        cmds[sizeof(cmds) - 2] = 0x81;
+        cmds[sizeof(cmds) - 1] = 0x33;
+        bus.command(cmds, sizeof(cmds));
+
+        // the caller may reuse the bytes at once
+        memset(cmds, 0, sizeof(cmds));
+        bus.wait();
+
+        EXPECT_EQ(3, recorder.command_transactions);
+        ASSERT_EQ(sizeof(cmds), recorder.command_bytes.size());
+        EXPECT_EQ(0xE3, recorder.command_bytes[0]);
+        EXPECT_EQ(0x33, sim.contrast());
+    }
+
+    TEST(Async, TransferDoesNotWaitForTheWire) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        // about 50 ms for a frame
+        mgui_thread_transport transport(&sim, 20000);
+        mgui_async_bus bus(&transport);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+        bus.wait();
+
+        mgui gui(128, 64);
+        gui.lcd()[5] = 0xA5;
+        const auto begin = std::chrono::steady_clock::now();
+        display.transfer(gui.lcd());
+        const auto queued = std::chrono::steady_clock::now();
+        bus.wait();
+        const auto sent = std::chrono::steady_clock::now();
+
+        EXPECT_LT(queued - begin, std::chrono::milliseconds(25));
+        EXPECT_GE(sent - begin, std::chrono::milliseconds(45));
+        EXPECT_EQ(0xA5, sim.ram(5, 0));
+    }
+
+    static void draw_frame(mgui* gui, mgui_rectangle* rect, int frame) {
+        rect->set_x(frame * 3);
+        rect->set_y(frame);
+        gui->update_lcd();
+    }
+
+    TEST(Pipeline, DoubleBuffer) {
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        rect.set_fill(true);
+
+        mgui single(128, 64);
+        single.add((mgui_object*)&rect);
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&rect);
+        gui.set_double_buffer(true);
+        EXPECT_TRUE(gui.double_buffer());
+
+        uint8_t* previous = nullptr;
+        for (int frame = 0; frame < 4; frame++) {
+            draw_frame(&single, &rect, frame);
+            draw_frame(&gui, &rect, frame);
+            EXPECT_EQ(0, memcmp(single.lcd(), gui.lcd(), 1024)) << frame;
+
+            // the buffers take turns
+            EXPECT_NE(previous, gui.lcd());
+            previous = gui.lcd();
+        }
+
+        // the last frame is kept in a single buffer
+        gui.set_double_buffer(false);
+        EXPECT_FALSE(gui.double_buffer());
+        EXPECT_EQ(0, memcmp(single.lcd(), gui.lcd(), 1024));
+    }
+
+    TEST(Pipeline, DoubleBufferRotated) {
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        rect.set_fill(true);
+
+        mgui single(128, 64);
+        single.set_rotation(mgui_rotation::Rotate90);
+        single.add((mgui_object*)&rect);
+        mgui gui(128, 64);
+        gui.set_double_buffer(true);
+        gui.set_rotation(mgui_rotation::Rotate90);
+        gui.add((mgui_object*)&rect);
+
+        for (int frame = 0; frame < 3; frame++) {
+            draw_frame(&single, &rect, frame);
+            draw_frame(&gui, &rect, frame);
+            EXPECT_EQ(0, memcmp(single.lcd(), gui.lcd(), 1024)) << frame;
+        }
+    }
+
+    TEST(Pipeline, DoubleBufferMulti) {
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        rect.set_fill(true);
+
+        mgui_multi gui(128, 64);
+        gui.set_double_buffer(true);
+        gui.add("main", (mgui_object*)&rect);
+        gui.update_lcd();
+        uint8_t* shown = gui.lcd();
+        EXPECT_EQ(0xFF, shown[0]);
+
+        // without the group the shown frame stays
+        gui.clear("main");
+        gui.update_lcd();
+        EXPECT_EQ(shown, gui.lcd());
+        EXPECT_EQ(0xFF, gui.lcd()[0]);
+    }
+
+    TEST(Pipeline, DrawWhileSending) {
+        mgui_display_simulator sim(mgui_display_controller::SH1106, 128, 64, 132, 2);
+        mgui_thread_transport transport(&sim, 400000, 50);
+        mgui_async_bus bus(&transport);
+        mgui_sh1106 display(128, 64, &bus);
+        display.init();
+
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        rect.set_fill(true);
+        mgui gui(128, 64);
+        gui.set_double_buffer(true);
+        gui.add((mgui_object*)&rect);
+
+        // frame N + 1 is drawn while frame N is on the wire
+        for (int frame = 0; frame < 6; frame++) {
+            draw_frame(&gui, &rect, frame);
+            bus.wait();
+            display.transfer(gui.lcd());
+        }
+        bus.wait();
+
+        mgui single(128, 64);
+        single.add((mgui_object*)&rect);
+        draw_frame(&single, &rect, 5);
+        EXPECT_TRUE(sim.equals(single.lcd()));
+    }
+
+    TEST(BusModel, WireTime) {
+        // 1024 bytes + address + control, 9 clocks each, and 3 clocks of overhead
+        const mgui_bus_model i2c = mgui_bus_model::i2c(400000);
+        EXPECT_EQ(1026LL * 9 * 2500 + 3 * 2500, i2c.transaction_ns(1024));
+        EXPECT_EQ(mgui_bus_type::I2C, i2c.type());
+
+        const mgui_bus_model slow = mgui_bus_model::i2c(100000);
+        EXPECT_EQ(4 * i2c.transaction_ns(1024), slow.transaction_ns(1024));
+
+        const mgui_bus_model spi = mgui_bus_model::spi(8);
+        EXPECT_EQ(1024LL * 1000 + 200, spi.transaction_ns(1024));
+        EXPECT_EQ(8000000, spi.clock_hz());
+
+        const mgui_bus_model custom(mgui_bus_type::SPI, 1000000, 0);
+        EXPECT_EQ(8000, custom.transaction_ns(1));
+    }
+
+    TEST(RecordingBus, Transactions) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus bus(mgui_bus_model::i2c(1000000), &sim);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+
+        mgui gui(128, 64);
+        gui.lcd()[130] = 0x3C;
+        display.transfer(gui.lcd());
+        bus.mark_frame();
+
+        EXPECT_EQ(3, bus.transactions());
+        EXPECT_EQ(2, bus.command_transactions());
+        EXPECT_EQ(1, bus.data_transactions());
+        EXPECT_EQ(1024, bus.data_bytes());
+        EXPECT_EQ(0x3C, sim.ram(2, 1));
+
+        // the window command and the frame
+        ASSERT_EQ(3, bus.count());
+        EXPECT_FALSE(bus.get(1).data);
+        EXPECT_EQ(6, bus.get(1).length);
+        EXPECT_EQ(0x21, bus.bytes(1)[0]);
+        EXPECT_TRUE(bus.get(2).data);
+        EXPECT_EQ(0x3C, bus.bytes(2)[130]);
+
+        long long total = 0;
+        for (int i = 0; i < bus.count(); i++) {
+            total += bus.get(i).wire_ns;
+        }
+        EXPECT_EQ(total, bus.wire_ns());
+        ASSERT_EQ(1, bus.frame_count());
+        EXPECT_EQ(total, bus.frame_ns(0));
+
+        bus.reset();
+        EXPECT_EQ(0, bus.transactions());
+        EXPECT_EQ(0, bus.wire_ns());
+        EXPECT_EQ(0, bus.frame_count());
+    }
+
+    TEST(RecordingBus, CountersOnly) {
+        mgui_recording_bus bus(mgui_bus_model::spi(10), nullptr, false);
+        mgui_st7565 display(128, 64, &bus);
+        mgui gui(128, 64);
+        display.transfer(gui.lcd());
+        bus.mark_frame();
+        display.transfer(gui.lcd());
+        bus.mark_frame();
+
+        EXPECT_EQ(0, bus.count());
+        EXPECT_EQ(32, bus.transactions());
+        EXPECT_EQ(2 * (8 * 3), bus.command_bytes());
+        EXPECT_EQ(2, bus.frame_count());
+        EXPECT_DOUBLE_EQ(bus.wire_ms() / 2, bus.frame_ms());
+    }
+
+    class DiffTest : public testing::TestWithParam<std::tuple<mgui_display_controller, bool>> {};
+
+    TEST_P(DiffTest, SameAsFull) {
+        const mgui_display_controller controller = std::get<0>(GetParam());
+        const bool per_page = std::get<1>(GetParam());
+        const int columns = (controller == mgui_display_controller::SSD1306) ? 128 : 132;
+        mgui_display_simulator sim(controller, 128, 64, columns);
+        mgui_recording_bus bus(mgui_bus_model::i2c(400000), &sim);
+        mgui_display* display;
+        if (controller == mgui_display_controller::SSD1306) {
+            display = new mgui_ssd1306(128, 64, &bus);
+        } else {
+            display = new mgui_sh1106(128, 64, &bus, 0);
+        }
+        display->init();
+
+        font_16x8 font;
+        mgui gui(128, 64);
+        draw_screen(&gui, &font, 0);
+        display->transfer(gui.lcd());
+        std::vector<uint8_t> shown(gui.lcd(), gui.lcd() + 1024);
+        const long long full_ns = bus.wire_ns();
+
+        // nothing to send
+        bus.reset();
+        EXPECT_FALSE(display->transfer_diff(gui.lcd(), shown.data(), per_page));
+        EXPECT_EQ(0, bus.transactions());
+
+        for (int shift = 1; shift < 4; shift++) {
+            draw_screen(&gui, &font, shift);
+            bus.reset();
+            EXPECT_TRUE(display->transfer_diff(gui.lcd(), shown.data(), per_page));
+            EXPECT_TRUE(sim.equals(gui.lcd()));
+            EXPECT_LT(bus.data_bytes(), 1024);
+            EXPECT_LT(bus.wire_ns(), full_ns);
+            shown.assign(gui.lcd(), gui.lcd() + 1024);
+        }
+
+        // a single byte
+        gui.lcd()[3 * 128 + 77] ^= 0x10;
+        bus.reset();
+        display->transfer_diff(gui.lcd(), shown.data(), per_page);
+        EXPECT_EQ(1, bus.data_bytes());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+
+        delete display;
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Strategies,
+        DiffTest,
+        testing::Combine(
+            testing::Values(mgui_display_controller::SSD1306, mgui_display_controller::SH1106),
+            testing::Bool()
+        )
+    );
+
+    // Runs the frames and sends those which changed; it returns the number of frames sent.
+    template <typename Gui>
+    static int run_adaptive(Gui* gui, mgui_display* display, int frames) {
+        int sent = 0;
+        for (int i = 0; i < frames; i++) {
+            if (gui->update_lcd()) {
+                display->transfer(gui->lcd());
+                sent++;
+            }
+        }
+        return sent;
+    }
+
+    static int encoder = 0;
+
+    static void read_encoder(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = encoder;
+    }
+
+    static void select_handler(mgui_ui_group* sender, const mgui_input_state state[], mgui_string*) {
+        sender->set_on_select_prev(state[0].value_1 < 0);
+        sender->set_on_select_next(state[0].value_1 > 0);
+    }
+
+    // Two buttons selected by the encoder
+    struct button_screen {
+        button_screen()
+         : gui(128, 64), first(10, 2), second(64, 2), first_text(&font, "first"), second_text(&font, "second") {
+            gui.input()->add(&read_encoder);
+            first.set_text(&first_text);
+            second.set_text(&second_text);
+            group.add(&first);
+            group.add(&second);
+            group.set_input_event_handler(&select_handler);
+            gui.add("main", (mgui_object*)&group);
+        }
+
+        font_16x8 font;
+        mgui_multi gui;
+        mgui_button first, second;
+        mgui_text first_text, second_text;
+        mgui_ui_group group;
+    };
+
+    TEST(AdaptiveRefresh, IdleScreenSendsNothing) {
+        for (int double_buffer = 0; double_buffer < 2; double_buffer++) {
+            mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+            mgui_recording_bus bus(mgui_bus_model::i2c(400000), &sim);
+            mgui_ssd1306 display(128, 64, &bus);
+            display.init();
+
+            button_screen screen;
+            screen.gui.set_double_buffer(double_buffer != 0);
+            screen.gui.set_adaptive_refresh(true);
+            EXPECT_TRUE(screen.gui.adaptive_refresh());
+
+            // the first frame is sent
+            EXPECT_EQ(1, run_adaptive(&screen.gui, &display, 1)) << double_buffer;
+            EXPECT_TRUE(sim.equals(screen.gui.lcd()));
+
+            bus.reset();
+            EXPECT_EQ(0, run_adaptive(&screen.gui, &display, 100)) << double_buffer;
+            EXPECT_EQ(0, bus.transactions());
+            EXPECT_FALSE(screen.gui.input_active());
+            EXPECT_FALSE(screen.gui.animating());
+
+            // the encoder selects the next button, and its release draws the same frame
+            encoder = 1;
+            EXPECT_EQ(1, run_adaptive(&screen.gui, &display, 1)) << double_buffer;
+            EXPECT_TRUE(screen.gui.input_active());
+            encoder = 0;
+            EXPECT_EQ(0, run_adaptive(&screen.gui, &display, 1)) << double_buffer;
+            EXPECT_TRUE(screen.gui.input_active());
+            EXPECT_EQ(0, run_adaptive(&screen.gui, &display, 10)) << double_buffer;
+            EXPECT_EQ(1, bus.data_transactions());
+            EXPECT_TRUE(sim.equals(screen.gui.lcd()));
+
+            // a change outside of the handlers
+            screen.second_text.set_text("third");
+            EXPECT_EQ(0, run_adaptive(&screen.gui, &display, 1));
+            screen.gui.invalidate();
+            EXPECT_EQ(1, run_adaptive(&screen.gui, &display, 1));
+            EXPECT_TRUE(sim.equals(screen.gui.lcd()));
+        }
+    }
+
+    TEST(AdaptiveRefresh, SameFramesAsFullRefresh) {
+        button_screen adaptive;
+        adaptive.gui.set_adaptive_refresh(true);
+        button_screen full;
+
+        // reported only when the frame differs from the last one (the second button is the last)
+        const int deltas[] = { 0, 1, 0, 0, -1, 0, 1, 1, 0, 0, 0, -1, 0 };
+        std::vector<uint8_t> last;
+        for (int i = 0; i < (int)(sizeof(deltas) / sizeof(deltas[0])); i++) {
+            encoder = deltas[i];
+            EXPECT_TRUE(full.gui.update_lcd());
+            const bool changed = adaptive.gui.update_lcd();
+            EXPECT_EQ(0, memcmp(full.gui.lcd(), adaptive.gui.lcd(), 1024)) << i;
+            EXPECT_EQ(last.empty() || memcmp(last.data(), full.gui.lcd(), 1024) != 0, changed) << i;
+            last.assign(full.gui.lcd(), full.gui.lcd() + 1024);
+        }
+        encoder = 0;
+    }
+
+    TEST(AdaptiveRefresh, AnimationSendsOnlyChanges) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus bus(mgui_bus_model::i2c(400000), &sim);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+
+        font_16x8 font;
+        mgui_text text(&font, "This is long text sample.");
+        text.set_view_width(64);
+        text.set_view_height(font.height());
+        text.set_move(true, 3);
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&text);
+        gui.set_adaptive_refresh(true);
+        EXPECT_EQ(1, run_adaptive(&gui, &display, 1));
+        EXPECT_TRUE(gui.animating());
+
+        // drawn in every frame, but moved every few frames
+        bus.reset();
+        const int sent = run_adaptive(&gui, &display, 40);
+        EXPECT_GT(sent, 5);
+        EXPECT_LT(sent, 20);
+        EXPECT_EQ(sent, bus.data_transactions());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+
+        // a stopped text is not drawn again
+        text.set_move(false);
+        gui.invalidate();
+        EXPECT_EQ(1, run_adaptive(&gui, &display, 1));
+        EXPECT_FALSE(gui.animating());
+        EXPECT_EQ(0, run_adaptive(&gui, &display, 10));
+    }
+
+    TEST(AdaptiveRefresh, FullRefreshAlwaysReports) {
+        mgui gui(128, 64);
+        EXPECT_FALSE(gui.adaptive_refresh());
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_TRUE(gui.update_lcd());
+
+        // without a group the shown frame is kept
+        mgui_multi multi(128, 64);
+        EXPECT_FALSE(multi.update_lcd());
+    }
+
+    static unsigned long fake_us = 0;
+    static unsigned long fake_clock() { return fake_us; }
+
+    TEST(IdlePower, DimOffAndWake) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus bus(mgui_bus_model::i2c(400000), &sim);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+
+        fake_us = 1000;
+        mgui_idle_power power(&display, &fake_clock, 0xC0);
+        power.set_dim(5000, 0x10);
+        power.set_off(20000);
+        bus.reset();
+
+        fake_us += 4999 * 1000;
+        EXPECT_FALSE(power.update(false));
+        EXPECT_EQ(mgui_power_state::On, power.state());
+        EXPECT_EQ(0, bus.transactions());
+
+        fake_us += 1000;
+        EXPECT_FALSE(power.update(false));
+        EXPECT_EQ(mgui_power_state::Dimmed, power.state());
+        EXPECT_EQ(0x10, sim.contrast());
+        EXPECT_TRUE(power.on());
+
+        // the commands are sent once
+        const int commands = bus.command_transactions();
+        EXPECT_FALSE(power.update(false));
+        EXPECT_EQ(commands, bus.command_transactions());
+
+        // an input restores the contrast without sending the frame
+        EXPECT_FALSE(power.update(true));
+        EXPECT_EQ(mgui_power_state::On, power.state());
+        EXPECT_EQ(0xC0, sim.contrast());
+
+        fake_us += 20000 * 1000;
+        EXPECT_FALSE(power.update(false));
+        EXPECT_EQ(mgui_power_state::Off, power.state());
+        EXPECT_FALSE(sim.power());
+        EXPECT_FALSE(power.on());
+        EXPECT_EQ(0, bus.data_transactions());
+
+        // turned on again by an input: the frame needs to be sent
+        fake_us += 1000;
+        EXPECT_TRUE(power.update(true));
+        EXPECT_TRUE(sim.power());
+        EXPECT_EQ(0xC0, sim.contrast());
+        EXPECT_EQ(mgui_power_state::On, power.state());
+    }
+
+    TEST(IdlePower, ClockWraps) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_ssd1306 display(128, 64, &sim);
+        display.init();
+
+        fake_us = 0xFFFFFFFFUL - 1000;
+        mgui_idle_power power(&display, &fake_clock);
+        power.set_off(10);
+        fake_us = 5000;
+        EXPECT_FALSE(power.update(false));
+        EXPECT_EQ(mgui_power_state::On, power.state());
+        fake_us = 9002;
+        power.update(false);
+        EXPECT_EQ(mgui_power_state::Off, power.state());
+    }
+
+    TEST(FrameExchange, HandsOverInOrder) {
+        uint8_t a = 0, b = 0, c = 0;
+        mgui_frame_exchange<2> exchange;
+        EXPECT_TRUE(exchange.empty());
+        EXPECT_EQ(nullptr, exchange.peek());
+
+        EXPECT_TRUE(exchange.publish(&a));
+        EXPECT_TRUE(exchange.publish(&b));
+        EXPECT_TRUE(exchange.full());
+        EXPECT_FALSE(exchange.publish(&c));
+        EXPECT_EQ(2, exchange.count());
+
+        // a frame is kept until it is released
+        EXPECT_EQ(&a, exchange.peek());
+        EXPECT_EQ(&a, exchange.peek());
+        exchange.release();
+        EXPECT_EQ(&b, exchange.peek());
+        EXPECT_TRUE(exchange.publish(&c));
+        exchange.release();
+        EXPECT_EQ(&c, exchange.peek());
+        exchange.release();
+        EXPECT_TRUE(exchange.empty());
+    }
+
+    static mgui_rectangle* moving = nullptr;
+    static int render_ms = 0;
+
+    // Moves the rectangle, then spends the render time like slow objects.
+    static void move_rectangle(int frame) {
+        moving->set_x((frame * 5) % 100);
+        moving->set_y(frame % 50);
+        if (render_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(render_ms));
+        }
+    }
+
+    TEST(RenderPipeline, EveryFrameIsSentWhole) {
+        const int frames = 24;
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus bus(mgui_bus_model::i2c(1000000), &sim);
+        bus.set_realtime(true);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+        bus.reset();
+
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        rect.set_fill(true);
+        moving = &rect;
+        render_ms = 0;
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&rect);
+
+        mgui_thread_pipeline<mgui> pipeline(&gui, &display);
+        EXPECT_TRUE(gui.double_buffer());
+        pipeline.run(frames, &move_rectangle);
+        EXPECT_TRUE(pipeline.drained());
+        EXPECT_EQ((uint32_t)frames, pipeline.rendered());
+        EXPECT_EQ((uint32_t)frames, pipeline.transmitted());
+        EXPECT_EQ(frames * 1024LL, bus.data_bytes());
+
+        // the frames on the wire are the frames drawn one by one
+        mgui single(128, 64);
+        single.add((mgui_object*)&rect);
+        std::vector<uint8_t> wire;
+        for (int i = 0; i < bus.count(); i++) {
+            if (bus.get(i).data) {
+                wire.insert(wire.end(), bus.bytes(i), bus.bytes(i) + bus.get(i).length);
+            }
+        }
+        for (int frame = 0; frame < frames; frame++) {
+            move_rectangle(frame);
+            single.update_lcd();
+            EXPECT_EQ(0, memcmp(single.lcd(), wire.data() + frame * 1024, 1024)) << frame;
+        }
+        EXPECT_TRUE(sim.equals(single.lcd()));
+    }
+
+    TEST(RenderPipeline, AdaptiveRefreshSendsOnlyChanges) {
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_ssd1306 display(128, 64, &sim);
+        display.init();
+
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        moving = &rect;
+        render_ms = 0;
+        mgui gui(128, 64);
+        gui.set_adaptive_refresh(true);
+        gui.add((mgui_object*)&rect);
+
+        // nothing moves after the first frame
+        mgui_thread_pipeline<mgui> pipeline(&gui, &display);
+        pipeline.run(10);
+        EXPECT_EQ(1u, pipeline.rendered());
+        EXPECT_EQ(1u, pipeline.transmitted());
+        EXPECT_TRUE(sim.equals(gui.lcd()));
+    }
+
+    TEST(RenderPipeline, FrameTimeIsTheSlowerStage) {
+        const int frames = 12;
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        // about 9 ms for a frame on the wire, and 8 ms to draw it
+        mgui_recording_bus bus(mgui_bus_model::i2c(1000000), &sim, false);
+        bus.set_realtime(true);
+        mgui_ssd1306 display(128, 64, &bus);
+        display.init();
+
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        moving = &rect;
+        render_ms = 8;
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&rect);
+
+        const auto serial_begin = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            move_rectangle(frame);
+            gui.update_lcd();
+            display.transfer(gui.lcd());
+        }
+        const auto serial = std::chrono::steady_clock::now() - serial_begin;
+
+        mgui_thread_pipeline<mgui> pipeline(&gui, &display);
+        const auto pipelined_begin = std::chrono::steady_clock::now();
+        pipeline.run(frames, &move_rectangle);
+        const auto pipelined = std::chrono::steady_clock::now() - pipelined_begin;
+        render_ms = 0;
+
+        EXPECT_EQ((uint32_t)frames, pipeline.transmitted());
+        EXPECT_GE(serial, std::chrono::milliseconds(frames * 17));
+        EXPECT_LT(pipelined * 4, serial * 3);
+    }
+
+    // Two rectangles on a canvas, one in each half, drawn again at an offset for a display.
+    struct canvas_scene {
+        canvas_scene(int width, int height, int offset_x = 0, int offset_y = 0) : gui(width, height) {
+            top.set_width(30);
+            top.set_height(12);
+            top.set_fill(true);
+            bottom.set_width(20);
+            bottom.set_height(9);
+            bottom.set_fill(true);
+            move(offset_x, offset_y, 12, 10);
+            gui.add((mgui_object*)&top);
+            gui.add((mgui_object*)&bottom);
+        }
+
+        void move(int offset_x, int offset_y, int top_x, int bottom_x) {
+            top.set_x(top_x - offset_x);
+            top.set_y(5 - offset_y);
+            bottom.set_x(bottom_x - offset_x);
+            bottom.set_y(70 - offset_y);
+        }
+
+        mgui gui;
+        mgui_rectangle top, bottom;
+    };
+
+    TEST(DisplaySet, RegionsOfOneCanvas) {
+        mgui_display_simulator main_sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus main_bus(mgui_bus_model::i2c(400000), &main_sim);
+        mgui_ssd1306 main_display(128, 64, &main_bus);
+        main_display.init();
+        mgui_display_simulator status_sim(mgui_display_controller::SH1106, 128, 32, 132, 2);
+        mgui_recording_bus status_bus(mgui_bus_model::i2c(400000), &status_sim);
+        mgui_sh1106 status_display(128, 32, &status_bus);
+        status_display.init();
+
+        canvas_scene scene(128, 128);
+        mgui_display_set set(128, 128);
+        EXPECT_EQ(0, set.add(&main_display));
+        EXPECT_EQ(1, set.add(&status_display, 0, 64));
+        EXPECT_EQ(2, set.count());
+
+        scene.gui.update_lcd();
+        EXPECT_EQ(2, set.present(scene.gui.lcd()));
+        canvas_scene main_expected(128, 64);
+        main_expected.gui.update_lcd();
+        EXPECT_TRUE(main_sim.equals(main_expected.gui.lcd()));
+        canvas_scene status_expected(128, 32, 0, 64);
+        status_expected.gui.update_lcd();
+        EXPECT_TRUE(status_sim.equals(status_expected.gui.lcd()));
+
+        // nothing changed
+        main_bus.reset();
+        status_bus.reset();
+        scene.gui.update_lcd();
+        EXPECT_EQ(0, set.present(scene.gui.lcd()));
+        EXPECT_EQ(0, main_bus.transactions() + status_bus.transactions());
+
+        // a change on the status region is sent only to the status display
+        scene.move(0, 0, 12, 40);
+        scene.gui.update_lcd();
+        EXPECT_EQ(1, set.present(scene.gui.lcd()));
+        EXPECT_FALSE(set.sent(0));
+        EXPECT_TRUE(set.sent(1));
+        EXPECT_EQ(0, main_bus.transactions());
+        EXPECT_GT(status_bus.data_transactions(), 0);
+        status_expected.move(0, 64, 12, 40);
+        status_expected.gui.update_lcd();
+        EXPECT_TRUE(status_sim.equals(status_expected.gui.lcd()));
+        EXPECT_EQ(1, set.transfers(0));
+        EXPECT_EQ(2, set.transfers(1));
+    }
+
+    TEST(DisplaySet, UnalignedRegion) {
+        const int offsets[][2] = { { 10, 4 }, { 0, 3 }, { 7, 61 }, { -6, -5 } };
+        for (const auto& offset : offsets) {
+            mgui_display_simulator sim(mgui_display_controller::SSD1306, 64, 48);
+            mgui_ssd1306 display(64, 48, &sim);
+            display.init();
+
+            canvas_scene scene(128, 128);
+            mgui_display_set set(128, 128);
+            set.add(&display, offset[0], offset[1], false);
+            scene.gui.update_lcd();
+            set.present(scene.gui.lcd());
+
+            canvas_scene expected(64, 48, offset[0], offset[1]);
+            expected.gui.update_lcd();
+            EXPECT_TRUE(sim.equals(expected.gui.lcd())) << offset[0] << ", " << offset[1];
+        }
+    }
+
+    static bool same_ram(const mgui_display_simulator& a, const mgui_display_simulator& b) {
+        for (int page = 0; page < a.height() / 8; page++) {
+            for (int column = 0; column < a.width(); column++) {
+                if (a.ram(column, page) != b.ram(column, page)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    TEST(DisplaySet, MirrorIsSentNotDrawn) {
+        mgui_display_simulator source_sim(mgui_display_controller::SSD1306, 64, 32);
+        mgui_display_simulator mirror_sim(mgui_display_controller::SSD1306, 64, 32);
+        mgui_display_simulator large_sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_recording_bus mirror_bus(mgui_bus_model::i2c(400000), &mirror_sim);
+        mgui_ssd1306 source(64, 32, &source_sim);
+        mgui_ssd1306 mirror(64, 32, &mirror_bus);
+        mgui_ssd1306 large(128, 64, &large_sim);
+        source.init();
+        mirror.init();
+        large.init();
+
+        mgui_multi gui(128, 128);
+        gui.set_adaptive_refresh(true);
+        mgui_rectangle rect;
+        rect.set_x(20);
+        rect.set_y(10);
+        rect.set_width(30);
+        rect.set_height(20);
+        gui.add("main", (mgui_object*)&rect);
+
+        mgui_display_set set(128, 128, 2);
+        EXPECT_EQ(0, set.add(&source, 16, 4));
+        EXPECT_EQ(-1, set.add_mirror(&large, 0));
+        EXPECT_EQ(-1, set.add_mirror(&mirror, 1));
+        EXPECT_EQ(1, set.add_mirror(&mirror, 0));
+        EXPECT_EQ(-1, set.add(&large));
+
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(2, set.present(gui.lcd()));
+        EXPECT_TRUE(same_ram(source_sim, mirror_sim));
+        EXPECT_EQ(0xFF, source_sim.ram(4, 0) | source_sim.ram(4, 1));
+
+        // a frame skipped by the adaptive refresh is not presented
+        mirror_bus.reset();
+        EXPECT_FALSE(gui.update_lcd());
+
+        // a mirror which was off is sent in full when it is enabled again
+        set.set_enabled(1, false);
+        EXPECT_FALSE(set.enabled(1));
+        rect.set_x(24);
+        gui.invalidate();
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(1, set.present(gui.lcd()));
+        EXPECT_EQ(0, mirror_bus.transactions());
+        EXPECT_FALSE(same_ram(source_sim, mirror_sim));
+        set.set_enabled(1, true);
+        EXPECT_EQ(1, set.present(gui.lcd()));
+        EXPECT_TRUE(set.sent(1));
+        EXPECT_EQ(64 * 4, mirror_bus.data_bytes());
+        EXPECT_TRUE(same_ram(source_sim, mirror_sim));
+
+        // forced
+        EXPECT_EQ(2, set.present(gui.lcd(), true));
+        set.invalidate(0);
+        EXPECT_EQ(1, set.present(gui.lcd()));
+    }
+
+    TEST(DisplaySet, MirrorOfDisabledSource) {
+        mgui_display_simulator source_sim(mgui_display_controller::SSD1306, 64, 32);
+        mgui_display_simulator mirror_sim(mgui_display_controller::SSD1306, 64, 32);
+        mgui_ssd1306 source(64, 32, &source_sim);
+        mgui_ssd1306 mirror(64, 32, &mirror_sim);
+        source.init();
+        mirror.init();
+
+        mgui gui(128, 128);
+        mgui_rectangle rect;
+        rect.set_x(20);
+        rect.set_y(10);
+        rect.set_width(30);
+        rect.set_height(20);
+        gui.add((mgui_object*)&rect);
+
+        mgui_display_set set(128, 128, 2);
+        set.add(&source, 16, 4);
+        set.add_mirror(&mirror, 0);
+        gui.update_lcd();
+        EXPECT_EQ(2, set.present(gui.lcd()));
+
+        // the mirror copies the region itself while its source is off
+        set.set_enabled(0, false);
+        rect.set_x(24);
+        gui.update_lcd();
+        EXPECT_EQ(1, set.present(gui.lcd()));
+        EXPECT_TRUE(set.sent(1));
+        EXPECT_FALSE(same_ram(source_sim, mirror_sim));
+
+        set.set_enabled(0, true);
+        EXPECT_EQ(1, set.present(gui.lcd()));
+        EXPECT_TRUE(set.sent(0));
+        EXPECT_FALSE(set.sent(1));
+        EXPECT_TRUE(same_ram(source_sim, mirror_sim));
+    }
+}
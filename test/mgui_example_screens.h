@@ -0,0 +1,253 @@
+// The screens of the Raspberry Pi Pico example (example/mgui-rp2040) with scripted inputs.
+#ifndef MGUI_EXAMPLE_SCREENS_H
+#define MGUI_EXAMPLE_SCREENS_H
+
+#include <string.h>
+
+#include "../mGUI/mgui.h"
+#include "font_16x8.h"
+
+namespace Example {
+
+    // input 0: button (1 while pressed), input 1: encoder (delta)
+    // The readers and the handlers are functions without a context, so the inputs and the
+    // button states of the handlers are not per instance. They are only thread_local:
+    // one instance of screens may be used at a time on each thread, and instances that
+    // are interleaved on one thread still share them.
+    static thread_local int button = 0;
+    static thread_local int encoder = 0;
+
+    static void read_button(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = button;
+    }
+
+    static void read_encoder(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = encoder;
+    }
+
+    static void menu_handler(mgui_menu* sender, const mgui_input_state state[], mgui_string*) {
+        sender->set_on_enter(state[0].value_1);
+
+        int delta = state[1].value_1;
+        sender->set_on_select_prev(delta < 0);
+        sender->set_on_select_next(delta > 0);
+    }
+
+    static void scroll_handler(mgui_vertical_scrollbar* sender, const mgui_input_state state[], mgui_string*) {
+        int delta = state[1].value_1;
+        sender->set_on_select_prev(delta < 0);
+        sender->set_on_select_next(delta > 0);
+    }
+
+    static void menu_return_handler(const mgui_menu_item*, const mgui_input_state state[], mgui_string* current_group) {
+        static thread_local int button_state = state[0].value_1;
+
+        // 0 -> 1 edge
+        if (button_state < state[0].value_1) {
+            *current_group = "main";
+        }
+        button_state = state[0].value_1;
+    }
+
+    static void button_group_handler(mgui_ui_group* sender, const mgui_input_state state[], mgui_string*) {
+        sender->set_on_press(state[0].value_1);
+
+        int delta = state[1].value_1;
+        sender->set_on_select_prev(delta < 0);
+        sender->set_on_select_next(delta > 0);
+    }
+
+    static void move_to(const mgui_input_state state[], mgui_string* current_group, int* button_state, const char* group) {
+        // 0 -> 1 edge
+        if (*button_state < state[0].value_1) {
+            *current_group = group;
+        }
+        *button_state = state[0].value_1;
+    }
+
+    static void move_to_menu(const mgui_button*, const mgui_input_state state[], mgui_string* current_group) {
+        static thread_local int button_state = state[0].value_1;
+        move_to(state, current_group, &button_state, "menu");
+    }
+
+    static void move_to_image(const mgui_button*, const mgui_input_state state[], mgui_string* current_group) {
+        static thread_local int button_state = state[0].value_1;
+        move_to(state, current_group, &button_state, "image");
+    }
+
+    static void move_to_text(const mgui_button*, const mgui_input_state state[], mgui_string* current_group) {
+        static thread_local int button_state = state[0].value_1;
+        move_to(state, current_group, &button_state, "text");
+    }
+
+    static const uint8_t image_data[32 * 32 / 8] = {};
+
+    // test_menu, test_text, test_image and test_main of the example on a 128x64 display
+    struct screens {
+        screens()
+         : gui(128, 64),
+           text1(&font, "Item 1"), text2(&font, "Check"), text3(&font, "Menu"),
+           text3_1(&font, "Back"), text3_2(&font, "Child 2"), text4(&font, "1234567890abcdefghij"),
+           text5(&font, "Item 5"), text6(&font, "Item 6"), text7(&font, "Item 7"), text8(&font, "Return"),
+           item1(&text1), item2(&text2), item3(&text3), item3_1(&text3_1), item3_2(&text3_2), item4(&text4),
+           item_menu3(128, 64), menu(112, 64), scroll(113, 0, 14, 64, 8),
+           text_return(&font, "Return"), text_menu(128, 64),
+           long_text(&font, "This is long text sample."), long_text2(&font, "This is long text sample."),
+           image_return(&font, "Return"), image_menu(128, 64), image_prop(32, 32, image_data), image(&image_prop, 48, 20),
+           button_menu(10, 2), button_image(64, 2), button_text(10, 24),
+           menu_text(&font, "menu"), image_text(&font, "image"), texts_text(&font, "texts") {
+            button = 0;
+            encoder = 0;
+            gui.input()->add(&read_button);
+            gui.input()->add(&read_encoder);
+
+            // test_menu
+            item2.set_check(false);
+            item3_1.set_return_menu(true);
+            item_menu3.add(&item3_1);
+            item_menu3.add(&item3_2);
+            item_menu3.add(&item3_3);
+            item3.set_menu(item_menu3.get_property());
+            text4.set_move(true);
+            item5.set_text(&text5);
+            item6.set_text(&text6);
+            item7.set_text(&text7);
+            item8.set_text(&text8);
+            item8.set_input_event_handler(&menu_return_handler);
+            menu.set_input_event_handler(&menu_handler);
+            mgui_menu_item* items[] = { &item1, &item2, &item3, &item4, &item5, &item6, &item7, &item8 };
+            for (mgui_menu_item* item : items) {
+                menu.add(item);
+            }
+            gui.add("menu", (mgui_object*)&menu);
+            scroll.set_input_event_handler(&scroll_handler);
+            gui.add("menu", (mgui_object*)&scroll);
+
+            // test_text
+            item_text_return.set_text(&text_return);
+            item_text_return.set_input_event_handler(&menu_return_handler);
+            text_menu.set_input_event_handler(&menu_handler);
+            text_menu.add(&item_text_return);
+            gui.add("text", (mgui_object*)&text_menu);
+            long_text.set_y(16);
+            long_text.set_view_height(font.height());
+            long_text.set_view_width(128);
+            long_text.set_move(true, 2);
+            gui.add("text", (mgui_object*)&long_text);
+            long_text2.set_x(32);
+            long_text2.set_y(32);
+            long_text2.set_view_height(font.height());
+            long_text2.set_view_width(64);
+            long_text2.set_move(true);
+            gui.add("text", (mgui_object*)&long_text2);
+
+            // test_image
+            item_image_return.set_text(&image_return);
+            item_image_return.set_input_event_handler(&menu_return_handler);
+            image_menu.set_input_event_handler(&menu_handler);
+            image_menu.add(&item_image_return);
+            gui.add("image", (mgui_object*)&image_menu);
+            gui.add("image", (mgui_object*)&image);
+
+            // test_main
+            button_menu.set_text(&menu_text);
+            button_menu.set_padding(4, 0, 4, 0);
+            button_menu.set_input_event_handler(&move_to_menu);
+            button_image.set_text(&image_text);
+            button_image.set_padding(4, 0, 4, 0);
+            button_image.set_input_event_handler(&move_to_image);
+            button_text.set_text(&texts_text);
+            button_text.set_padding(4, 0, 4, 0);
+            button_text.set_input_event_handler(&move_to_text);
+            group.add(&button_menu);
+            group.add(&button_image);
+            group.add(&button_text);
+            group.set_input_event_handler(&button_group_handler);
+            gui.add("main", (mgui_object*)&group);
+
+            gui.select("main");
+        }
+
+        // A frame with the input, then a frame without it.
+        void step(int pressed, int delta) {
+            button = pressed;
+            encoder = delta;
+            gui.update_lcd();
+            button = 0;
+            encoder = 0;
+            gui.update_lcd();
+        }
+
+        void press() { step(1, 0); }
+
+        void turn(int delta) {
+            for (; delta > 0; delta--) step(0, 1);
+            for (; delta < 0; delta++) step(0, -1);
+        }
+
+        bool shown(const char* group) const { return strcmp(gui.selected().c_str(), group) == 0; }
+
+        // Visits all screens and the submenu and returns to the same state.
+        // It returns the number of screens (and menus) that were shown as expected.
+        int session() {
+            int visited = 0;
+
+            // main -> menu -> submenu -> menu -> main
+            turn(-2);
+            press();
+            visited += shown("menu");
+            turn(-8);
+            turn(2);
+            press();
+            visited += (menu.menu_item_count() == 3);
+            turn(1);
+            turn(-1);
+            press();
+            turn(5);
+            visited += (menu.menu_item_count() == 8);
+            press();
+            visited += shown("main");
+
+            // main -> image -> main
+            turn(1);
+            press();
+            visited += shown("image");
+            press();
+            visited += shown("main");
+
+            // main -> text -> main
+            turn(1);
+            press();
+            visited += shown("text");
+            press();
+            visited += shown("main");
+            return visited;
+        }
+
+        enum { SESSION_SCREENS = 8 };
+
+        font_16x8 font;
+        mgui_multi gui;
+        mgui_text text1, text2, text3, text3_1, text3_2, text4, text5, text6, text7, text8;
+        mgui_menu_item item1, item2, item3, item3_1, item3_2, item3_3, item4, item5, item6, item7, item8;
+        mgui_menu item_menu3;
+        mgui_menu menu;
+        mgui_vertical_scrollbar scroll;
+        mgui_text text_return;
+        mgui_menu_item item_text_return;
+        mgui_menu text_menu;
+        mgui_text long_text, long_text2;
+        mgui_text image_return;
+        mgui_menu_item item_image_return;
+        mgui_menu image_menu;
+        mgui_image_property image_prop;
+        mgui_image image;
+        mgui_button button_menu, button_image, button_text;
+        mgui_text menu_text, image_text, texts_text;
+        mgui_ui_group group;
+    };
+}
+
+#endif // MGUI_EXAMPLE_SCREENS_H
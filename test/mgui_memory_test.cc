@@ -0,0 +1,290 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../mGUI/mgui_memory_report.h"
+#include "mgui_example_screens.h"
+
+namespace Memory {
+
+    // Budgets of the example screens on a 128x64 display (bytes on the host).
+    static const long SCREEN_BUDGET = 1536;
+    static const long LIST_BUDGET = 768;
+    static const long STRING_BUDGET = 128;
+    static const long STRING_MAP_BUDGET = 512;
+    static const long TEXT_PROPERTY_BUDGET = 2048;
+    static const long STACK_BUDGET = 128;
+    static const long INPUT_BUDGET = 64;
+    static const long TOTAL_BUDGET = 4608;
+
+    // Budgets of sizeof on the host (64-bit): widgets, and the classes that own them
+    static const long WIDGET_BUDGET = 256;
+    static const long OWNER_BUDGET = 1024;
+
+    // Counts the calls and fills the memory to find reads of uninitialized bytes.
+    class counting_allocator : public mgui_allocator {
+    public:
+        counting_allocator() : allocations(0), frees(0), bytes(0) {}
+
+        void* allocate(long size, mgui_memory_tag) {
+            allocations++;
+            bytes += size;
+            void* memory = ::operator new(size);
+            memset(memory, 0xA5, size);
+            return memory;
+        }
+
+        void deallocate(void* memory, long size, mgui_memory_tag) {
+            frees++;
+            bytes -= size;
+            ::operator delete(memory);
+        }
+
+        long allocations;
+        long frees;
+        long bytes;
+    };
+
+    static long peak(mgui_memory_tag tag, const mgui_memory_stats& before) {
+        return mgui_memory::stats(tag).peak - before.current;
+    }
+
+    TEST(Memory, StringAndList) {
+        const mgui_memory_stats string = mgui_memory::stats(mgui_memory_tag::String);
+        const mgui_memory_stats list = mgui_memory::stats(mgui_memory_tag::List);
+        {
+            mgui_string text("abc");
+            EXPECT_EQ(string.current + 4, mgui_memory::stats(mgui_memory_tag::String).current);
+            text = "abcdefg";
+            EXPECT_EQ(string.current + 8, mgui_memory::stats(mgui_memory_tag::String).current);
+
+            mgui_list<int> numbers;
+            numbers.add(1);
+            numbers.add(2);
+            EXPECT_EQ(list.current + 2 * (long)sizeof(mgui_list_node<int>),
+                      mgui_memory::stats(mgui_memory_tag::List).current);
+            numbers.remove(1);
+            EXPECT_EQ(list.current + (long)sizeof(mgui_list_node<int>),
+                      mgui_memory::stats(mgui_memory_tag::List).current);
+        }
+        EXPECT_EQ(string.current, mgui_memory::stats(mgui_memory_tag::String).current);
+        EXPECT_EQ(list.current, mgui_memory::stats(mgui_memory_tag::List).current);
+        EXPECT_EQ(mgui_memory::stats(mgui_memory_tag::String).allocations - string.allocations,
+                  mgui_memory::stats(mgui_memory_tag::String).frees - string.frees);
+    }
+
+    TEST(Memory, StackAndMapDoNotLeak) {
+        const long before = mgui_memory::total().current;
+        {
+            mgui_stack<int> stack;
+            stack.push(1);
+            stack.push(2);
+            EXPECT_EQ(2, stack.pop());
+            EXPECT_LT(0, mgui_memory::stats(mgui_memory_tag::Stack).current);
+
+            mgui_string_map<int> map;
+            map.insert("a", 1);
+            map.insert("a", 2);
+            map.insert("b", 3);
+            map.remove("b");
+            EXPECT_EQ(2, *map.get("a"));
+        }
+        EXPECT_EQ(before, mgui_memory::total().current);
+    }
+
+    TEST(Memory, ExampleScreensWithinBudget) {
+        const mgui_memory_stats before[mgui_memory::TAGS] = {
+            mgui_memory::stats(mgui_memory_tag::List), mgui_memory::stats(mgui_memory_tag::String),
+            mgui_memory::stats(mgui_memory_tag::StringMap), mgui_memory::stats(mgui_memory_tag::TextProperty),
+            mgui_memory::stats(mgui_memory_tag::Stack), mgui_memory::stats(mgui_memory_tag::Screen),
+            mgui_memory::stats(mgui_memory_tag::Font), mgui_memory::stats(mgui_memory_tag::Input),
+            mgui_memory::stats(mgui_memory_tag::Transfer)
+        };
+        const mgui_memory_stats total = mgui_memory::total();
+        mgui_memory::reset_peak();
+        {
+            Example::screens screens;
+            for (int i = 0; i < 3; i++) {
+                EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+            }
+        }
+
+        EXPECT_LE(peak(mgui_memory_tag::Screen, before[(int)mgui_memory_tag::Screen]), SCREEN_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::List, before[(int)mgui_memory_tag::List]), LIST_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::String, before[(int)mgui_memory_tag::String]), STRING_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::StringMap, before[(int)mgui_memory_tag::StringMap]), STRING_MAP_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::TextProperty, before[(int)mgui_memory_tag::TextProperty]), TEXT_PROPERTY_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::Stack, before[(int)mgui_memory_tag::Stack]), STACK_BUDGET);
+        EXPECT_LE(peak(mgui_memory_tag::Input, before[(int)mgui_memory_tag::Input]), INPUT_BUDGET);
+        EXPECT_LE(mgui_memory::total().peak - total.current, TOTAL_BUDGET);
+        // the frame buffer is the largest allocation
+        EXPECT_GE(peak(mgui_memory_tag::Screen, before[(int)mgui_memory_tag::Screen]), 1024);
+
+        // everything is released
+        for (int tag = 0; tag < mgui_memory::TAGS; tag++) {
+            EXPECT_EQ(before[tag].current, mgui_memory::stats((mgui_memory_tag)tag).current)
+                << mgui_memory::tag_name((mgui_memory_tag)tag);
+        }
+        EXPECT_EQ(total.current, mgui_memory::total().current);
+    }
+
+    TEST(Memory, SizesWithinBudget) {
+        int count = 0;
+        const mgui_size_entry* sizes = mgui_sizes(&count);
+        ASSERT_GT(count, 0);
+        for (int i = 0; i < count; i++) {
+            const char* name = sizes[i].name;
+            long budget = WIDGET_BUDGET;
+            if (strcmp(name, "mgui_font_aa") == 0 || strncmp(name, "mgui_string_map", 15) == 0
+                || strcmp(name, "mgui") == 0 || strcmp(name, "mgui_multi") == 0) {
+                budget = OWNER_BUDGET;
+            }
+            EXPECT_GT(sizes[i].size, 0) << name;
+            EXPECT_LE(sizes[i].size, budget) << name;
+        }
+        EXPECT_EQ((long)sizeof(mgui_text), sizes[6].size);
+    }
+
+    TEST(Memory, Allocator) {
+        counting_allocator allocator;
+        mgui_memory::set_allocator(&allocator);
+        {
+            Example::screens screens;
+            EXPECT_EQ(Example::screens::SESSION_SCREENS, screens.session());
+            EXPECT_GT(allocator.allocations, 0);
+            EXPECT_GE(allocator.bytes, 1024);
+        }
+        mgui_memory::set_allocator(nullptr);
+        EXPECT_EQ(allocator.allocations, allocator.frees);
+        EXPECT_EQ(0, allocator.bytes);
+    }
+
+    // Gives the first allowed allocations and then no memory.
+    class failing_allocator : public mgui_allocator {
+    public:
+        explicit failing_allocator(int allowed) : allowed(allowed), failures(0) {}
+
+        void* allocate(long size, mgui_memory_tag) {
+            if (allowed == 0) {
+                failures++;
+                return nullptr;
+            }
+            allowed--;
+            return ::operator new(size);
+        }
+
+        void deallocate(void* memory, long, mgui_memory_tag) {
+            ::operator delete(memory);
+        }
+
+        int allowed;
+        int failures;
+    };
+
+    struct counted {
+        counted() { constructed++; }
+        static int constructed;
+    };
+    int counted::constructed = 0;
+
+    TEST(Memory, NoMemory) {
+        const long before = mgui_memory::total().current;
+        failing_allocator allocator(0);
+        mgui_memory::set_allocator(&allocator);
+        {
+            // the constructor is not run
+            EXPECT_EQ(nullptr, mgui_create<counted>(mgui_memory_tag::Screen));
+            EXPECT_EQ(0, counted::constructed);
+
+            mgui_list<int> list;
+            EXPECT_FALSE(list.add(1));
+            EXPECT_EQ(0, list.count());
+            mgui_stack<int> stack;
+            EXPECT_FALSE(stack.push(1));
+            EXPECT_TRUE(stack.is_empty());
+            mgui_string_map<int> map;
+            EXPECT_FALSE(map.insert("a", 1));
+            EXPECT_EQ(nullptr, map.get("a"));
+            mgui_string text("abc");
+            EXPECT_EQ(nullptr, text.c_str());
+
+            mgui gui(128, 64);
+            EXPECT_FALSE(gui.allocated());
+            EXPECT_FALSE(gui.update_lcd());
+            mgui_multi multi(128, 64);
+            EXPECT_FALSE(multi.allocated());
+            EXPECT_FALSE(multi.update_lcd());
+        }
+        mgui_memory::set_allocator(nullptr);
+        EXPECT_GT(allocator.failures, 0);
+        EXPECT_EQ(before, mgui_memory::total().current);
+    }
+
+    TEST(Memory, NoMemoryForViewport) {
+        mgui_rectangle box;
+        mgui_multi gui(128, 64);
+        gui.add("main", (mgui_object*)&box);
+        gui.add("dialog", (mgui_object*)&box);
+        gui.select("main");
+        const long before = mgui_memory::total().current;
+
+        // a viewport without its buffer, and one without its mgui_draw
+        for (int allowed = 0; allowed < 2; allowed++) {
+            failing_allocator allocator(allowed);
+            mgui_memory::set_allocator(&allocator);
+            EXPECT_EQ(-1, gui.add_viewport(nullptr, 0, 0, 128, 64)) << allowed;
+            EXPECT_FALSE(gui.open_dialog("dialog", 0, 0, 64, 24)) << allowed;
+            mgui_memory::set_allocator(nullptr);
+            EXPECT_EQ(before, mgui_memory::total().current) << allowed;
+        }
+        EXPECT_EQ(0, gui.viewport_count());
+        EXPECT_EQ(nullptr, gui.dialog());
+        EXPECT_TRUE(gui.update_lcd());
+    }
+
+    struct throwing {
+        explicit throwing(int value) : value(value) { throw value; }
+        long value;
+        char padding[40];
+    };
+
+    TEST(Memory, CreateReleasesWhenConstructorThrows) {
+        counting_allocator allocator;
+        mgui_memory::set_allocator(&allocator);
+        const mgui_memory_stats before = mgui_memory::stats(mgui_memory_tag::Screen);
+        EXPECT_THROW(mgui_create<throwing>(mgui_memory_tag::Screen, 3), int);
+        const mgui_memory_stats after = mgui_memory::stats(mgui_memory_tag::Screen);
+        mgui_memory::set_allocator(nullptr);
+        EXPECT_EQ(before.current, after.current);
+        EXPECT_EQ(before.allocations + 1, after.allocations);
+        EXPECT_EQ(before.frees + 1, after.frees);
+        EXPECT_EQ(1, allocator.frees);
+        EXPECT_EQ(0, allocator.bytes);
+    }
+
+    TEST(Memory, Report) {
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        {
+            mgui gui(128, 64);
+            mgui_print_memory(file);
+        }
+        mgui_print_sizes(file);
+        rewind(file);
+
+        char line[256];
+        ASSERT_NE(nullptr, fgets(line, sizeof(line), file));
+        EXPECT_EQ(0, strncmp(line, "heap:", 5));
+        bool screen = false;
+        bool text = false;
+        while (fgets(line, sizeof(line), file) != nullptr) {
+            screen |= strstr(line, "  Screen ") != nullptr;
+            text |= strstr(line, "  mgui_text ") != nullptr;
+        }
+        fclose(file);
+        EXPECT_TRUE(screen);
+        EXPECT_TRUE(text);
+        EXPECT_STREQ("TextProperty", mgui_memory::tag_name(mgui_memory_tag::TextProperty));
+    }
+}
@@ -0,0 +1,182 @@
+// Built with MGUI_OVERDRAW as a separate program (see CMakeLists.txt).
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "../mGUI/mgui_heatmap.h"
+#include "font_16x8.h"
+
+namespace Overdraw {
+
+    static int lit_pixels(const uint8_t* buffer, int size) {
+        int total = 0;
+        for (int i = 0; i < size; i++) {
+            for (int b = 0; b < 8; b++) {
+                total += (buffer[i] >> b) & 1;
+            }
+        }
+        return total;
+    }
+
+    TEST(Overdraw, RectangleOnce) {
+        uint8_t buffer[1024] = {};
+        mgui_draw draw(128, 64, buffer);
+        mgui_overdraw overdraw(128, 64);
+        draw.set_overdraw(&overdraw);
+
+        draw.draw_rectangle(3, 5, 42, 30, true);
+        EXPECT_EQ(40 * 26, overdraw.writes());
+        EXPECT_EQ(40 * 26, overdraw.unique());
+        EXPECT_EQ(1, overdraw.max());
+        EXPECT_EQ(1, overdraw.count(3, 5));
+        EXPECT_EQ(0, overdraw.count(2, 5));
+        EXPECT_EQ(40 * 26, overdraw.writes(mgui_overdraw::OTHER));
+
+        // clear is not a write
+        draw.clear();
+        EXPECT_EQ(40 * 26, overdraw.writes());
+
+        // clipped
+        draw.draw_rectangle(120, 60, 140, 70, true);
+        EXPECT_EQ(40 * 26 + 8 * 4, overdraw.writes());
+
+        draw.set_overdraw(nullptr);
+        draw.draw_pixel(0, 0, true);
+        EXPECT_EQ(0, overdraw.count(0, 0));
+    }
+
+    TEST(Overdraw, CircleFill) {
+        uint8_t buffer[1024] = {};
+        mgui_draw draw(128, 64, buffer);
+        mgui_overdraw overdraw(128, 64);
+        draw.set_overdraw(&overdraw);
+
+        draw.draw_circle(64, 32, 20, true);
+        EXPECT_EQ(lit_pixels(buffer, sizeof(buffer)), overdraw.unique());
+        // the octant spans cross each other
+        EXPECT_GT(overdraw.max(), 2);
+        EXPECT_GT(overdraw.writes(), overdraw.unique() * 3L / 2);
+    }
+
+    TEST(Overdraw, GrayRowsAreCountedOnce) {
+        uint8_t buffer[64 * 64 / 2] = {};
+        mgui_draw draw(64, 64, buffer, mgui_pixel_format::Gray4);
+        mgui_overdraw overdraw(64, 64);
+        draw.set_overdraw(&overdraw);
+
+        draw.draw_rectangle(1, 2, 20, 9, true);
+        EXPECT_EQ(20 * 8, overdraw.writes());
+        EXPECT_EQ(1, overdraw.max());
+
+        const uint8_t pattern[8] = { 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA };
+        overdraw.begin_frame();
+        draw.fill_pattern(0, 0, 7, 7, pattern);
+        EXPECT_EQ(64, overdraw.writes());
+    }
+
+    TEST(Overdraw, FramesAndTypes) {
+        font_16x8 font;
+        mgui gui(128, 64);
+        mgui_rectangle rect;
+        rect.set_width(64);
+        rect.set_height(16);
+        rect.set_fill(true);
+        mgui_text text(&font, "AB");
+        gui.add((mgui_object*)&rect);
+        gui.add((mgui_object*)&text);
+
+        mgui_overdraw overdraw(128, 64);
+        gui.set_overdraw(&overdraw);
+        gui.update_lcd();
+        gui.update_lcd();
+
+        // the counts are of the last frame
+        EXPECT_EQ(2, overdraw.frames());
+        EXPECT_EQ(64 * 16, overdraw.writes(mgui_object_type::Rectangle));
+        EXPECT_EQ(64 * 16, overdraw.unique(mgui_object_type::Rectangle));
+        EXPECT_GT(overdraw.writes(mgui_object_type::Text), 0);
+        EXPECT_EQ(0, overdraw.writes(mgui_overdraw::OTHER));
+        EXPECT_EQ(overdraw.writes(), overdraw.writes(mgui_object_type::Rectangle)
+                  + overdraw.writes(mgui_object_type::Text));
+        // the text is drawn over the rectangle
+        EXPECT_EQ(2, overdraw.max());
+        EXPECT_EQ(64 * 16, overdraw.unique());
+        EXPECT_EQ(2 * overdraw.writes(), overdraw.total_writes());
+        EXPECT_EQ(2LL * overdraw.unique(), overdraw.total_unique());
+    }
+
+    TEST(Overdraw, SelectedMenuItem) {
+        font_16x8 font;
+        mgui_multi gui(128, 64);
+        mgui_menu menu(128, 64);
+        mgui_text text1(&font, "Item 1");
+        mgui_text text2(&font, "Item 2");
+        mgui_menu_item item1(&text1);
+        mgui_menu_item item2(&text2);
+        menu.add(&item1);
+        menu.add(&item2);
+        gui.add("menu", (mgui_object*)&menu);
+
+        mgui_overdraw overdraw(128, 64);
+        gui.set_overdraw(&overdraw);
+        gui.update_lcd();
+
+        // the highlight rectangle and the inverted text of the selected item
+        EXPECT_GT(overdraw.writes(mgui_object_type::MenuItem), 0);
+        EXPECT_EQ(0, overdraw.writes(mgui_object_type::Menu));
+        EXPECT_EQ(2, overdraw.max());
+    }
+
+    TEST(Overdraw, Heatmap) {
+        uint8_t buffer[1024] = {};
+        mgui_draw draw(128, 64, buffer);
+        mgui_overdraw overdraw(128, 64);
+        draw.set_overdraw(&overdraw);
+        draw.draw_rectangle(0, 0, 3, 3, true);
+        draw.draw_rectangle(0, 0, 1, 1, true);
+
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        ASSERT_TRUE(mgui_save_heatmap(overdraw, file, 2));
+        rewind(file);
+        int width = 0;
+        int height = 0;
+        int max = 0;
+        ASSERT_EQ(3, fscanf(file, "P6 %d %d %d", &width, &height, &max));
+        EXPECT_EQ(256, width);
+        EXPECT_EQ(128, height);
+        EXPECT_EQ(255, max);
+        fgetc(file);
+
+        std::string pixels(width * height * 3, '\0');
+        ASSERT_EQ(pixels.size(), fread(&pixels[0], 1, pixels.size(), file));
+        fclose(file);
+
+        auto color = [&](int x, int y) {
+            uint8_t rgb[3];
+            memcpy(rgb, &pixels[(y * width + x) * 3], 3);
+            return std::string((const char*)rgb, 3);
+        };
+        uint8_t expected[3];
+        mgui_heatmap_color(2, expected);
+        EXPECT_EQ(std::string((const char*)expected, 3), color(3, 3));
+        mgui_heatmap_color(1, expected);
+        EXPECT_EQ(std::string((const char*)expected, 3), color(4, 4));
+        mgui_heatmap_color(0, expected);
+        EXPECT_EQ(std::string((const char*)expected, 3), color(8, 0));
+
+        file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        mgui_print_overdraw(overdraw, file);
+        rewind(file);
+        char line[256];
+        ASSERT_NE(nullptr, fgets(line, sizeof(line), file));
+        EXPECT_STREQ("overdraw: 20 writes, 16 pixels, 1.25 writes/pixel, max 2\n", line);
+        ASSERT_NE(nullptr, fgets(line, sizeof(line), file));
+        EXPECT_NE(nullptr, strstr(line, "Other"));
+        fclose(file);
+    }
+}
@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../mGUI/mgui_host_batch.h"
+#include "font_16x8_aa.h"
+#include "mgui_example_screens.h"
+
+namespace Parallel {
+
+    static const int FRAME_BYTES = 128 * 64 / 8;
+
+    // The example screens after two sessions and a few more inputs.
+    static std::vector<uint8_t> render_example(int variant) {
+        Example::screens screens;
+        screens.session();
+        screens.session();
+        screens.turn(variant % 3);
+        if ((variant & 4) != 0) {
+            screens.press();
+            screens.turn(variant % 5);
+        }
+        return std::vector<uint8_t>(screens.gui.lcd(), screens.gui.lcd() + FRAME_BYTES);
+    }
+
+    static const char* const LANGUAGES[][3] = {
+        { "Start", "Settings", "About" },
+        { "Starten", "Optionen", "Info" },
+        { "Demarrer", "Reglages", "A propos" },
+        { "Inizio", "Impostare", "Info" },
+    };
+
+    // A menu in one of the languages with the item of the variant selected.
+    static std::vector<uint8_t> render_menu(font_16x8* font, int variant) {
+        const char* const* names = LANGUAGES[variant % 4];
+        mgui_text first(font, names[0]), second(font, names[1]), third(font, names[2]);
+        mgui_menu_item items[3];
+        items[0].set_text(&first);
+        items[1].set_text(&second);
+        items[2].set_text(&third);
+        mgui_menu menu(128, 64);
+        for (mgui_menu_item& item : items) {
+            menu.add(&item);
+        }
+
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&menu);
+        for (int i = 0; i < (variant / 4) % 3; i++) {
+            menu.set_on_select_next(true);
+            gui.update_lcd();
+            menu.set_on_select_next(false);
+        }
+        gui.update_lcd();
+        return std::vector<uint8_t>(gui.lcd(), gui.lcd() + FRAME_BYTES);
+    }
+
+    // Anti-aliased text of the variant: other screen formats, phases within a byte and inks.
+    static std::vector<uint8_t> render_aa(font_16x8_aa* font, int variant) {
+        const mgui_pixel_format format = (variant & 1) ? mgui_pixel_format::Gray2 : mgui_pixel_format::Gray4;
+        mgui gui(128, 64, format);
+        mgui_text first(font, LANGUAGES[variant % 4][0], variant % 7, 0);
+        mgui_text second(font, LANGUAGES[(variant + 1) % 4][1], 3 + variant % 5, 24);
+        first.set_intensity((uint8_t)(0xFF - variant * 16));
+        second.set_intensity((uint8_t)(0x40 + variant * 8));
+        gui.add((mgui_object*)&first);
+        gui.add((mgui_object*)&second);
+        gui.update_lcd();
+        return std::vector<uint8_t>(gui.lcd(), gui.lcd() + mgui_draw::buffer_size(128, 64, format));
+    }
+
+    TEST(ParallelInstances, SharedAntialiasedFont) {
+        const int variants = 8;
+        // two slots: the threads keep replacing the glyphs of each other
+        font_16x8_aa font(2);
+        std::vector<std::vector<uint8_t>> expected;
+        for (int variant = 0; variant < variants; variant++) {
+            expected.push_back(render_aa(&font, variant));
+        }
+        EXPECT_NE(expected[0], expected[2]);
+
+        std::atomic<int> mismatches(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; t++) {
+            threads.emplace_back([&, t] {
+                for (int repeat = 0; repeat < 20; repeat++) {
+                    for (int variant = t; variant < variants; variant += 2) {
+                        if (render_aa(&font, variant) != expected[variant]) {
+                            mismatches.fetch_add(1);
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(0, mismatches.load());
+    }
+
+    TEST(ParallelInstances, ExampleScreensOnThreads) {
+        const int variants = 8;
+        std::vector<std::vector<uint8_t>> expected;
+        for (int variant = 0; variant < variants; variant++) {
+            expected.push_back(render_example(variant));
+        }
+        EXPECT_NE(expected[0], expected[4]);
+        const mgui_memory_stats before = mgui_memory::total();
+
+        // each thread runs its own screens, like virtual devices in one simulator
+        std::atomic<int> mismatches(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (int repeat = 0; repeat < 3; repeat++) {
+                    for (int variant = t; variant < variants; variant += 4) {
+                        if (render_example(variant) != expected[variant]) {
+                            mismatches.fetch_add(1);
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(0, mismatches.load());
+        // the shared statistics counted every allocation of the threads
+        const mgui_memory_stats after = mgui_memory::total();
+        EXPECT_EQ(before.current, after.current);
+        EXPECT_EQ(after.allocations - before.allocations, after.frees - before.frees);
+        EXPECT_GT(after.allocations, before.allocations);
+    }
+
+    TEST(BatchRenderer, SameAsSerial) {
+        const int jobs = 48;
+        font_16x8 font;
+        std::vector<std::vector<uint8_t>> expected;
+        for (int i = 0; i < jobs; i++) {
+            expected.push_back(render_menu(&font, i));
+        }
+
+        mgui_batch_renderer batch(3);
+        EXPECT_EQ(3, batch.threads());
+        std::vector<std::vector<uint8_t>> frames(jobs);
+        std::vector<int> calls(jobs, 0);
+        batch.run(jobs, [&](int index) {
+            frames[index] = render_menu(&font, index);
+            calls[index]++;
+        });
+
+        for (int i = 0; i < jobs; i++) {
+            EXPECT_EQ(1, calls[i]) << i;
+            EXPECT_EQ(expected[i], frames[i]) << i;
+        }
+        EXPECT_EQ(jobs, batch.finished());
+
+        // the threads are kept for the next batch
+        std::vector<std::vector<uint8_t>> examples(8);
+        batch.run(8, [&](int index) {
+            examples[index] = render_example(index);
+        });
+        for (int i = 0; i < 8; i++) {
+            EXPECT_EQ(render_example(i), examples[i]) << i;
+        }
+        EXPECT_EQ(jobs + 8, batch.finished());
+
+        batch.run(0, [&](int index) { calls[index]++; });
+        EXPECT_EQ(jobs + 8, batch.finished());
+    }
+
+    TEST(BatchRenderer, ManySmallBatches) {
+        mgui_batch_renderer batch(4);
+        EXPECT_EQ(4, batch.threads());
+        std::atomic<int> total(0);
+        for (int i = 1; i <= 50; i++) {
+            std::vector<int> calls(i, 0);
+            batch.run(i, [&](int index) {
+                calls[index]++;
+                total.fetch_add(1);
+            });
+            for (int index = 0; index < i; index++) {
+                ASSERT_EQ(1, calls[index]) << i << " " << index;
+            }
+        }
+        EXPECT_EQ(50 * 51 / 2, total.load());
+        EXPECT_GE(mgui_batch_renderer().threads(), 1);
+    }
+}
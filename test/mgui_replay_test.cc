@@ -0,0 +1,259 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../mGUI/mgui_replay.h"
+#include "font_16x8.h"
+
+namespace Replay {
+
+    static int frame = 0;
+    static unsigned long now = 0;
+
+    static void read_button(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = (frame % 37) == 36;
+    }
+
+    static void read_encoder(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = (frame % 7 == 0) ? ((frame / 7) % 6 < 3 ? 1 : -1) : 0;
+    }
+
+    static unsigned long read_clock() {
+        return now;
+    }
+
+    static void menu_handler(mgui_menu* sender, const mgui_input_state state[], mgui_string*) {
+        sender->set_on_enter(state[0].value_1);
+        sender->set_on_select_prev(state[1].value_1 < 0);
+        sender->set_on_select_next(state[1].value_1 > 0);
+    }
+
+    // The screens of a session, created again for each run.
+    struct session {
+        session() : gui(128, 64), menu(112, 64), scroll(113, 0, 14, 64, 6) {
+            const char* names[] = { "Item 1", "Item 2", "Item 3", "Item 4", "Item 5", "Item 6" };
+            for (int i = 0; i < 6; i++) {
+                texts.push_back(new mgui_text(&font, names[i]));
+                items.push_back(new mgui_menu_item(texts[i]));
+                menu.add(items[i]);
+            }
+            texts[3]->set_move(true);
+            menu.set_input_event_handler(&menu_handler);
+            gui.input()->add(&read_button);
+            gui.input()->add(&read_encoder);
+            gui.add("menu", (mgui_object*)&menu);
+            gui.add("menu", (mgui_object*)&scroll);
+        }
+
+        ~session() {
+            for (size_t i = 0; i < items.size(); i++) {
+                delete items[i];
+                delete texts[i];
+            }
+        }
+
+        font_16x8 font;
+        mgui_multi gui;
+        mgui_menu menu;
+        mgui_vertical_scrollbar scroll;
+        std::vector<mgui_text*> texts;
+        std::vector<mgui_menu_item*> items;
+    };
+
+    static mgui_word32 checksum(mgui_multi& gui) {
+        return mgui_frame_checksum(gui.lcd(), 1024);
+    }
+
+    TEST(InputTrace, RepeatsAreMerged) {
+        mgui_input_trace trace(2, 4);
+        mgui_input_state states[2] = { { mgui_input_type::Single, 0 }, { mgui_input_type::Single, 0 } };
+
+        EXPECT_TRUE(trace.record(10, states));
+        EXPECT_TRUE(trace.record(20, states));
+        EXPECT_TRUE(trace.record(30, states));
+        states[1].value_1 = 1;
+        EXPECT_TRUE(trace.record(40, states));
+        states[1].value_1 = 0;
+        EXPECT_TRUE(trace.record(50, states));
+
+        EXPECT_EQ(3, trace.count());
+        EXPECT_EQ(5, trace.updates());
+        EXPECT_EQ(10u, trace.time(0));
+        EXPECT_EQ(3, trace.repeat(0));
+        EXPECT_EQ(40u, trace.time(1));
+        EXPECT_EQ(1, trace.states(1)[1].value_1);
+        EXPECT_EQ(1, trace.repeat(2));
+
+        // full
+        states[0].value_1 = 1;
+        EXPECT_TRUE(trace.record(60, states));
+        states[0].value_1 = 2;
+        EXPECT_FALSE(trace.record(70, states));
+        EXPECT_TRUE(trace.overflow());
+        EXPECT_EQ(4, trace.count());
+
+        trace.clear();
+        EXPECT_EQ(0, trace.count());
+        EXPECT_EQ(0, trace.updates());
+        EXPECT_FALSE(trace.overflow());
+    }
+
+    TEST(InputTrace, RecordFromInput) {
+        mgui_input input;
+        input.add(&read_button);
+        input.add(&read_encoder);
+        mgui_input_trace trace(2, 64);
+        input.set_recorder(&trace, &read_clock);
+
+        for (frame = 0; frame < 15; frame++) {
+            now = frame * 1000;
+            input.update();
+        }
+        input.set_recorder(nullptr);
+        input.update();
+
+        EXPECT_EQ(15, trace.updates());
+        // frames 0, 1-6, 7, 8-13, 14
+        ASSERT_EQ(5, trace.count());
+        EXPECT_EQ(0u, trace.time(0));
+        EXPECT_EQ(1, trace.states(0)[1].value_1);
+        EXPECT_EQ(1000u, trace.time(1));
+        EXPECT_EQ(6, trace.repeat(1));
+        EXPECT_EQ(7000u, trace.time(2));
+    }
+
+    TEST(InputTrace, Player) {
+        mgui_input_trace trace(1, 4);
+        mgui_input_state state = { mgui_input_type::Single, 5 };
+        trace.add(0, 2, &state);
+        state.value_1 = -3;
+        trace.add(0, 1, &state);
+
+        mgui_input input;
+        input.add(&read_encoder);
+        input.set_player(&trace);
+        EXPECT_FALSE(input.finished());
+
+        input.update();
+        EXPECT_EQ(5, input.get_input_result()[0].value_1);
+        input.update();
+        EXPECT_EQ(5, input.get_input_result()[0].value_1);
+        input.update();
+        EXPECT_EQ(-3, input.get_input_result()[0].value_1);
+        EXPECT_TRUE(input.finished());
+
+        // the last states are kept
+        input.update();
+        EXPECT_EQ(-3, input.get_input_result()[0].value_1);
+
+        // back to the callback
+        input.set_player(nullptr);
+        frame = 7;
+        input.update();
+        EXPECT_EQ(1, input.get_input_result()[0].value_1);
+    }
+
+    TEST(InputTrace, PlayerWithoutCallbacks) {
+        mgui_input_trace trace(2, 4);
+        mgui_input_state states[2] = { { mgui_input_type::Single, 1 }, { mgui_input_type::Single, 2 } };
+        trace.add(0, 1, states);
+
+        mgui_input input;
+        input.set_player(&trace);
+        input.update();
+        EXPECT_EQ(1, input.get_input_result()[0].value_1);
+        EXPECT_EQ(2, input.get_input_result()[1].value_1);
+    }
+
+    TEST(InputTrace, ReplayIsDeterministic) {
+        const int frames = 200;
+        mgui_input_trace trace(2, 256);
+        std::vector<mgui_word32> live;
+        {
+            session s;
+            s.gui.input()->set_recorder(&trace);
+            for (frame = 0; frame < frames; frame++) {
+                s.gui.update_lcd();
+                live.push_back(checksum(s.gui));
+            }
+            s.gui.input()->set_recorder(nullptr);
+        }
+        EXPECT_EQ(frames, trace.updates());
+        EXPECT_LT(trace.count(), frames);
+
+        // the selection changes the screen
+        std::vector<mgui_word32> distinct(live);
+        std::sort(distinct.begin(), distinct.end());
+        EXPECT_GT(std::unique(distinct.begin(), distinct.end()) - distinct.begin(), 3);
+
+        // frame by frame; the callbacks would return other values now
+        frame = 3;
+        {
+            session s;
+            s.gui.input()->set_player(&trace);
+            for (int i = 0; i < frames; i++) {
+                s.gui.update_lcd();
+                ASSERT_EQ(live[i], checksum(s.gui)) << i;
+            }
+            EXPECT_TRUE(s.gui.input()->finished());
+        }
+
+        // at full speed
+        {
+            session s;
+            mgui_replay_result result = mgui_replay(s.gui, *s.gui.input(), trace);
+            EXPECT_EQ(frames, result.frames);
+            EXPECT_EQ(live.back(), result.checksum);
+            EXPECT_LE(result.min_us, result.p50_us);
+            EXPECT_LE(result.p50_us, result.p95_us);
+            EXPECT_LE(result.p95_us, result.p99_us);
+            EXPECT_LE(result.p99_us, result.max_us);
+            EXPECT_GT(result.mean_us, 0);
+        }
+    }
+
+    TEST(InputTrace, SaveAndLoad) {
+        mgui_input_trace trace(2, 64);
+        mgui_input input;
+        input.add(&read_button);
+        input.add(&read_encoder);
+        input.set_recorder(&trace, &read_clock);
+        for (frame = 0; frame < 40; frame++) {
+            now = 100000UL + frame * 16667UL;
+            input.update();
+        }
+
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        ASSERT_TRUE(mgui_save_trace(trace, file));
+
+        rewind(file);
+        mgui_input_trace loaded(2, 64);
+        ASSERT_TRUE(mgui_load_trace(&loaded, file));
+        ASSERT_EQ(trace.count(), loaded.count());
+        EXPECT_EQ(trace.updates(), loaded.updates());
+        for (int i = 0; i < trace.count(); i++) {
+            EXPECT_EQ(trace.time(i), loaded.time(i));
+            EXPECT_EQ(trace.repeat(i), loaded.repeat(i));
+            for (int c = 0; c < 2; c++) {
+                EXPECT_EQ(trace.states(i)[c].value_1, loaded.states(i)[c].value_1);
+                EXPECT_EQ(trace.states(i)[c].type, loaded.states(i)[c].type);
+            }
+        }
+
+        // the number of channels must match
+        rewind(file);
+        mgui_input_trace other(3, 64);
+        EXPECT_FALSE(mgui_load_trace(&other, file));
+
+        // too small
+        rewind(file);
+        mgui_input_trace small(2, 2);
+        EXPECT_FALSE(mgui_load_trace(&small, file));
+        EXPECT_TRUE(small.overflow());
+        fclose(file);
+    }
+}
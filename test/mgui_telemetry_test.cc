@@ -0,0 +1,402 @@
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "../mGUI/mgui_telemetry.h"
+#include "font_16x8.h"
+
+namespace Telemetry {
+
+    static unsigned long now = 0;
+    static int button = 0;
+
+    static unsigned long read_clock() {
+        return now;
+    }
+
+    static void read_button(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = button;
+    }
+
+    // Advances the clock while drawing, like a slow object.
+    class busy_object : public mgui_object {
+    public:
+        explicit busy_object(unsigned long us) : us_(us) {}
+
+        mgui_object_type type() const { return mgui_object_type::Pixel; }
+
+        void update(mgui_draw*, mgui_input_state*, mgui_string*) {
+            now += us_;
+        }
+
+        void set_us(unsigned long us) { us_ = us; }
+
+    private:
+        unsigned long us_;
+    };
+
+    // Draws quickly, then does slow work unless the frame budget defers it.
+    class deferrable_object : public mgui_object {
+    public:
+        deferrable_object(unsigned long draw_us, unsigned long work_us)
+         : works(0), draw_us_(draw_us), work_us_(work_us) {}
+
+        mgui_object_type type() const { return mgui_object_type::Pixel; }
+
+        void update(mgui_draw* draw, mgui_input_state*, mgui_string*) {
+            now += draw_us_;
+            if (draw->deferring()) {
+                draw->defer();
+                return;
+            }
+            now += work_us_;
+            works++;
+        }
+
+        int works;
+
+    private:
+        unsigned long draw_us_;
+        unsigned long work_us_;
+    };
+
+    TEST(Histogram, Buckets) {
+        EXPECT_EQ(0, mgui_histogram::bucket_index(0));
+        EXPECT_EQ(3, mgui_histogram::bucket_index(3));
+        EXPECT_EQ(4, mgui_histogram::bucket_index(4));
+        EXPECT_EQ(mgui_histogram::BUCKETS - 1, mgui_histogram::bucket_index(0xFFFFFFFFu));
+        EXPECT_EQ(0u, mgui_histogram::bucket_lower(0));
+        EXPECT_EQ(0xFFFFFFFFu, mgui_histogram::bucket_upper(mgui_histogram::BUCKETS - 1));
+
+        // contiguous and each value in its bucket
+        for (int i = 0; i + 1 < mgui_histogram::BUCKETS; i++) {
+            EXPECT_EQ(mgui_histogram::bucket_upper(i) + 1, mgui_histogram::bucket_lower(i + 1)) << i;
+        }
+        const mgui_word32 values[] = { 5, 17, 100, 1000, 16667, 33333, 123456, 1u << 20, 0x80000001u };
+        for (mgui_word32 v : values) {
+            const int index = mgui_histogram::bucket_index(v);
+            EXPECT_LE(mgui_histogram::bucket_lower(index), v) << v;
+            EXPECT_GE(mgui_histogram::bucket_upper(index), v) << v;
+            // within 25%
+            EXPECT_LE(mgui_histogram::bucket_upper(index) - mgui_histogram::bucket_lower(index), v / 4) << v;
+        }
+    }
+
+    TEST(Histogram, Percentiles) {
+        mgui_histogram histogram;
+        EXPECT_EQ(0u, histogram.count());
+        EXPECT_EQ(0u, histogram.min());
+        EXPECT_EQ(0u, histogram.percentile(50));
+
+        for (mgui_word32 v = 1; v <= 1000; v++) {
+            histogram.record(v);
+        }
+        EXPECT_EQ(1000u, histogram.count());
+        EXPECT_EQ(1u, histogram.min());
+        EXPECT_EQ(1000u, histogram.max());
+
+        const int percents[] = { 50, 95, 99 };
+        for (int p : percents) {
+            const mgui_word32 exact = p * 10;
+            const mgui_word32 value = histogram.percentile(p);
+            EXPECT_GE(value, exact) << p;
+            EXPECT_LE(value, exact + exact / 4) << p;
+        }
+        EXPECT_EQ(1000u, histogram.percentile(100));
+        EXPECT_EQ(1u, histogram.percentile(0));
+
+        histogram.reset();
+        EXPECT_EQ(0u, histogram.count());
+        EXPECT_EQ(0u, histogram.max());
+    }
+
+    TEST(Histogram, Write) {
+        mgui_histogram histogram;
+        histogram.record(2);
+        histogram.record(2);
+        histogram.record(100);
+
+        char line[256];
+        const int length = histogram.write("frame", line, sizeof(line));
+        ASSERT_GT(length, 0);
+        EXPECT_EQ((int)strlen(line), length);
+        const std::string expected = "frame 3 2 100 2 100 100 2:2 "
+            + std::to_string(mgui_histogram::bucket_index(100)) + ":1\n";
+        EXPECT_EQ(expected, line);
+
+        // too small
+        EXPECT_EQ(-1, histogram.write("frame", line, 12));
+    }
+
+    TEST(Histogram, ReadFromAnotherThread) {
+        mgui_histogram histogram;
+        std::atomic<bool> done(false);
+        std::thread writer([&] {
+            for (mgui_word32 i = 0; i < 200000; i++) {
+                histogram.record(i & 1023);
+            }
+            done = true;
+        });
+
+        // the counters only grow
+        mgui_word32 last = 0;
+        while (!done) {
+            const mgui_word32 count = histogram.count();
+            EXPECT_GE(count, last);
+            last = count;
+            (void)histogram.percentile(99);
+        }
+        writer.join();
+        EXPECT_EQ(200000u, histogram.count());
+        EXPECT_EQ(1023u, histogram.max());
+    }
+
+    TEST(FrameTelemetry, FrameTransferAndLatency) {
+        now = 0;
+        button = 0;
+        mgui gui(128, 64);
+        mgui_input input;
+        input.add(&read_button);
+        gui.set_input(&input);
+        busy_object busy(100);
+        gui.add((mgui_object*)&busy);
+
+        mgui_telemetry telemetry(&read_clock);
+        gui.set_frame_listener(&telemetry);
+
+        auto frame = [&](unsigned long transfer_us) {
+            gui.update_lcd();
+            telemetry.begin_transfer();
+            now += transfer_us;
+            telemetry.end_transfer();
+            now += 1000;
+        };
+
+        // the first update is not an event
+        frame(500);
+        frame(500);
+        EXPECT_EQ(0u, telemetry.latency().count());
+
+        // read at the beginning of the frame: 100 us to draw and 500 us to send
+        button = 1;
+        frame(500);
+        EXPECT_EQ(1u, telemetry.latency().count());
+        EXPECT_EQ(600u, telemetry.latency().max());
+        frame(500);
+        EXPECT_EQ(1u, telemetry.latency().count());
+
+        // an event waits for the next transfer
+        button = 0;
+        gui.update_lcd();
+        now += 1000;
+        button = 1;
+        gui.update_lcd();
+        telemetry.begin_transfer();
+        now += 200;
+        telemetry.end_transfer();
+        EXPECT_EQ(2u, telemetry.latency().count());
+        EXPECT_EQ(1400u, telemetry.latency().max());
+
+        EXPECT_EQ(6u, telemetry.frame().count());
+        EXPECT_EQ(100u, telemetry.frame().min());
+        EXPECT_EQ(100u, telemetry.frame().max());
+        EXPECT_EQ(5u, telemetry.transfer().count());
+        EXPECT_EQ(200u, telemetry.transfer().min());
+        EXPECT_EQ(500u, telemetry.transfer().max());
+
+        gui.set_frame_listener(nullptr);
+        gui.update_lcd();
+        EXPECT_EQ(6u, telemetry.frame().count());
+
+        telemetry.reset();
+        EXPECT_EQ(0u, telemetry.frame().count());
+        EXPECT_EQ(0u, telemetry.latency().count());
+    }
+
+    TEST(FrameTelemetry, MultiAndExport) {
+        now = 0;
+        button = 0;
+        mgui_multi gui(128, 64);
+        gui.input()->add(&read_button);
+        busy_object busy(40);
+        gui.add("main", (mgui_object*)&busy);
+
+        mgui_telemetry telemetry(&read_clock);
+        gui.set_frame_listener(&telemetry);
+        for (int i = 0; i < 10; i++) {
+            button = (i == 5);
+            gui.update_lcd();
+            telemetry.begin_transfer();
+            now += 300;
+            telemetry.end_transfer();
+        }
+        EXPECT_EQ(10u, telemetry.frame().count());
+        EXPECT_EQ(10u, telemetry.transfer().count());
+        // pressed and released
+        EXPECT_EQ(2u, telemetry.latency().count());
+        EXPECT_EQ(340u, telemetry.latency().max());
+
+        char text[512];
+        const int length = telemetry.write(text, sizeof(text));
+        ASSERT_GT(length, 0);
+        EXPECT_EQ((int)strlen(text), length);
+        EXPECT_EQ(0, strncmp(text, "mgui-telemetry 1\nframe 10 40 40 40 40 40 ", 41));
+        EXPECT_NE(nullptr, strstr(text, "\ntransfer 10 300 300 300 300 300 "));
+        EXPECT_NE(nullptr, strstr(text, "\nlatency 2 340 340 340 340 340 "));
+        EXPECT_EQ(-1, telemetry.write(text, 40));
+
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        telemetry.print(file);
+        rewind(file);
+        char line[256];
+        ASSERT_NE(nullptr, fgets(line, sizeof(line), file));
+        EXPECT_NE(nullptr, strstr(line, "p50 40 us, p95 40 us, p99 40 us"));
+        fclose(file);
+    }
+
+    TEST(FrameBudget, DeadlineHolds) {
+        now = 0;
+        mgui_multi gui(128, 64);
+        deferrable_object chart(500, 11500);
+        busy_object status(4000);
+        busy_object focused(6000);
+        gui.add("main", (mgui_object*)&chart);
+        gui.add("main", (mgui_object*)&status);
+        gui.add("main", (mgui_object*)&focused);
+        gui.set_priority((mgui_object*)&chart, mgui_priority::Low);
+        gui.set_priority((mgui_object*)&focused, mgui_priority::High);
+        EXPECT_EQ(mgui_priority::Normal, gui.frame_budget().priority((mgui_object*)&status));
+
+        mgui_telemetry telemetry(&read_clock);
+        gui.set_frame_listener(&telemetry);
+        gui.set_frame_budget(33000, &read_clock);
+        EXPECT_EQ(33000ul, gui.frame_budget().budget());
+
+        // 22 ms: nothing is deferred
+        for (int i = 0; i < 5; i++) {
+            gui.update_lcd();
+            EXPECT_EQ(22000ul, gui.frame_budget().last());
+        }
+        EXPECT_EQ(5, chart.works);
+        EXPECT_EQ(0u, telemetry.deferrals());
+        EXPECT_EQ(12000ul, gui.frame_budget().cost((mgui_object*)&chart));
+
+        // the focused object becomes slow: its first frame is measured, then the chart waits
+        focused.set_us(24000);
+        gui.update_lcd();
+        EXPECT_EQ(40000ul, gui.frame_budget().last());
+        for (int i = 0; i < 10; i++) {
+            gui.update_lcd();
+            EXPECT_LE(gui.frame_budget().last(), 33000ul) << i;
+        }
+        EXPECT_EQ(6, chart.works);
+        EXPECT_EQ(10u, telemetry.deferred_frames());
+        EXPECT_EQ(10u, telemetry.deferrals());
+        // the deferred time is not measured
+        EXPECT_EQ(12000ul, gui.frame_budget().cost((mgui_object*)&chart));
+
+        // back to normal: the chart waits for one more frame
+        focused.set_us(6000);
+        for (int i = 0; i < 4; i++) {
+            gui.update_lcd();
+        }
+        EXPECT_EQ(9, chart.works);
+        EXPECT_EQ(11u, telemetry.deferred_frames());
+
+        char text[512];
+        ASSERT_GT(telemetry.write(text, sizeof(text)), 0);
+        EXPECT_NE(nullptr, strstr(text, "\ndeferred 11 11\n"));
+
+        // without a budget nothing is deferred
+        gui.set_frame_budget(0, &read_clock);
+        focused.set_us(40000);
+        gui.update_lcd();
+        gui.update_lcd();
+        EXPECT_EQ(11, chart.works);
+        EXPECT_EQ(11u, telemetry.deferred_frames());
+    }
+
+    TEST(FrameBudget, NormalObjectsUseTheWholeBudget) {
+        now = 0;
+        mgui gui(128, 64);
+        deferrable_object low(0, 10000);
+        deferrable_object normal(0, 10000);
+        busy_object before(16000);
+        gui.add((mgui_object*)&before);
+        gui.add((mgui_object*)&low);
+        gui.add((mgui_object*)&normal);
+        gui.set_priority((mgui_object*)&low, mgui_priority::Low);
+        gui.set_frame_budget(33000, &read_clock);
+
+        // 16 + 10 ms passes three quarters of the budget, but fits in it
+        gui.update_lcd();
+        EXPECT_EQ(36000ul, gui.frame_budget().last());
+        gui.update_lcd();
+        EXPECT_EQ(1, low.works);
+        EXPECT_EQ(2, normal.works);
+        EXPECT_EQ(26000ul, gui.frame_budget().last());
+
+        // a removed object is forgotten
+        gui.remove((mgui_object*)&low);
+        EXPECT_EQ(mgui_priority::Normal, gui.frame_budget().priority((mgui_object*)&low));
+        EXPECT_EQ(0ul, gui.frame_budget().cost((mgui_object*)&low));
+    }
+
+    TEST(FrameBudget, MarqueeWaitsButFocusedItemMoves) {
+        now = 0;
+        font_16x8 font;
+        busy_object focused(40000);
+
+        // a moving text, deferred after the first frame
+        mgui_text text(&font, "This is long text sample.");
+        text.set_view_width(64);
+        text.set_view_height(font.height());
+        text.set_move(true);
+        mgui gui(128, 64);
+        gui.add((mgui_object*)&focused);
+        gui.add((mgui_object*)&text);
+        gui.set_priority((mgui_object*)&focused, mgui_priority::High);
+        gui.set_priority((mgui_object*)&text, mgui_priority::Low);
+        gui.set_frame_budget(33000, &read_clock);
+        mgui_telemetry telemetry(&read_clock);
+        gui.set_frame_listener(&telemetry);
+        gui.update_lcd();
+        gui.update_lcd();
+        std::string shown((const char*)gui.lcd(), 1024);
+        for (int i = 0; i < 4; i++) {
+            gui.update_lcd();
+            EXPECT_EQ(shown, std::string((const char*)gui.lcd(), 1024)) << i;
+        }
+        EXPECT_TRUE(gui.animating());
+        // the frames are over the budget after the focused object
+        EXPECT_EQ(6u, telemetry.deferrals());
+
+        // the text of the focused menu item moves in a deferred menu
+        mgui_text long_item(&font, "1234567890abcdefghij");
+        mgui_menu_item item(&long_item);
+        mgui_menu menu(112, 64);
+        menu.add(&item);
+        mgui menu_gui(128, 64);
+        menu_gui.add((mgui_object*)&focused);
+        menu_gui.add((mgui_object*)&menu);
+        menu_gui.set_priority((mgui_object*)&focused, mgui_priority::High);
+        menu_gui.set_priority((mgui_object*)&menu, mgui_priority::Low);
+        menu_gui.set_frame_budget(33000, &read_clock);
+        menu_gui.update_lcd();
+        shown.assign((const char*)menu_gui.lcd(), 1024);
+        int moved = 0;
+        for (int i = 0; i < 4; i++) {
+            menu_gui.update_lcd();
+            moved += shown != std::string((const char*)menu_gui.lcd(), 1024);
+            shown.assign((const char*)menu_gui.lcd(), 1024);
+        }
+        EXPECT_GE(moved, 2);
+    }
+}
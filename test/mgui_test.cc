@@ -3,6 +3,7 @@
 
 #include "../mGUI/mgui.h"
 #include "font_16x8.h"
+#include "font_16x8_aa.h"
 
 constexpr int WIDTH = 128;
 constexpr int HEIGHT = 64;
@@ -1033,4 +1034,1355 @@ namespace UserInterface {
         scroll.set_on_select_next(true);
         EXPECT_EQ(scroll.current_index(), 3);
     }
-}
\ No newline at end of file
+}
+namespace Orientation {
+
+    static bool get_pixel(const unsigned char* buffer, int width, int x, int y) {
+        return (buffer[(y >> 3) * width + x] >> (y & 7)) & 1;
+    }
+
+    static unsigned long long reference_transpose(unsigned long long x) {
+        unsigned long long result = 0;
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 8; j++) {
+                if ((x >> (i * 8 + j)) & 1) {
+                    result |= 1ULL << (j * 8 + i);
+                }
+            }
+        }
+        return result;
+    }
+
+    TEST(BitMatrix, Transpose) {
+        unsigned long long seed = 0x0123456789ABCDEFULL;
+        for (int n = 0; n < 1000; n++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            unsigned long long expected = reference_transpose(seed);
+
+            EXPECT_EQ(mgui_bit_matrix::transpose8x8_64(seed), expected);
+
+            mgui_word32 lo = (mgui_word32)seed;
+            mgui_word32 hi = (mgui_word32)(seed >> 32);
+            mgui_bit_matrix::transpose8x8_32(lo, hi);
+            EXPECT_EQ(((unsigned long long)hi << 32) | lo, expected);
+
+#ifdef MGUI_USE_SSE2
+            unsigned char src[16];
+            memcpy(src, &seed, 8);
+            unsigned long long inverted = ~seed;
+            memcpy(src + 8, &inverted, 8);
+            mgui_word64 first, second;
+            mgui_bit_matrix::transpose8x8x2_sse2(src, first, second);
+            EXPECT_EQ(first, expected);
+            EXPECT_EQ(second, reference_transpose(inverted));
+#endif
+        }
+    }
+
+    class RotationTest :
+        public testing::TestWithParam<std::tuple<mgui_rotation, bool, bool>> {};
+
+    TEST_P(RotationTest, Pixels) {
+        mgui_rotation rotation = std::get<0>(GetParam());
+        bool mirror_x = std::get<1>(GetParam());
+        bool mirror_y = std::get<2>(GetParam());
+
+        mgui g(WIDTH, HEIGHT);
+        g.set_rotation(rotation, mirror_x, mirror_y);
+
+        bool transpose = rotation == mgui_rotation::Rotate90 || rotation == mgui_rotation::Rotate270;
+        EXPECT_EQ(g.width(), transpose ? HEIGHT : WIDTH);
+        EXPECT_EQ(g.height(), transpose ? WIDTH : HEIGHT);
+
+        // Asymmetric pattern
+        mgui_pixel pixels[6] = {
+            mgui_pixel(0, 0, true), mgui_pixel(1, 0, true), mgui_pixel(0, 3, true),
+            mgui_pixel(13, 9, true), mgui_pixel(40, 60, true), mgui_pixel(g.width() - 1, g.height() - 2, true)
+        };
+        for (auto& pixel : pixels) {
+            g.add((mgui_object*)&pixel);
+        }
+        g.update_lcd();
+
+        int count = 0;
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                count += get_pixel(g.lcd(), WIDTH, x, y);
+            }
+        }
+        EXPECT_EQ(count, 6);
+
+        for (auto& pixel : pixels) {
+            int lx = pixel.x();
+            int ly = pixel.y();
+            int px = lx;
+            int py = ly;
+            switch (rotation) {
+            case mgui_rotation::Rotate90:
+                px = WIDTH - 1 - ly;
+                py = lx;
+                break;
+            case mgui_rotation::Rotate180:
+                px = WIDTH - 1 - lx;
+                py = HEIGHT - 1 - ly;
+                break;
+            case mgui_rotation::Rotate270:
+                px = ly;
+                py = HEIGHT - 1 - lx;
+                break;
+            default:
+                break;
+            }
+            if (mirror_x) px = WIDTH - 1 - px;
+            if (mirror_y) py = HEIGHT - 1 - py;
+
+            EXPECT_TRUE(get_pixel(g.lcd(), WIDTH, px, py)) << lx << "," << ly;
+        }
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        All,
+        RotationTest,
+        testing::Combine(
+            testing::Values(mgui_rotation::Rotate0, mgui_rotation::Rotate90,
+                            mgui_rotation::Rotate180, mgui_rotation::Rotate270),
+            testing::Bool(),
+            testing::Bool()
+        )
+    );
+
+    TEST(RotationTest, Multi) {
+        mgui_multi g(WIDTH, HEIGHT);
+        g.set_rotation(mgui_rotation::Rotate270);
+
+        mgui_pixel pixel(2, 5, true);
+        g.add("main", (mgui_object*)&pixel);
+        g.update_lcd();
+
+        EXPECT_TRUE(get_pixel(g.lcd(), WIDTH, 5, HEIGHT - 1 - 2));
+    }
+
+    TEST(RotationTest, UnalignedWidth) {
+        const int width = WIDTH - 4;
+        mgui g(width, HEIGHT);
+        mgui_multi multi(width, HEIGHT);
+
+        // the conversion works on 8x8 blocks, so only the identity is kept
+        g.set_rotation(mgui_rotation::Rotate180);
+        g.set_rotation(mgui_rotation::Rotate0, true);
+        multi.set_rotation(mgui_rotation::Rotate90);
+        EXPECT_EQ(width, g.width());
+        EXPECT_EQ(width, multi.width());
+        EXPECT_EQ(HEIGHT, multi.height());
+
+        mgui_pixel pixel(2, 5, true);
+        mgui_pixel other(2, 5, true);
+        g.add((mgui_object*)&pixel);
+        multi.add("main", (mgui_object*)&other);
+        g.update_lcd();
+        multi.update_lcd();
+        EXPECT_TRUE(get_pixel(g.lcd(), width, 2, 5));
+        EXPECT_TRUE(get_pixel(multi.lcd(), width, 2, 5));
+
+        g.set_rotation(mgui_rotation::Rotate0);
+        g.update_lcd();
+        EXPECT_TRUE(get_pixel(g.lcd(), width, 2, 5));
+    }
+}
+
+namespace Kernel {
+
+    template <typename K>
+    class KernelTest : public testing::Test {};
+
+    typedef testing::Types<
+        mgui_buffer_kernel<mgui_simd_swar32>,
+        mgui_buffer_kernel<mgui_simd_swar64>
+#ifdef MGUI_USE_SSE2
+        , mgui_buffer_kernel<mgui_simd_sse2>
+#endif
+#ifdef MGUI_USE_AVX2
+        , mgui_buffer_kernel<mgui_simd_avx2>
+#endif
+#ifdef MGUI_USE_NEON
+        , mgui_buffer_kernel<mgui_simd_neon>
+#endif
+    > KernelTypes;
+
+    TYPED_TEST_SUITE(KernelTest, KernelTypes);
+
+    static void fill_random(unsigned char* buffer, int size, unsigned int seed) {
+        for (int i = 0; i < size; i++) {
+            seed = seed * 1103515245 + 12345;
+            buffer[i] = (unsigned char)(seed >> 16);
+        }
+    }
+
+    // Sizes around the vector widths, including an unaligned start.
+    static const int SIZES[] = { 0, 1, 3, 4, 7, 8, 15, 16, 31, 33, 64, 100, 1024 };
+
+    TYPED_TEST(KernelTest, FillCopyInvert) {
+        unsigned char a[1030], b[1030];
+        for (int size : SIZES) {
+            fill_random(a, sizeof(a), size);
+            TypeParam::fill(a + 1, 0x5A, size);
+            for (int i = 0; i < size; i++) EXPECT_EQ(a[1 + i], 0x5A);
+
+            fill_random(a, sizeof(a), size + 1);
+            TypeParam::copy(b + 1, a + 1, size);
+            EXPECT_EQ(memcmp(a + 1, b + 1, size), 0);
+
+            TypeParam::invert(b + 1, size);
+            for (int i = 0; i < size; i++) EXPECT_EQ(b[1 + i], (unsigned char)~a[1 + i]);
+        }
+    }
+
+    TYPED_TEST(KernelTest, Composite) {
+        unsigned char a[1030], b[1030], expected[1030];
+        for (int size : SIZES) {
+            fill_random(a, sizeof(a), size);
+            fill_random(b, sizeof(b), size * 7 + 1);
+
+            for (int i = 0; i < size; i++) expected[i] = a[i] | b[i];
+            TypeParam::or_into(a, b, size);
+            EXPECT_EQ(memcmp(a, expected, size), 0);
+
+            for (int i = 0; i < size; i++) expected[i] = a[i] & ~b[i];
+            TypeParam::and_not_into(a, b, size);
+            EXPECT_EQ(memcmp(a, expected, size), 0);
+
+            for (int i = 0; i < size; i++) expected[i] = a[i] | 0x24;
+            TypeParam::or_mask(a, 0x24, size);
+            EXPECT_EQ(memcmp(a, expected, size), 0);
+
+            for (int i = 0; i < size; i++) expected[i] = a[i] & 0x81;
+            TypeParam::and_mask(a, 0x81, size);
+            EXPECT_EQ(memcmp(a, expected, size), 0);
+        }
+    }
+
+    TYPED_TEST(KernelTest, Pattern) {
+        const unsigned char pattern[8] = { 0x11, 0x22, 0x44, 0x88, 0x11, 0x22, 0x44, 0x88 };
+        unsigned char a[1030], expected[1030];
+        for (int size : SIZES) {
+            for (int phase = 0; phase < 8; phase++) {
+                fill_random(a, sizeof(a), size + phase);
+                for (int i = 0; i < size; i++) {
+                    expected[i] = (a[i] & ~0x3C) | (pattern[(phase + i) & 7] & 0x3C);
+                }
+                TypeParam::fill_pattern(a, pattern, phase, 0x3C, size);
+                EXPECT_EQ(memcmp(a, expected, size), 0);
+            }
+        }
+    }
+
+    TYPED_TEST(KernelTest, Diff) {
+        unsigned char a[1024], b[1024];
+        fill_random(a, sizeof(a), 3);
+        memcpy(b, a, sizeof(a));
+
+        int first = -1, last = -1;
+        EXPECT_TRUE(TypeParam::equal(a, b, sizeof(a)));
+        EXPECT_FALSE(TypeParam::diff(a, b, sizeof(a), &first, &last));
+
+        const int positions[][2] = { { 0, 0 }, { 1023, 1023 }, { 5, 900 }, { 17, 18 }, { 0, 1023 } };
+        for (const auto& position : positions) {
+            memcpy(b, a, sizeof(a));
+            b[position[0]] ^= 1;
+            b[position[1]] ^= 0x80;
+
+            EXPECT_FALSE(TypeParam::equal(a, b, sizeof(a)));
+            EXPECT_TRUE(TypeParam::diff(a, b, sizeof(a), &first, &last));
+            EXPECT_EQ(first, position[0]);
+            EXPECT_EQ(last, position[1]);
+        }
+    }
+
+    // Per-pixel versions of the primitives, as they were drawn before the span kernels.
+    static void reference_rectangle_fill(mgui_draw& d, int x0, int y0, int x1, int y1, bool on) {
+        for (int x = x0; x <= x1; x++) {
+            for (int y = y0; y <= y1; y++) {
+                if (x >= 0 && y >= 0) d.draw_pixel(x, y, on);
+            }
+        }
+    }
+
+    static void reference_circle_fill(mgui_draw& d, int x0, int y0, int r) {
+        int x = r;
+        int y = 0;
+        int f = -(r << 1) + 3;
+        while (x >= y) {
+            for (int xd = 0; xd < x; xd++) {
+                const int points[8][2] = {
+                    { x0 + xd, y0 + y }, { x0 + y, y0 - xd }, { x0 + xd, y0 - y }, { x0 + y, y0 + xd },
+                    { x0 - xd, y0 + y }, { x0 - y, y0 + xd }, { x0 - xd, y0 - y }, { x0 - y, y0 - xd } };
+                for (const auto& p : points) {
+                    if (p[0] >= 0 && p[1] >= 0) d.draw_pixel(p[0], p[1], true);
+                }
+            }
+            if (f >= 0) {
+                x--;
+                f -= (x << 2);
+            }
+            y++;
+            f += (y << 2) + 2;
+        }
+    }
+
+    static void reference_rounded_fill(mgui_draw& d, int x0, int y0, int x1, int y1, int r) {
+        int x = r;
+        int y = 0;
+        int f = -(r << 1) + 3;
+        int px0 = x0 + r;
+        int px1 = x1 - r;
+        int py0 = y0 + r;
+        int py1 = y1 - r;
+        while (x >= y) {
+            for (int xd = 0; xd <= x; xd++) {
+                const int points[8][2] = {
+                    { px1 + xd, py0 - y }, { px1 + y, py0 - xd }, { px1 + xd, py1 + y }, { px1 + y, py1 + xd },
+                    { px0 - xd, py1 + y }, { px0 - y, py1 + xd }, { px0 - xd, py0 - y }, { px0 - y, py0 - xd } };
+                for (const auto& p : points) {
+                    if (p[0] >= 0 && p[1] >= 0) d.draw_pixel(p[0], p[1], true);
+                }
+            }
+            if (f >= 0) {
+                x--;
+                f -= (x << 2);
+            }
+            y++;
+            f += (y << 2) + 2;
+        }
+        reference_rectangle_fill(d, x0, py0, x0 + r, py1, true);
+        reference_rectangle_fill(d, px1, py0, px1 + r, py1, true);
+        reference_rectangle_fill(d, px0, y0, px1, y1, true);
+    }
+
+    class SpanTest :
+        public testing::TestWithParam<P_A5> {};
+
+    TEST_P(SpanTest, SameAsPixels) {
+        int x0 = std::get<0>(GetParam());
+        int y0 = std::get<1>(GetParam());
+        int x1 = std::get<2>(GetParam());
+        int y1 = std::get<3>(GetParam());
+        int r = std::get<4>(GetParam());
+
+        unsigned char actual[BUFFER_SIZE] = {};
+        unsigned char expected[BUFFER_SIZE] = {};
+        mgui_draw a(WIDTH, HEIGHT, actual);
+        mgui_draw e(WIDTH, HEIGHT, expected);
+
+        a.draw_rectangle(x0, y0, x1, y1, true);
+        reference_rectangle_fill(e, x0, y0, x1, y1, true);
+        EXPECT_EQ(memcmp(actual, expected, BUFFER_SIZE), 0);
+
+        a.draw_rectangle(x0 + 1, y0 + 1, x1 - 1, y1 - 1, true, false);
+        reference_rectangle_fill(e, x0 + 1, y0 + 1, x1 - 1, y1 - 1, false);
+        EXPECT_EQ(memcmp(actual, expected, BUFFER_SIZE), 0);
+
+        a.clear();
+        e.clear();
+        a.draw_circle(x0, y0, r, true);
+        reference_circle_fill(e, x0, y0, r);
+        EXPECT_EQ(memcmp(actual, expected, BUFFER_SIZE), 0);
+
+        a.clear();
+        e.clear();
+        a.draw_rectangle_rounded(x0, y0, x1, y1, r, true);
+        reference_rounded_fill(e, x0, y0, x1, y1, r);
+        EXPECT_EQ(memcmp(actual, expected, BUFFER_SIZE), 0);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        On,
+        SpanTest,
+        testing::Values(
+            P_A5{ 2, 2, 12, 12, 2 },
+            P_A5{ 0, 0, 31, 31, 8 },
+            P_A5{ 0, 48, 127, 63, 2 },
+            P_A5{ 3, 5, 100, 60, 10 },
+            P_A5{ 32, 32, 60, 41, 20 },
+            P_A5{ 120, 7, 140, 70, 4 }
+        )
+    );
+
+    TEST(DrawTest, Pattern) {
+        const unsigned char pattern[8] = { 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA };
+        unsigned char buffer[BUFFER_SIZE] = {};
+        mgui_draw d(WIDTH, HEIGHT, buffer);
+
+        d.fill_pattern(3, 5, 20, 30, pattern);
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                bool inside = 3 <= x && x <= 20 && 5 <= y && y <= 30;
+                bool expected = inside && ((pattern[x & 7] >> (y & 7)) & 1);
+                EXPECT_EQ((buffer[_byte_index(x, y)] >> (y & 7)) & 1, expected ? 1 : 0);
+            }
+        }
+
+        d.invert();
+        EXPECT_EQ(buffer[0], 0xFF);
+        d.clear();
+        EXPECT_EQ(buffer[0], 0x00);
+    }
+}
+
+namespace Grayscale {
+
+    static int mono_pixel(unsigned char* buffer, int x, int y) {
+        return (buffer[_byte_index(x, y)] >> (y & 7)) & 1;
+    }
+
+    TEST(GrayTest, BufferSize) {
+        EXPECT_EQ(mgui_draw::buffer_size(WIDTH, HEIGHT, mgui_pixel_format::Mono1), BUFFER_SIZE);
+        EXPECT_EQ(mgui_draw::buffer_size(WIDTH, HEIGHT, mgui_pixel_format::Gray2), WIDTH * HEIGHT / 4);
+        EXPECT_EQ(mgui_draw::buffer_size(256, 64, mgui_pixel_format::Gray4), 8192);
+    }
+
+    TEST(GrayTest, PixelPacking) {
+        unsigned char buffer[WIDTH * HEIGHT / 2] = {};
+        mgui_draw d(WIDTH, HEIGHT, buffer, mgui_pixel_format::Gray4);
+
+        d.set_intensity(0xA0);
+        d.draw_pixel(0, 0, true);
+        d.set_intensity(0x30);
+        d.draw_pixel(1, 0, true);
+        d.draw_pixel(3, 1, true);
+        EXPECT_EQ(buffer[0], 0xA3);
+        EXPECT_EQ(buffer[WIDTH / 2 + 1], 0x03);
+        EXPECT_EQ(d.pixel_level(0, 0), 0xA);
+
+        d.draw_pixel(0, 0, false);
+        EXPECT_EQ(buffer[0], 0x03);
+
+        // Outside of the screen
+        d.draw_pixel(-1, 0, true);
+        d.draw_pixel(WIDTH, HEIGHT - 1, true);
+        d.draw_pixel(0, HEIGHT, true);
+        EXPECT_EQ(buffer[WIDTH * HEIGHT / 2 - 1], 0x00);
+
+        unsigned char buffer2[WIDTH * HEIGHT / 4] = {};
+        mgui_draw d2(WIDTH, HEIGHT, buffer2, mgui_pixel_format::Gray2);
+        d2.set_intensity(0x80);
+        d2.draw_pixel(1, 0, true);
+        d2.draw_pixel(3, 0, true);
+        EXPECT_EQ(buffer2[0], 0x22);
+    }
+
+    class GrayFillTest :
+        public testing::TestWithParam<std::tuple<mgui_pixel_format, int, int, int, int>> {};
+
+    TEST_P(GrayFillTest, SameAsPixels) {
+        mgui_pixel_format format = std::get<0>(GetParam());
+        int x0 = std::get<1>(GetParam());
+        int y0 = std::get<2>(GetParam());
+        int x1 = std::get<3>(GetParam());
+        int y1 = std::get<4>(GetParam());
+
+        unsigned char actual[WIDTH * HEIGHT / 2] = {};
+        unsigned char expected[WIDTH * HEIGHT / 2] = {};
+        mgui_draw a(WIDTH, HEIGHT, actual, format);
+        mgui_draw e(WIDTH, HEIGHT, expected, format);
+        a.set_intensity(0xC0);
+        e.set_intensity(0xC0);
+
+        a.draw_rectangle(x0, y0, x1, y1, true);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) e.draw_pixel(x, y, true);
+        }
+        EXPECT_EQ(memcmp(actual, expected, a.buffer_size()), 0);
+
+        a.draw_rectangle(x0 + 1, y0 + 1, x1 - 1, y1 - 1, true, false);
+        for (int y = y0 + 1; y <= y1 - 1; y++) {
+            for (int x = x0 + 1; x <= x1 - 1; x++) e.draw_pixel(x, y, false);
+        }
+        EXPECT_EQ(memcmp(actual, expected, a.buffer_size()), 0);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Rect,
+        GrayFillTest,
+        testing::Combine(
+            testing::Values(mgui_pixel_format::Gray2, mgui_pixel_format::Gray4),
+            testing::Values(-3, 0, 1, 5),
+            testing::Values(-1, 3),
+            testing::Values(2, 6, 8, 63, 130),
+            testing::Values(4, 70)
+        )
+    );
+
+    // Every monochrome primitive and widget draws the same shape on grayscale.
+    TEST(GrayTest, SameShapeAsMono) {
+        font_16x8 font;
+        mgui_text text(&font, "Gray 123");
+        text.set_x(3);
+        text.set_y(40);
+
+        mgui_rectangle rect;
+        rect.set_x(5);
+        rect.set_y(3);
+        rect.set_width(50);
+        rect.set_height(30);
+        rect.set_radius(6);
+        rect.set_fill(true);
+
+        mgui_rectangle hole;
+        hole.set_x(9);
+        hole.set_y(7);
+        hole.set_width(20);
+        hole.set_height(10);
+        hole.set_fill(true);
+        hole.set_invert(true);
+
+        mgui_circle circle;
+        circle.set_x(90);
+        circle.set_y(30);
+        circle.set_radius(17);
+        circle.set_fill(true);
+
+        mgui_triangle triangle;
+        triangle.set_x0(60);
+        triangle.set_y0(60);
+        triangle.set_x1(127);
+        triangle.set_y1(50);
+        triangle.set_x2(100);
+        triangle.set_y2(2);
+
+        const mgui_pixel_format formats[] = { mgui_pixel_format::Gray2, mgui_pixel_format::Gray4 };
+        for (mgui_pixel_format format : formats) {
+            mgui mono(WIDTH, HEIGHT);
+            mgui gray(WIDTH, HEIGHT, format);
+            mgui_object* objects[] = {
+                (mgui_object*)&rect, (mgui_object*)&hole, (mgui_object*)&circle,
+                (mgui_object*)&triangle, (mgui_object*)&text };
+            for (mgui_object* object : objects) {
+                mono.add(object);
+                gray.add(object);
+            }
+            mono.update_lcd();
+            gray.update_lcd();
+
+            mgui_draw levels(WIDTH, HEIGHT, gray.lcd(), format);
+            const int max = format == mgui_pixel_format::Gray4 ? 15 : 3;
+            for (int y = 0; y < HEIGHT; y++) {
+                for (int x = 0; x < WIDTH; x++) {
+                    EXPECT_EQ(levels.pixel_level(x, y), mono_pixel(mono.lcd(), x, y) ? max : 0);
+                }
+            }
+        }
+    }
+
+    TEST(GrayTest, LevelsOnMono) {
+        // levels 0, 1, 2, 3 of a 2-bit image
+        static const uint8_t levels[] = { 0x1B };
+        mgui_image_property image(4, 1, levels, 2);
+        unsigned char buffer[BUFFER_SIZE] = {};
+        mgui_draw d(WIDTH, HEIGHT, buffer);
+
+        d.draw_rectangle(0, 0, 7, 7, true);
+        d.draw_image(&image, 0, 0);
+        // the low levels are transparent, not cleared
+        for (int x = 0; x < 4; x++) {
+            EXPECT_EQ(1, mono_pixel(buffer, x, 0)) << x;
+        }
+
+        d.draw_image(&image, 0, 0, true);
+        EXPECT_EQ(1, mono_pixel(buffer, 0, 0));
+        EXPECT_EQ(1, mono_pixel(buffer, 1, 0));
+        EXPECT_EQ(0, mono_pixel(buffer, 2, 0));
+        EXPECT_EQ(0, mono_pixel(buffer, 3, 0));
+
+        d.draw_rectangle(0, 0, 7, 7, true, false);
+        d.draw_image(&image, 0, 0);
+        EXPECT_EQ(0, mono_pixel(buffer, 1, 0));
+        EXPECT_EQ(1, mono_pixel(buffer, 2, 0));
+        EXPECT_EQ(1, mono_pixel(buffer, 3, 0));
+    }
+
+    TEST(GrayTest, CircleRows) {
+        for (int r = 0; r <= 40; r++) {
+            unsigned char mono[BUFFER_SIZE] = {};
+            unsigned char gray[WIDTH * HEIGHT / 4] = {};
+            mgui_draw m(WIDTH, HEIGHT, mono);
+            mgui_draw g(WIDTH, HEIGHT, gray, mgui_pixel_format::Gray2);
+            m.draw_circle(60 + (r & 3), 31, r, true);
+            g.draw_circle(60 + (r & 3), 31, r, true);
+            for (int y = 0; y < HEIGHT; y++) {
+                for (int x = 0; x < WIDTH; x++) {
+                    ASSERT_EQ(g.pixel_level(x, y), mono_pixel(mono, x, y) ? 3 : 0) << r;
+                }
+            }
+        }
+    }
+
+    TEST(GrayTest, ObjectIntensity) {
+        mgui g(WIDTH, HEIGHT, mgui_pixel_format::Gray4);
+        mgui_rectangle rect;
+        rect.set_width(4);
+        rect.set_height(2);
+        rect.set_fill(true);
+        rect.set_intensity(0x80);
+        g.add((mgui_object*)&rect);
+        g.update_lcd();
+
+        EXPECT_EQ(g.lcd()[0], 0x88);
+        EXPECT_EQ(g.lcd()[1], 0x88);
+        EXPECT_EQ(g.lcd()[2], 0x00);
+        EXPECT_EQ(g.lcd()[WIDTH / 2], 0x88);
+    }
+
+    class GrayImageTest :
+        public testing::TestWithParam<std::tuple<int, int, bool>> {};
+
+    TEST_P(GrayImageTest, Levels) {
+        int x0 = std::get<0>(GetParam());
+        int y0 = std::get<1>(GetParam());
+        bool invert = std::get<2>(GetParam());
+
+        // 16x3 image with 4 bits per pixel, levels 0..15 and transparent zeros.
+        unsigned char resource[8 * 3];
+        for (int i = 0; i < 8; i++) {
+            resource[i] = (unsigned char)(((2 * i) << 4) | (2 * i + 1));
+            resource[8 + i] = (unsigned char)(i & 1 ? 0xF0 : 0x0F);
+            resource[16 + i] = 0x00;
+        }
+        mgui_image_property image(16, 3, resource, 4);
+
+        unsigned char buffer[WIDTH * HEIGHT / 2];
+        memset(buffer, 0x77, sizeof(buffer));
+        mgui_draw d(WIDTH, HEIGHT, buffer, mgui_pixel_format::Gray4);
+        d.draw_image(&image, x0, y0, invert);
+
+        for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 16; x++) {
+                if (x0 + x < 0 || x0 + x >= WIDTH || y0 + y < 0 || y0 + y >= HEIGHT) continue;
+                int level = (resource[y * 8 + x / 2] >> ((x & 1) ? 0 : 4)) & 0xF;
+                int expected = level == 0 ? 7 : (invert ? 15 - level : level);
+                EXPECT_EQ(d.pixel_level(x0 + x, y0 + y), expected) << x << "," << y;
+            }
+        }
+
+        // 2-bit source on a 4-bit screen and on a monochrome screen
+        const unsigned char two_bit[2] = { 0x1B, 0xE4 };  // 0 1 2 3 / 3 2 1 0
+        mgui_image_property image2(8, 1, two_bit, 2);
+        memset(buffer, 0, sizeof(buffer));
+        d.draw_image(&image2, 0, 0);
+        EXPECT_EQ(buffer[0], 0x05);
+        EXPECT_EQ(buffer[1], 0xAF);
+        EXPECT_EQ(buffer[2], 0xFA);
+        EXPECT_EQ(buffer[3], 0x50);
+
+        unsigned char mono[BUFFER_SIZE] = {};
+        mgui_draw m(WIDTH, HEIGHT, mono);
+        m.draw_image(&image2, 0, 0);
+        const int expected_mono[8] = { 0, 0, 1, 1, 1, 1, 0, 0 };
+        for (int x = 0; x < 8; x++) EXPECT_EQ(mono_pixel(mono, x, 0), expected_mono[x]);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Blit,
+        GrayImageTest,
+        testing::Combine(
+            testing::Values(-2, 0, 1, 8, 120),
+            testing::Values(-1, 0, 62),
+            testing::Bool()
+        )
+    );
+
+    TEST(GrayTest, Font) {
+        // 4x2 glyphs with 4 bits per pixel, two glyphs.
+        static const unsigned char glyphs[] = {
+            0xF0, 0x0F, 0x8F, 0xF8,
+            0x12, 0x34, 0x56, 0x78 };
+        struct font_gray : public mgui_font {
+            font_gray() : mgui_font(4, 2, glyphs, 4) {}
+            int search(const char* c) { return (*c == 'B') ? 4 : 0; }
+        } font;
+
+        unsigned char buffer[WIDTH * HEIGHT / 2] = {};
+        mgui_draw d(WIDTH, HEIGHT, buffer, mgui_pixel_format::Gray4);
+        d.draw_char(&font, 0, 0, font.search("A"));
+        d.draw_char(&font, 4, 0, font.search("B"));
+        EXPECT_EQ(buffer[0], 0xF0);
+        EXPECT_EQ(buffer[1], 0x0F);
+        EXPECT_EQ(buffer[2], 0x12);
+        EXPECT_EQ(buffer[3], 0x34);
+        EXPECT_EQ(buffer[WIDTH / 2], 0x8F);
+        EXPECT_EQ(buffer[WIDTH / 2 + 3], 0x78);
+    }
+}
+
+namespace AntiAlias {
+
+    // Blend with a rounded division, as the lookup table should give.
+    static int reference_blend(int level, int ink, int coverage, int max) {
+        return (int)floor(level + (double)(ink - level) * coverage / max + 0.5);
+    }
+
+    TEST(AntiAliasTest, BlendTable) {
+        font_16x8_aa font;
+        const unsigned char* table = font.blend_table(15, 4);
+        for (int level = 0; level < 16; level++) {
+            EXPECT_EQ(table[level], level);
+            EXPECT_EQ(table[(15 << 4) | level], 15);
+        }
+        EXPECT_EQ(table[(4 << 4) | 0], 4);
+
+        table = font.blend_table(0, 2);
+        for (int level = 0; level < 4; level++) {
+            EXPECT_EQ(table[(3 << 2) | level], 0);
+            EXPECT_EQ(table[(1 << 2) | level], reference_blend(level, 0, 1, 3));
+        }
+    }
+
+    class AntiAliasTextTest :
+        public testing::TestWithParam<std::tuple<mgui_pixel_format, int, int, bool>> {};
+
+    TEST_P(AntiAliasTextTest, SameAsReference) {
+        mgui_pixel_format format = std::get<0>(GetParam());
+        int x0 = std::get<1>(GetParam());
+        int y0 = std::get<2>(GetParam());
+        bool invert = std::get<3>(GetParam());
+        const int bpp = mgui_draw::bits_per_pixel(format);
+        const int max = (1 << bpp) - 1;
+
+        unsigned char buffer[WIDTH * HEIGHT / 2];
+        memset(buffer, 0x96, sizeof(buffer));
+        unsigned char background[WIDTH * HEIGHT / 2];
+        memcpy(background, buffer, sizeof(buffer));
+        mgui_draw d(WIDTH, HEIGHT, buffer, format);
+        mgui_draw b(WIDTH, HEIGHT, background, format);
+        d.set_intensity(0xC0);
+        const int ink = invert ? 0 : (0xC0 >> (8 - bpp));
+
+        font_16x8_aa font(2);
+        const char* text = "Ag#";
+        for (int i = 0; i < 3; i++) {
+            d.draw_char(&font, x0 + 8 * i, y0, font.search(&text[i]), invert);
+        }
+
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                int expected = b.pixel_level(x, y);
+                int i = (x - x0) >> 3;
+                if (x >= x0 && i < 3 && y >= y0 && y < y0 + 16) {
+                    const unsigned char* glyph = font.resource() + font.search(&text[i]);
+                    int gx = (x - x0) & 7;
+                    int coverage = (glyph[(y - y0) * 4 + gx / 2] >> ((gx & 1) ? 0 : 4)) & 15;
+                    coverage >>= (4 - bpp);
+                    if (coverage) {
+                        expected = reference_blend(expected, ink, coverage, max);
+                    }
+                }
+                ASSERT_EQ(d.pixel_level(x, y), expected) << x << "," << y;
+            }
+        }
+    }
+
+    INSTANTIATE_TEST_SUITE_P(
+        Blend,
+        AntiAliasTextTest,
+        testing::Combine(
+            testing::Values(mgui_pixel_format::Gray2, mgui_pixel_format::Gray4),
+            testing::Values(-3, 0, 1, 2, 3, 5, 110, 120),
+            testing::Values(-4, 0, 50),
+            testing::Bool()
+        )
+    );
+
+    TEST(AntiAliasTest, Text) {
+        font_16x8_aa aa;
+        font_16x8 mono_font;
+
+        // mgui_text draws an anti-aliased font without any setting.
+        mgui gray(WIDTH, HEIGHT, mgui_pixel_format::Gray4);
+        mgui_text text(&aa, "Hello", 3, 10);
+        gray.add((mgui_object*)&text);
+        gray.update_lcd();
+
+        unsigned char expected[WIDTH * HEIGHT / 2] = {};
+        mgui_draw d(WIDTH, HEIGHT, expected, mgui_pixel_format::Gray4);
+        for (int i = 0; i < 5; i++) {
+            d.draw_char(&aa, 3 + 8 * i, 10, aa.search(&"Hello"[i]));
+        }
+        EXPECT_EQ(memcmp(gray.lcd(), expected, sizeof(expected)), 0);
+
+        // On a monochrome screen it is the same as the 1-bit font.
+        mgui mono(WIDTH, HEIGHT);
+        mgui mono_ref(WIDTH, HEIGHT);
+        mgui_text text_ref(&mono_font, "Hello", 3, 10);
+        mono.add((mgui_object*)&text);
+        mono_ref.add((mgui_object*)&text_ref);
+        mono.update_lcd();
+        mono_ref.update_lcd();
+        EXPECT_EQ(memcmp(mono.lcd(), mono_ref.lcd(), BUFFER_SIZE), 0);
+    }
+}
+
+namespace Viewport {
+
+    static bool lit(const unsigned char* buffer, int x, int y) {
+        return (buffer[_byte_index(x, y)] >> (y & 7)) & 1;
+    }
+
+    // A filled rectangle which counts its drawings.
+    class counted_box : public mgui_object {
+    public:
+        counted_box(int x, int y, int width, int height)
+         : draws(0), inputs(0), x_(x), y_(y), width_(width), height_(height) {}
+
+        mgui_object_type type() const { return mgui_object_type::Rectangle; }
+
+        void update(mgui_draw* draw, mgui_input_state* state, mgui_string*) {
+            draws++;
+            if (state != nullptr) {
+                inputs++;
+            }
+            draw->draw_rectangle(x_, y_, x_ + width_ - 1, y_ + height_ - 1, true);
+        }
+
+        int draws;
+        int inputs;
+
+    private:
+        int x_;
+        int y_;
+        int width_;
+        int height_;
+    };
+
+    static int turn = 0;
+
+    static void read_turn(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = turn;
+    }
+
+    TEST(ViewportTest, StatusBarAndMainArea) {
+        counted_box status(100, 0, 28, 8);
+        counted_box first(0, 0, 10, 100);
+        counted_box second(20, 4, 10, 10);
+
+        mgui_multi g(WIDTH, HEIGHT);
+        g.set_adaptive_refresh(true);
+        g.add("status", (mgui_object*)&status);
+        g.add("first", (mgui_object*)&first);
+        g.add("second", (mgui_object*)&second);
+        g.select("first");
+
+        EXPECT_EQ(-1, g.add_viewport("status", 0, 4, WIDTH, 8));
+        EXPECT_EQ(-1, g.add_viewport("status", 0, 0, WIDTH, 12));
+        EXPECT_EQ(-1, g.add_viewport("status", 64, 0, 80, 8));
+        EXPECT_EQ(0, g.add_viewport("status", 0, 0, WIDTH, 8));
+        EXPECT_EQ(1, g.add_viewport(nullptr, 0, 16, WIDTH, 48));
+        EXPECT_EQ(2, g.viewport_count());
+
+        EXPECT_TRUE(g.update_lcd());
+        EXPECT_EQ(1, status.draws);
+        EXPECT_EQ(1, first.draws);
+        EXPECT_TRUE(lit(g.lcd(), 100, 0));
+        EXPECT_TRUE(lit(g.lcd(), 127, 7));
+        EXPECT_FALSE(lit(g.lcd(), 99, 0));
+        // translated to the viewport and clipped to it
+        EXPECT_TRUE(lit(g.lcd(), 0, 16));
+        EXPECT_TRUE(lit(g.lcd(), 9, 63));
+        EXPECT_FALSE(lit(g.lcd(), 0, 15));
+        EXPECT_FALSE(lit(g.lcd(), 10, 16));
+        EXPECT_FALSE(g.update_lcd());
+
+        // switching the main area does not draw the status bar again
+        uint8_t status_bar[WIDTH];
+        memcpy(status_bar, g.lcd(), WIDTH);
+        EXPECT_TRUE(g.select("second"));
+        EXPECT_TRUE(g.update_lcd());
+        EXPECT_EQ(1, status.draws);
+        EXPECT_EQ(1, second.draws);
+        EXPECT_EQ(1ul, g.viewport(0)->redraws());
+        EXPECT_EQ(2ul, g.viewport(1)->redraws());
+        EXPECT_EQ(0, memcmp(status_bar, g.lcd(), WIDTH));
+        EXPECT_FALSE(lit(g.lcd(), 0, 16));
+        EXPECT_TRUE(lit(g.lcd(), 20, 20));
+        EXPECT_FALSE(lit(g.lcd(), 20, 19));
+
+        // the status bar alone; the same pixels are not shown again
+        g.invalidate("status");
+        EXPECT_FALSE(g.update_lcd());
+        EXPECT_EQ(2, status.draws);
+        EXPECT_EQ(1, second.draws);
+
+        // a group which is not shown changes nothing
+        counted_box hidden(0, 0, 4, 4);
+        g.add("first", (mgui_object*)&hidden);
+        EXPECT_FALSE(g.update_lcd());
+        EXPECT_EQ(0, hidden.draws);
+
+        // the whole screen again
+        g.clear_viewports();
+        EXPECT_TRUE(g.update_lcd());
+        EXPECT_EQ(2, status.draws);
+        EXPECT_EQ(2, second.draws);
+        EXPECT_TRUE(lit(g.lcd(), 20, 4));
+        EXPECT_FALSE(lit(g.lcd(), 100, 0));
+    }
+
+    TEST(ViewportTest, InputAndDoubleBuffer) {
+        counted_box status(0, 0, 8, 8);
+        counted_box main(0, 0, 8, 8);
+
+        mgui_multi g(WIDTH, HEIGHT);
+        g.set_double_buffer(true);
+        g.input()->add(&read_turn);
+        g.add("main", (mgui_object*)&main);
+        g.add("status", (mgui_object*)&status);
+        g.select("main");
+        g.add_viewport("status", 120, 0, 8, 8);
+        g.add_viewport(nullptr, 0, 8, WIDTH, 56);
+
+        turn = 0;
+        g.update_lcd();
+        EXPECT_EQ(1, status.draws);
+        EXPECT_EQ(1, main.draws);
+
+        // only the selected group reads the input
+        for (int frame = 0; frame < 4; frame++) {
+            turn = 1 + frame;
+            g.update_lcd();
+            // both buffers hold the status bar
+            EXPECT_TRUE(lit(g.lcd(), 120, 0)) << frame;
+            EXPECT_TRUE(lit(g.lcd(), 0, 8)) << frame;
+        }
+        EXPECT_EQ(1, status.draws);
+        EXPECT_EQ(0, status.inputs);
+        EXPECT_EQ(5, main.draws);
+        EXPECT_EQ(5, main.inputs);
+
+        // without an input or a change nothing is drawn, but every frame is shown
+        turn = 0;
+        g.update_lcd();
+        EXPECT_TRUE(g.update_lcd());
+        EXPECT_EQ(6, main.draws);
+        EXPECT_TRUE(lit(g.lcd(), 120, 0));
+        EXPECT_TRUE(lit(g.lcd(), 0, 8));
+    }
+
+    TEST(ViewportTest, GrayAlignment) {
+        counted_box box(0, 0, 2, 2);
+        mgui_multi g(WIDTH, HEIGHT, mgui_pixel_format::Gray4);
+        g.add("box", (mgui_object*)&box);
+        EXPECT_EQ(-1, g.add_viewport("box", 3, 3, 10, 10));
+        EXPECT_EQ(-1, g.add_viewport("box", 4, 3, 9, 10));
+        ASSERT_EQ(0, g.add_viewport("box", 4, 3, 10, 10));
+        g.update_lcd();
+
+        const int stride = WIDTH / 2;
+        EXPECT_EQ(0x00, g.lcd()[2 * stride + 2]);
+        EXPECT_EQ(0xFF, g.lcd()[3 * stride + 2]);
+        EXPECT_EQ(0xFF, g.lcd()[4 * stride + 2]);
+        EXPECT_EQ(0x00, g.lcd()[5 * stride + 2]);
+        EXPECT_EQ(0x00, g.lcd()[3 * stride + 1]);
+        EXPECT_EQ(0x00, g.lcd()[3 * stride + 3]);
+    }
+}
+
+namespace Dialog {
+
+    // Moves to a group in its next update, like an input event handler.
+    class group_switch : public mgui_object {
+    public:
+        group_switch() : target(nullptr) {}
+
+        mgui_object_type type() const { return mgui_object_type::Pixel; }
+
+        void update(mgui_draw*, mgui_input_state*, mgui_string* current_group) {
+            if (target != nullptr) {
+                *current_group = target;
+                target = nullptr;
+            }
+        }
+
+        const char* target;
+    };
+
+    struct screen {
+        screen() : gui(WIDTH, HEIGHT), menu(0, 0, 60, 64), side(64, 8, 64, 8), other(0, 0, 4, 4) {
+            frame.set_width(64);
+            frame.set_height(24);
+            gui.add("confirm", (mgui_object*)&frame);
+            gui.add("confirm", (mgui_object*)&button);
+            gui.add("menu", (mgui_object*)&menu);
+            gui.add("menu", (mgui_object*)&side);
+            gui.add("other", (mgui_object*)&other);
+            gui.select("menu");
+        }
+
+        mgui_multi gui;
+        Viewport::counted_box menu;
+        Viewport::counted_box side;
+        mgui_rectangle frame;
+        group_switch button;
+        Viewport::counted_box other;
+    };
+
+    TEST(DialogTest, AreaIsRestored) {
+        screen s;
+        s.gui.set_adaptive_refresh(true);
+        EXPECT_TRUE(s.gui.update_lcd());
+        uint8_t menu[BUFFER_SIZE];
+        memcpy(menu, s.gui.lcd(), BUFFER_SIZE);
+
+        EXPECT_FALSE(s.gui.open_dialog("none", 32, 16, 64, 24));
+        EXPECT_FALSE(s.gui.open_dialog("confirm", 32, 12, 64, 24));
+        EXPECT_FALSE(s.gui.open_dialog("confirm", 80, 16, 64, 24));
+
+        const mgui_memory_stats before = mgui_memory::stats(mgui_memory_tag::Screen);
+        EXPECT_TRUE(s.gui.open_dialog("confirm", 32, 8, 64, 24));
+        EXPECT_FALSE(s.gui.open_dialog("confirm", 0, 0, 64, 24));
+        // two buffers of the dialog size
+        EXPECT_EQ(before.current + 2 * 64 * 3 + (long)sizeof(mgui_dialog) + (long)sizeof(mgui_draw),
+                  mgui_memory::stats(mgui_memory_tag::Screen).current);
+
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(1, s.menu.draws);
+        EXPECT_EQ(1ul, s.gui.dialog()->redraws());
+        // the frame of the dialog over the menu
+        EXPECT_EQ(0xFF, s.gui.lcd()[_byte_index(32, 8)]);
+        EXPECT_EQ(0x01, s.gui.lcd()[_byte_index(33, 8)]);
+        EXPECT_EQ(0x00, s.gui.lcd()[_byte_index(64, 16)]);
+        EXPECT_EQ(0xFF, s.gui.lcd()[_byte_index(31, 8)]);
+        EXPECT_EQ(0, memcmp(menu, s.gui.lcd(), WIDTH));
+        EXPECT_FALSE(s.gui.update_lcd());
+
+        s.gui.close_dialog();
+        EXPECT_EQ(nullptr, s.gui.dialog());
+        EXPECT_EQ(before.current, mgui_memory::stats(mgui_memory_tag::Screen).current);
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(1, s.menu.draws);
+        EXPECT_EQ(0, memcmp(menu, s.gui.lcd(), BUFFER_SIZE));
+        EXPECT_FALSE(s.gui.update_lcd());
+
+        // a handler of the dialog goes back to the menu
+        EXPECT_TRUE(s.gui.open_dialog("confirm", 32, 8, 64, 24));
+        s.gui.update_lcd();
+        s.button.target = "menu";
+        s.gui.invalidate("confirm");
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(nullptr, s.gui.dialog());
+        EXPECT_EQ(1, s.menu.draws);
+        EXPECT_EQ(0, memcmp(menu, s.gui.lcd(), BUFFER_SIZE));
+        EXPECT_FALSE(s.gui.update_lcd());
+    }
+
+    TEST(DialogTest, ChangedUnderTheDialog) {
+        screen s;
+        s.gui.set_adaptive_refresh(true);
+        s.gui.update_lcd();
+
+        // the menu changed while the dialog was open, so it is drawn on close
+        EXPECT_TRUE(s.gui.open_dialog("confirm", 0, 0, 64, 24));
+        s.gui.update_lcd();
+        s.gui.invalidate();
+        // only the dialog is drawn again, and it looks the same
+        EXPECT_FALSE(s.gui.update_lcd());
+        EXPECT_EQ(2ul, s.gui.dialog()->redraws());
+        EXPECT_EQ(1, s.menu.draws);
+        s.gui.close_dialog();
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(2, s.menu.draws);
+
+        // a handler of the dialog moves to another group, which is drawn at once
+        EXPECT_TRUE(s.gui.open_dialog("confirm", 0, 0, 64, 24));
+        s.gui.update_lcd();
+        s.button.target = "other";
+        s.gui.invalidate("confirm");
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(nullptr, s.gui.dialog());
+        EXPECT_TRUE(s.gui.selected() == "other");
+        EXPECT_EQ(1, s.other.draws);
+        EXPECT_EQ(2, s.menu.draws);
+        EXPECT_EQ(0x0F, s.gui.lcd()[0]);
+        EXPECT_EQ(0x00, s.gui.lcd()[4]);
+    }
+
+    TEST(DialogTest, DoubleBuffer) {
+        screen s;
+        s.gui.set_double_buffer(true);
+        s.gui.set_adaptive_refresh(true);
+        s.gui.update_lcd();
+        uint8_t menu[BUFFER_SIZE];
+        memcpy(menu, s.gui.lcd(), BUFFER_SIZE);
+
+        EXPECT_TRUE(s.gui.open_dialog("confirm", 64, 40, 64, 24));
+        for (int frame = 0; frame < 3; frame++) {
+            s.gui.invalidate("confirm");
+            EXPECT_TRUE(s.gui.update_lcd() || frame > 0) << frame;
+            // both buffers hold the menu under the dialog
+            EXPECT_EQ(0, memcmp(menu, s.gui.lcd(), 5 * WIDTH)) << frame;
+            EXPECT_EQ(0xFF, s.gui.lcd()[_byte_index(64, 40)]) << frame;
+        }
+        s.gui.close_dialog();
+        EXPECT_TRUE(s.gui.update_lcd());
+        EXPECT_EQ(1, s.menu.draws);
+        EXPECT_EQ(0, memcmp(menu, s.gui.lcd(), BUFFER_SIZE));
+    }
+}
+
+namespace Navigation {
+
+    TEST(NavigationTest, Grid) {
+        // 3 x 3 buttons, index = row * 3 + column
+        mgui_button buttons[9] = {
+            mgui_button(0, 0, 20, 10), mgui_button(30, 0, 20, 10), mgui_button(60, 0, 20, 10),
+            mgui_button(0, 20, 20, 10), mgui_button(30, 20, 20, 10), mgui_button(60, 20, 20, 10),
+            mgui_button(0, 40, 20, 10), mgui_button(30, 40, 20, 10), mgui_button(60, 40, 20, 10),
+        };
+        mgui_ui_group group;
+        for (mgui_button& button : buttons) {
+            group.add(&button);
+        }
+
+        EXPECT_TRUE(group.move_selection(mgui_direction::Right));
+        EXPECT_TRUE(group.move_selection(mgui_direction::Right));
+        EXPECT_EQ(2, group.get_selected_index());
+        EXPECT_FALSE(group.move_selection(mgui_direction::Right));
+        EXPECT_FALSE(group.move_selection(mgui_direction::Up));
+        EXPECT_TRUE(group.move_selection(mgui_direction::Down));
+        EXPECT_EQ(5, group.get_selected_index());
+        EXPECT_TRUE(group.move_selection(mgui_direction::Left));
+        EXPECT_EQ(4, group.get_selected_index());
+        EXPECT_TRUE(group.move_selection(mgui_direction::Down));
+        EXPECT_EQ(7, group.get_selected_index());
+        EXPECT_FALSE(group.move_selection(mgui_direction::Down));
+
+        EXPECT_TRUE(buttons[7].get_on_selected());
+        EXPECT_FALSE(buttons[4].get_on_selected());
+        EXPECT_FALSE(buttons[0].get_on_selected());
+
+        EXPECT_EQ(3, group.neighbor(0, mgui_direction::Down));
+        EXPECT_EQ(-1, group.neighbor(0, mgui_direction::Left));
+        EXPECT_EQ(-1, group.neighbor(9, mgui_direction::Left));
+    }
+
+    TEST(NavigationTest, OverlapBeforeDistance) {
+        mgui_button top_left(0, 0, 20, 10);
+        mgui_button top_right(60, 0, 20, 10);
+        mgui_button wide(0, 30, 80, 10);
+        mgui_button near_right(24, 12, 10, 10);
+        mgui_menu_item item;
+
+        mgui_ui_group group;
+        group.add(&top_left);
+        group.add(&top_right);
+        group.add(&wide);
+        group.add(&near_right);
+        group.add(&item);
+
+        // the wide button is under both; near_right is nearer but not under top_left
+        EXPECT_EQ(2, group.neighbor(0, mgui_direction::Down));
+        EXPECT_EQ(2, group.neighbor(1, mgui_direction::Down));
+        // up from the wide button, the nearest centre of those above it
+        EXPECT_EQ(3, group.neighbor(2, mgui_direction::Up));
+        // the button of the same row, though near_right is nearer
+        EXPECT_EQ(1, group.neighbor(0, mgui_direction::Right));
+        EXPECT_EQ(0, group.neighbor(3, mgui_direction::Left));
+        // an element without bounds is not reached and does not move
+        EXPECT_EQ(-1, group.neighbor(4, mgui_direction::Up));
+        for (int i = 0; i < 4; i++) {
+            for (int direction = 0; direction < 4; direction++) {
+                EXPECT_NE(4, group.neighbor(i, (mgui_direction)direction));
+            }
+        }
+    }
+
+    TEST(NavigationTest, LayoutChange) {
+        mgui_button left(0, 0, 20, 10);
+        mgui_button right(40, 0, 20, 10);
+        mgui_ui_group group;
+        group.add(&left);
+        group.add(&right);
+        EXPECT_EQ(1, group.neighbor(0, mgui_direction::Right));
+        EXPECT_EQ(-1, group.neighbor(0, mgui_direction::Down));
+
+        right.set_y(30);
+        right.set_x(0);
+        EXPECT_EQ(-1, group.neighbor(0, mgui_direction::Right));
+        EXPECT_EQ(1, group.neighbor(0, mgui_direction::Down));
+
+        mgui_button third(0, 15, 20, 10);
+        group.add(&third);
+        EXPECT_EQ(2, group.neighbor(0, mgui_direction::Down));
+        group.remove(&third);
+        EXPECT_EQ(1, group.neighbor(0, mgui_direction::Down));
+    }
+
+    TEST(NavigationTest, LargeGridIsALookup) {
+        const int side = 32;
+        std::vector<mgui_button*> buttons;
+        mgui_ui_group group;
+        for (int row = 0; row < side; row++) {
+            for (int column = 0; column < side; column++) {
+                buttons.push_back(new mgui_button(column * 12, row * 8, 10, 6));
+                group.add(buttons.back());
+            }
+        }
+
+        EXPECT_EQ(1, group.neighbor(0, mgui_direction::Right));
+        const mgui_memory_stats built = mgui_memory::stats(mgui_memory_tag::List);
+        for (int i = 0; i < side - 1; i++) {
+            ASSERT_TRUE(group.move_selection(mgui_direction::Right));
+            ASSERT_TRUE(group.move_selection(mgui_direction::Down));
+        }
+        EXPECT_EQ(side * side - 1, group.get_selected_index());
+        EXPECT_FALSE(group.move_selection(mgui_direction::Down));
+        EXPECT_TRUE(group.move_selection(mgui_direction::Left));
+        EXPECT_EQ(side * side - 2, group.get_selected_index());
+        // the table was not built again
+        EXPECT_EQ(built.allocations, mgui_memory::stats(mgui_memory_tag::List).allocations);
+
+        for (mgui_button* button : buttons) {
+            delete button;
+        }
+    }
+}
+
+namespace InputChannels {
+
+    enum panel { PANEL_KEYS, PANEL_ENCODER, PANEL_LEVEL, PANEL_CHANNELS };
+
+    static const mgui_input_channel PANEL[PANEL_CHANNELS] = {
+        { "keys", mgui_input_type::Buttons },
+        { "encoder", mgui_input_type::Encoder },
+        { "level", mgui_input_type::Analog },
+    };
+
+    // The pins of the simulated device: one register for the switches.
+    static unsigned int gpio = 0;
+    static int steps = 0;
+    static int level = 0;
+    static int reads = 0;
+    static int callbacks = 0;
+
+    static void read_panel(mgui_input_state result[], int) {
+        reads++;
+        result[PANEL_KEYS].value_1 = (int)(~gpio & 0x3u);
+        result[PANEL_ENCODER].value_1 = steps;
+        result[PANEL_LEVEL].value_1 = level;
+        steps = 0;
+    }
+
+    static void read_extra(mgui_input_state* result) {
+        callbacks++;
+        result->value_1 = 7;
+    }
+
+    TEST(InputChannelTest, ReaderAndCallbacks) {
+        gpio = 0x3;
+        steps = 0;
+        level = 512;
+        reads = 0;
+        callbacks = 0;
+
+        // the callback added first still comes after the channels
+        mgui_input input;
+        input.add(&read_extra);
+        input.set_reader(&read_panel, PANEL, PANEL_CHANNELS);
+        EXPECT_EQ(4, input.count());
+        EXPECT_EQ(3, input.channel_count());
+        EXPECT_EQ(PANEL_ENCODER, input.find("encoder"));
+        EXPECT_EQ(PANEL_LEVEL, input.find("level"));
+        EXPECT_EQ(-1, input.find("touch"));
+
+        input.update();
+        EXPECT_EQ(1, reads);
+        EXPECT_EQ(1, callbacks);
+        const mgui_input_state* state = input.get_input_result();
+        EXPECT_EQ(mgui_input_type::Buttons, state[PANEL_KEYS].type);
+        EXPECT_EQ(mgui_input_type::Encoder, state[PANEL_ENCODER].type);
+        EXPECT_EQ(mgui_input_type::Analog, state[PANEL_LEVEL].type);
+        EXPECT_EQ(mgui_input_type::Single, state[3].type);
+        EXPECT_EQ(512, state[PANEL_LEVEL].value_1);
+        EXPECT_EQ(7, state[3].value_1);
+
+        // the same level is not an input
+        input.remove(0);
+        EXPECT_EQ(3, input.count());
+        input.update();
+        input.update();
+        EXPECT_FALSE(input.active());
+        level = 513;
+        input.update();
+        EXPECT_TRUE(input.active());
+        input.update();
+        EXPECT_FALSE(input.active());
+
+        gpio = 0x1;
+        input.update();
+        EXPECT_TRUE(input.active());
+        EXPECT_FALSE(input.get_input_result()[PANEL_KEYS].button(0));
+        EXPECT_TRUE(input.get_input_result()[PANEL_KEYS].button(1));
+        EXPECT_EQ(6, reads);
+
+        input.set_reader(nullptr, nullptr, 0);
+        EXPECT_EQ(0, input.count());
+        EXPECT_EQ(-1, input.find("keys"));
+        input.update();
+        EXPECT_EQ(6, reads);
+    }
+
+    static void group_handler(mgui_ui_group* sender, const mgui_input_state state[], mgui_string*) {
+        sender->set_on_press(state[PANEL_KEYS].button(0));
+        sender->set_on_select_prev(state[PANEL_ENCODER].value_1 < 0);
+        sender->set_on_select_next(state[PANEL_ENCODER].value_1 > 0);
+    }
+
+    TEST(InputChannelTest, HandlerAndTrace) {
+        gpio = 0x3;
+        steps = 0;
+        level = 0;
+        reads = 0;
+
+        mgui_button first(0, 0, 20, 10), second(30, 0, 20, 10), third(60, 0, 20, 10);
+        mgui_ui_group group;
+        group.add(&first);
+        group.add(&second);
+        group.add(&third);
+        group.set_input_event_handler(&group_handler);
+
+        mgui_multi gui(WIDTH, HEIGHT);
+        gui.set_adaptive_refresh(true);
+        gui.input()->set_reader(&read_panel, PANEL, PANEL_CHANNELS);
+        gui.add("main", (mgui_object*)&group);
+        mgui_input_trace trace(PANEL_CHANNELS, 16);
+        gui.input()->set_recorder(&trace);
+
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_FALSE(gui.update_lcd());
+        steps = 2;
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_EQ(1, group.get_selected_index());
+        gpio = 0x2;
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_TRUE(second.get_on_press());
+        gpio = 0x3;
+        EXPECT_TRUE(gui.update_lcd());
+        EXPECT_FALSE(second.get_on_press());
+        // one read per frame for all the channels
+        EXPECT_EQ(5, reads);
+
+        // the trace has the typed states
+        gui.input()->set_recorder(nullptr);
+        EXPECT_EQ(5, trace.updates());
+        EXPECT_EQ(mgui_input_type::Encoder, trace.states(1)[PANEL_ENCODER].type);
+        EXPECT_EQ(2, trace.states(1)[PANEL_ENCODER].value_1);
+
+        group.set_selected_index(0);
+        first.set_on_selected(true);
+        second.set_on_selected(false);
+        gui.input()->set_player(&trace);
+        while (!gui.input()->finished()) {
+            gui.update_lcd();
+        }
+        EXPECT_EQ(1, group.get_selected_index());
+        EXPECT_EQ(5, reads);
+    }
+}
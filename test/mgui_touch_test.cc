@@ -0,0 +1,348 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "../mGUI/mgui_touch.h"
+#include "font_16x8.h"
+
+namespace TouchInput {
+
+    static unsigned long now = 0;
+
+    static unsigned long read_clock() {
+        return now;
+    }
+
+    static mgui_touch_sample touch(int x, int y, unsigned long time, int pressure = 40) {
+        return mgui_touch_sample::unpack(mgui_touch_sample::pack(x, y, pressure), time);
+    }
+
+    static mgui_touch_sample release(unsigned long time) {
+        return mgui_touch_sample::unpack(0, time);
+    }
+
+    TEST(TouchSample, PackAndUnpack) {
+        const int value = mgui_touch_sample::pack(319, 4095, 200);
+        EXPECT_GT(value, 0);
+        const mgui_touch_sample sample = mgui_touch_sample::unpack(value, 77);
+        EXPECT_EQ(319, sample.x);
+        EXPECT_EQ(4095, sample.y);
+        EXPECT_EQ(127, sample.pressure);
+        EXPECT_EQ(77u, sample.time);
+        EXPECT_TRUE(sample.down());
+
+        // not touched is 0, so an idle panel is not an active input
+        EXPECT_EQ(0, mgui_touch_sample::pack(10, 20, 0));
+        EXPECT_FALSE(mgui_touch_sample::unpack(0, 0).down());
+        EXPECT_STREQ("TouchController", mgui_object_type_name(mgui_object_type::TouchController));
+    }
+
+    TEST(GestureRecognizer, TapWithNoise) {
+        mgui_gesture_recognizer recognizer(6, 500);
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(release(0)).type);
+        EXPECT_EQ(mgui_gesture_type::Down, recognizer.update(touch(100, 50, 10)).type);
+        EXPECT_TRUE(recognizer.touching());
+        // within the slop
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(104, 47, 30)).type);
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(97, 56, 50)).type);
+        // the release is read far away
+        const mgui_gesture tap = recognizer.update(release(90));
+        EXPECT_EQ(mgui_gesture_type::Tap, tap.type);
+        EXPECT_EQ(97, tap.x);
+        EXPECT_EQ(56, tap.y);
+        EXPECT_EQ(80u, tap.duration);
+        EXPECT_FALSE(recognizer.touching());
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(release(100)).type);
+    }
+
+    TEST(GestureRecognizer, LongPress) {
+        mgui_gesture_recognizer recognizer(6, 500);
+        recognizer.update(touch(20, 20, 1000));
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(21, 20, 1499)).type);
+        EXPECT_EQ(mgui_gesture_type::LongPress, recognizer.update(touch(21, 21, 1500)).type);
+        // only once
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(21, 21, 2000)).type);
+        const mgui_gesture up = recognizer.update(release(2100));
+        EXPECT_EQ(mgui_gesture_type::Up, up.type);
+        EXPECT_EQ(1100u, up.duration);
+    }
+
+    TEST(GestureRecognizer, DragAndSwipe) {
+        mgui_gesture_recognizer recognizer(6, 500, 24, 250);
+        recognizer.update(touch(200, 100, 0));
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(196, 100, 10)).type);
+        mgui_gesture drag = recognizer.update(touch(190, 101, 20));
+        EXPECT_EQ(mgui_gesture_type::Drag, drag.type);
+        EXPECT_EQ(-10, drag.dx);
+        EXPECT_EQ(1, drag.dy);
+        EXPECT_TRUE(recognizer.dragging());
+        drag = recognizer.update(touch(160, 103, 40));
+        EXPECT_EQ(-30, drag.dx);
+        EXPECT_EQ(2, drag.dy);
+        // still
+        EXPECT_EQ(mgui_gesture_type::None, recognizer.update(touch(160, 103, 60)).type);
+        const mgui_gesture swipe = recognizer.update(release(80));
+        EXPECT_EQ(mgui_gesture_type::Swipe, swipe.type);
+        EXPECT_EQ(mgui_direction::Left, swipe.direction);
+        EXPECT_EQ(-40, swipe.dx);
+        EXPECT_EQ(3, swipe.dy);
+
+        // a slow drag is not a swipe
+        recognizer.update(touch(50, 50, 1000));
+        EXPECT_EQ(mgui_gesture_type::Drag, recognizer.update(touch(50, 100, 1100)).type);
+        EXPECT_EQ(mgui_gesture_type::Up, recognizer.update(release(1400)).type);
+
+        // a short one neither
+        recognizer.update(touch(50, 50, 2000));
+        EXPECT_EQ(mgui_gesture_type::Drag, recognizer.update(touch(50, 60, 2010)).type);
+        EXPECT_EQ(mgui_gesture_type::Up, recognizer.update(release(2020)).type);
+
+        recognizer.update(touch(50, 50, 3000));
+        recognizer.update(touch(52, 90, 3050));
+        const mgui_gesture down = recognizer.update(release(3100));
+        EXPECT_EQ(mgui_gesture_type::Swipe, down.type);
+        EXPECT_EQ(mgui_direction::Down, down.direction);
+    }
+
+    // Widgets of a scene: groups of buttons at pseudo-random places, some overlapping.
+    struct scene {
+        scene(int count, int groups_count) {
+            unsigned long seed = 12345;
+            for (int i = 0; i < groups_count; i++) {
+                groups.push_back(new mgui_ui_group());
+            }
+            for (int i = 0; i < count; i++) {
+                seed = seed * 1103515245 + 12345;
+                const int x = (int)((seed >> 8) % 320);
+                seed = seed * 1103515245 + 12345;
+                const int y = (int)((seed >> 8) % 240);
+                const int width = 4 + (int)((seed >> 20) % 24);
+                const int height = 4 + (int)((seed >> 26) % 16);
+                buttons.push_back(new mgui_button(x, y, width, height));
+                groups[i % groups_count]->add(buttons.back());
+            }
+        }
+
+        ~scene() {
+            for (mgui_ui_group* group : groups) {
+                delete group;
+            }
+            for (mgui_button* button : buttons) {
+                delete button;
+            }
+        }
+
+        // the last element containing the position, in the order of the grid
+        const mgui_core_ui* linear_hit(int x, int y) const {
+            const mgui_core_ui* found = nullptr;
+            for (const mgui_ui_group* group : groups) {
+                for (const mgui_list_node<mgui_core_ui*>* node = group->elements()->first(); node != nullptr; node = node->next) {
+                    const mgui_bounds bounds = node->obj->bounds();
+                    if (x >= bounds.x && x < bounds.x + bounds.width && y >= bounds.y && y < bounds.y + bounds.height) {
+                        found = node->obj;
+                    }
+                }
+            }
+            return found;
+        }
+
+        std::vector<mgui_ui_group*> groups;
+        std::vector<mgui_button*> buttons;
+    };
+
+    TEST(HitGrid, SameAsLinearScan) {
+        scene widgets(1000, 3);
+        mgui_hit_grid grid(320, 240, 16);
+        for (mgui_ui_group* group : widgets.groups) {
+            grid.add(group);
+        }
+        EXPECT_EQ(20, grid.columns());
+        EXPECT_EQ(15, grid.rows());
+
+        int hits = 0;
+        for (int y = 0; y < 240; y += 3) {
+            for (int x = 0; x < 320; x += 3) {
+                const mgui_hit* hit = grid.hit(x, y);
+                const mgui_core_ui* expected = widgets.linear_hit(x, y);
+                ASSERT_EQ(expected, hit != nullptr ? hit->item : nullptr) << x << " " << y;
+                if (hit != nullptr) {
+                    hits++;
+                    const mgui_list_node<mgui_core_ui*>* node = hit->group->elements()->first();
+                    for (int i = 0; i < hit->index; i++) {
+                        node = node->next;
+                    }
+                    ASSERT_EQ(hit->item, node->obj);
+                }
+            }
+        }
+        EXPECT_GT(hits, 0);
+        EXPECT_EQ(1000, grid.count());
+        EXPECT_GE(grid.entries(), 1000);
+        EXPECT_EQ(nullptr, grid.hit(-1, 0));
+        EXPECT_EQ(nullptr, grid.hit(320, 10));
+        EXPECT_EQ(nullptr, grid.hit(10, 240));
+    }
+
+    TEST(HitGrid, IndexAndLayoutChange) {
+        mgui_button first(0, 0, 40, 20), second(30, 10, 40, 20), other(100, 100, 10, 10);
+        mgui_menu_item item;
+        mgui_ui_group group, top;
+        group.add(&first);
+        group.add(&item);
+        group.add(&second);
+        top.add(&other);
+
+        mgui_hit_grid grid(128, 128, 8);
+        grid.add(&group);
+        grid.add(&top);
+        const mgui_hit* hit = grid.hit(35, 15);
+        ASSERT_NE(nullptr, hit);
+        // the later one is on top, and the element without bounds is counted in the index
+        EXPECT_EQ(&second, hit->item);
+        EXPECT_EQ(&group, hit->group);
+        EXPECT_EQ(2, hit->index);
+        EXPECT_EQ(&first, grid.hit(5, 5)->item);
+        EXPECT_EQ(&top, grid.hit(105, 105)->group);
+        EXPECT_EQ(0, grid.hit(105, 105)->index);
+        EXPECT_EQ(nullptr, grid.hit(90, 90));
+        EXPECT_EQ(3, grid.count());
+
+        // no allocation while nothing changes
+        const mgui_memory_stats built = mgui_memory::stats(mgui_memory_tag::Input);
+        for (int i = 0; i < 100; i++) {
+            grid.hit(i, i);
+        }
+        EXPECT_EQ(built.allocations, mgui_memory::stats(mgui_memory_tag::Input).allocations);
+
+        // moved partly out of the screen
+        other.set_x(120);
+        EXPECT_EQ(nullptr, grid.hit(105, 105));
+        EXPECT_EQ(&other, grid.hit(127, 105)->item);
+
+        grid.remove(&top);
+        EXPECT_EQ(nullptr, grid.hit(127, 105));
+        grid.clear();
+        EXPECT_EQ(nullptr, grid.hit(5, 5));
+        EXPECT_EQ(0, grid.count());
+    }
+
+    static std::vector<mgui_gesture_type> events;
+
+    static void record_gesture(mgui_touch_controller*, const mgui_gesture& gesture, mgui_string*) {
+        events.push_back(gesture.type);
+    }
+
+    // Adds the touch states of the frames from..to (time 10 per frame) to the trace.
+    static void add_touch(mgui_input_trace* trace, int frames, int x, int y, int pressure) {
+        mgui_input_state state = { mgui_input_type::Touch, mgui_touch_sample::pack(x, y, pressure) };
+        trace->add(0, frames, &state);
+    }
+
+    TEST(TouchController, PressAndSelectFromTrace) {
+        mgui_button buttons[4] = {
+            mgui_button(0, 0, 60, 30), mgui_button(64, 0, 60, 30),
+            mgui_button(0, 34, 60, 30), mgui_button(64, 34, 60, 30),
+        };
+        mgui_ui_group group;
+        for (mgui_button& button : buttons) {
+            group.add(&button);
+        }
+        mgui_hit_grid grid(128, 64);
+        grid.add(&group);
+        mgui_touch_controller controller(&grid, 0, &read_clock, mgui_gesture_recognizer(6, 300));
+        controller.set_gesture_handler(&record_gesture);
+        events.clear();
+
+        mgui_multi gui(128, 64);
+        gui.add("main", (mgui_object*)&controller);
+        gui.add("main", (mgui_object*)&group);
+
+        mgui_input_trace trace(1, 16);
+        add_touch(&trace, 2, 0, 0, 0);
+        add_touch(&trace, 3, 90, 50, 30);   // tap the last button
+        add_touch(&trace, 2, 0, 0, 0);
+        add_touch(&trace, 40, 70, 10, 30);  // long press of the second
+        add_touch(&trace, 1, 0, 0, 0);
+        add_touch(&trace, 1, 10, 10, 30);   // drag from the first
+        add_touch(&trace, 1, 30, 12, 30);
+        add_touch(&trace, 1, 0, 0, 0);
+        gui.input()->set_player(&trace);
+
+        std::vector<int> selected;
+        std::vector<bool> pressed;
+        for (now = 0; !gui.input()->finished(); now += 10) {
+            gui.update_lcd();
+            selected.push_back(group.get_selected_index());
+            pressed.push_back(controller.pressed());
+        }
+        ASSERT_EQ(51u, selected.size());
+
+        EXPECT_EQ(0, selected[1]);
+        EXPECT_EQ(3, selected[2]);
+        EXPECT_TRUE(pressed[2]);
+        EXPECT_TRUE(pressed[4]);
+        EXPECT_FALSE(pressed[5]);
+        EXPECT_FALSE(buttons[3].get_on_press());
+
+        // held for 300 and more: still pressed
+        EXPECT_EQ(1, selected[7]);
+        EXPECT_TRUE(pressed[46]);
+        EXPECT_FALSE(pressed[47]);
+        EXPECT_FALSE(buttons[3].get_on_selected());
+
+        // the drag cancels the press, the selection stays
+        EXPECT_TRUE(pressed[48]);
+        EXPECT_FALSE(pressed[49]);
+        EXPECT_EQ(0, selected[50]);
+        EXPECT_FALSE(buttons[0].get_on_press());
+
+        const std::vector<mgui_gesture_type> expected = {
+            mgui_gesture_type::Down, mgui_gesture_type::Tap,
+            mgui_gesture_type::Down, mgui_gesture_type::LongPress, mgui_gesture_type::Up,
+            mgui_gesture_type::Down, mgui_gesture_type::Drag, mgui_gesture_type::Up,
+        };
+        EXPECT_EQ(expected, events);
+        EXPECT_EQ(&buttons[0], controller.target()->item);
+
+        // nothing touched
+        EXPECT_EQ(mgui_gesture_type::Down, controller.feed(touch(126, 62, now)).type);
+        EXPECT_EQ(nullptr, controller.target());
+        EXPECT_FALSE(controller.pressed());
+        EXPECT_EQ(0, group.get_selected_index());
+    }
+
+    TEST(TouchController, DragScrollsMenu) {
+        font_16x8 font;
+        const char* names[] = { "Item 1", "Item 2", "Item 3", "Item 4", "Item 5", "Item 6" };
+        std::vector<mgui_text*> texts;
+        std::vector<mgui_menu_item*> items;
+        mgui_menu menu(128, 64);
+        for (int i = 0; i < 6; i++) {
+            texts.push_back(new mgui_text(&font, names[i]));
+            items.push_back(new mgui_menu_item(texts[i]));
+            menu.add(items[i]);
+        }
+
+        // no grid: only the gestures
+        mgui_touch_controller controller(nullptr);
+        controller.set_scroll_target(&menu, 16);
+        controller.feed(touch(60, 60, 0));
+        controller.feed(touch(60, 50, 1));
+        EXPECT_EQ(0, menu.selected_index());
+        controller.feed(touch(60, 40, 2));
+        EXPECT_EQ(1, menu.selected_index());
+        // 50 up in one sample
+        controller.feed(touch(60, 0, 3));
+        EXPECT_EQ(3, menu.selected_index());
+        // back down by 34: the 12 left over and one step
+        controller.feed(touch(60, 34, 4));
+        EXPECT_EQ(2, menu.selected_index());
+        EXPECT_EQ(mgui_gesture_type::Up, controller.feed(release(600)).type);
+        EXPECT_EQ(nullptr, controller.target());
+
+        for (size_t i = 0; i < items.size(); i++) {
+            delete items[i];
+            delete texts[i];
+        }
+    }
+}
@@ -0,0 +1,197 @@
+// Built with MGUI_TRACE as a separate program (see CMakeLists.txt).
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../mGUI/mgui_host_transport.h"
+#include "font_16x8.h"
+
+namespace Trace {
+
+    static int encoder = 0;
+
+    static void read_encoder(mgui_input_state* result) {
+        result->type = mgui_input_type::Single;
+        result->value_1 = encoder;
+    }
+
+    static int count(const std::vector<mgui_trace_record>& records, const std::string& name) {
+        int n = 0;
+        for (const mgui_trace_record& r : records) {
+            if (name == r.event.name) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    static const mgui_trace_event* find(const std::vector<mgui_trace_record>& records, const std::string& name) {
+        for (const mgui_trace_record& r : records) {
+            if (name == r.event.name) {
+                return &r.event;
+            }
+        }
+        return nullptr;
+    }
+
+    // b runs within a
+    static bool inside(const mgui_trace_event* a, const mgui_trace_event* b) {
+        return a->start_ns <= b->start_ns
+            && b->start_ns + b->duration_ns <= a->start_ns + a->duration_ns;
+    }
+
+    TEST(Trace, ObjectTypeNames) {
+        EXPECT_STREQ("Rectangle", mgui_object_type_name(mgui_object_type::Rectangle));
+        EXPECT_STREQ("Text", mgui_object_type_name(mgui_object_type::Text));
+        EXPECT_STREQ("UiGroup", mgui_object_type_name(mgui_object_type::UiGroup));
+    }
+
+    TEST(Trace, Frame) {
+        mgui_tracer& tracer = mgui_tracer::instance();
+        tracer.clear();
+
+        font_16x8 font;
+        mgui gui(128, 64);
+        mgui_input input;
+        input.add(&read_encoder);
+        gui.set_input(&input);
+        mgui_rectangle rect;
+        rect.set_width(20);
+        rect.set_height(10);
+        mgui_text text(&font, "trace");
+        gui.add((mgui_object*)&rect);
+        gui.add((mgui_object*)&text);
+
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        mgui_ssd1306 display(128, 64, &sim);
+        display.init();
+        for (int i = 0; i < 3; i++) {
+            gui.update_lcd();
+            display.transfer(gui.lcd());
+        }
+
+        const std::vector<mgui_trace_record> records = tracer.drain();
+        EXPECT_EQ(3, count(records, "update_lcd"));
+        EXPECT_EQ(3, count(records, "clear"));
+        EXPECT_EQ(3, count(records, "Rectangle"));
+        EXPECT_EQ(3, count(records, "Text"));
+        EXPECT_EQ(3, count(records, "input"));
+        EXPECT_EQ(3, count(records, "callback"));
+        EXPECT_EQ(3, count(records, "transfer"));
+
+        const mgui_trace_event* frame = find(records, "update_lcd");
+        ASSERT_NE(nullptr, frame);
+        EXPECT_STREQ("frame", frame->category);
+        EXPECT_TRUE(inside(frame, find(records, "Rectangle")));
+        EXPECT_TRUE(inside(frame, find(records, "Text")));
+        EXPECT_TRUE(inside(find(records, "input"), find(records, "callback")));
+        EXPECT_STREQ("object", find(records, "Text")->category);
+        EXPECT_FALSE(inside(frame, find(records, "transfer")));
+
+        // drained
+        EXPECT_TRUE(tracer.drain().empty());
+    }
+
+    TEST(Trace, Disabled) {
+        mgui_tracer& tracer = mgui_tracer::instance();
+        tracer.clear();
+        tracer.set_enabled(false);
+
+        mgui gui(128, 64);
+        gui.update_lcd();
+        EXPECT_TRUE(tracer.drain().empty());
+
+        tracer.set_enabled(true);
+        gui.update_lcd();
+        EXPECT_EQ(1, count(tracer.drain(), "update_lcd"));
+    }
+
+    TEST(Trace, Threads) {
+        mgui_tracer& tracer = mgui_tracer::instance();
+        tracer.clear();
+
+        mgui_display_simulator sim(mgui_display_controller::SSD1306, 128, 64);
+        {
+            mgui_thread_transport transport(&sim);
+            mgui_async_bus bus(&transport);
+            mgui_ssd1306 display(128, 64, &bus);
+            display.init();
+
+            mgui gui(128, 64);
+            gui.update_lcd();
+            display.transfer(gui.lcd());
+            bus.wait();
+        }
+
+        const std::vector<mgui_trace_record> records = tracer.drain();
+        const mgui_trace_record* wire = nullptr;
+        const mgui_trace_record* frame = nullptr;
+        for (const mgui_trace_record& r : records) {
+            if (std::string("wire data") == r.event.name) wire = &r;
+            if (std::string("update_lcd") == r.event.name) frame = &r;
+        }
+        ASSERT_NE(nullptr, wire);
+        ASSERT_NE(nullptr, frame);
+        EXPECT_NE(wire->thread, frame->thread);
+        EXPECT_GE(count(records, "wire command"), 1);
+        EXPECT_GE(count(records, "wait"), 1);
+    }
+
+    TEST(Trace, Overflow) {
+        mgui_tracer& tracer = mgui_tracer::instance();
+        tracer.clear();
+        tracer.set_capacity(4);
+
+        // the buffer of a new thread is small
+        std::thread worker([] {
+            for (int i = 0; i < 10; i++) {
+                MGUI_TRACE_SCOPE("test", "event");
+            }
+        });
+        worker.join();
+        tracer.set_capacity(MGUI_TRACE_CAPACITY);
+
+        EXPECT_EQ(4, count(tracer.drain(), "event"));
+        EXPECT_EQ(6, tracer.dropped());
+        tracer.clear();
+        EXPECT_EQ(0, tracer.dropped());
+    }
+
+    TEST(Trace, ChromeJson) {
+        mgui_tracer& tracer = mgui_tracer::instance();
+        tracer.clear();
+
+        std::thread worker([] {
+            mgui_tracer::instance().set_thread_name("renderer \"2\"");
+            MGUI_TRACE_SCOPE("test", "work");
+        });
+        worker.join();
+        {
+            MGUI_TRACE_SCOPE("test", "main work");
+        }
+
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        ASSERT_TRUE(tracer.flush(file));
+        rewind(file);
+        std::string json;
+        char chunk[256];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            json.append(chunk, n);
+        }
+        fclose(file);
+
+        EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+        EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"renderer \\\"2\\\"\"}"));
+        EXPECT_NE(std::string::npos, json.find("{\"name\":\"work\",\"cat\":\"test\",\"ph\":\"X\",\"ts\":"));
+        EXPECT_NE(std::string::npos, json.find("{\"name\":\"main work\",\"cat\":\"test\",\"ph\":\"X\""));
+        EXPECT_NE(std::string::npos, json.find("\"displayTimeUnit\":\"ns\"}"));
+        // no trailing comma before the end of the array
+        EXPECT_EQ(std::string::npos, json.find(",\n]"));
+    }
+}